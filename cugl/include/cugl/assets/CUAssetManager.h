@@ -52,6 +52,9 @@
 #include <cugl/assets/CULoader.h>
 #include <typeinfo>
 #include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
 
 
 namespace cugl {
@@ -89,8 +92,19 @@ private:
 protected:
     /** The individual loaders for each type */
     std::unordered_map<size_t,std::shared_ptr<BaseLoader>> _handlers;
-    /** The central thread for managing all of the loaders */
+    /** The central thread for reading directories and ordered loaders */
     std::shared_ptr<ThreadPool> _workers;
+    /** The threads shared by the loaders that can preload in parallel */
+    std::shared_ptr<ThreadPool> _decoders;
+
+    /** The materialize steps waiting for the main thread */
+    std::deque<std::function<void()>> _uploads;
+    /** A mutex lock for the upload queue */
+    std::mutex _uploadMutex;
+    /** Whether a scheduled callback is draining the upload queue */
+    bool _uploading;
+    /** The time the upload queue may take each animation frame, in microseconds */
+    Uint32 _uploadBudget;
 
     /** State variable to manage reading JSON directories */
     bool _preload;
@@ -98,6 +112,54 @@ protected:
     /** Wait variable to create a load barrier for directories. */
     std::atomic<bool> _wait;
 
+    /** A list of assets, as pairs of asset type hash and key */
+    typedef std::vector<std::pair<size_t,std::string>> AssetList;
+
+    /**
+     * A named collection of assets, loaded and unloaded as a whole.
+     *
+     * A group is loaded once for each time {@link loadGroup} is called with
+     * its name, and its assets are released when it has been unloaded the
+     * same number of times.
+     */
+    struct Group {
+        /** The name of the group */
+        std::string name;
+        /** The JSON asset directory of the group */
+        std::shared_ptr<JsonValue> directory;
+        /** The number of loads of this group not yet matched by an unload */
+        int references;
+        /** The number of assets of this group still loading asynchronously */
+        size_t pending;
+        /** Whether every asset of this group loaded successfully */
+        bool success;
+        /** The callbacks waiting for this group to finish loading */
+        std::vector<LoaderCallback> callbacks;
+    };
+
+    /**
+     * The groups holding an asset.
+     *
+     * An asset is unloaded when the last group holding it is unloaded, but
+     * only if a group loaded it. Assets that were already present when the
+     * first group asked for them belong to whoever loaded them.
+     */
+    struct Hold {
+        /** The number of loaded groups holding this asset */
+        int references;
+        /** Whether a group loaded this asset (and may unload it) */
+        bool owned;
+        /** Whether this asset is still loading asynchronously */
+        bool loading;
+        /** The groups waiting for this asset to finish loading */
+        std::vector<std::shared_ptr<Group>> waiting;
+    };
+
+    /** The loaded groups, by name */
+    std::unordered_map<std::string,std::shared_ptr<Group>> _groups;
+    /** The assets held by groups, by asset type hash and then by key */
+    std::unordered_map<size_t,std::unordered_map<std::string,Hold>> _holds;
+
     /**
      * Synchronously reads an asset category from a JSON file
      *
@@ -154,9 +216,10 @@ protected:
      * @param hash      The hash of the asset type
      * @param json      The child of asset directory with these assets
      * @param callback  An optional callback after each asset is loaded
+     * @param queued    The list to append the queued assets to
      */
     void readCategory(size_t hash, const std::shared_ptr<JsonValue>& json,
-                      LoaderCallback callback);
+                      LoaderCallback callback, AssetList& queued);
     
     /**
      * Immediately removes an asset category previously loaded from the JSON file
@@ -173,14 +236,128 @@ protected:
     bool purgeCategory(size_t hash, const std::shared_ptr<JsonValue>& json);
 
     /**
-     * Synchronizes the asset manager to wait until all assets have finished.
+     * Returns the hash of the asset type for a category of an asset directory.
+     *
+     * The category names are the ones listed in {@link loadDirectory}.
+     *
+     * @param category  The name of the asset category
+     *
+     * @return the hash of the asset type, or 0 if the category is unknown.
+     */
+    static size_t categoryHash(const std::string& category);
+
+    /**
+     * Acquires the assets of a group directory, loading those not yet present.
+     *
+     * Each asset in the directory gains a hold.  An asset is only loaded on
+     * its first hold, and only if no loader has it already.  In asynchronous
+     * mode the group waits for every asset still loading, including the ones
+     * that another group started, and scene graphs are loaded after every
+     * other asset has been materialized.
+     *
+     * @param group The group to acquire the assets for
+     * @param async Whether to load the assets asynchronously
+     *
+     * @return true if every asset is (or is being) loaded.
+     */
+    bool acquireGroup(const std::shared_ptr<Group>& group, bool async);
+
+    /**
+     * Acquires a single asset for a group, loading it if necessary.
+     *
+     * This is a helper for {@link acquireGroup}. An asset that is loading
+     * outside of groups is not loaded again. An asynchronous group waits for
+     * it instead, while a synchronous group fails.
+     *
+     * @param hash  The hash of the asset type
+     * @param json  The directory entry of the asset
+     * @param group The group to acquire the asset for
+     * @param async Whether to load the asset asynchronously
+     *
+     * @return true if the asset is (or is being) loaded.
+     */
+    bool acquireAsset(size_t hash, const std::shared_ptr<JsonValue>& json,
+                      const std::shared_ptr<Group>& group, bool async);
+
+    /**
+     * Records that an asynchronously loaded asset of a group has finished.
+     *
+     * Every group waiting on the asset is notified. If a group loaded the
+     * asset, it is unloaded right away when all of its groups were unloaded
+     * while it was loading.
+     *
+     * @param hash      The hash of the asset type
+     * @param key       The asset key
+     * @param success   Whether the asset loaded successfully
+     */
+    void finishAsset(size_t hash, const std::string& key, bool success);
+
+    /**
+     * Records that a group has one less asset loading asynchronously.
+     *
+     * When no asset is left, the callbacks of the group are called, unless
+     * the group has been unloaded in the meantime.
+     *
+     * @param group     The group waiting on the asset
+     * @param success   Whether the asset loaded successfully
+     */
+    void finishGroup(const std::shared_ptr<Group>& group, bool success);
+
+    /**
+     * Releases the holds of a group, unloading the assets no group holds.
+     *
+     * @param group The group to release the assets for
+     *
+     * @return true if all of the released assets were unloaded.
+     */
+    bool releaseGroup(const std::shared_ptr<Group>& group);
+
+    /**
+     * Synchronizes the asset manager to wait until the given assets have finished.
      *
      * This method is necessary for assets whose construction depends on
-     * previously loaded assets (e.g. scene graphs).  In the current architecture,
-     * this method is only correct if the asset manager loads assets in a
-     * single thread.
+     * previously loaded assets (e.g. scene graphs).  Assets queued on the
+     * directory thread after a sync are not loaded until the given assets,
+     * including the ones preloading on the decoding threads, have been
+     * materialized.  Other assets still decoding, such as the prefetch of
+     * another group, do not hold up the sync.
+     *
+     * @param assets    The assets to wait for
+     */
+    void sync(const AssetList& assets);
+
+    /**
+     * Blocks the calling thread until none of the given assets is left to
+     * load in the parallel loaders.
+     *
+     * This method is used to implement the {@link sync()} method.  It must
+     * not be called in the main thread.
+     *
+     * @param assets    The assets to wait for
+     */
+    void drain(const AssetList& assets);
+
+    /**
+     * Returns true if any of the given assets is still loading in the
+     * parallel loaders.
+     *
+     * This method must be called in the main thread.
+     *
+     * @param assets    The assets to check
+     *
+     * @return true if any of the given assets is still loading in the parallel loaders.
      */
-    void sync();
+    bool isDecoding(const AssetList& assets) const;
+
+    /**
+     * Runs queued materialize steps until the upload budget is spent.
+     *
+     * This method is scheduled in the main thread while the upload queue is
+     * not empty.
+     *
+     * @return true if steps remain for the next animation frame.
+     */
+    bool processUploads();
     
     /**
      * Blocks the asset manager until the next animation frame.
@@ -210,7 +387,7 @@ public:
      * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate an asset 
      * manager on the heap, use one of the static constructors instead.
      */
-    AssetManager() : _preload(false), _wait(false) {}
+    AssetManager() : _uploading(false), _uploadBudget(DEFAULT_UPLOAD_BUDGET), _preload(false), _wait(false) {}
     
     /**
      * Deletes this asset manager, disposing of all resources.
@@ -227,11 +404,13 @@ public:
     void dispose();
 
     /**
-     * Initializes a new asset manager with two auxiliary threads.
+     * Initializes a new asset manager with a thread per core.
      *
-     * The asset manager will have a thread pool of size 2, giving it two 
-     * threads to load assets asynchronously.  These threads have no effect on 
-     * synchronous loading and will sleep when no assets are being loaded.
+     * The asset manager will have one thread to read asset directories, and
+     * one decoding thread per core beyond the main thread.  Textures, sounds
+     * and JSON files are decoded in parallel on the decoding threads.  These
+     * threads have no effect on synchronous loading and will sleep when no
+     * assets are being loaded.
      *
      * This initializer does not attach any loaders.  It simply creates an 
      * object that is ready to accept loader objects.
@@ -240,63 +419,62 @@ public:
      */
     bool init();
 
-    //
-    // Initializes a new asset manager with the given number of auxiliary threads.
-    //
-    // The asset manager will have a thread pool of the given size, allowing it
-    // load assets asynchronously.  These threads have no effect on synchronous
-    // loading and will sleep when no assets are being loaded.  If threads is
-    // 0, all assets must be loaded synchronously.
-    //
-    // This initializer does not attach any loaders.  It simply creates an
-    // object that is ready to accept loader objects.
-    //
-    // @param threads   The number of threads for asynchronous loading
-    //
-    // @return true if the asset manager was initialized successfully
-    //
-    // TODO: This class must be refactored for this to be safe to use.
-    // bool init(unsigned int threads);
+    /**
+     * Initializes a new asset manager with the given number of decoding threads.
+     *
+     * The asset manager will have one thread to read asset directories, and
+     * the given number of decoding threads for the loaders that can preload
+     * in parallel.  If threads is 0, every loader uses the directory thread,
+     * so assets are decoded one at a time.  These threads have no effect on
+     * synchronous loading and will sleep when no assets are being loaded.
+     *
+     * This initializer does not attach any loaders.  It simply creates an
+     * object that is ready to accept loader objects.
+     *
+     * @param threads   The number of decoding threads
+     *
+     * @return true if the asset manager was initialized successfully
+     */
+    bool init(unsigned int threads);
     
 #pragma mark -
 #pragma mark Static Constructors
     /**
-     * Returns a newly allocated asset manager with two auxiliary threads.
+     * Returns a newly allocated asset manager with a thread per core.
      *
-     * The asset manager will have a thread pool of size 2, giving it two
-     * threads to load assets asynchronously.  These threads have no effect on
-     * synchronous loading and will sleep when no assets are being loaded.
+     * The asset manager will have one thread to read asset directories, and
+     * one decoding thread per core beyond the main thread.  These threads
+     * have no effect on synchronous loading and will sleep when no assets are
+     * being loaded.
      *
      * This constructor does not attach any loaders.  It simply creates an
      * object that is ready to accept loader objects.
      *
-     * @return a newly allocated asset manager with two auxiliary threads.
+     * @return a newly allocated asset manager with a thread per core.
      */
     static std::shared_ptr<AssetManager> alloc() {
         std::shared_ptr<AssetManager> result = std::make_shared<AssetManager>();
         return (result->init() ? result : nullptr);
     }
     
-    //
-    // Returns a newly allocated asset manager with the given number of auxiliary threads.
-    //
-    // The asset manager will have a thread pool of the given size, allowing it
-    // load assets asynchronously.  These threads have no effect on synchronous
-    // loading and will sleep when no assets are being loaded.  If threads is
-    // 0, all assets must be loaded synchronously.
-    //
-    // This constructor does not attach any loaders.  It simply creates an
-    // object that is ready to accept loader objects.
-    //
-    // @param threads   The number of threads for asynchronous loading
-    //
-    // @return a newly allocated asset manager with the given number of auxiliary threads.
-    //
-    // TODO: This class must be refactored for this to be safe to use.
-    // static std::shared_ptr<AssetManager> alloc(unsigned int threads) {
-    //     std::shared_ptr<AssetManager> result = std::make_shared<AssetManager>();
-    //     return (result->init(threads) ? result : nullptr);
-    // }
+    /**
+     * Returns a newly allocated asset manager with the given number of decoding threads.
+     *
+     * The asset manager will have one thread to read asset directories, and
+     * the given number of decoding threads for the loaders that can preload
+     * in parallel.  If threads is 0, every loader uses the directory thread.
+     *
+     * This constructor does not attach any loaders.  It simply creates an
+     * object that is ready to accept loader objects.
+     *
+     * @param threads   The number of decoding threads
+     *
+     * @return a newly allocated asset manager with the given number of decoding threads.
+     */
+    static std::shared_ptr<AssetManager> alloc(unsigned int threads) {
+        std::shared_ptr<AssetManager> result = std::make_shared<AssetManager>();
+        return (result->init(threads) ? result : nullptr);
+    }
 
 #pragma mark -
 #pragma mark Loader Management
@@ -320,7 +498,8 @@ public:
             return false;
         }
         
-        loader->setThreadPool(_workers);
+        bool parallel = loader->isThreadSafe() && _decoders != nullptr;
+        loader->setThreadPool(parallel ? _decoders : _workers);
         _handlers[hash] = loader;
         loader->setManager(this);
         return true;
@@ -393,6 +572,49 @@ public:
         return std::dynamic_pointer_cast<Loader<T>>(it->second);
     }
     
+#pragma mark -
+#pragma mark Upload Budget
+    /** The default time the upload queue may take each frame, in microseconds */
+    static const Uint32 DEFAULT_UPLOAD_BUDGET = 4000;
+
+    /**
+     * Returns the time the upload queue may take each animation frame.
+     *
+     * Asynchronous loads finish with a materialize step in the main thread,
+     * which for textures and fonts uploads data to the GPU.  These steps are
+     * queued, and each animation frame only runs them until this budget is
+     * spent, so that a large directory does not stall the frame rate.  At
+     * least one step runs every frame.
+     *
+     * @return the time the upload queue may take each frame, in microseconds
+     */
+    Uint32 getUploadBudget() const { return _uploadBudget; }
+
+    /**
+     * Sets the time the upload queue may take each animation frame.
+     *
+     * Asynchronous loads finish with a materialize step in the main thread,
+     * which for textures and fonts uploads data to the GPU.  These steps are
+     * queued, and each animation frame only runs them until this budget is
+     * spent, so that a large directory does not stall the frame rate.  At
+     * least one step runs every frame.
+     *
+     * @param micros    The time the upload queue may take each frame, in microseconds
+     */
+    void setUploadBudget(Uint32 micros) { _uploadBudget = micros; }
+
+    /**
+     * Queues the materialize step of an asynchronous load.
+     *
+     * The step runs in the main thread, in queue order, within the upload
+     * budget of a later animation frame.  Loaders call this through
+     * {@link BaseLoader#scheduleUpload}.  This method may be called from any
+     * thread.
+     *
+     * @param task  The materialize step
+     */
+    void upload(const std::function<void()>& task);
+
 #pragma mark -
 #pragma mark Progress Monitoring
     /**
@@ -778,6 +1000,8 @@ public:
         for(auto it = _handlers.begin(); it != _handlers.end(); ++it) {
             it->second->unloadAll();
         }
+        _groups.clear();
+        _holds.clear();
     }
     
 #pragma mark -
@@ -830,6 +1054,10 @@ public:
      * can.  If any asset fails to load, it will return false.  However, some
      * assets may still be loaded and safe to access.
      *
+     * If the directory has a baked copy (see {@link JsonLoader#getBakedPath}),
+     * that copy is read instead of the text file. This is also true of the
+     * other methods that take the path to a directory.
+     *
      * @param directory The path to the JSON asset directory
      *
      * @return true if all assets specified in the directory were successfully loaded.
@@ -1007,6 +1235,153 @@ public:
         return unloadDirectory(std::string(directory));
     }
 
+#pragma mark -
+#pragma mark Group Support
+    /**
+     * Synchronously loads the assets of a directory as a named group.
+     *
+     * Groups let a game keep only the assets of the current scene (or level,
+     * or biome) in memory.  A group is an asset directory in the format of
+     * {@link loadDirectory}, and it is reference counted: every call to this
+     * method must be matched by a call to {@link unloadGroup} with the same
+     * name.  If the group is already loaded, this method only adds to its
+     * count and the directory is ignored.
+     *
+     * Groups may share assets.  Each asset is loaded by the first group that
+     * needs it and unloaded with the last group holding it.  An asset that
+     * was loaded outside of groups (e.g. by {@link loadDirectory}) is never
+     * unloaded by a group.
+     *
+     * This method does not wait for assets that another group is still
+     * loading asynchronously.  It returns false in that case, as it does if
+     * any asset fails to load.
+     *
+     * @param name  The name of the group
+     * @param json  The JSON asset directory of the group
+     *
+     * @return true if all assets of the group were successfully loaded.
+     */
+    bool loadGroup(const std::string& name, const std::shared_ptr<JsonValue>& json);
+
+    /**
+     * Synchronously loads the assets of a directory as a named group.
+     *
+     * Groups let a game keep only the assets of the current scene (or level,
+     * or biome) in memory.  A group is an asset directory in the format of
+     * {@link loadDirectory}, and it is reference counted: every call to this
+     * method must be matched by a call to {@link unloadGroup} with the same
+     * name.  If the group is already loaded, this method only adds to its
+     * count and the directory is not read.
+     *
+     * Groups may share assets.  Each asset is loaded by the first group that
+     * needs it and unloaded with the last group holding it.  An asset that
+     * was loaded outside of groups (e.g. by {@link loadDirectory}) is never
+     * unloaded by a group.
+     *
+     * This method does not wait for assets that another group is still
+     * loading asynchronously.  It returns false in that case, as it does if
+     * any asset fails to load.
+     *
+     * @param name      The name of the group
+     * @param directory The path to the JSON asset directory of the group
+     *
+     * @return true if all assets of the group were successfully loaded.
+     */
+    bool loadGroup(const std::string& name, const std::string& directory);
+
+    /**
+     * Asynchronously loads the assets of a directory as a named group.
+     *
+     * This is the asynchronous version of {@link loadGroup}, and the way to
+     * prefetch the group of the next scene while the current one plays.  The
+     * group counts as loaded as soon as this method returns, so it must be
+     * matched by a call to {@link unloadGroup} like a synchronous load.  Use
+     * {@link isGroupLoaded} or the callback to know when its assets are safe
+     * to access.  If the group is unloaded before it finishes, its assets are
+     * unloaded as they arrive.
+     *
+     * The optional callback function is called once, with the group name as
+     * the key, when every asset of the group has finished loading (at once
+     * if the group is already loaded).  It is successful only if every asset
+     * loaded successfully.
+     *
+     * @param name      The name of the group
+     * @param json      The JSON asset directory of the group
+     * @param callback  An optional callback after the group is loaded
+     */
+    void loadGroupAsync(const std::string& name, const std::shared_ptr<JsonValue>& json,
+                        LoaderCallback callback);
+
+    /**
+     * Asynchronously loads the assets of a directory as a named group.
+     *
+     * This is the asynchronous version of {@link loadGroup}, and the way to
+     * prefetch the group of the next scene while the current one plays.  The
+     * group counts as loaded as soon as this method returns, so it must be
+     * matched by a call to {@link unloadGroup} like a synchronous load.  Use
+     * {@link isGroupLoaded} or the callback to know when its assets are safe
+     * to access.  If the group is unloaded before it finishes, its assets are
+     * unloaded as they arrive.
+     *
+     * The directory file itself is read in the calling thread, as a group
+     * must be registered before this method returns.  Only the assets are
+     * loaded in the background.
+     *
+     * The optional callback function is called once, with the group name as
+     * the key, when every asset of the group has finished loading (at once
+     * if the group is already loaded).  It is successful only if every asset
+     * loaded successfully.
+     *
+     * @param name      The name of the group
+     * @param directory The path to the JSON asset directory of the group
+     * @param callback  An optional callback after the group is loaded
+     */
+    void loadGroupAsync(const std::string& name, const std::string& directory,
+                        LoaderCallback callback);
+
+    /**
+     * Unloads a group previously loaded with {@link loadGroup}.
+     *
+     * This only removes one reference to the group.  When the last reference
+     * is removed, every asset held by no other group is unloaded, unless it
+     * was loaded outside of groups.  As with {@link unloadDirectory}, assets
+     * with active smart pointers may remain in memory, but the rest of the
+     * program can no longer access them.
+     *
+     * @param name  The name of the group
+     *
+     * @return true if the group was loaded (and its assets were unloaded).
+     */
+    bool unloadGroup(const std::string& name);
+
+    /**
+     * Returns true if the group has been loaded and not unloaded.
+     *
+     * The assets of the group may still be loading.  Use {@link isGroupLoaded}
+     * to know if they are safe to access.
+     *
+     * @param name  The name of the group
+     *
+     * @return true if the group has been loaded and not unloaded.
+     */
+    bool hasGroup(const std::string& name) const {
+        return _groups.find(name) != _groups.end();
+    }
+
+    /**
+     * Returns true if every asset of the group has finished loading.
+     *
+     * This is false for groups that were never loaded, or were unloaded.
+     *
+     * @param name  The name of the group
+     *
+     * @return true if every asset of the group has finished loading.
+     */
+    bool isGroupLoaded(const std::string& name) const {
+        auto it = _groups.find(name);
+        return it != _groups.end() && it->second->pending == 0;
+    }
+
 };
 
 }
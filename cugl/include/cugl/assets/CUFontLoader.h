@@ -63,7 +63,7 @@ namespace cugl {
  * loads as much of the asset as possible without using OpenGL.  This allows
  * us to load the texture in a separate thread.  It then finishes off the
  * remainder of asset loading (particularly the OpenGL atlas generation) using
- * {@link Application#schedule}.  This is a good template for asset loaders in
+ * {@link BaseLoader#scheduleUpload}.  This is a good template for asset loaders in
  * general.
  *
  * As with all of our loaders, this loader is designed to be attached to an
@@ -131,7 +131,7 @@ protected:
      * This method finishes the asset loading started in {@link preload}.  As
      * atlas generation requires OpenGL, this step is not safe to be done in a 
      * separate thread.  Instead, it takes place in the main CUGL thread via 
-     ( {@link Application#schedule}.
+     ( {@link BaseLoader#scheduleUpload}.
      *
      * The font atlas will use the character set specified in the asset.
      *
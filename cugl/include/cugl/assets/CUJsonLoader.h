@@ -6,6 +6,11 @@
 //  (non-directory) json assets.  It is essentially a wrapper around JsonReader
 //  that allows it to be used with AssetManager.
 //
+//  Each JSON file may have a baked copy, written with BinaryWriter::writeJson
+//  next to it with the suffix .jsonb. The loader reads the baked copy when it
+//  exists and was baked from the current text file, which skips all text
+//  parsing.
+//
 //  As with all of our loaders, this loader is designed to be attached to an
 //  asset manager.  In addition, this class uses our standard shared-pointer
 //  architecture.
@@ -56,6 +61,12 @@ namespace cugl {
  * wrapper around {@link JsonReader} that allows it to be used with an
  * instance of {@link AssetManager}.
  *
+ * By default the loader prefers the baked copy of each file, as returned by
+ * {@link getBakedPath}. The baked copy stores the hash of the text file it
+ * was baked from, and the loader parses the text file instead if there is
+ * no copy or if the text file has changed since. Use {@link setPreferBaked}
+ * to always read the text files.
+ *
  * As with all of our loaders, this loader is designed to be attached to an
  * asset manager. Use the method {@link getHook()} to get the appropriate
  * pointer for attaching the loader.
@@ -66,6 +77,9 @@ private:
     CU_DISALLOW_COPY_AND_ASSIGN(JsonLoader);
     
 protected:
+    /** Whether to read the baked copy of a file when it exists */
+    bool _baked;
+
     /**
      * Finishes loading the Json file, cleaning up the wait queues.
      *
@@ -134,7 +148,7 @@ public:
      * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a loader on
      * the heap, use one of the static constructors instead.
      */
-    JsonLoader() {}
+    JsonLoader() : _baked(true) {}
     
     /**
      * Disposes all resources and assets of this loader
@@ -184,6 +198,73 @@ public:
         std::shared_ptr<JsonLoader> result = std::make_shared<JsonLoader>();
         return (result->init(threads) ? result : nullptr);
     }
+    
+#pragma mark -
+#pragma mark Baked Files
+    /**
+     * Returns true if this loader reads the baked copy of a file when it exists.
+     *
+     * @return true if this loader reads the baked copy of a file when it exists.
+     */
+    bool prefersBaked() const { return _baked; }
+
+    /**
+     * Sets whether this loader reads the baked copy of a file when it exists.
+     *
+     * @param value Whether to read the baked copy of a file when it exists
+     */
+    void setPreferBaked(bool value) { _baked = value; }
+
+    /**
+     * Returns the path of the baked copy of a JSON file.
+     *
+     * The baked copy replaces the suffix .json with .jsonb. Any other file
+     * gets .jsonb appended to its name.
+     *
+     * @param source    The path to the JSON file
+     *
+     * @return the path of the baked copy of a JSON file.
+     */
+    static std::string getBakedPath(const std::string& source);
+
+    /**
+     * Returns the hash of the text of a JSON file, as stored in its baked copy.
+     *
+     * This is 64-bit FNV-1a, which is plenty to notice an edited file. It is
+     * only checked by the tools that build the assets, not by the game.
+     *
+     * @param text      The contents of the JSON file
+     *
+     * @return the hash of the text of a JSON file, never 0.
+     */
+    static Uint64 hashSource(const std::string& text);
+
+    /**
+     * Returns the contents of a JSON asset file.
+     *
+     * If baked is true and the file has a baked copy, this method reads that
+     * copy with {@link BinaryReader#readJson}, and does not open the text file
+     * at all. Otherwise it parses the text file. The baked copy is trusted, so
+     * a stale copy is caught when the assets are built, by the --check modes of
+     * switchwitch-jsonbake and switchwitch-pack. This method is safe to call
+     * outside of the main thread.
+     *
+     * @param source    The path to the JSON file, relative to the asset directory
+     * @param baked     Whether to read the baked copy if there is one
+     *
+     * @return the contents of a JSON asset file, or nullptr if it cannot be read.
+     */
+    static std::shared_ptr<JsonValue> readAsset(const std::string& source, bool baked=true);
+
+    /**
+     * Returns true if several assets may be preloaded at the same time.
+     *
+     * JSON files are parsed without any shared state, so the asset manager gives
+     * this loader its pool of decoding threads.
+     *
+     * @return true if several assets may be preloaded at the same time.
+     */
+    virtual bool isThreadSafe() const override { return true; }
 };
 
 }
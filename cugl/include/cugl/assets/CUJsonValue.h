@@ -4,8 +4,8 @@
 //
 //  This module a modern C++ alternative to the cJSON interface for reading
 //  JSON files.  In particular, this gives us better type-checking and memory
-//  management.  With that said, it still uses cJSON as the underlying parsing
-//  engine.
+//  management.  JSON strings are parsed directly into JsonValue trees, in a
+//  single pass.  cJSON is still used to write them back out.
 //
 //  This class uses our standard shared-pointer architecture.
 //
@@ -47,6 +47,7 @@
 #include <cJSON/cJSON.h>
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 namespace cugl {
 
@@ -62,7 +63,8 @@ namespace cugl {
  * if the node is an object type.  Hence the main usage of this feature is to
  * "cast" object nodes to arrays.
  *
- * This class uses cJSON as the underlying parsing engine.  However, it manages
+ * This class parses JSON strings itself, building the tree of nodes in a
+ * single pass, and uses cJSON only to write trees back to strings.  It manages
  * memory automatically so that the user does not need to worry about deleting
  * or allocating memory beyond the initial node itself.
  */
@@ -108,6 +110,17 @@ public:
     
     /** The children of this node (only non-empty if array or object) */
     std::vector<std::shared_ptr<JsonValue>> _children;
+    /**
+     * The position of the first child with each key (only built for large objects)
+     *
+     * The index is kept for every object with enough children for a linear
+     * search to be slow.  It is built as soon as the children are parsed,
+     * extended as children are appended, and rebuilt whenever children are
+     * inserted, removed or renamed.  A lookup never writes to it, so a tree
+     * that is no longer modified may be read from several threads.  The
+     * order of the children is always the order of {@link _children}.
+     */
+    std::unordered_map<std::string,size_t> _index;
 
 #pragma mark -
 #pragma mark cJSON Conversions
@@ -152,6 +165,29 @@ public:
      * @param value The JsonValue to convert
      */
     static cJSON* toCJSON(const JsonValue* value);
+
+    /**
+     * Returns the position of the first child with the given key
+     *
+     * Objects with a key index use it, so that looking up every key of an
+     * object is linear rather than quadratic.  Other nodes are searched
+     * linearly.  This method never modifies the node, so it is safe to call
+     * from several threads at once.
+     *
+     * @param key   The key of the child
+     *
+     * @return the position of the first child with the given key, or -1 if none.
+     */
+    int lookup(const std::string& key) const;
+
+    /**
+     * Rebuilds the key index after the children of this node have changed.
+     *
+     * The index is only kept for objects with enough children for a linear
+     * search to be slow.  Every method that changes the children of a node
+     * calls this, so the index is never built during a lookup.
+     */
+    void reindex();
     
 #pragma mark -
 #pragma mark Constructors
@@ -305,6 +341,18 @@ public:
      */
     bool initWithJson(const char* json);
 
+    /**
+     * Initializes a new JsonValue as a deep copy of the given one.
+     *
+     * Every descendant of the given node is copied, so the two trees share
+     * nothing. This node has the key of the given node, but no parent.
+     *
+     * @param value The JSON node to copy.
+     *
+     * @return  true if the JSON node is initialized properly, false otherwise.
+     */
+    bool initWithCopy(const JsonValue& value);
+
     
 #pragma mark -
 #pragma mark Static Constructors
@@ -472,6 +520,22 @@ public:
         return (result->initWithJson(json) ? result : nullptr);
     }
 
+    /**
+     * Returns a newly allocated deep copy of the given JsonValue.
+     *
+     * Every descendant of the given node is copied, so the two trees share
+     * nothing. The copy has the key of the given node, but no parent. It
+     * can be added as the child of another node.
+     *
+     * @param value The JSON node to copy.
+     *
+     * @return a newly allocated deep copy of the given JsonValue.
+     */
+    static std::shared_ptr<JsonValue> allocWithCopy(const std::shared_ptr<JsonValue>& value) {
+        std::shared_ptr<JsonValue> result = std::make_shared<JsonValue>();
+        return (result->initWithCopy(*value) ? result : nullptr);
+    }
+
     
 #pragma mark -
 #pragma mark Type
@@ -97,6 +97,21 @@ typedef std::function<void(const std::string& key, bool success)> LoaderCallback
  */
 class BaseLoader : public std::enable_shared_from_this<BaseLoader> {
 protected:
+    /**
+     * Schedules the materialize step of an asynchronous load.
+     *
+     * The step runs in the main CUGL thread. If this loader has an asset
+     * manager, the step joins its upload queue, which only runs as many
+     * steps per frame as fit in the upload budget (see
+     * {@link AssetManager#setUploadBudget}). Otherwise it runs in the next
+     * animation frame via {@link Application#schedule}.
+     *
+     * This method may be called from any thread.
+     *
+     * @param task  The materialize step
+     */
+    void scheduleUpload(const std::function<void()>& task);
+
     /** 
      * The associated thread for asynchronous loading
      *
@@ -219,7 +234,7 @@ public:
      * NEVER CALL THIS CONSTRUCTOR. As this is an abstract class, you should 
      * call one of the static constructors of the appropriate child class.
      */
-    BaseLoader()    {}
+    BaseLoader() : _manager(nullptr) {}
     
     /**
      * Deletes this asset loader, disposing of all resources.
@@ -324,6 +339,21 @@ public:
     void setThreadPool(const std::shared_ptr<ThreadPool>& threads) {
         _loader = threads;
     }
+
+    /**
+     * Returns true if several assets may be preloaded at the same time.
+     *
+     * The preload step of such a loader may run on many threads at once, so
+     * the asset manager gives it the shared pool of decoding threads. Other
+     * loaders keep the single directory thread of the manager, which also
+     * orders them with {@link AssetManager#sync}.
+     *
+     * This method should be overridden by loaders whose preload step touches
+     * no shared state.
+     *
+     * @return true if several assets may be preloaded at the same time.
+     */
+    virtual bool isThreadSafe() const { return false; }
     
     /**
      * Sets the asset manager for this loader.
@@ -407,6 +437,9 @@ public:
      *
      * The optional callback function will be called with the asset status when
      * it either finishes loading or fails to load.
+     * It is never called if the asset is already loaded or loading, or if
+     * this loader has no thread pool and loads it at once. This method
+     * returns false in those cases.
      *
      * This method is abstract and should be overridden in child classes to
      * support the appropriate asset type.
@@ -414,9 +447,16 @@ public:
      * @param key       The key to access the asset after loading
      * @param source    The pathname to the asset
      * @param callback  An optional callback for asynchronous loading
+     *
+     * @return true if the asset is loading, and the callback will be called
      */
-    void loadAsync(const std::string key, const std::string source, LoaderCallback callback) {
+    bool loadAsync(const std::string key, const std::string source, LoaderCallback callback) {
+        // A key that is loading already is refused without a callback
+        if (isLoading(key)) {
+            return false;
+        }
         read(key, source, callback,true);
+        return isLoading(key);
     }
 
     /**
@@ -436,15 +476,25 @@ public:
      *
      * The optional callback function will be called with the asset status when
      * it either finishes loading or fails to load.
+     * It is never called if the asset is already loaded or loading, or if
+     * this loader has no thread pool and loads it at once. This method
+     * returns false in those cases.
      *
      * This method is abstract and should be overridden in child classes to
      * support the appropriate asset type.
      *
      * @param json  	The JSON entry (and key) associated with the asset
      * @param callback  An optional callback for asynchronous loading
+     *
+     * @return true if the asset is loading, and the callback will be called
      */
-    void loadAsync(const std::shared_ptr<JsonValue>& json, LoaderCallback callback) {
+    bool loadAsync(const std::shared_ptr<JsonValue>& json, LoaderCallback callback) {
+        // A key that is loading already is refused without a callback
+        if (isLoading(json->key())) {
+            return false;
+        }
         read(json, callback,true);
+        return isLoading(json->key());
     }
 
     /**
@@ -544,6 +594,21 @@ public:
      * @return the number of assets waiting to load.
      */
     virtual size_t waitCount() const { return 0; }
+
+    /**
+     * Returns true if an asset with this key is still loading.
+     *
+     * An asset is loading if it has been loaded asychronously, and the
+     * loading process has not yet finished.
+     *
+     * This method is abstract and should be overridden in child classes to
+     * support the appropriate asset type.
+     *
+     * @param key   The key associated with the asset
+     *
+     * @return true if an asset with this key is still loading.
+     */
+    virtual bool isLoading(const std::string& key) const { return false; }
     
     /**
      * Returns true if the loader has finished loading all assets.
@@ -715,6 +780,20 @@ public:
      */
     size_t waitCount() const override { return _queue.size(); }
 
+    /**
+     * Returns true if an asset with this key is still loading.
+     *
+     * An asset is loading if it has been loaded asychronously, and the
+     * loading process has not yet finished.
+     *
+     * @param key   The key associated with the asset
+     *
+     * @return true if an asset with this key is still loading.
+     */
+    bool isLoading(const std::string& key) const override {
+        return _queue.find(key) != _queue.end();
+    }
+
     /**
      * Unloads all assets present in this loader.
      *
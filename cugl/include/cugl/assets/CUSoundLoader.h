@@ -228,6 +228,16 @@ public:
      */
     void setVolume(float volume) { _volume = volume; }
     
+    
+    /**
+     * Returns true if several assets may be preloaded at the same time.
+     *
+     * Sounds are decoded without any shared state, so the asset manager gives
+     * this loader its pool of decoding threads.
+     *
+     * @return true if several assets may be preloaded at the same time.
+     */
+    virtual bool isThreadSafe() const override { return true; }
 };
     
 }
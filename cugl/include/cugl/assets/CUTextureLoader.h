@@ -47,6 +47,7 @@
 #define __CU_TEXTURE_LOADER_H__
 #include <cugl/assets/CULoader.h>
 #include <cugl/render/CUTexture.h>
+#include <cugl/render/CUCompressedImage.h>
 
 namespace cugl {
 
@@ -63,9 +64,14 @@ namespace cugl {
  * Note that this implementation uses a two phase loading system.  First, it
  * loads as much of the asset as possible without using OpenGL.  This allows 
  * us to load the texture in a separate thread.  It then finishes off the 
- * remainder of asset loading using {@link Application#schedule}.  This is a
+ * remainder of asset loading using {@link BaseLoader#scheduleUpload}.  This is a
  * good template for asset loaders in general.
  *
+ * Files with the suffix .ktx are read as {@link CompressedImage} objects
+ * instead. Their blocks are uploaded without decoding them, unless the
+ * OpenGL driver does not support their format. In that case, formats that
+ * can be decompressed on the CPU are decompressed in the loader thread.
+ *
  * As with all of our loaders, this loader is designed to be attached to an
  * asset manager. Use the method {@link getHook()} to get the appropriate
  * pointer for attaching the loader.
@@ -94,7 +100,10 @@ protected:
      * An atlas is specified as a list of named, four-element integer arrays.
      * Each integer array specifies the left, top, right, and bottom pixels of
      * the subtexture, respectively.  Each subtexture will have the key of the
-     * main texture as the prefix (together with an underscore _) of its key.
+     * main texture as the prefix (together with an underscore _) of its key,
+     * unless the directory entry has a "prefix" string to use instead.  An
+     * empty prefix gives each subtexture the name of its atlas entry, which
+     * is how packed atlas pages keep the keys of the textures they replace.
      *
      * @param json      The asset directory entry
      * @param texture   The texture loaded for this asset
@@ -114,13 +123,26 @@ protected:
      * @return the SDL_Surface with the texture information
      */
     SDL_Surface* preload(const std::string& source);
+
+    /**
+     * Loads a KTX file in a form that is safe to load outside the main thread.
+     *
+     * The compressed blocks are read as they are, with no decoding. If the
+     * OpenGL driver cannot sample their format, they are decompressed to RGBA
+     * here instead, so that this work never takes place in the main thread.
+     *
+     * @param source    The pathname to the asset
+     *
+     * @return the compressed image with the texture information
+     */
+    std::shared_ptr<CompressedImage> preloadCompressed(const std::string& source);
     
     /**
      * Creates an OpenGL texture from the SDL_Surface, and assigns it the given key.
      *
      * This method finishes the asset loading started in {@link preload}.  This
      * step is not safe to be done in a separate thread.  Instead, it takes
-     * place in the main CUGL thread via {@link Application#schedule}.
+     * place in the main CUGL thread via {@link BaseLoader#scheduleUpload}.
      *
      * The loaded texture will have default parameters for scaling and wrap.
      * It will only have a mipmap if that is the default.
@@ -133,13 +155,44 @@ protected:
      * @param callback  An optional callback for asynchronous loading
      */
     void materialize(const std::string& key, SDL_Surface* surface, LoaderCallback callback);
+
+    /**
+     * Creates an OpenGL texture from a compressed image, and assigns it the given key.
+     *
+     * This method finishes the asset loading started in {@link preloadCompressed}.
+     * This step is not safe to be done in a separate thread.  Instead, it takes
+     * place in the main CUGL thread via {@link BaseLoader#scheduleUpload}.
+     *
+     * The loaded texture will have default parameters for scaling and wrap.
+     * It will have the mipmaps of the file, if any.
+     *
+     * This method supports an optional callback function which reports whether
+     * the asset was successfully materialized.
+     *
+     * @param key       The key to access the asset after loading
+     * @param image     The compressed image to upload
+     * @param callback  An optional callback for asynchronous loading
+     */
+    void materialize(const std::string& key, const std::shared_ptr<CompressedImage>& image, LoaderCallback callback);
+
+    /**
+     * Assigns a newly created texture the given key, with the default settings.
+     *
+     * This is the last step of {@link materialize}. A null texture is a failed
+     * load, which is reported to the callback.
+     *
+     * @param key       The key to access the asset after loading
+     * @param texture   The texture created for the asset
+     * @param callback  An optional callback for asynchronous loading
+     */
+    void store(const std::string& key, const std::shared_ptr<Texture>& texture, LoaderCallback callback);
     
     /**
      * Creates an OpenGL texture from the SDL_Surface accoring to the directory entry.
      *
      * This method finishes the asset loading started in {@link preload}.  This
      * step is not safe to be done in a separate thread.  Instead, it takes
-     * place in the main CUGL thread via {@link Application#schedule}.
+     * place in the main CUGL thread via {@link BaseLoader#scheduleUpload}.
      *
      * This version of read provides support for JSON directories. A texture
      * directory entry has the following values
@@ -163,6 +216,37 @@ protected:
      * @param callback  An optional callback for asynchronous loading
      */
     void materialize(const std::shared_ptr<JsonValue>& json, SDL_Surface* surface, LoaderCallback callback);
+
+    /**
+     * Creates an OpenGL texture from a compressed image accoring to the directory entry.
+     *
+     * This method finishes the asset loading started in {@link preloadCompressed}.
+     * This step is not safe to be done in a separate thread.  Instead, it takes
+     * place in the main CUGL thread via {@link BaseLoader#scheduleUpload}.
+     *
+     * The directory entry is the same as for any other texture. However, the
+     * texture only has the mipmaps of the file, whatever the "mipmaps" value.
+     *
+     * This method supports an optional callback function which reports whether
+     * the asset was successfully materialized.
+     *
+     * @param json      The asset directory entry
+     * @param image     The compressed image to upload
+     * @param callback  An optional callback for asynchronous loading
+     */
+    void materialize(const std::shared_ptr<JsonValue>& json, const std::shared_ptr<CompressedImage>& image, LoaderCallback callback);
+
+    /**
+     * Assigns a newly created texture the key and settings of its directory entry.
+     *
+     * This is the last step of {@link materialize}. A null texture is a failed
+     * load, which is reported to the callback.
+     *
+     * @param json      The asset directory entry
+     * @param texture   The texture created for the asset
+     * @param callback  An optional callback for asynchronous loading
+     */
+    void store(const std::shared_ptr<JsonValue>& json, const std::shared_ptr<Texture>& texture, LoaderCallback callback);
     
 
     /**
@@ -262,6 +346,21 @@ public:
         _assets.clear();
         _loader = nullptr;
     }
+
+    /**
+     * Initializes a new texture loader.
+     *
+     * This method bootstraps the loader with any initial resources that it
+     * needs to load assets. In particular, the OpenGL context must be active,
+     * as this is where the loader learns which compressed formats the driver
+     * supports. Attempts to load an asset before this method is called will fail.
+     *
+     * @param threads   The thread pool for asynchronous loading support
+     *
+     * @return true if the asset loader was initialized successfully
+     */
+    bool init(const std::shared_ptr<ThreadPool>& threads) override;
+    using Loader<Texture>::init;
     
     /**
      * Returns a newly allocated texture loader.
@@ -405,6 +504,16 @@ public:
      */
     void setMipMaps(bool flag) { _mipmaps = flag; }
 
+    
+    /**
+     * Returns true if several assets may be preloaded at the same time.
+     *
+     * Textures are decoded without any shared state, so the asset manager gives
+     * this loader its pool of decoding threads.
+     *
+     * @return true if several assets may be preloaded at the same time.
+     */
+    virtual bool isThreadSafe() const override { return true; }
 };
 
 }
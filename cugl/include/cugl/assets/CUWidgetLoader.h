@@ -186,6 +186,16 @@ public:
         std::shared_ptr<WidgetLoader> result = std::make_shared<WidgetLoader>();
         return (result->init(threads) ? result : nullptr);
     }
+    
+    /**
+     * Returns true if several assets may be preloaded at the same time.
+     *
+     * Widget files are parsed without any shared state, so the asset manager gives
+     * this loader its pool of decoding threads.
+     *
+     * @return true if several assets may be preloaded at the same time.
+     */
+    virtual bool isThreadSafe() const override { return true; }
 };
 
 }
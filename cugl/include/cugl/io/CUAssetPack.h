@@ -0,0 +1,347 @@
+//
+//  CUAssetPack.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides a pack file of assets, so that a game can ship one
+//  large file instead of hundreds of loose ones. A pack has a header, an
+//  index of the entries sorted by the hash of their names, and the contents
+//  of each entry, aligned in the file. Each entry may be compressed with
+//  LZ4. The pack is memory-mapped where the platform allows it, and read in
+//  a single pass otherwise.
+//
+//  The mounted packs act as a virtual file system for the asset directory.
+//  The readers of textures, sounds, fonts and JSON files open their files
+//  with openAsset, which looks in the mounted packs before the disk.
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef __CU_ASSET_PACK_H__
+#define __CU_ASSET_PACK_H__
+#include <cugl/base/CUBase.h>
+#include <SDL/SDL.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace cugl {
+
+/**
+ * This class represents a pack file of assets.
+ *
+ * A pack file has the following layout, with every number in network order.
+ *
+ *      header:  "CUPK", version (Uint32), entry count (Uint32), alignment (Uint32)
+ *      index:   one 32 byte entry per file, sorted by name hash
+ *      names:   the names of the files, one after the other
+ *      data:    the contents of each file, starting at a multiple of alignment
+ *
+ * An index entry holds the 64 bit FNV-1a hash of the name (Uint64), the
+ * offset of the contents (Uint64), the stored size (Uint32), the original
+ * size (Uint32), the offset of the name in the name table (Uint32), the
+ * name length (Uint16) and the flags (Uint16). The only flag is
+ * {@link COMPRESSED}, for contents in the LZ4 block format. The names are
+ * paths relative to the asset directory, with / as the separator.
+ *
+ * A pack is mounted with {@link mount}. From then on, {@link openAsset} finds
+ * its files before those on the disk. The packs are read-only, and mounting
+ * is meant to happen once at startup, before any asset is loaded. Mounted
+ * packs can then be read from any thread.
+ */
+class AssetPack {
+public:
+    /** The flag of an entry stored in the LZ4 block format */
+    static const Uint16 COMPRESSED;
+
+private:
+    /** An entry of the index */
+    typedef struct {
+        /** The hash of the name */
+        Uint64 hash;
+        /** The offset of the contents in the pack */
+        Uint64 offset;
+        /** The size of the contents in the pack */
+        Uint32 stored;
+        /** The size of the contents once decompressed */
+        Uint32 size;
+        /** The offset of the name in the name table */
+        Uint32 name;
+        /** The length of the name */
+        Uint16 length;
+        /** The entry flags */
+        Uint16 flags;
+    } Entry;
+
+    /** The path to the pack file */
+    std::string _path;
+    /** The contents of the pack, mapped or read */
+    const Uint8* _data;
+    /** The size of the pack in bytes */
+    size_t _size;
+    /** Whether _data is a memory mapping */
+    bool _mapped;
+    /** The contents of the pack when it cannot be mapped */
+    std::vector<Uint8> _buffer;
+    /** The entries, sorted by hash */
+    std::vector<Entry> _entries;
+    /** The start of the name table */
+    const char* _names;
+
+    /**
+     * Returns the entry of the given file, or nullptr if there is none.
+     *
+     * @param name  The path of the file relative to the asset directory
+     *
+     * @return the entry of the given file, or nullptr if there is none.
+     */
+    const Entry* find(const std::string& name) const;
+
+public:
+#pragma mark Constructors
+    /**
+     * Creates an empty pack with no files.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a pack on
+     * the heap, use one of the static constructors instead.
+     */
+    AssetPack() : _data(nullptr), _size(0), _mapped(false), _names(nullptr) {}
+
+    /**
+     * Deletes this pack, disposing all resources
+     */
+    ~AssetPack() { dispose(); }
+
+    /**
+     * Unmaps the pack file and resets all attributes.
+     *
+     * A mounted pack is never disposed, as the mounts hold a reference.
+     */
+    void dispose();
+
+    /**
+     * Initializes a pack from the given file.
+     *
+     * The file is memory-mapped if the platform allows it, and read whole
+     * otherwise. Only the index is checked here.
+     *
+     * @param path  The path to the pack file
+     *
+     * @return true if initialization was successful.
+     */
+    bool init(const std::string& path);
+
+    /**
+     * Initializes a pack from the given file in the asset directory.
+     *
+     * @param file  The path to the pack file relative to the asset directory
+     *
+     * @return true if initialization was successful.
+     */
+    bool initWithAsset(const std::string& file);
+
+#pragma mark Static Constructors
+    /**
+     * Returns a newly allocated pack from the given file.
+     *
+     * @param path  The path to the pack file
+     *
+     * @return a newly allocated pack from the given file.
+     */
+    static std::shared_ptr<AssetPack> alloc(const std::string& path) {
+        std::shared_ptr<AssetPack> result = std::make_shared<AssetPack>();
+        return (result->init(path) ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated pack from the given file in the asset directory.
+     *
+     * @param file  The path to the pack file relative to the asset directory
+     *
+     * @return a newly allocated pack from the given file in the asset directory.
+     */
+    static std::shared_ptr<AssetPack> allocWithAsset(const std::string& file) {
+        std::shared_ptr<AssetPack> result = std::make_shared<AssetPack>();
+        return (result->initWithAsset(file) ? result : nullptr);
+    }
+
+#pragma mark Files
+    /**
+     * Returns the number of files in this pack.
+     *
+     * @return the number of files in this pack.
+     */
+    size_t size() const { return _entries.size(); }
+
+    /**
+     * Returns true if this pack is memory-mapped.
+     *
+     * @return true if this pack is memory-mapped.
+     */
+    bool isMapped() const { return _mapped; }
+
+    /**
+     * Returns true if this pack has the given file.
+     *
+     * @param name  The path of the file relative to the asset directory
+     *
+     * @return true if this pack has the given file.
+     */
+    bool contains(const std::string& name) const { return find(name) != nullptr; }
+
+    /**
+     * Returns a read-only stream of the given file, or nullptr if there is none.
+     *
+     * A stored file is streamed straight from the pack. A compressed file
+     * is decompressed into a buffer that the stream frees when it is closed.
+     * The caller must close the stream with SDL_RWclose.
+     *
+     * @param name  The path of the file relative to the asset directory
+     *
+     * @return a read-only stream of the given file, or nullptr if there is none.
+     */
+    SDL_RWops* open(const std::string& name) const;
+
+    /**
+     * Returns the contents of the given file in place, if it is not compressed.
+     *
+     * The contents stay valid for the lifetime of this pack.
+     *
+     * @param name  The path of the file relative to the asset directory
+     * @param size  Set to the size of the file
+     *
+     * @return the contents of the given file, or nullptr if it is compressed or absent.
+     */
+    const Uint8* getData(const std::string& name, size_t& size) const;
+
+#pragma mark Virtual File System
+    /**
+     * Mounts a pack, so that {@link openAsset} looks in it before the disk.
+     *
+     * Packs mounted later are searched first.
+     *
+     * @param pack  The pack to mount
+     */
+    static void mount(const std::shared_ptr<AssetPack>& pack);
+
+    /**
+     * Unmounts every pack.
+     *
+     * No stream opened from a pack may be in use when it is unmounted.
+     */
+    static void unmountAll();
+
+    /**
+     * Returns the path of a file relative to the asset directory.
+     *
+     * A path inside the asset directory loses that prefix, and separators
+     * become /. Any other absolute path is returned as the empty string, as
+     * no pack can hold it.
+     *
+     * @param path  The path of the file
+     *
+     * @return the path of a file relative to the asset directory.
+     */
+    static std::string getAssetName(const std::string& path);
+
+    /**
+     * Returns true if a mounted pack has the given file.
+     *
+     * @param path  The path of the file, absolute or relative to the asset directory
+     *
+     * @return true if a mounted pack has the given file.
+     */
+    static bool hasAsset(const std::string& path);
+
+    /**
+     * Returns a stream of the given file, from a mounted pack or the disk.
+     *
+     * This is the replacement for SDL_RWFromFile when reading assets. The
+     * mode is only used for files on the disk, as packs are read-only.
+     *
+     * @param path  The path of the file, absolute or relative to the asset directory
+     * @param mode  The SDL_RWFromFile mode for files on the disk
+     *
+     * @return a stream of the given file, or nullptr if it cannot be opened.
+     */
+    static SDL_RWops* openAsset(const std::string& path, const char* mode="rb");
+
+    /**
+     * Returns the contents of the given file in a mounted pack, if stored in place.
+     *
+     * This allows files to be read without a copy. The contents stay valid
+     * until the packs are unmounted.
+     *
+     * @param path  The path of the file, absolute or relative to the asset directory
+     * @param size  Set to the size of the file
+     *
+     * @return the contents of the given file, or nullptr if no mounted pack stores it.
+     */
+    static const Uint8* getAssetData(const std::string& path, size_t& size);
+
+    /**
+     * Returns the 64 bit FNV-1a hash of a file name, as used by the index.
+     *
+     * @param name  The path of the file relative to the asset directory
+     *
+     * @return the 64 bit FNV-1a hash of a file name.
+     */
+    static Uint64 hash(const std::string& name);
+
+#pragma mark Compression
+    /**
+     * Returns the given data compressed in the LZ4 block format.
+     *
+     * This is used by the packer; the game only decompresses.
+     *
+     * @param data  The data to compress
+     * @param size  The size of the data
+     *
+     * @return the given data compressed in the LZ4 block format.
+     */
+    static std::vector<Uint8> compress(const Uint8* data, size_t size);
+
+    /**
+     * Decompresses data in the LZ4 block format.
+     *
+     * @param data      The compressed data
+     * @param size      The size of the compressed data
+     * @param output    The buffer for the decompressed data
+     * @param capacity  The exact size of the decompressed data
+     *
+     * @return true if the data decompressed to exactly capacity bytes.
+     */
+    static bool decompress(const Uint8* data, size_t size, Uint8* output, size_t capacity);
+};
+
+}
+
+#endif /* __CU_ASSET_PACK_H__ */
@@ -55,9 +55,13 @@
 #include <cugl/base/CUBase.h>
 #include <SDL/SDL.h>
 #include <string>
+#include <memory>
 
 namespace cugl {
 
+/** Forward reference to a JSON value */
+class JsonValue;
+
 /**
  * Simple cross-platform reader for binary files.
  *
@@ -562,6 +566,25 @@ public:
      * @return the number of doubles read from the stream
      */
     size_t read(double* buffer, size_t maximum, size_t offset=0);
+
+#pragma mark -
+#pragma mark JSON Reads
+    /**
+     * Returns the JSON tree written by {@link BinaryWriter#writeJson}.
+     *
+     * The tree is rebuilt directly from its tags, without tokenizing any
+     * text. This method returns nullptr if the file does not start with a
+     * binary JSON header, or if it is truncated or corrupt.
+     *
+     * If source is not 0, the tree is only read if it was written from a
+     * text file with that hash. Otherwise the text file has changed since
+     * the tree was baked, and this method returns nullptr as well.
+     *
+     * @param source    the hash of the text file of the tree, or 0 to skip the check
+     *
+     * @return the JSON tree written by {@link BinaryWriter#writeJson}.
+     */
+    std::shared_ptr<JsonValue> readJson(Uint64 source=0);
 };
 
 }
@@ -55,8 +55,12 @@
 #include <cugl/base/CUBase.h>
 #include <SDL/SDL.h>
 #include <string>
+#include <memory>
 
 namespace cugl {
+
+/** Forward reference to a JSON value */
+class JsonValue;
     
 /**
  * Simple cross-platform writer for binary files.
@@ -499,7 +503,31 @@ public:
      * @param offset the initial offset into the array
      */
     void write(const double* array, size_t length, size_t offset=0);
-    
+
+#pragma mark -
+#pragma mark JSON Writes
+    /**
+     * Writes a JSON tree to the binary file.
+     *
+     * The tree is encoded compactly, so that {@link BinaryReader#readJson}
+     * can rebuild it without any text parsing. Every value is a one byte tag
+     * followed by its payload. Integers are stored in 4 or 8 bytes depending
+     * on their size, and doubles only when they have a fraction. The keys of
+     * the objects are stored once, in a table at the start of the file, and
+     * each object child refers to its key by index.
+     *
+     * The encoding is meant for files that only hold the tree, so it should
+     * be the only thing written to this file.
+     *
+     * The header records the hash of the text file the tree was read from
+     * (see {@link JsonLoader#hashSource}), so that a reader can tell when
+     * the text file has changed since. Use 0 if the tree has no text file.
+     *
+     * @param json      the JSON tree to write
+     * @param source    the hash of the text file of the tree, or 0 for none
+     */
+    void writeJson(const std::shared_ptr<JsonValue>& json, Uint64 source=0);
+
 };
 
 }
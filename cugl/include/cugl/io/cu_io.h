@@ -28,6 +28,7 @@
 #ifndef __CU_IO_PKG_H__
 #define __CU_IO_PKG_H__
 
+#include "CUAssetPack.h"
 #include "CUTextReader.h"
 #include "CUTextWriter.h"
 #include "CUJsonReader.h"
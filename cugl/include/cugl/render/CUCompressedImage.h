@@ -0,0 +1,290 @@
+//
+//  CUCompressedImage.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides the class for reading GPU-compressed images from KTX
+//  files. A compressed image holds the blocks of every mipmap level exactly
+//  as they are stored in the file, so a texture can be uploaded without ever
+//  inflating a PNG or converting pixels. The image supports the ETC1, ETC2
+//  and ASTC (LDR) formats. As not every driver samples every format, images
+//  in the ETC family can also be decompressed to RGBA on the CPU.
+//
+//  Reading a compressed image does not use OpenGL, so it is safe to do it
+//  outside of the main thread. Only the query of the supported formats
+//  requires the OpenGL context.
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef __CU_COMPRESSED_IMAGE_H__
+#define __CU_COMPRESSED_IMAGE_H__
+#include <cugl/math/CUMathBase.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace cugl {
+
+/**
+ * This class represents the contents of a KTX (version 1) file.
+ *
+ * A KTX file stores a 2D image as a chain of mipmap levels, each of them a
+ * sequence of compressed blocks in an OpenGL internal format. This class
+ * reads the levels without decoding them, so that {@link Texture} can hand
+ * them to glCompressedTexImage2D as they are. The supported formats are
+ * ETC2 RGB, ETC2 RGB with punchthrough alpha, ETC2 RGBA (with EAC alpha),
+ * and the LDR ASTC formats of any block size. ETC1 files are read as ETC2
+ * RGB, which decodes every ETC1 block the same way.
+ *
+ * The first row of each level is the top row of the image, as in the PNG
+ * files that CUGL loads. This is the default orientation of most KTX tools.
+ * Array textures, cube maps and 3D textures are not supported.
+ *
+ * A driver that cannot sample a format still gets the image if it is in the
+ * ETC family, through {@link decompress}. That method replaces every level
+ * with RGBA pixels. ASTC images have no such fallback, as an ASTC decoder
+ * would dwarf the rest of this class. Use {@link isSupported} to pick a file
+ * the device can use.
+ */
+class CompressedImage {
+public:
+    /** The KTX internal format of ETC2 RGB images */
+    static const GLenum ETC2_RGB8;
+    /** The KTX internal format of ETC2 RGB images with punchthrough alpha */
+    static const GLenum ETC2_RGB8_A1;
+    /** The KTX internal format of ETC2 RGBA images with EAC alpha */
+    static const GLenum ETC2_RGBA8;
+    /** The KTX internal format of 4x4 ASTC images; the other sizes follow */
+    static const GLenum ASTC_4x4;
+    /** The KTX internal format of 12x12 ASTC images, the last LDR ASTC format */
+    static const GLenum ASTC_12x12;
+
+private:
+    /** The OpenGL internal format, or 0 if the levels are RGBA pixels */
+    GLenum _format;
+    /** The width of the image in pixels */
+    int _width;
+    /** The height of the image in pixels */
+    int _height;
+    /** The data of each mipmap level, starting with the full image */
+    std::vector<std::vector<Uint8>> _levels;
+
+public:
+#pragma mark Constructors
+    /**
+     * Creates an empty image with no size.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate an image on
+     * the heap, use one of the static constructors instead.
+     */
+    CompressedImage() : _format(0), _width(0), _height(0) {}
+
+    /**
+     * Deletes this image, disposing all resources
+     */
+    ~CompressedImage() { dispose(); }
+
+    /**
+     * Deletes the image data and resets all attributes.
+     *
+     * You must reinitialize the image to use it.
+     */
+    void dispose();
+
+    /**
+     * Initializes an image with the contents of a KTX file in memory.
+     *
+     * @param data  The contents of the file
+     * @param size  The size of the file in bytes
+     *
+     * @return true if initialization was successful.
+     */
+    bool initWithData(const Uint8* data, size_t size);
+
+    /**
+     * Initializes an image with the contents of a KTX file.
+     *
+     * IMPORTANT: In CUGL, relative path names always refer to the asset
+     * directory. If you wish to load an image from somewhere else, you must
+     * use an absolute pathname.
+     *
+     * @param filename  The KTX file
+     *
+     * @return true if initialization was successful.
+     */
+    bool initWithFile(const std::string filename);
+
+#pragma mark Static Constructors
+    /**
+     * Returns a newly allocated image with the contents of a KTX file in memory.
+     *
+     * @param data  The contents of the file
+     * @param size  The size of the file in bytes
+     *
+     * @return a newly allocated image with the contents of a KTX file in memory.
+     */
+    static std::shared_ptr<CompressedImage> allocWithData(const Uint8* data, size_t size) {
+        std::shared_ptr<CompressedImage> result = std::make_shared<CompressedImage>();
+        return (result->initWithData(data, size) ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated image with the contents of a KTX file.
+     *
+     * IMPORTANT: In CUGL, relative path names always refer to the asset
+     * directory. If you wish to load an image from somewhere else, you must
+     * use an absolute pathname.
+     *
+     * @param filename  The KTX file
+     *
+     * @return a newly allocated image with the contents of a KTX file.
+     */
+    static std::shared_ptr<CompressedImage> allocWithFile(const std::string filename) {
+        std::shared_ptr<CompressedImage> result = std::make_shared<CompressedImage>();
+        return (result->initWithFile(filename) ? result : nullptr);
+    }
+
+#pragma mark Attributes
+    /**
+     * Returns the OpenGL internal format of this image.
+     *
+     * This is 0 once the image has been decompressed to RGBA pixels.
+     *
+     * @return the OpenGL internal format of this image.
+     */
+    GLenum getFormat() const { return _format; }
+
+    /**
+     * Returns true if the levels of this image are still compressed blocks.
+     *
+     * @return true if the levels of this image are still compressed blocks.
+     */
+    bool isCompressed() const { return _format != 0; }
+
+    /**
+     * Returns the width of this image in pixels.
+     *
+     * @return the width of this image in pixels.
+     */
+    int getWidth() const { return _width; }
+
+    /**
+     * Returns the height of this image in pixels.
+     *
+     * @return the height of this image in pixels.
+     */
+    int getHeight() const { return _height; }
+
+    /**
+     * Returns the number of mipmap levels, including the full image.
+     *
+     * @return the number of mipmap levels, including the full image.
+     */
+    size_t getLevelCount() const { return _levels.size(); }
+
+    /**
+     * Returns the data of a mipmap level.
+     *
+     * Level 0 is the full image, and each level after it halves the size.
+     *
+     * @param level The mipmap level
+     *
+     * @return the data of a mipmap level.
+     */
+    const std::vector<Uint8>& getLevel(size_t level) const { return _levels[level]; }
+
+    /**
+     * Returns the number of bytes of all the mipmap levels.
+     *
+     * This is the memory the image takes on the GPU once uploaded.
+     *
+     * @return the number of bytes of all the mipmap levels.
+     */
+    size_t getByteSize() const;
+
+#pragma mark Decompression
+    /**
+     * Returns true if this image can be decompressed on the CPU.
+     *
+     * That is the case for the ETC family, but not for ASTC.
+     *
+     * @return true if this image can be decompressed on the CPU.
+     */
+    bool canDecompress() const;
+
+    /**
+     * Replaces every mipmap level with its RGBA pixels.
+     *
+     * This is the fallback for drivers that cannot sample the format of this
+     * image. The pixels are RGBA8, in the byte order that {@link Texture}
+     * expects for {@link Texture::PixelFormat#RGBA}. Afterwards
+     * {@link isCompressed} is false.
+     *
+     * @return true if the image was decompressed.
+     */
+    bool decompress();
+
+    /**
+     * Returns true if the OpenGL driver can sample the given format.
+     *
+     * The supported formats are queried from OpenGL the first time, and so
+     * the first call must take place in the main thread, with the OpenGL
+     * context active. Later calls are safe in any thread.
+     *
+     * @param format    The OpenGL internal format
+     *
+     * @return true if the OpenGL driver can sample the given format.
+     */
+    static bool isSupported(GLenum format);
+
+    /**
+     * Returns the width and height of a block of the given format in pixels.
+     *
+     * @param format    The OpenGL internal format
+     * @param width     Set to the block width, or 0 if the format is unknown
+     * @param height    Set to the block height, or 0 if the format is unknown
+     */
+    static void getBlockSize(GLenum format, int& width, int& height);
+
+    /**
+     * Returns the number of bytes of a block of the given format.
+     *
+     * @param format    The OpenGL internal format
+     *
+     * @return the number of bytes of a block of the given format, or 0 if the format is unknown
+     */
+    static size_t getBlockBytes(GLenum format);
+};
+
+}
+
+#endif /* __CU_COMPRESSED_IMAGE_H__ */
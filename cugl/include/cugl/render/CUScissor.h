@@ -391,6 +391,7 @@ public:
      * @return this scissor mask, returned for chaining
      */
     Scissor& operator=(Scissor&& mask)  {
+        _scissor   = mask._scissor;
         _inverse   = mask._inverse;
         _transform = mask._transform;
         _bounds  = mask._bounds;
@@ -579,6 +580,38 @@ public:
     void setFringe(float fringe) { _fringe = fringe; }
 
 
+#pragma mark -
+#pragma mark Comparisons
+    /**
+     * Returns true if this scissor mask is equal to the given one.
+     *
+     * Comparison is exact on the transform, bounds and fringe, which may be
+     * unreliable given that they are floats. It is meant to detect masks
+     * that have not changed at all.
+     *
+     * @param mask  The scissor mask to compare against.
+     *
+     * @return true if this scissor mask is equal to the given one.
+     */
+    bool operator==(const Scissor& mask) const {
+        return _transform == mask._transform && _bounds == mask._bounds && _fringe == mask._fringe;
+    }
+
+    /**
+     * Returns true if this scissor mask is not equal to the given one.
+     *
+     * Comparison is exact on the transform, bounds and fringe, which may be
+     * unreliable given that they are floats.
+     *
+     * @param mask  The scissor mask to compare against.
+     *
+     * @return true if this scissor mask is not equal to the given one.
+     */
+    bool operator!=(const Scissor& mask) const {
+        return !(*this == mask);
+    }
+
+
 #pragma mark -
 #pragma mark Transforms
     /**
@@ -51,6 +51,7 @@
 #include <vector>
 #include "CUSpriteVertex.h"
 #include "CUMesh.h"
+#include "CUScissor.h"
 #include <cugl/math/CUMathBase.h>
 #include <cugl/math/CUMat4.h>
 #include <cugl/math/CUColor4.h>
@@ -69,7 +70,6 @@ class Shader;
 class Affine2;
 class Texture;
 class Gradient;
-class Scissor;
 class Font;
 class Rect;
 class Poly2;
@@ -813,6 +813,13 @@ enum StencilEffect {
  * Even texture switches are batched.  However, it is still true that using a
  * single texture atlas can significantly improve drawing speed.
  *
+ * A sprite batch may also defer its drawing (see {@link #setDeferred}). In
+ * that mode, the recorded draws are reordered when they are flushed, so that
+ * draws with the same texture, shader state, scissor and depth are merged into
+ * a single OpenGL call. A draw only moves ahead of the draws that it does not
+ * overlap, so the result is the same as drawing in the order given. This is
+ * useful for scene graphs that interleave many small textures.
+ *
  * A review of this class shows that there are a lot of redundant drawing methods.
  * The scene graphs only use the {@link Mesh} methods. This goal has been to make 
  * this class more accessible to students familiar with classic sprite batches 
@@ -878,14 +885,16 @@ private:
     bool _inflight;
     /** The drawing context history */
     std::vector<Context*> _history;
+    /** Whether to reorder the drawing context history when flushing */
+    bool _deferred;
     
     /** The active color */
     Color4 _color;
     
     /** The active gradient */
     std::shared_ptr<Gradient> _gradient;
-    /** The active scissor mask */
-    std::shared_ptr<Scissor>  _scissor;
+    /** The scissor stack, whose top is the active scissor mask */
+    std::vector<Scissor> _scissors;
 
     // Monitoring values
     /** The number of vertices drawn in this pass (so far) */
@@ -1156,6 +1165,32 @@ public:
      */
     unsigned int getCallsMade() const { return _callTotal; }
 
+    /**
+     * Sets whether this sprite batch defers and sorts its draws.
+     *
+     * A deferred sprite batch reorders its draws when it flushes, merging
+     * draws that share a texture, blending state, scissor, gradient and depth
+     * into a single OpenGL call. A draw is only moved ahead of draws that it
+     * does not overlap, so the image is the same as in the immediate mode.
+     * Draws are never moved across a stencil effect, a stencil clear or a
+     * change of perspective.
+     *
+     * This value is false by default. It may be changed at any time, but
+     * only takes effect at the next flush.
+     *
+     * @param deferred  Whether this sprite batch defers and sorts its draws
+     */
+    void setDeferred(bool deferred) { _deferred = deferred; }
+
+    /**
+     * Returns true if this sprite batch defers and sorts its draws.
+     *
+     * See {@link #setDeferred} for a description of the deferred mode.
+     *
+     * @return true if this sprite batch defers and sorts its draws.
+     */
+    bool isDeferred() const { return _deferred; }
+
     /**
      * Sets the shader for this sprite batch
      *
@@ -1295,6 +1330,9 @@ public:
      * This method acquires a copy of the scissor. Changes to the original
      * scissor mask after calling this method have no effect.
      *
+     * The scissor replaces the top of the scissor stack (see
+     * {@link #pushScissor}). Setting it to nullptr empties the stack.
+     *
      * @param scissor   The active scissor mask for this sprite batch
      */
     void setScissor(const std::shared_ptr<Scissor>& scissor);
@@ -1315,6 +1353,31 @@ public:
      * @return The active scissor mask for this sprite batch
      */
     std::shared_ptr<Scissor> getScissor() const;
+
+    /**
+     * Pushes a scissor mask on the scissor stack of this sprite batch
+     *
+     * The scissor becomes the active scissor mask, intersected with the
+     * previous active mask (if any) by {@link Scissor#intersect}. As with
+     * {@link #setScissor}, it is in the coordinate system of
+     * {@link getPerspective}. The previous mask is restored by
+     * {@link #popScissor}.
+     *
+     * Unlike {@link #setScissor}, this method does not allocate any memory
+     * once the stack is deep enough. This makes it the preferred way to
+     * clip nested scene graph nodes on every frame.
+     *
+     * @param scissor   The scissor mask to push
+     */
+    void pushScissor(const Scissor& scissor);
+
+    /**
+     * Pops the active scissor mask from the scissor stack of this sprite batch
+     *
+     * This restores the mask that was active before the matching call to
+     * {@link #pushScissor}. Popping an empty stack does nothing.
+     */
+    void popScissor();
     
     /**
      * Sets the blending function for the source color
@@ -2853,6 +2916,17 @@ private:
      * This method is called upon flushing or cleanup.
      */
     void unwind();
+
+    /**
+     * Reorders the drawing context history to merge compatible draws.
+     *
+     * This method is called by {@link #flush} in deferred mode. Each context
+     * is moved back to the latest earlier context with the same state, as
+     * long as it does not overlap any context in between. The indices of the
+     * merged contexts are rewritten so that each merged context is a single
+     * range, and the dirty bits are recomputed for the new order.
+     */
+    void sortHistory();
     
     /**
      * Sets the active uniform block to agree with the gradient and stroke.
@@ -2927,6 +3001,22 @@ private:
      */
     unsigned int prepare(const Rect rect, const Affine2& mat);
 
+    /**
+     * Returns the number of vertices added to the drawing buffer.
+     *
+     * This method is the fast path of {@link #prepare} for rectangles. It
+     * writes the four corners straight into the vertex buffer, with the
+     * texture coordinates of the rectangle, instead of going through a
+     * temporary {@link Poly2}. The corners are in the order bottom left,
+     * bottom right, top right and top left, already transformed. The caller
+     * must make room in the buffers and set the uniform block first.
+     *
+     * @param corners   The quad corners as [x0 y0 x1 y1 x2 y2 x3 y3]
+     *
+     * @return the number of vertices added to the drawing buffer.
+     */
+    unsigned int prepareQuad(const float* corners);
+
     /**
      * Returns the number of vertices added to the drawing buffer.
      *
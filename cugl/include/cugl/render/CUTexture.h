@@ -49,6 +49,9 @@
 
 namespace cugl {
 
+/** Forward reference to a compressed image */
+class CompressedImage;
+
 /**
  * This is a class representing an OpenGL texture.
  *
@@ -157,6 +160,9 @@ private:
     /** The pixel format of the texture */
     PixelFormat _pixelFormat;
 
+    /** The OpenGL internal format of compressed texture data (0 if not compressed) */
+    GLenum _compression;
+
     /** The decriptive texture name */
     std::string _name;
     
@@ -270,6 +276,9 @@ public:
      *
      * This method can load any file format supported by SDL_Image. This
      * includes (but is not limited to) PNG, JPEG, GIF, TIFF, BMP and PCX.
+     * It can also load KTX files of the formats in {@link CompressedImage}.
+     * Their data is uploaded without decoding it, unless the OpenGL driver
+     * does not support the format and it can be decompressed on the CPU.
      *
      * The texture will be stored in RGBA format, even if it is a file format
      * that does not support transparency (e.g. JPEG).
@@ -284,6 +293,25 @@ public:
      */
     bool initWithFile(const std::string filename);
 
+    /**
+     * Initializes an texture with the mipmap levels of a compressed image.
+     *
+     * Initializing a texture requires the use of the binding point at 0. Any
+     * texture bound to that point will be unbound. In addition, once
+     * initialization is done, this texture will not longer be bound as well.
+     *
+     * The levels are uploaded as they are, without decoding them, so the
+     * OpenGL driver must support the format of the image (see
+     * {@link CompressedImage#isSupported}). An image that was decompressed
+     * on the CPU is uploaded as RGBA instead. If the image has more than one
+     * level, the texture has mipmaps.
+     *
+     * @param image     The compressed image
+     *
+     * @return true if initialization was successful.
+     */
+    bool initWithCompressed(const std::shared_ptr<CompressedImage>& image);
+
     
 #pragma mark -
 #pragma mark Static Constructors
@@ -340,6 +368,7 @@ public:
      *
      * This method can load any file format supported by SDL_Image.  This
      * includes (but is not limited to) PNG, JPEG, GIF, TIFF, BMP and PCX.
+     * It can also load KTX files of the formats in {@link CompressedImage}.
      *
      * The texture will be stored in RGBA format, even if it is a file format
      * that does not support transparency (e.g. JPEG).
@@ -352,6 +381,28 @@ public:
         std::shared_ptr<Texture> result = std::make_shared<Texture>();
         return (result->initWithFile(filename) ? result : nullptr);
     }
+
+    /**
+     * Returns a new texture with the mipmap levels of a compressed image.
+     *
+     * Allocating a texture requires the use of the binding point at 0. Any
+     * texture bound to that point will be unbound. In addition, once
+     * allocation is done, this texture will not longer be bound as well.
+     *
+     * The levels are uploaded as they are, without decoding them, so the
+     * OpenGL driver must support the format of the image (see
+     * {@link CompressedImage#isSupported}). An image that was decompressed
+     * on the CPU is uploaded as RGBA instead. If the image has more than one
+     * level, the texture has mipmaps.
+     *
+     * @param image     The compressed image
+     *
+     * @return a new texture with the mipmap levels of a compressed image.
+     */
+    static std::shared_ptr<Texture> allocWithCompressed(const std::shared_ptr<CompressedImage>& image) {
+        std::shared_ptr<Texture> result = std::make_shared<Texture>();
+        return (result->initWithCompressed(image) ? result : nullptr);
+    }
     
     /**
      * Returns a blank texture that can be used to make solid shapes.
@@ -460,7 +511,11 @@ public:
     /**
      * Returns the number of bytes in a single pixel of this texture.
      *
-     * @return the number of bytes in a single pixel of this texture.
+     * A compressed texture has no bytes per pixel. For such a texture this is
+     * the number of bytes in a single block instead, which covers the pixels
+     * of {@link CompressedImage#getBlockSize}.
+     *
+     * @return the number of bytes in a single pixel (or block) of this texture.
      */
     unsigned int getByteSize() const;
      
@@ -474,6 +529,19 @@ public:
      */
     PixelFormat getFormat() const { return _pixelFormat; }
 
+    /**
+     * Returns the OpenGL internal format of the compressed data of this texture.
+     *
+     * This is 0 if the texture is not compressed. A compressed texture
+     * cannot be changed with {@link set}, nor can it build mipmaps; it only
+     * has the mipmaps it was created with.
+     *
+     * @return the OpenGL internal format of the compressed data of this texture.
+     */
+    GLenum getCompression() const {
+        return (_parent != nullptr ? _parent->getCompression() : _compression);
+    }
+
     /**
      * Returns whether this texture has generated mipmaps.
      *
@@ -493,6 +561,9 @@ public:
      * texture can have mipmaps. In addition, mipmaps can only be built if the
      * texture size is a power of two.
      *
+     * A compressed texture cannot build mipmaps, and keeps the ones of the
+     * image it was created with (if any).
+     *
      * This method is only successful if the texture is currently active.
      */
     void buildMipMaps();
@@ -817,7 +888,8 @@ public:
      * Returns true if able to save the texture to the given file.
      *
      * The image will be saved as a PNG file.  If the suffix of file is not
-     * .png, then this suffix will be added.
+     * .png, then this suffix will be added. A compressed texture cannot be
+     * saved, as its blocks cannot be read back as pixels.
      *
      * This method is only successful if the texture is currently active.
      *
@@ -46,6 +46,7 @@
 #define __CU_VERTEX_BUFFER_H__
 
 #include <string>
+#include <vector>
 #include <unordered_map>
 #include <cugl/math/CUMathBase.h>
 #include <cugl/math/CUMat4.h>
@@ -76,6 +77,14 @@ class Shader;
  * buffer has attributes lacking in the shader, they will be ignored. If it is missing
  * attributes that the shader expects, the shader will use the default value
  * for the type.
+ *
+ * A vertex buffer may also stream its data (see {@link #initWithStream}).
+ * A streaming buffer allocates its storage once, as a ring of segments, and
+ * each load is written after the previous one through an unsynchronized
+ * mapping. Fences keep a segment from being overwritten while the GPU still
+ * reads it.
+ * This avoids the reallocation (and the driver stalls) of glBufferData when
+ * the buffer is reloaded every frame.
  */
 class VertexBuffer {
 private:
@@ -108,6 +117,37 @@ private:
     GLuint _vertBuffer;
     /** The index buffer for drawing a shape */
     GLuint _indxBuffer;
+
+    /**
+     * This class is a simple struct for a buffer streamed as a ring.
+     *
+     * The buffer is split into segments of the same size. Loads are written
+     * one after the other into the current segment. When a load does not fit
+     * in what is left of it, the segment is fenced and the ring moves on to
+     * the next one.
+     */
+    class Ring {
+    public:
+        /** The capacity of each segment, in elements */
+        GLsizei slice;
+        /** The segment being written */
+        GLsizei segment;
+        /** The first free element of the segment being written */
+        GLsizei cursor;
+        /** The position of the latest load in the buffer */
+        GLsizei base;
+        /** The fence of each segment, or nullptr if it is free */
+        std::vector<GLsync> fences;
+    };
+
+    /** The number of ring segments when streaming (0 if not streaming) */
+    GLsizei _segments;
+    /** The ring of the vertex buffer when streaming */
+    Ring _vertRing;
+    /** The ring of the index buffer when streaming */
+    Ring _indxRing;
+    /** The rebased indices, when the index ring cannot be mapped */
+    std::vector<GLuint> _rebased;
     
     /** The shader currently attached to this vertex buffer */
     std::shared_ptr<Shader> _shader;
@@ -117,6 +157,23 @@ private:
     /** The settings for each attribute */
     std::unordered_map<std::string, AttribData> _attributes;
     
+    /**
+     * Returns the position in the given ring for a load of the given size.
+     *
+     * The ring moves on to the next segment if the load does not fit in the
+     * current one, waiting until the GPU is done with it. The storage grows
+     * if the load does not fit in any segment. The buffer of the ring must
+     * be bound.
+     *
+     * @param ring      The ring to write
+     * @param target    The buffer target of the ring
+     * @param size      The number of elements to load
+     * @param unit      The size of an element in bytes
+     *
+     * @return the position in the given ring for a load of the given size.
+     */
+    GLsizei reserve(Ring& ring, GLenum target, GLsizei size, GLsizei unit);
+
 public:
 #pragma mark Constructors
     /**
@@ -175,6 +232,50 @@ public:
         return (result->init(stride) ? result : nullptr);
     }
 
+    /**
+     * Initializes this vertex buffer to stream data of the given stride.
+     *
+     * A streaming vertex buffer allocates its storage as a ring of segments,
+     * each large enough for the given number of vertices and indices. Every
+     * call to {@link #loadVertexData} or {@link #loadIndexData} writes its
+     * data after that of the previous call, through an unsynchronized mapping.
+     * When a load does not fit in the current segment, the segment is fenced
+     * and the load moves on to the next one, waiting until the GPU is done
+     * with it. With three segments, the CPU can fill one segment while the
+     * GPU draws the other two. The ring grows if a load does not fit in a
+     * segment at all.
+     *
+     * Indices are always relative to the vertices of the latest load, just
+     * as for a buffer that is not streaming. The offsets of the draw calls
+     * are also unchanged.
+     *
+     * @param stride    The size of a single piece of vertex data.
+     * @param vertices  The vertex capacity of each segment
+     * @param indices   The index capacity of each segment
+     * @param segments  The number of segments in the ring
+     *
+     * @return true if initialization was successful.
+     */
+    bool initWithStream(GLsizei stride, GLsizei vertices, GLsizei indices, GLsizei segments=3);
+
+    /**
+     * Returns a new vertex buffer to stream data of the given stride.
+     *
+     * See {@link #initWithStream} for a description of streaming.
+     *
+     * @param stride    The size of a single piece of vertex data.
+     * @param vertices  The vertex capacity of each segment
+     * @param indices   The index capacity of each segment
+     * @param segments  The number of segments in the ring
+     *
+     * @return a new vertex buffer to stream data of the given stride.
+     */
+    static std::shared_ptr<VertexBuffer> allocWithStream(GLsizei stride, GLsizei vertices,
+                                                         GLsizei indices, GLsizei segments=3) {
+        std::shared_ptr<VertexBuffer> result = std::make_shared<VertexBuffer>();
+        return (result->initWithStream(stride,vertices,indices,segments) ? result : nullptr);
+    }
+
 
 #pragma mark -
 #pragma mark Binding
@@ -251,6 +352,15 @@ public:
      * @return the stride of this vertex buffer
      */
      GLsizei getStride() const { return _stride; }
+
+    /**
+     * Returns true if this vertex buffer streams its data.
+     *
+     * See {@link #initWithStream} for a description of streaming.
+     *
+     * @return true if this vertex buffer streams its data.
+     */
+    bool isStreaming() const { return _segments > 0; }
     
     /**
      * Loads the given vertex buffer with data.
@@ -271,6 +381,10 @@ public:
      * can amortize the uniform changes.  For quads and other simple meshes, 
      * you should always choose GL_STREAM_DRAW.
      *
+     * If this buffer is streaming, the usage is ignored. The data is written
+     * after the latest load in the ring, and the indices must be loaded again
+     * after it.
+     *
      * This method will only succeed if this buffer is actively bound.
      *
      * @param data  The data to load
@@ -299,6 +413,10 @@ public:
      * you should always choose GL_STREAM_DRAW and push as much computation to the
      * CPU as possible.
      *
+     * If this buffer is streaming, the usage is ignored. The indices are
+     * written after the latest load in the ring, and refer to the latest
+     * vertex data.
+     *
      * This method will only succeed if this buffer is actively bound.
      *
      * @param data  The indices to load
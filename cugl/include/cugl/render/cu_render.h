@@ -30,6 +30,7 @@
 
 #include "CUSpriteVertex.h"
 #include "CUTexture.h"
+#include "CUCompressedImage.h"
 #include "CUMesh.h"
 #include "CUScissor.h"
 #include "CUGradient.h"
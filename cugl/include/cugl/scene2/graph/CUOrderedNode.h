@@ -621,6 +621,17 @@ public:
         render(batch,Affine2::IDENTITY,Color4::WHITE);
     }
 
+protected:
+    /**
+     * Returns true, as this node renders its children itself.
+     *
+     * The children may be drawn in any order, so they cannot be part of the
+     * render list of an ancestor.
+     *
+     * @return true, as this node renders its children itself.
+     */
+    virtual bool rendersChildren() const override { return true; }
+
     /** This macro disables the copy constructor (not allowed on scene graphs) */
     CU_DISALLOW_COPY_AND_ASSIGN(OrderedNode);
 };
@@ -132,6 +132,12 @@ protected:
     
     /** An optional scissor value */
     std::shared_ptr<Scissor> _scissor;
+    /** The scissor (in node space) that was last transformed for rendering */
+    Scissor _clipSource;
+    /** The global transform that _clipSource was last transformed by */
+    Affine2 _clipMatrix;
+    /** The cached scissor _clipSource transformed by _clipMatrix */
+    Scissor _clipped;
     
     /**
      * The scale of this node.
@@ -172,6 +178,15 @@ protected:
      * alternate transform.
      */
     Affine2  _combined;
+
+    /**
+     * The stamp of the local transform.
+     *
+     * This value changes whenever the local transform does. A render list
+     * compares it to the stamp it last saw to tell which of its cached
+     * world transforms are out of date.
+     */
+    Uint32 _stamp;
     
     /** The array of children nodes */
     std::vector<std::shared_ptr<SceneNode>> _children;
@@ -218,6 +233,47 @@ protected:
 
     /** The defining JSON data for this node (if any) */
     std::shared_ptr<JsonValue> _json;
+
+private:
+    /**
+     * This class is a simple struct for an entry of a render list.
+     *
+     * A render list is the subtree of a node flattened in pre-order, so
+     * that the entries of the descendants of an entry are the ones just
+     * after it, up to its end. Each entry caches the world transform of its
+     * node, which is only recomputed when the stamp of the node or the
+     * world transform of its parent changes.
+     */
+    class RenderEntry {
+    public:
+        /** The node of this entry */
+        SceneNode* node;
+        /** The position of the parent entry (unused for the root) */
+        Uint32 parent;
+        /** The position after the last descendant of this entry */
+        Uint32 end;
+        /** The stamp of the node when the world transform was computed */
+        Uint32 stamp;
+        /** Whether the world transform must be recomputed */
+        bool stale;
+        /** Whether the world transform was recomputed in this render */
+        bool moved;
+        /** Whether the node renders its own subtree (see rendersChildren) */
+        bool barrier;
+        /** The cached world transform of the node */
+        Affine2 world;
+        /** The tint of the node in this render */
+        Color4 tint;
+    };
+
+    /** The render list of this node, when it is rendered as a root */
+    std::vector<RenderEntry> _renderList;
+    /** The ends of the render list scopes with an active scissor */
+    std::vector<Uint32> _renderClips;
+    /** The global transform of the latest render */
+    Affine2 _renderBase;
+    /** Whether the tree below this node changed since the last render */
+    bool _renderDirty;
     
 
 #pragma mark -
@@ -1845,6 +1901,13 @@ public:
      * define custom drawing code. In fact, overriding this method can break
      * the functionality of {@link OrderedNode}.
      *
+     * This node keeps its subtree as a flattened render list, which is only
+     * rebuilt when a child is added or removed below it. The world transform
+     * of each node is cached in the list, and only recomputed when its
+     * transform or that of an ancestor changes. Descendants are drawn with
+     * {@link #draw}, unless {@link #rendersChildren} is true for them. So a
+     * subclass that overrides this method must also override that one.
+     *
      * @param batch     The SpriteBatch to draw with.
      * @param transform The global transformation matrix.
      * @param tint      The tint to blend with the Node color.
@@ -1889,8 +1952,36 @@ public:
      * @param tint      The tint to blend with the Node color.
      */
     virtual void draw(const std::shared_ptr<SpriteBatch>& batch, const Affine2& transform, Color4 tint) {}
-    
-    
+
+protected:
+    /**
+     * Pushes a scissor of this node on the scissor stack of the SpriteBatch.
+     *
+     * The scissor is in the coordinate system of this node, and is applied
+     * with the given global transform. The transformed scissor is cached, so
+     * that it is only recomputed when the scissor or the transform changes.
+     * The caller must pop the scissor with {@link SpriteBatch#popScissor}
+     * once this node and its children are drawn.
+     *
+     * @param batch     The SpriteBatch to draw with.
+     * @param scissor   The scissor in the coordinate system of this node.
+     * @param transform The global transformation matrix.
+     */
+    void pushScissor(const std::shared_ptr<SpriteBatch>& batch, const Scissor& scissor, const Affine2& transform);
+
+    /**
+     * Returns true if this node renders its children itself.
+     *
+     * A node that returns true is a barrier in the render list of its
+     * ancestors: its {@link #render} method is called in place of
+     * {@link #draw}, and it is responsible for its whole subtree. This must
+     * be true for any subclass that overrides {@link #render}.
+     *
+     * @return true if this node renders its children itself.
+     */
+    virtual bool rendersChildren() const { return false; }
+
+public:
 #pragma mark -
 #pragma mark Layout Automation
     /**
@@ -1964,6 +2055,26 @@ private:
      */
     void pushScene(Scene2* scene);
 
+    /**
+     * Marks the render lists of this node and its ancestors as out of date.
+     *
+     * This must be called whenever a child is added or removed, as any
+     * ancestor may have been rendered as a root.
+     */
+    void invalidateRenderList();
+
+    /**
+     * Appends this node and its descendants to the given render list.
+     *
+     * The entries are appended in pre-order. The subtree of a barrier (see
+     * {@link #rendersChildren}) is not appended, unless it is the root.
+     *
+     * @param list      The render list to append to
+     * @param parent    The position of the parent entry
+     * @param root      Whether this node is the root of the list
+     */
+    void flatten(std::vector<RenderEntry>& list, Uint32 parent, bool root);
+
     /**
      * Updates the node to parent transform.
      *
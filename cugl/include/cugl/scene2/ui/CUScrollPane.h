@@ -896,6 +896,17 @@ public:
     virtual void render(const std::shared_ptr<SpriteBatch>& batch) override {
         render(batch,Affine2::IDENTITY,Color4::WHITE);
     }
+
+protected:
+    /**
+     * Returns true, as this node renders its children itself.
+     *
+     * The children are offset by the pane transform and clipped by the mask,
+     * so they cannot be part of the render list of an ancestor.
+     *
+     * @return true, as this node renders its children itself.
+     */
+    virtual bool rendersChildren() const override { return true; }
 };
     }
 }
@@ -52,11 +52,13 @@ using namespace cugl;
 #pragma mark -
 #pragma mark Constructors
 /**
- * Initializes a new asset manager with two auxiliary threads.
+ * Initializes a new asset manager with a thread per core.
  *
- * The asset manager will have a thread pool of size 2, giving it two
- * threads to load assets asynchronously.  These threads have no effect on
- * synchronous loading and will sleep when no assets are being loaded.
+ * The asset manager will have one thread to read asset directories, and
+ * one decoding thread per core beyond the main thread.  Textures, sounds
+ * and JSON files are decoded in parallel on the decoding threads.  These
+ * threads have no effect on synchronous loading and will sleep when no
+ * assets are being loaded.
  *
  * This initializer does not attach any loaders.  It simply creates an
  * object that is ready to accept loader objects.
@@ -64,7 +66,28 @@ using namespace cugl;
  * @return true if the asset manager was initialized successfully
  */
 bool AssetManager::init() {
+    return init(std::max(SDL_GetCPUCount()-1,1));
+}
+
+/**
+ * Initializes a new asset manager with the given number of decoding threads.
+ *
+ * The asset manager will have one thread to read asset directories, and
+ * the given number of decoding threads for the loaders that can preload
+ * in parallel.  If threads is 0, every loader uses the directory thread,
+ * so assets are decoded one at a time.  These threads have no effect on
+ * synchronous loading and will sleep when no assets are being loaded.
+ *
+ * This initializer does not attach any loaders.  It simply creates an
+ * object that is ready to accept loader objects.
+ *
+ * @param threads   The number of decoding threads
+ *
+ * @return true if the asset manager was initialized successfully
+ */
+bool AssetManager::init(unsigned int threads) {
     _workers = ThreadPool::alloc(1);
+    _decoders = threads > 0 ? ThreadPool::alloc(threads) : nullptr;
     return true;
 }
 
@@ -77,7 +100,12 @@ bool AssetManager::init() {
  */
 void AssetManager::dispose() {
     detachAll();
+    _groups.clear();
+    _holds.clear();
     _workers = nullptr;
+    _decoders = nullptr;
+    std::unique_lock<std::mutex> lk(_uploadMutex);
+    _uploads.clear();
 }
 
 #pragma mark -
@@ -157,9 +185,10 @@ bool AssetManager::readCategory(size_t hash, const std::shared_ptr<JsonValue>& j
  * @param hash      The hash of the asset type
  * @param json      The child of asset directory with these assets
  * @param callback  An optional callback after each asset is loaded
+ * @param queued    The list to append the queued assets to
  */
 void AssetManager::readCategory(size_t hash, const std::shared_ptr<JsonValue>& json,
-                                LoaderCallback callback) {
+                                LoaderCallback callback, AssetList& queued) {
     auto it = _handlers.find(hash);
     std::shared_ptr<BaseLoader> loader = it->second;
     if (loader == nullptr) {
@@ -175,6 +204,7 @@ void AssetManager::readCategory(size_t hash, const std::shared_ptr<JsonValue>& j
     for(int ii = 0; ii < json->size(); ii++) {
         std::shared_ptr<JsonValue> child = json->get(ii);
         loader->loadAsync(child, callback);
+        queued.push_back(std::make_pair(hash,child->key()));
     }
 }
 
@@ -212,20 +242,74 @@ bool AssetManager::purgeCategory(size_t hash, const std::shared_ptr<JsonValue>&
 }
 
 /**
- * Synchronizes the asset manager to wait until all assets have finished.
+ * Synchronizes the asset manager to wait until the given assets have finished.
  *
  * This method is necessary for assets whose construction depends on
- * previously loaded assets (e.g. scene graphs).  In the current architecture,
- * this method is only correct if the asset manager loads assets in a
- * single thread.
+ * previously loaded assets (e.g. scene graphs).  Assets queued on the
+ * directory thread after a sync are not loaded until the given assets,
+ * including the ones preloading on the decoding threads, have been
+ * materialized.  Other assets still decoding, such as the prefetch of
+ * another group, do not hold up the sync.
+ *
+ * @param assets    The assets to wait for
  */
-void AssetManager::sync() {
+void AssetManager::sync(const AssetList& assets) {
     _workers->addTask([=](void) {
+        this->drain(assets);
         this->block();
         this->block(); // Two blocks force one complete cycle
     });
 }
 
+/**
+ * Blocks the calling thread until none of the given assets is left to
+ * load in the parallel loaders.
+ *
+ * This method is used to implement the {@link sync()} method.  It must
+ * not be called in the main thread.
+ *
+ * @param assets    The assets to wait for
+ */
+void AssetManager::drain(const AssetList& assets) {
+    if (_decoders == nullptr || assets.empty()) {
+        return;
+    }
+    // The loaders may only be inspected in the main thread
+    _wait = true;
+    Application::get()->schedule([=](void){
+        if (this->isDecoding(assets)) {
+            return true;
+        }
+        this->resume();
+        return false;
+    });
+    while (_wait) {
+        int delay = (int)(500/Application::get()->getFPS());
+        SDL_Delay(delay);
+    }
+}
+
+/**
+ * Returns true if any of the given assets is still loading in the
+ * parallel loaders.
+ *
+ * This method must be called in the main thread.
+ *
+ * @param assets    The assets to check
+ *
+ * @return true if any of the given assets is still loading in the parallel loaders.
+ */
+bool AssetManager::isDecoding(const AssetList& assets) const {
+    for(auto it = assets.begin(); it != assets.end(); ++it) {
+        auto jt = _handlers.find(it->first);
+        if (jt != _handlers.end() && jt->second != nullptr &&
+            jt->second->getThreadPool() == _decoders && jt->second->isLoading(it->second)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * Blocks the asset manager until the next animation frame.
  *
@@ -234,11 +318,12 @@ void AssetManager::sync() {
  * to implement the {@link sync()} method.
  */
 void AssetManager::block() {
+    // Set before scheduling, or a fast callback could be missed
+    _wait = true;
     Application::get()->schedule([=](void){
         this->resume();
         return false;
     });
-    _wait = true;
     while (_wait) {
         int delay = (int)(500/Application::get()->getFPS());
         SDL_Delay(delay);
@@ -334,13 +419,11 @@ bool AssetManager::loadDirectory(const std::shared_ptr<JsonValue>& json) {
  * @return true if all assets specified in the directory were successfully loaded.
  */
 bool AssetManager::loadDirectory(const std::string& directory) {
-    std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(directory);
-    if (reader == nullptr) {
+    std::shared_ptr<JsonValue> json = JsonLoader::readAsset(directory);
+    if (json == nullptr) {
         CULogError("No asset directory located at '%s'",directory.c_str());
         return false;
     }
-    
-    std::shared_ptr<JsonValue> json = reader->readJson();
     return loadDirectory(json);
 }
 
@@ -377,18 +460,19 @@ bool AssetManager::loadDirectory(const std::string& directory) {
  * @param callback  An optional callback after each asset is loaded
  */
 void AssetManager::loadDirectoryAsync(const std::shared_ptr<JsonValue>& json, LoaderCallback callback) {
+    AssetList queued;
     for(int ii = 0; ii < json->size(); ii++) {
         std::shared_ptr<JsonValue> child = json->get(ii);
         if (child->key() == "textures") {
-            readCategory(typeid(Texture).hash_code(),child,callback);
+            readCategory(typeid(Texture).hash_code(),child,callback,queued);
         } else if (child->key() == "sounds") {
-            readCategory(typeid(Sound).hash_code(),child,callback);
+            readCategory(typeid(Sound).hash_code(),child,callback,queued);
         } else if (child->key() == "fonts") {
-            readCategory(typeid(Font).hash_code(),child,callback);
+            readCategory(typeid(Font).hash_code(),child,callback,queued);
         } else if (child->key() == "jsons") {
-            readCategory(typeid(JsonValue).hash_code(),child,callback);
+            readCategory(typeid(JsonValue).hash_code(),child,callback,queued);
         } else if (child->key() == "widgets") {
-            readCategory(typeid(WidgetValue).hash_code(),child,callback);
+            readCategory(typeid(WidgetValue).hash_code(),child,callback,queued);
         } else if (child->key() != "scene2s") {
             CULogError("Unknown asset category '%s'",child->key().c_str());
         }
@@ -396,9 +480,9 @@ void AssetManager::loadDirectoryAsync(const std::shared_ptr<JsonValue>& json, Lo
     
     // Scenes are read after everything else.
     std::shared_ptr<JsonValue> child = json->get("scene2s");
-    sync();
+    sync(queued);
     if (child) {
-        readCategory(typeid(scene2::SceneNode).hash_code(),child,callback);
+        readCategory(typeid(scene2::SceneNode).hash_code(),child,callback,queued);
     }
 }
 
@@ -437,14 +521,20 @@ void AssetManager::loadDirectoryAsync(const std::shared_ptr<JsonValue>& json, Lo
 void AssetManager::loadDirectoryAsync(const std::string& directory, LoaderCallback callback) {
     _preload = true;
     
-    std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(directory);
-    if (reader == nullptr && callback != nullptr) {
-        callback("",false);
-        return;
-    }
-    
+    // The directory is read by a worker, as even the baked copy can be large
     _workers->addTask([=](void) {
-        std::shared_ptr<JsonValue> json = reader->readJson();
+        std::shared_ptr<JsonValue> json = JsonLoader::readAsset(directory);
+        if (json == nullptr) {
+            CULogError("No asset directory located at '%s'",directory.c_str());
+            _preload = false;
+            if (callback != nullptr) {
+                Application::get()->schedule([=](void) {
+                    callback("",false);
+                    return false;
+                });
+            }
+            return;
+        }
         loadDirectoryAsync(json,callback);
         _preload = false;
     });
@@ -496,16 +586,542 @@ bool AssetManager::unloadDirectory(const std::shared_ptr<JsonValue>& json) {
  * @param directory The path to the JSON asset directory
  */
 bool AssetManager::unloadDirectory(const std::string& directory) {
-    std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(directory);
-    if (reader == nullptr) {
+    std::shared_ptr<JsonValue> json = JsonLoader::readAsset(directory);
+    if (json == nullptr) {
         CULogError("No asset directory located at '%s'",directory.c_str());
         return false;
     }
-    
-    std::shared_ptr<JsonValue> json = reader->readJson();
     return unloadDirectory(json);
 }
 
+#pragma mark -
+#pragma mark Group Support
+/**
+ * Returns the hash of the asset type for a category of an asset directory.
+ *
+ * The category names are the ones listed in {@link loadDirectory}.
+ *
+ * @param category  The name of the asset category
+ *
+ * @return the hash of the asset type, or 0 if the category is unknown.
+ */
+size_t AssetManager::categoryHash(const std::string& category) {
+    if (category == "textures") {
+        return typeid(Texture).hash_code();
+    } else if (category == "sounds") {
+        return typeid(Sound).hash_code();
+    } else if (category == "fonts") {
+        return typeid(Font).hash_code();
+    } else if (category == "jsons") {
+        return typeid(JsonValue).hash_code();
+    } else if (category == "widgets") {
+        return typeid(WidgetValue).hash_code();
+    } else if (category == "scene2s") {
+        return typeid(scene2::SceneNode).hash_code();
+    }
+    return 0;
+}
+
+/**
+ * Acquires the assets of a group directory, loading those not yet present.
+ *
+ * Each asset in the directory gains a hold.  An asset is only loaded on
+ * its first hold, and only if no loader has it already.  In asynchronous
+ * mode the group waits for every asset of it still loading, including the
+ * ones that another group started, and scene graphs are loaded after every
+ * other asset of the group has been materialized.
+ *
+ * @param group The group to acquire the assets for
+ * @param async Whether to load the assets asynchronously
+ *
+ * @return true if every asset is (or is being) loaded.
+ */
+bool AssetManager::acquireGroup(const std::shared_ptr<Group>& group, bool async) {
+    bool success = true;
+    AssetList acquired;
+    std::shared_ptr<JsonValue> json = group->directory;
+    for(int ii = 0; ii < json->size(); ii++) {
+        std::shared_ptr<JsonValue> child = json->get(ii);
+        size_t hash = categoryHash(child->key());
+        if (hash == 0) {
+            CULogError("Unknown asset category '%s'",child->key().c_str());
+            success = false;
+        } else if (!async || child->key() != "scene2s") {
+            for(int jj = 0; jj < child->size(); jj++) {
+                success = acquireAsset(hash,child->get(jj),group,async) && success;
+                acquired.push_back(std::make_pair(hash,child->get(jj)->key()));
+            }
+        }
+    }
+
+    // Scenes are read after everything else.
+    std::shared_ptr<JsonValue> scenes = json->get("scene2s");
+    if (async && scenes != nullptr) {
+        sync(acquired);
+        size_t hash = typeid(scene2::SceneNode).hash_code();
+        for(int jj = 0; jj < scenes->size(); jj++) {
+            success = acquireAsset(hash,scenes->get(jj),group,async) && success;
+        }
+    }
+    return success;
+}
+
+/**
+ * Acquires a single asset for a group, loading it if necessary.
+ *
+ * This is a helper for {@link acquireGroup}. An asset that is loading
+ * outside of groups is not loaded again. An asynchronous group waits for
+ * it instead, while a synchronous group fails.
+ *
+ * @param hash  The hash of the asset type
+ * @param json  The directory entry of the asset
+ * @param group The group to acquire the asset for
+ * @param async Whether to load the asset asynchronously
+ *
+ * @return true if the asset is (or is being) loaded.
+ */
+bool AssetManager::acquireAsset(size_t hash, const std::shared_ptr<JsonValue>& json,
+                                const std::shared_ptr<Group>& group, bool async) {
+    auto it = _handlers.find(hash);
+    if (it == _handlers.end() || it->second == nullptr) {
+        CULogError("No loader for hash %zu",hash);
+        return false;
+    }
+
+    std::shared_ptr<BaseLoader> loader = it->second;
+    std::string key = json->key();
+    Hold& hold = _holds[hash][key];
+    hold.references++;
+    if (hold.loading) {
+        // Another group is loading it; a synchronous load cannot wait
+        group->pending++;
+        hold.waiting.push_back(group);
+        return async;
+    } else if (hold.references > 1) {
+        return true;
+    } else if (loader->contains(key)) {
+        hold.owned = false;
+        return true;
+    } else if (loader->isLoading(key)) {
+        // Loading outside of groups, so there is no callback to join
+        hold.owned = false;
+        if (!async) {
+            return false;
+        }
+        hold.loading = true;
+        group->pending++;
+        hold.waiting.push_back(group);
+        Application::get()->schedule([=](void){
+            if (loader->isLoading(key)) {
+                return true;
+            }
+            this->finishAsset(hash,key,loader->contains(key));
+            return false;
+        });
+        return true;
+    }
+
+    hold.owned = true;
+    if (!async) {
+        return loader->load(json);
+    }
+    hold.loading = true;
+    group->pending++;
+    hold.waiting.push_back(group);
+    bool queued = loader->loadAsync(json, [=](const std::string& asset, bool success) {
+        this->finishAsset(hash,key,success);
+    });
+    if (!queued && hold.loading) {
+        // Refused, or loaded at once; either way there is no callback
+        hold.loading = false;
+        hold.waiting.clear();
+        group->pending--;
+        return loader->contains(key);
+    }
+    return true;
+}
+
+/**
+ * Records that an asynchronously loaded asset of a group has finished.
+ *
+ * Every group waiting on the asset is notified. If a group loaded the
+ * asset, it is unloaded right away when all of its groups were unloaded
+ * while it was loading.
+ *
+ * @param hash      The hash of the asset type
+ * @param key       The asset key
+ * @param success   Whether the asset loaded successfully
+ */
+void AssetManager::finishAsset(size_t hash, const std::string& key, bool success) {
+    auto it = _holds.find(hash);
+    if (it == _holds.end()) {
+        return;
+    }
+    auto jt = it->second.find(key);
+    if (jt == it->second.end()) {
+        return;
+    }
+
+    std::vector<std::shared_ptr<Group>> waiting;
+    waiting.swap(jt->second.waiting);
+    jt->second.loading = false;
+    if (jt->second.references == 0) {
+        auto loader = _handlers.find(hash);
+        if (jt->second.owned && loader != _handlers.end() && loader->second != nullptr) {
+            loader->second->unload(key);
+        }
+        it->second.erase(jt);
+    }
+
+    for(auto group = waiting.begin(); group != waiting.end(); ++group) {
+        finishGroup(*group,success);
+    }
+}
+
+/**
+ * Records that a group has one less asset loading asynchronously.
+ *
+ * When no asset is left, the callbacks of the group are called, unless
+ * the group has been unloaded in the meantime.
+ *
+ * @param group     The group waiting on the asset
+ * @param success   Whether the asset loaded successfully
+ */
+void AssetManager::finishGroup(const std::shared_ptr<Group>& group, bool success) {
+    group->success = group->success && success;
+    if (--group->pending > 0 || group->references == 0) {
+        return;
+    }
+
+    std::vector<LoaderCallback> callbacks;
+    callbacks.swap(group->callbacks);
+    for(auto it = callbacks.begin(); it != callbacks.end(); ++it) {
+        (*it)(group->name,group->success);
+    }
+}
+
+/**
+ * Releases the holds of a group, unloading the assets no group holds.
+ *
+ * @param group The group to release the assets for
+ *
+ * @return true if all of the released assets were unloaded.
+ */
+bool AssetManager::releaseGroup(const std::shared_ptr<Group>& group) {
+    bool success = true;
+    std::shared_ptr<JsonValue> json = group->directory;
+    for(int ii = 0; ii < json->size(); ii++) {
+        std::shared_ptr<JsonValue> child = json->get(ii);
+        size_t hash = categoryHash(child->key());
+        auto it = _holds.find(hash);
+        if (it == _holds.end()) {
+            continue;
+        }
+
+        auto loader = _handlers.find(hash);
+        for(int jj = 0; jj < child->size(); jj++) {
+            std::string key = child->get(jj)->key();
+            auto jt = it->second.find(key);
+            if (jt == it->second.end() || --jt->second.references > 0) {
+                continue;
+            }
+            if (jt->second.loading) {
+                // Unloaded by finishAsset when it arrives
+                continue;
+            }
+            if (jt->second.owned && loader != _handlers.end() && loader->second != nullptr) {
+                success = loader->second->unload(key) && success;
+            }
+            it->second.erase(jt);
+        }
+    }
+    return success;
+}
+
+/**
+ * Synchronously loads the assets of a directory as a named group.
+ *
+ * Groups let a game keep only the assets of the current scene (or level,
+ * or biome) in memory.  A group is an asset directory in the format of
+ * {@link loadDirectory}, and it is reference counted: every call to this
+ * method must be matched by a call to {@link unloadGroup} with the same
+ * name.  If the group is already loaded, this method only adds to its
+ * count and the directory is ignored.
+ *
+ * Groups may share assets.  Each asset is loaded by the first group that
+ * needs it and unloaded with the last group holding it.  An asset that
+ * was loaded outside of groups (e.g. by {@link loadDirectory}) is never
+ * unloaded by a group.
+ *
+ * This method does not wait for assets that another group is still
+ * loading asynchronously.  It returns false in that case, as it does if
+ * any asset fails to load.
+ *
+ * @param name  The name of the group
+ * @param json  The JSON asset directory of the group
+ *
+ * @return true if all assets of the group were successfully loaded.
+ */
+bool AssetManager::loadGroup(const std::string& name, const std::shared_ptr<JsonValue>& json) {
+    auto it = _groups.find(name);
+    if (it != _groups.end()) {
+        it->second->references++;
+        return it->second->pending == 0 && it->second->success;
+    } else if (json == nullptr) {
+        return false;
+    }
+
+    std::shared_ptr<Group> group = std::make_shared<Group>();
+    group->name = name;
+    group->directory = json;
+    group->references = 1;
+    group->pending = 0;
+    group->success = true;
+    _groups[name] = group;
+    group->success = acquireGroup(group,false);
+    return group->success;
+}
+
+/**
+ * Synchronously loads the assets of a directory as a named group.
+ *
+ * Groups let a game keep only the assets of the current scene (or level,
+ * or biome) in memory.  A group is an asset directory in the format of
+ * {@link loadDirectory}, and it is reference counted: every call to this
+ * method must be matched by a call to {@link unloadGroup} with the same
+ * name.  If the group is already loaded, this method only adds to its
+ * count and the directory is not read.
+ *
+ * Groups may share assets.  Each asset is loaded by the first group that
+ * needs it and unloaded with the last group holding it.  An asset that
+ * was loaded outside of groups (e.g. by {@link loadDirectory}) is never
+ * unloaded by a group.
+ *
+ * This method does not wait for assets that another group is still
+ * loading asynchronously.  It returns false in that case, as it does if
+ * any asset fails to load.
+ *
+ * @param name      The name of the group
+ * @param directory The path to the JSON asset directory of the group
+ *
+ * @return true if all assets of the group were successfully loaded.
+ */
+bool AssetManager::loadGroup(const std::string& name, const std::string& directory) {
+    if (hasGroup(name)) {
+        return loadGroup(name,std::shared_ptr<JsonValue>());
+    }
+
+    std::shared_ptr<JsonValue> json = JsonLoader::readAsset(directory);
+    if (json == nullptr) {
+        CULogError("No asset directory located at '%s'",directory.c_str());
+        return false;
+    }
+    return loadGroup(name,json);
+}
+
+/**
+ * Asynchronously loads the assets of a directory as a named group.
+ *
+ * This is the asynchronous version of {@link loadGroup}, and the way to
+ * prefetch the group of the next scene while the current one plays.  The
+ * group counts as loaded as soon as this method returns, so it must be
+ * matched by a call to {@link unloadGroup} like a synchronous load.  Use
+ * {@link isGroupLoaded} or the callback to know when its assets are safe
+ * to access.  If the group is unloaded before it finishes, its assets are
+ * unloaded as they arrive.
+ *
+ * The optional callback function is called once, with the group name as
+ * the key, when every asset of the group has finished loading (at once
+ * if the group is already loaded).  It is successful only if every asset
+ * loaded successfully.
+ *
+ * @param name      The name of the group
+ * @param json      The JSON asset directory of the group
+ * @param callback  An optional callback after the group is loaded
+ */
+void AssetManager::loadGroupAsync(const std::string& name, const std::shared_ptr<JsonValue>& json,
+                                  LoaderCallback callback) {
+    auto it = _groups.find(name);
+    if (it != _groups.end()) {
+        std::shared_ptr<Group> group = it->second;
+        group->references++;
+        if (callback != nullptr && group->pending == 0) {
+            callback(name,group->success);
+        } else if (callback != nullptr) {
+            group->callbacks.push_back(callback);
+        }
+        return;
+    } else if (json == nullptr) {
+        if (callback != nullptr) {
+            callback(name,false);
+        }
+        return;
+    }
+
+    std::shared_ptr<Group> group = std::make_shared<Group>();
+    group->name = name;
+    group->directory = json;
+    group->references = 1;
+    group->success = true;
+    if (callback != nullptr) {
+        group->callbacks.push_back(callback);
+    }
+    _groups[name] = group;
+
+    // Hold the group open until every asset is queued
+    group->pending = 1;
+    bool success = acquireGroup(group,true);
+    finishGroup(group,success);
+}
+
+/**
+ * Asynchronously loads the assets of a directory as a named group.
+ *
+ * This is the asynchronous version of {@link loadGroup}, and the way to
+ * prefetch the group of the next scene while the current one plays.  The
+ * group counts as loaded as soon as this method returns, so it must be
+ * matched by a call to {@link unloadGroup} like a synchronous load.  Use
+ * {@link isGroupLoaded} or the callback to know when its assets are safe
+ * to access.  If the group is unloaded before it finishes, its assets are
+ * unloaded as they arrive.
+ *
+ * The directory file itself is read in the calling thread, as a group
+ * must be registered before this method returns.  Only the assets are
+ * loaded in the background.
+ *
+ * The optional callback function is called once, with the group name as
+ * the key, when every asset of the group has finished loading (at once
+ * if the group is already loaded).  It is successful only if every asset
+ * loaded successfully.
+ *
+ * @param name      The name of the group
+ * @param directory The path to the JSON asset directory of the group
+ * @param callback  An optional callback after the group is loaded
+ */
+void AssetManager::loadGroupAsync(const std::string& name, const std::string& directory,
+                                  LoaderCallback callback) {
+    if (hasGroup(name)) {
+        loadGroupAsync(name,std::shared_ptr<JsonValue>(),callback);
+        return;
+    }
+
+    std::shared_ptr<JsonValue> json = JsonLoader::readAsset(directory);
+    if (json == nullptr) {
+        CULogError("No asset directory located at '%s'",directory.c_str());
+        if (callback != nullptr) {
+            callback(name,false);
+        }
+        return;
+    }
+    loadGroupAsync(name,json,callback);
+}
+
+/**
+ * Unloads a group previously loaded with {@link loadGroup}.
+ *
+ * This only removes one reference to the group.  When the last reference
+ * is removed, every asset held by no other group is unloaded, unless it
+ * was loaded outside of groups.  As with {@link unloadDirectory}, assets
+ * with active smart pointers may remain in memory, but the rest of the
+ * program can no longer access them.
+ *
+ * @param name  The name of the group
+ *
+ * @return true if the group was loaded (and its assets were unloaded).
+ */
+bool AssetManager::unloadGroup(const std::string& name) {
+    auto it = _groups.find(name);
+    if (it == _groups.end()) {
+        return false;
+    }
+
+    std::shared_ptr<Group> group = it->second;
+    if (--group->references > 0) {
+        return true;
+    }
+    _groups.erase(it);
+    group->callbacks.clear();
+    return releaseGroup(group);
+}
+
+#pragma mark -
+#pragma mark Upload Budget
+/**
+ * Queues the materialize step of an asynchronous load.
+ *
+ * The step runs in the main thread, in queue order, within the upload
+ * budget of a later animation frame.  Loaders call this through
+ * {@link BaseLoader#scheduleUpload}.  This method may be called from any
+ * thread.
+ *
+ * @param task  The materialize step
+ */
+void AssetManager::upload(const std::function<void()>& task) {
+    std::unique_lock<std::mutex> lk(_uploadMutex);
+    _uploads.push_back(task);
+    if (!_uploading) {
+        _uploading = true;
+        Application::get()->schedule([=](void){
+            return this->processUploads();
+        });
+    }
+}
+
+/**
+ * Runs queued materialize steps until the upload budget is spent.
+ *
+ * This method is scheduled in the main thread while the upload queue is
+ * not empty.
+ *
+ * @return true if steps remain for the next animation frame.
+ */
+bool AssetManager::processUploads() {
+    Timestamp start;
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lk(_uploadMutex);
+            if (_uploads.empty()) {
+                _uploading = false;
+                return false;
+            }
+            task = std::move(_uploads.front());
+            _uploads.pop_front();
+        }
+        task();
+        Timestamp now;
+        if (Timestamp::ellapsedMicros(start,now) >= _uploadBudget) {
+            std::unique_lock<std::mutex> lk(_uploadMutex);
+            _uploading = !_uploads.empty();
+            return _uploading;
+        }
+    }
+}
+
+/**
+ * Schedules the materialize step of an asynchronous load.
+ *
+ * The step runs in the main CUGL thread. If this loader has an asset
+ * manager, the step joins its upload queue, which only runs as many
+ * steps per frame as fit in the upload budget (see
+ * {@link AssetManager#setUploadBudget}). Otherwise it runs in the next
+ * animation frame via {@link Application#schedule}.
+ *
+ * This method may be called from any thread.
+ *
+ * @param task  The materialize step
+ */
+void BaseLoader::scheduleUpload(const std::function<void()>& task) {
+    if (_manager != nullptr) {
+        _manager->upload(task);
+        return;
+    }
+    Application::get()->schedule([=](void){
+        task();
+        return false;
+    });
+}
+
 #pragma mark -
 #pragma mark Progress Monitoring
 /**
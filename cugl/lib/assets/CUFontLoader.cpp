@@ -179,7 +179,7 @@ std::shared_ptr<Font> FontLoader::preload(const std::shared_ptr<JsonValue>& json
  * This method finishes the asset loading started in {@link preload}.  As
  * atlas generation requires OpenGL, this step is not safe to be done in a
  * separate thread.  Instead, it takes place in the main CUGL thread via
- ( {@link Application#schedule}.
+ ( {@link BaseLoader#scheduleUpload}.
  *
  * The font atlas will use the default character set.
  *
@@ -243,9 +243,8 @@ bool FontLoader::read(const std::string key, const std::string source, int size,
     } else {
         _loader->addTask([=](void) {
             std::shared_ptr<Font> font = this->preload(source,_charset,size);
-            Application::get()->schedule([=](void){
+            scheduleUpload([=](void){
                 this->materialize(key,font,callback);
-                return false;
             });
         });
     }
@@ -302,9 +301,8 @@ bool FontLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback cal
     } else {
         _loader->addTask([=](void) {
             std::shared_ptr<Font> font = this->preload(json);
-            Application::get()->schedule([=](void){
+            scheduleUpload([=](void){
                 this->materialize(key,font,callback);
-                return false;
             });
         });
     }
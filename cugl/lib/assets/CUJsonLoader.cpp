@@ -6,6 +6,11 @@
 //  (non-directory) json assets.  It is essentially a wrapper around JsonReader
 //  that allows it to be used with AssetManager.
 //
+//  Each JSON file may have a baked copy, written with BinaryWriter::writeJson
+//  next to it with the suffix .jsonb. The loader reads the baked copy when it
+//  exists and was baked from the current text file, which skips all text
+//  parsing.
+//
 //  As with all of our loaders, this loader is designed to be attached to an
 //  asset manager.  In addition, this class uses our standard shared-pointer
 //  architecture.
@@ -43,14 +48,93 @@
 //  Version: 1/7/16
 //
 #include <cugl/assets/CUJsonLoader.h>
-#include <cugl/io/CUJsonReader.h>
+#include <cugl/io/CUTextReader.h>
+#include <cugl/io/CUBinaryReader.h>
 #include <cugl/base/CUApplication.h>
 
 using namespace cugl;
 
 /** What the source name is if we do not know it */
 #define UNKNOWN_SOURCE  "<unknown>"
+/** The suffix of a JSON file */
+#define JSON_SUFFIX     ".json"
+/** The suffix of a baked JSON file */
+#define BAKED_SUFFIX    ".jsonb"
+
+#pragma mark -
+#pragma mark Baked Files
+/**
+ * Returns the path of the baked copy of a JSON file.
+ *
+ * The baked copy replaces the suffix .json with .jsonb. Any other file
+ * gets .jsonb appended to its name.
+ *
+ * @param source    The path to the JSON file
+ *
+ * @return the path of the baked copy of a JSON file.
+ */
+std::string JsonLoader::getBakedPath(const std::string& source) {
+    size_t length = strlen(JSON_SUFFIX);
+    if (source.size() >= length && source.compare(source.size()-length,length,JSON_SUFFIX) == 0) {
+        return source.substr(0,source.size()-length)+BAKED_SUFFIX;
+    }
+    return source+BAKED_SUFFIX;
+}
+
+/**
+ * Returns the hash of the text of a JSON file, as stored in its baked copy.
+ *
+ * This is 64-bit FNV-1a, which is plenty to notice an edited file. It is
+ * only checked by the tools that build the assets, not by the game.
+ *
+ * @param text      The contents of the JSON file
+ *
+ * @return the hash of the text of a JSON file, never 0.
+ */
+Uint64 JsonLoader::hashSource(const std::string& text) {
+    Uint64 hash = 0xcbf29ce484222325ULL;
+    for(auto it = text.begin(); it != text.end(); ++it) {
+        hash = (hash ^ (Uint8)*it)*0x100000001b3ULL;
+    }
+    return hash == 0 ? 1 : hash;
+}
 
+/**
+ * Returns the contents of a JSON asset file.
+ *
+ * If baked is true and the file has a baked copy, this method reads that
+ * copy with {@link BinaryReader#readJson}, and does not open the text file
+ * at all. Otherwise it parses the text file. The baked copy is trusted, so
+ * a stale copy is caught when the assets are built, by the --check modes of
+ * switchwitch-jsonbake and switchwitch-pack. This method is safe to call
+ * outside of the main thread.
+ *
+ * @param source    The path to the JSON file, relative to the asset directory
+ * @param baked     Whether to read the baked copy if there is one
+ *
+ * @return the contents of a JSON asset file, or nullptr if it cannot be read.
+ */
+std::shared_ptr<JsonValue> JsonLoader::readAsset(const std::string& source, bool baked) {
+    if (baked) {
+        // A missing baked copy is the normal case, so this is silent
+        std::shared_ptr<BinaryReader> reader = BinaryReader::allocWithAsset(getBakedPath(source));
+        std::shared_ptr<JsonValue> json = (reader == nullptr ? nullptr : reader->readJson());
+        if (json != nullptr) {
+            return json;
+        }
+    }
+
+    std::shared_ptr<TextReader> text = TextReader::allocWithAsset(source);
+    if (text == nullptr) {
+        return nullptr;
+    }
+    std::string contents = text->ready() ? text->readAll() : "";
+    text->close();
+    return JsonValue::allocWithJson(contents);
+}
+
+#pragma mark -
+#pragma mark Asset Loading
 /**
  * Finishes loading the Json file, cleaning up the wait queues.
  *
@@ -103,15 +187,14 @@ bool JsonLoader::read(const std::string key, const std::string source, LoaderCal
     _queue.emplace(key);
     
     bool success = false;
+    bool baked = _baked;
     if (_loader == nullptr || !async) {
-        std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(source);
-        std::shared_ptr<JsonValue> json = (reader == nullptr ? nullptr : reader->readJson());
+        std::shared_ptr<JsonValue> json = readAsset(source,baked);
         success = (json != nullptr);
         materialize(key,json,callback);
     } else {
         _loader->addTask([=](void) {
-            std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(source);
-            std::shared_ptr<JsonValue> json = (reader == nullptr ? nullptr : reader->readJson());
+            std::shared_ptr<JsonValue> json = readAsset(source,baked);
             Application::get()->schedule([=](void) {
                 this->materialize(key,json,callback);
                 return false;
@@ -154,15 +237,14 @@ bool JsonLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback cal
     std::string source = json->asString(UNKNOWN_SOURCE);
     
     bool success = false;
+    bool baked = _baked;
     if (_loader == nullptr || !async) {
-        std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(source);
-        std::shared_ptr<JsonValue> json = (reader == nullptr ? nullptr : reader->readJson());
+        std::shared_ptr<JsonValue> json = readAsset(source,baked);
         success = (json != nullptr);
         materialize(key,json,callback);
     } else {
         _loader->addTask([=](void) {
-            std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(source);
-            std::shared_ptr<JsonValue> json = (reader == nullptr ? nullptr : reader->readJson());
+            std::shared_ptr<JsonValue> json = readAsset(source,baked);
             Application::get()->schedule([=](void) {
                 this->materialize(key,json,callback);
                 return false;
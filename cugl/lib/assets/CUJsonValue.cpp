@@ -4,8 +4,8 @@
 //
 //  This module a modern C++ alternative to the cJSON interface for reading
 //  JSON files.  In particular, this gives us better type-checking and memory
-//  management.  With that said, it still uses cJSON as the underlying parsing
-//  engine.
+//  management.  JSON strings are parsed directly into JsonValue trees, in a
+//  single pass.  cJSON is still used to write them back out.
 //
 //  This class uses our standard shared-pointer architecture.
 //
@@ -44,9 +44,14 @@
 #include <cugl/assets/CUJsonValue.h>
 #include <cugl/util/CUDebug.h>
 #include <cugl/util/CUStrings.h>
+#include <cstring>
+#include <cmath>
 
 using namespace cugl;
 
+/** The number of children at which an object builds its key index */
+#define INDEX_THRESHOLD 8
+
 /**
  * Returns the line of JSON with the offending error.
  *
@@ -83,6 +88,304 @@ std::string isolate_error(const char* data, const char* error, int& lineno) {
     return std::string(error,len);
 }
 
+#pragma mark -
+#pragma mark JSON Parsing
+/** The deepest nesting of arrays and objects that the parser accepts */
+#define PARSE_DEPTH_LIMIT 1000
+
+/**
+ * Returns the first character at or after pos that is not whitespace
+ *
+ * As in cJSON, every control character counts as whitespace.
+ *
+ * @param pos   The current parse location
+ *
+ * @return the first character at or after pos that is not whitespace
+ */
+static const char* parse_space(const char* pos) {
+    while (*pos && (unsigned char)*pos <= 32) {
+        pos++;
+    }
+    return pos;
+}
+
+/**
+ * Returns the value of the 4 hexadecimal digits at pos, or -1 if invalid
+ *
+ * @param pos   The first digit
+ *
+ * @return the value of the 4 hexadecimal digits at pos, or -1 if invalid
+ */
+static int parse_hex4(const char* pos) {
+    int result = 0;
+    for(int ii = 0; ii < 4; ii++) {
+        char c = pos[ii];
+        result <<= 4;
+        if (c >= '0' && c <= '9') {
+            result += c-'0';
+        } else if (c >= 'A' && c <= 'F') {
+            result += 10+c-'A';
+        } else if (c >= 'a' && c <= 'f') {
+            result += 10+c-'a';
+        } else {
+            return -1;
+        }
+    }
+    return result;
+}
+
+/**
+ * Parses the JSON string literal at pos into out
+ *
+ * Strings without escape sequences, which is nearly all of them, are
+ * copied once straight from the source.
+ *
+ * @param out   The string to store the result
+ * @param pos   The opening quote
+ * @param error A pointer to store the parse error location
+ *
+ * @return the parse location after the string, or nullptr on error
+ */
+static const char* parse_string(std::string& out, const char* pos, const char** error) {
+    if (*pos != '\"') {
+        *error = pos;
+        return nullptr;
+    }
+
+    const char* start = pos+1;
+    const char* curr = start;
+    while (*curr && *curr != '\"' && *curr != '\\') {
+        curr++;
+    }
+    if (*curr == '\"') {
+        out.assign(start,curr-start);
+        return curr+1;
+    }
+
+    // Escape sequences: decode the rest one piece at a time
+    out.assign(start,curr-start);
+    while (*curr != '\"') {
+        if (*curr == '\0') {
+            *error = pos;
+            return nullptr;
+        } else if (*curr != '\\') {
+            start = curr;
+            while (*curr && *curr != '\"' && *curr != '\\') {
+                curr++;
+            }
+            out.append(start,curr-start);
+            continue;
+        }
+
+        curr++;
+        switch (*curr) {
+            case 'b':
+                out.push_back('\b');
+                break;
+            case 'f':
+                out.push_back('\f');
+                break;
+            case 'n':
+                out.push_back('\n');
+                break;
+            case 'r':
+                out.push_back('\r');
+                break;
+            case 't':
+                out.push_back('\t');
+                break;
+            case '\"':
+            case '\\':
+            case '/':
+                out.push_back(*curr);
+                break;
+            case 'u':
+            {
+                int uc = parse_hex4(curr+1);
+                curr += 4;
+                if (uc <= 0 || (uc >= 0xDC00 && uc <= 0xDFFF)) {
+                    *error = pos;
+                    return nullptr;
+                }
+                // UTF16 surrogate pairs
+                if (uc >= 0xD800 && uc <= 0xDBFF) {
+                    int uc2 = (curr[1] == '\\' && curr[2] == 'u') ? parse_hex4(curr+3) : -1;
+                    if (uc2 < 0xDC00 || uc2 > 0xDFFF) {
+                        *error = pos;
+                        return nullptr;
+                    }
+                    curr += 6;
+                    uc = 0x10000 + (((uc & 0x3FF) << 10) | (uc2 & 0x3FF));
+                }
+                // Encode as UTF8
+                if (uc < 0x80) {
+                    out.push_back((char)uc);
+                } else if (uc < 0x800) {
+                    out.push_back((char)(0xC0 | (uc >> 6)));
+                    out.push_back((char)(0x80 | (uc & 0x3F)));
+                } else if (uc < 0x10000) {
+                    out.push_back((char)(0xE0 | (uc >> 12)));
+                    out.push_back((char)(0x80 | ((uc >> 6) & 0x3F)));
+                    out.push_back((char)(0x80 | (uc & 0x3F)));
+                } else {
+                    out.push_back((char)(0xF0 | (uc >> 18)));
+                    out.push_back((char)(0x80 | ((uc >> 12) & 0x3F)));
+                    out.push_back((char)(0x80 | ((uc >> 6) & 0x3F)));
+                    out.push_back((char)(0x80 | (uc & 0x3F)));
+                }
+            }
+                break;
+            default:
+                *error = pos;
+                return nullptr;
+        }
+        curr++;
+    }
+    return curr+1;
+}
+
+/**
+ * Parses the JSON number at pos into value
+ *
+ * This reads numbers exactly as cJSON did, so that parsed files keep the
+ * same values.
+ *
+ * @param value The node to store the result
+ * @param pos   The first character of the number
+ *
+ * @return the parse location after the number
+ */
+static const char* parse_number(JsonValue* value, const char* pos) {
+    double n = 0;
+    double sign = 1;
+    int scale = 0;
+    int subscale = 0;
+    int signsubscale = 1;
+
+    if (*pos == '-') {
+        sign = -1;
+        pos++;
+    }
+    if (*pos == '0') {
+        pos++;
+    }
+    if (*pos >= '1' && *pos <= '9') {
+        do {
+            n = (n*10.0)+(*pos++ - '0');
+        } while (*pos >= '0' && *pos <= '9');
+    }
+    if (*pos == '.' && pos[1] >= '0' && pos[1] <= '9') {
+        pos++;
+        do {
+            n = (n*10.0)+(*pos++ - '0');
+            scale--;
+        } while (*pos >= '0' && *pos <= '9');
+    }
+    if (*pos == 'e' || *pos == 'E') {
+        pos++;
+        if (*pos == '+') {
+            pos++;
+        } else if (*pos == '-') {
+            signsubscale = -1;
+            pos++;
+        }
+        while (*pos >= '0' && *pos <= '9') {
+            subscale = (subscale*10)+(*pos++ - '0');
+        }
+    }
+
+    n = sign*n*pow(10.0,(scale+subscale*signsubscale));
+    value->_type = JsonValue::Type::NumberType;
+    value->_doubleValue = n;
+    value->_longValue = (long)n;
+    return pos;
+}
+
+/**
+ * Parses the JSON value at pos into value
+ *
+ * Arrays and objects are parsed recursively, each child allocated once as
+ * it is read.  The children are gathered on the shared stack, so that the
+ * children of each node are moved into a vector of the exact size, instead
+ * of growing it one child at a time.  Object keys are parsed directly into
+ * the keys of the children.
+ *
+ * @param value The node to store the result
+ * @param pos   The first character of the value
+ * @param error A pointer to store the parse error location
+ * @param stack The children of the arrays and objects being parsed
+ * @param depth The nesting depth of value
+ *
+ * @return the parse location after the value, or nullptr on error
+ */
+static const char* parse_value(JsonValue* value, const char* pos, const char** error,
+                               std::vector<std::shared_ptr<JsonValue>>& stack, int depth) {
+    if (*pos == 'n' && !strncmp(pos,"null",4)) {
+        value->_type = JsonValue::Type::NullType;
+        return pos+4;
+    } else if (*pos == 'f' && !strncmp(pos,"false",5)) {
+        value->_type = JsonValue::Type::BoolType;
+        value->_longValue = 0;
+        return pos+5;
+    } else if (*pos == 't' && !strncmp(pos,"true",4)) {
+        value->_type = JsonValue::Type::BoolType;
+        value->_longValue = 1;
+        return pos+4;
+    } else if (*pos == '\"') {
+        value->_type = JsonValue::Type::StringType;
+        return parse_string(value->_stringValue,pos,error);
+    } else if (*pos == '-' || (*pos >= '0' && *pos <= '9')) {
+        return parse_number(value,pos);
+    } else if ((*pos != '[' && *pos != '{') || depth >= PARSE_DEPTH_LIMIT) {
+        *error = pos;
+        return nullptr;
+    }
+
+    bool object = (*pos == '{');
+    char close = object ? '}' : ']';
+    value->_type = object ? JsonValue::Type::ObjectType : JsonValue::Type::ArrayType;
+    pos = parse_space(pos+1);
+    if (*pos == close) {
+        return pos+1;
+    }
+
+    size_t first = stack.size();
+    while (true) {
+        std::shared_ptr<JsonValue> child = std::make_shared<JsonValue>();
+        child->_parent = value;
+        if (object) {
+            pos = parse_string(child->_key,pos,error);
+            if (pos == nullptr) {
+                return nullptr;
+            }
+            pos = parse_space(pos);
+            if (*pos != ':') {
+                *error = pos;
+                return nullptr;
+            }
+            pos = parse_space(pos+1);
+        }
+        pos = parse_value(child.get(),pos,error,stack,depth+1);
+        if (pos == nullptr) {
+            return nullptr;
+        }
+        stack.push_back(std::move(child));
+
+        pos = parse_space(pos);
+        if (*pos == close) {
+            value->_children.assign(std::make_move_iterator(stack.begin()+first),
+                                    std::make_move_iterator(stack.end()));
+            stack.resize(first);
+            value->reindex();
+            return pos+1;
+        } else if (*pos != ',') {
+            *error = pos;
+            return nullptr;
+        }
+        pos = parse_space(pos+1);
+    }
+}
+
 #pragma mark -
 #pragma mark JSON Conversions
 /**
@@ -181,6 +484,7 @@ std::shared_ptr<JsonValue> JsonValue::toJsonValue(const cJSON* node) {
         }
     }
     result->_children.assign(items.begin(),items.end());
+    result->reindex();
     
     return result;
 }
@@ -221,6 +525,7 @@ void JsonValue::toJsonValue(JsonValue* value, const cJSON* node) {
         }
     }
     value->_children.assign(items.begin(),items.end());
+    value->reindex();
 }
 
 /**
@@ -278,6 +583,50 @@ cJSON* JsonValue::toCJSON(const JsonValue* value) {
     return result;
 }
 
+/**
+ * Returns the position of the first child with the given key
+ *
+ * Objects with a key index use it, so that looking up every key of an
+ * object is linear rather than quadratic.  Other nodes are searched
+ * linearly.  This method never modifies the node, so it is safe to call
+ * from several threads at once.
+ *
+ * @param key   The key of the child
+ *
+ * @return the position of the first child with the given key, or -1 if none.
+ */
+int JsonValue::lookup(const std::string& key) const {
+    if (_index.empty()) {
+        for(size_t ii = 0; ii < _children.size(); ii++) {
+            if (_children[ii]->_key == key) {
+                return (int)ii;
+            }
+        }
+        return -1;
+    }
+    auto it = _index.find(key);
+    return it == _index.end() ? -1 : (int)it->second;
+}
+
+/**
+ * Rebuilds the key index after the children of this node have changed.
+ *
+ * The index is only kept for objects with enough children for a linear
+ * search to be slow.  Every method that changes the children of a node
+ * calls this, so the index is never built during a lookup.
+ */
+void JsonValue::reindex() {
+    _index.clear();
+    if (_type != Type::ObjectType || _children.size() < INDEX_THRESHOLD) {
+        return;
+    }
+    _index.reserve(_children.size());
+    for(size_t ii = 0; ii < _children.size(); ii++) {
+        // Keep the first of any duplicate keys, as the linear search does
+        _index.emplace(_children[ii]->_key,ii);
+    }
+}
+
 #pragma mark -
 #pragma mark Constructors
 /**
@@ -303,6 +652,7 @@ _doubleValue(0.0) {
  */
 JsonValue::~JsonValue() {
     _children.clear();
+    _index.clear();
     _parent = nullptr;
     _type = Type::NullType;
 }
@@ -401,12 +751,14 @@ bool JsonValue::init(double value) {
  */
 bool JsonValue::initWithJson(const char* json) {
     const char *error = NULL;
-    cJSON* node = cJSON_ParseWithOpts(json, &error, 0);
-    if (node) {
-        toJsonValue(this,node);
-        cJSON_Delete(node);
+    _children.clear();
+    _index.clear();
+    std::vector<std::shared_ptr<JsonValue>> stack;
+    if (parse_value(this, parse_space(json), &error, stack, 0)) {
         return true;
     }
+    _children.clear();
+    _type = Type::NullType;
     if (error) {
         int line = 0;
         std::string source = isolate_error(json,error,line);
@@ -417,6 +769,35 @@ bool JsonValue::initWithJson(const char* json) {
     return false; // If asserts turned off
 }
 
+/**
+ * Initializes a new JsonValue as a deep copy of the given one.
+ *
+ * Every descendant of the given node is copied, so the two trees share
+ * nothing. This node has the key of the given node, but no parent.
+ *
+ * @param value The JSON node to copy.
+ *
+ * @return  true if the JSON node is initialized properly, false otherwise.
+ */
+bool JsonValue::initWithCopy(const JsonValue& value) {
+    _type = value._type;
+    _key  = value._key;
+    _stringValue = value._stringValue;
+    _longValue   = value._longValue;
+    _doubleValue = value._doubleValue;
+    _children.clear();
+    _index.clear();
+    _children.reserve(value._children.size());
+    for(auto it = value._children.begin(); it != value._children.end(); ++it) {
+        std::shared_ptr<JsonValue> child = std::make_shared<JsonValue>();
+        child->initWithCopy(**it);
+        child->_parent = this;
+        _children.push_back(child);
+    }
+    reindex();
+    return true;
+}
+
 
 #pragma mark -
 #pragma mark Type
@@ -809,6 +1190,7 @@ void JsonValue::setKey(const std::string& key) {
     if (_parent) {
         CUAssertLog(!_parent->has(key), "The key %s is already in use", key.c_str());
         _key = key;
+        _parent->reindex();
     }
 }
 
@@ -842,12 +1224,7 @@ const int JsonValue::index() const {
  */
 bool JsonValue::has(const std::string& key) const {
     CUAssertLog(isObject(), "Node is not an object type");
-    for(auto it = _children.begin(); it != _children.end(); it++) {
-        if ((*it)->_key == key) {
-            return true;
-        }
-    }
-    return false;
+    return lookup(key) >= 0;
 }
 
 /**
@@ -896,12 +1273,8 @@ const std::shared_ptr<JsonValue> JsonValue::get(int index) const {
  */
 std::shared_ptr<JsonValue> JsonValue::get(const std::string& key) {
     CUAssertLog(isObject(), "Node is not an object type");
-    for(auto it = _children.begin(); it != _children.end(); it++) {
-        if ((*it)->_key == key) {
-            return *it;
-        }
-    }
-    return nullptr;
+    int pos = lookup(key);
+    return pos < 0 ? nullptr : _children[pos];
 }
 
 /**
@@ -918,12 +1291,8 @@ std::shared_ptr<JsonValue> JsonValue::get(const std::string& key) {
  */
 const std::shared_ptr<JsonValue> JsonValue::get(const std::string& key) const {
     CUAssertLog(isObject(), "Node is not an object type");
-    for(auto it = _children.begin(); it != _children.end(); it++) {
-        if ((*it)->_key == key) {
-            return *it;
-        }
-    }
-    return nullptr;
+    int pos = lookup(key);
+    return pos < 0 ? nullptr : _children[pos];
 }
 
 #pragma mark -
@@ -1060,6 +1429,7 @@ std::shared_ptr<JsonValue> JsonValue::removeChild(int index) {
     CUAssertLog(0 <= index && index < _children.size(), "Index %d out of range", index);
     std::shared_ptr<JsonValue> result = _children[index];
     _children.erase(_children.begin() + index);
+    reindex();
     result->_parent = nullptr;
     return result;
 }
@@ -1077,15 +1447,11 @@ std::shared_ptr<JsonValue> JsonValue::removeChild(int index) {
  * Returns the child with the specified key and removes it from this node.
  */
 std::shared_ptr<JsonValue> JsonValue::removeChild(const std::string& key) {
-    auto jt = _children.end();
-    for(auto it = _children.begin(); jt == _children.end() && it != _children.end(); it++) {
-        if ((*it)->_key == key) {
-            jt = it;
-        }
-    }
-    if (jt != _children.end()) {
-        std::shared_ptr<JsonValue> result = *jt;
-        _children.erase(jt);
+    int pos = lookup(key);
+    if (pos >= 0) {
+        std::shared_ptr<JsonValue> result = _children[pos];
+        _children.erase(_children.begin() + pos);
+        reindex();
         result->_parent = nullptr;
         return result;
     }
@@ -1107,6 +1473,7 @@ void JsonValue::merge(std::shared_ptr<JsonValue>& node) {
     node->_key = _key;
     _parent->removeChild(_key);
     node->_parent->_children.push_back(node);
+    node->_parent->reindex();
 }
 
 
@@ -1131,6 +1498,11 @@ void JsonValue::appendChild(const std::shared_ptr<JsonValue>& child) {
     CUAssertLog(isArray() || !has(child->key()),
                 "The key %s is already in use", child->key().c_str());
     _children.push_back(child);
+    if (!_index.empty()) {
+        _index.emplace(child->_key,_children.size()-1);
+    } else if (_children.size() >= INDEX_THRESHOLD) {
+        reindex();
+    }
     child->_parent = this;
 }
 
@@ -1156,6 +1528,11 @@ void JsonValue::appendChild(const std::string& key, const std::shared_ptr<JsonVa
     CUAssertLog(!has(key), "The key %s is already in use", key.c_str());
     child->_key = key;
     _children.push_back(child);
+    if (!_index.empty()) {
+        _index.emplace(key,_children.size()-1);
+    } else if (_children.size() >= INDEX_THRESHOLD) {
+        reindex();
+    }
     child->_parent = this;
 }
 
@@ -1180,6 +1557,7 @@ void JsonValue::insertChild(unsigned int index, const std::shared_ptr<JsonValue>
     CUAssertLog(!child->_parent, "This child already has a parent");
     CUAssertLog(isArray() || isObject(), "This node is a value type");
     _children.insert(_children.begin()+index,child);
+    reindex();
     child->_parent = this;
 }
 
@@ -1209,6 +1587,7 @@ void JsonValue::insertChild(unsigned int index, const std::string& key,
     CUAssertLog(!has(key), "The key %s is already in use", key.c_str());
     child->_key = key;
     _children.insert(_children.begin()+index,child);
+    reindex();
     child->_parent = this;
 }
 
@@ -150,8 +150,9 @@ bool SoundLoader::read(const std::string key, const std::string source, LoaderCa
         success = (sound != nullptr);
         if (success) {
             sound->setVolume(_volume);
-            materialize(key,sound,callback);
         }
+        // Failures are materialized too, so that they leave the queue
+        materialize(key,sound,callback);
     } else {
         _loader->addTask([=](void) {
             std::shared_ptr<Sound> sound = nullptr;
@@ -160,11 +161,12 @@ bool SoundLoader::read(const std::string key, const std::string source, LoaderCa
             }
             if (sound != nullptr) {
                 sound->setVolume(_volume);
-                Application::get()->schedule([=](void){
-                    this->materialize(key,sound,callback);
-                    return false;
-                });
             }
+            // Failures are materialized too, so that they leave the queue
+            Application::get()->schedule([=](void){
+                this->materialize(key,sound,callback);
+                return false;
+            });
         });
     }
     
@@ -215,8 +217,9 @@ bool SoundLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback ca
         success = (sound != nullptr);
         if (success) {
             sound->setVolume(volume);
-            materialize(key,sound,callback);
         }
+        // Failures are materialized too, so that they leave the queue
+        materialize(key,sound,callback);
     } else {
         _loader->addTask([=](void) {
             std::shared_ptr<Sound> sound = nullptr;
@@ -227,11 +230,12 @@ bool SoundLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback ca
             }
             if (sound != nullptr) {
                 sound->setVolume(volume);
-                Application::get()->schedule([=](void) {
-                    this->materialize(key,sound,callback);
-                    return false;
-                });
             }
+            // Failures are materialized too, so that they leave the queue
+            Application::get()->schedule([=](void) {
+                this->materialize(key,sound,callback);
+                return false;
+            });
         });
     }
     
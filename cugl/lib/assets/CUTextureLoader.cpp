@@ -44,7 +44,10 @@
 //  Version: 1/7/16
 //
 #include <cugl/assets/CUTextureLoader.h>
+#include <cugl/render/CUCompressedImage.h>
 #include <cugl/base/CUApplication.h>
+#include <cugl/util/CUFiletools.h>
+#include <cugl/io/CUAssetPack.h>
 #include <SDL/SDL_image.h>
 
 using namespace cugl;
@@ -141,6 +144,24 @@ _wrapt(GL_CLAMP_TO_EDGE),
 _mipmaps(false) {
 }
 
+/**
+ * Initializes a new texture loader.
+ *
+ * This method bootstraps the loader with any initial resources that it
+ * needs to load assets. In particular, the OpenGL context must be active,
+ * as this is where the loader learns which compressed formats the driver
+ * supports. Attempts to load an asset before this method is called will fail.
+ *
+ * @param threads   The thread pool for asynchronous loading support
+ *
+ * @return true if the asset loader was initialized successfully
+ */
+bool TextureLoader::init(const std::shared_ptr<ThreadPool>& threads) {
+    // The first query of the formats must happen in the main thread
+    CompressedImage::isSupported(CompressedImage::ETC2_RGB8);
+    return Loader<Texture>::init(threads);
+}
+
 
 #pragma mark -
 #pragma mark Asset Loading
@@ -167,7 +188,8 @@ SDL_Surface* TextureLoader::preload(const std::string& source) {
     
     std::string path = Application::get()->getAssetDirectory();
     path.append(source);
-    SDL_Surface* surface = IMG_Load(path.c_str());
+    std::string suffix = filetool::base_suffix(path);
+    SDL_Surface* surface = IMG_LoadTyped_RW(AssetPack::openAsset(path), 1, suffix.c_str());
     if (surface == nullptr) {
         return nullptr;
     }
@@ -182,12 +204,36 @@ SDL_Surface* TextureLoader::preload(const std::string& source) {
     return normal;
 }
 
+/**
+ * Loads a KTX file in a form that is safe to load outside the main thread.
+ *
+ * The compressed blocks are read as they are, with no decoding. If the
+ * OpenGL driver cannot sample their format, they are decompressed to RGBA
+ * here instead, so that this work never takes place in the main thread.
+ *
+ * @param source    The pathname to the asset
+ *
+ * @return the compressed image with the texture information
+ */
+std::shared_ptr<CompressedImage> TextureLoader::preloadCompressed(const std::string& source) {
+    std::string path = Application::get()->getAssetDirectory();
+    path.append(source);
+    std::shared_ptr<CompressedImage> image = CompressedImage::allocWithFile(path);
+    if (image == nullptr) {
+        return nullptr;
+    } else if (!CompressedImage::isSupported(image->getFormat()) && !image->decompress()) {
+        CULogError("Texture format of %s is not supported by this device", source.c_str());
+        return nullptr;
+    }
+    return image;
+}
+
 /**
  * Creates an OpenGL texture from the SDL_Surface, and assigns it the given key.
  *
  * This method finishes the asset loading started in {@link preload}.  This
  * step is not safe to be done in a separate thread.  Instead, it takes
- * place in the main CUGL thread via {@link Application#schedule}.
+ * place in the main CUGL thread via {@link BaseLoader#scheduleUpload}.
  *
  * The loaded texture will have default parameters for scaling and wrap.
  * It will not have any mipmaps.
@@ -200,8 +246,50 @@ SDL_Surface* TextureLoader::preload(const std::string& source) {
  * @param callback  An optional callback for asynchronous loading
  */
 void TextureLoader::materialize(const std::string& key, SDL_Surface* surface, LoaderCallback callback) {
-    std::shared_ptr<Texture> texture = Texture::allocWithData(surface->pixels, surface->w, surface->h);
-    
+    std::shared_ptr<Texture> texture = nullptr;
+    if (surface != nullptr) {
+        texture = Texture::allocWithData(surface->pixels, surface->w, surface->h);
+    }
+    SDL_FreeSurface(surface);
+    store(key,texture,callback);
+}
+
+/**
+ * Creates an OpenGL texture from a compressed image, and assigns it the given key.
+ *
+ * This method finishes the asset loading started in {@link preloadCompressed}.
+ * This step is not safe to be done in a separate thread.  Instead, it takes
+ * place in the main CUGL thread via {@link BaseLoader#scheduleUpload}.
+ *
+ * The loaded texture will have default parameters for scaling and wrap.
+ * It will have the mipmaps of the file, if any.
+ *
+ * This method supports an optional callback function which reports whether
+ * the asset was successfully materialized.
+ *
+ * @param key       The key to access the asset after loading
+ * @param image     The compressed image to upload
+ * @param callback  An optional callback for asynchronous loading
+ */
+void TextureLoader::materialize(const std::string& key, const std::shared_ptr<CompressedImage>& image, LoaderCallback callback) {
+    std::shared_ptr<Texture> texture = nullptr;
+    if (image != nullptr) {
+        texture = Texture::allocWithCompressed(image);
+    }
+    store(key,texture,callback);
+}
+
+/**
+ * Assigns a newly created texture the given key, with the default settings.
+ *
+ * This is the last step of {@link materialize}. A null texture is a failed
+ * load, which is reported to the callback.
+ *
+ * @param key       The key to access the asset after loading
+ * @param texture   The texture created for the asset
+ * @param callback  An optional callback for asynchronous loading
+ */
+void TextureLoader::store(const std::string& key, const std::shared_ptr<Texture>& texture, LoaderCallback callback) {
     bool success = false;
     if (texture != nullptr) {
         _assets[key] = texture;
@@ -218,7 +306,6 @@ void TextureLoader::materialize(const std::string& key, SDL_Surface* surface, Lo
     if (callback != nullptr) {
         callback(key,success);
     }
-    SDL_FreeSurface(surface);
     _queue.erase(key);
 }
                                 
@@ -227,7 +314,7 @@ void TextureLoader::materialize(const std::string& key, SDL_Surface* surface, Lo
  *
  * This method finishes the asset loading started in {@link preload}.  This
  * step is not safe to be done in a separate thread.  Instead, it takes
- * place in the main CUGL thread via {@link Application#schedule}.
+ * place in the main CUGL thread via {@link BaseLoader#scheduleUpload}.
  *
  * This version of read provides support for JSON directories. A texture
  * directory entry has the following values
@@ -251,7 +338,50 @@ void TextureLoader::materialize(const std::string& key, SDL_Surface* surface, Lo
  * @param callback  An optional callback for asynchronous loading
  */
 void TextureLoader::materialize(const std::shared_ptr<JsonValue>& json, SDL_Surface* surface, LoaderCallback callback) {
-    std::shared_ptr<Texture> texture = Texture::allocWithData(surface->pixels, surface->w, surface->h);
+    std::shared_ptr<Texture> texture = nullptr;
+    if (surface != nullptr) {
+        texture = Texture::allocWithData(surface->pixels, surface->w, surface->h);
+    }
+    SDL_FreeSurface(surface);
+    store(json,texture,callback);
+}
+
+/**
+ * Creates an OpenGL texture from a compressed image accoring to the directory entry.
+ *
+ * This method finishes the asset loading started in {@link preloadCompressed}.
+ * This step is not safe to be done in a separate thread.  Instead, it takes
+ * place in the main CUGL thread via {@link BaseLoader#scheduleUpload}.
+ *
+ * The directory entry is the same as for any other texture. However, the
+ * texture only has the mipmaps of the file, whatever the "mipmaps" value.
+ *
+ * This method supports an optional callback function which reports whether
+ * the asset was successfully materialized.
+ *
+ * @param json      The asset directory entry
+ * @param image     The compressed image to upload
+ * @param callback  An optional callback for asynchronous loading
+ */
+void TextureLoader::materialize(const std::shared_ptr<JsonValue>& json, const std::shared_ptr<CompressedImage>& image, LoaderCallback callback) {
+    std::shared_ptr<Texture> texture = nullptr;
+    if (image != nullptr) {
+        texture = Texture::allocWithCompressed(image);
+    }
+    store(json,texture,callback);
+}
+
+/**
+ * Assigns a newly created texture the key and settings of its directory entry.
+ *
+ * This is the last step of {@link materialize}. A null texture is a failed
+ * load, which is reported to the callback.
+ *
+ * @param json      The asset directory entry
+ * @param texture   The texture created for the asset
+ * @param callback  An optional callback for asynchronous loading
+ */
+void TextureLoader::store(const std::shared_ptr<JsonValue>& json, const std::shared_ptr<Texture>& texture, LoaderCallback callback) {
     std::string key = json->key();
 
     bool success = false;
@@ -278,7 +408,6 @@ void TextureLoader::materialize(const std::shared_ptr<JsonValue>& json, SDL_Surf
     if (callback != nullptr) {
         callback(key,success);
     }
-    SDL_FreeSurface(surface);
     _queue.erase(key);
 }
 
@@ -316,10 +445,16 @@ bool TextureLoader::read(const std::string key, const std::string source, Loader
         _queue.erase(key);
     } else {
         _loader->addTask([=](void) {
+            if (filetool::base_suffix(source) == "ktx") {
+                std::shared_ptr<CompressedImage> image = this->preloadCompressed(source);
+                scheduleUpload([=](void){
+                    this->materialize(key,image,callback);
+                });
+                return;
+            }
             SDL_Surface* surface = this->preload(source);
-            Application::get()->schedule([=](void){
+            scheduleUpload([=](void){
                 this->materialize(key,surface,callback);
-                return false;
             });
         });
     }
@@ -385,10 +520,16 @@ bool TextureLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback
         _queue.erase(key);
     } else {
         _loader->addTask([=](void) {
+            if (filetool::base_suffix(source) == "ktx") {
+                std::shared_ptr<CompressedImage> image = this->preloadCompressed(source);
+                scheduleUpload([=](void){
+                    this->materialize(json,image,callback);
+                });
+                return;
+            }
             SDL_Surface* surface = this->preload(source);
-            Application::get()->schedule([=](void){
+            scheduleUpload([=](void){
                 this->materialize(json,surface,callback);
-                return false;
             });
         });
     }
@@ -440,11 +581,12 @@ bool TextureLoader::purge(const std::shared_ptr<JsonValue>& json) {
     _assets.erase(it);
     
     JsonValue* child = json->get("atlas").get();
+    std::string prefix = json->getString("prefix",key+"_");
     bool success = true;
     if (child) {
         for(int ii = 0; ii < child->size(); ii++) {
             JsonValue* item = child->get(ii).get();
-            std::string name = key+"_"+item->key();
+            std::string name = prefix+item->key();
             auto jt = _assets.find(name);
             success = (jt != _assets.end()) && success;
             if (jt != _assets.end()) {
@@ -464,19 +606,23 @@ bool TextureLoader::purge(const std::shared_ptr<JsonValue>& json) {
  * An atlas is specified as a list of named, four-element integer arrays.
  * Each integer array specifies the left, top, right, and bottom pixels of
  * the subtexture, respectively.  Each subtexture will have the key of the
- * main texture as the prefix (together with an underscore _) of its key.
+ * main texture as the prefix (together with an underscore _) of its key,
+ * unless the directory entry has a "prefix" string to use instead.  An
+ * empty prefix gives each subtexture the name of its atlas entry, which
+ * is how packed atlas pages keep the keys of the textures they replace.
  *
  * @param json      The asset directory entry
  * @param texture   The texture loaded for this asset
  */
 void TextureLoader::parseAtlas(const std::shared_ptr<JsonValue>& json, const std::shared_ptr<Texture>& texture) {
     std::string key = json->key();
+    std::string prefix = json->getString("prefix",key+"_");
     JsonValue* child = json->get("atlas").get();
     Size size = texture->getSize();
     if (child) {
         for(int ii = 0; ii < child->size(); ii++) {
             JsonValue* item = child->get(ii).get();
-            std::string name = key+"_"+item->key();
+            std::string name = prefix+item->key();
             std::vector<int> values = item->asIntArray();
             CUAssertLog(values.size() == 4, "Atlas dimensions are incorrect: %d",(Uint32)values.size());
             _assets[name] = texture->getSubTexture(values[0]/size.width, values[2]/size.width,
@@ -36,6 +36,7 @@
 //  Version: 8/20/18
 //
 #include <cugl/audio/codecs/CUFLACDecoder.h>
+#include <cugl/io/CUAssetPack.h>
 #include <cassert>
 #include <climits>
 
@@ -248,7 +249,7 @@ FLACDecoder::~FLACDecoder() {
 bool FLACDecoder::init(const std::string& file) {
     _file = file;
     
-    _source = SDL_RWFromFile(file.c_str(), "r");
+    _source = AssetPack::openAsset(file, "r");
     if (_source == nullptr) {
         SDL_SetError("Could not open '%s'",file.c_str());
         return false;
@@ -37,6 +37,7 @@
 //  Version: 6/29/17
 //
 #include <cugl/audio/codecs/CUOGGDecoder.h>
+#include <cugl/io/CUAssetPack.h>
 #include <cassert>
 #include <climits>
 
@@ -177,7 +178,7 @@ OGGDecoder::~OGGDecoder() {
 bool OGGDecoder::init(const std::string& file) {
     _file = file;
     
-    _source = SDL_RWFromFile(file.c_str(), "rb");
+    _source = AssetPack::openAsset(file, "rb");
     if (_source == nullptr) {
         SDL_SetError("Could not open '%s'",file.c_str());
         return false;
@@ -0,0 +1,603 @@
+//
+//  CUAssetPack.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides a pack file of assets, so that a game can ship one
+//  large file instead of hundreds of loose ones. A pack has a header, an
+//  index of the entries sorted by the hash of their names, and the contents
+//  of each entry, aligned in the file. Each entry may be compressed with
+//  LZ4. The pack is memory-mapped where the platform allows it, and read in
+//  a single pass otherwise.
+//
+//  The mounted packs act as a virtual file system for the asset directory.
+//  The readers of textures, sounds, fonts and JSON files open their files
+//  with openAsset, which looks in the mounted packs before the disk.
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+#include <cugl/io/CUAssetPack.h>
+#include <cugl/base/CUApplication.h>
+#include <cugl/base/CUEndian.h>
+#include <cugl/util/CUDebug.h>
+#include <cugl/util/CUFiletools.h>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CU_CAN_MMAP 1
+#endif
+
+using namespace cugl;
+
+/** The first bytes of a pack file */
+#define PACK_MAGIC      "CUPK"
+/** The version of the pack format */
+#define PACK_VERSION    1
+/** The size of the pack header */
+#define HEADER_SIZE     16
+/** The size of an index entry */
+#define ENTRY_SIZE      32
+
+/** The shortest LZ4 match */
+#define LZ4_MINMATCH    4
+/** The last bytes of a block, which are always literals */
+#define LZ4_LASTLITERALS 5
+/** The last match must start this many bytes before the end of a block */
+#define LZ4_MFLIMIT     12
+/** The bits of the match finder hash table */
+#define LZ4_HASHBITS    14
+
+const Uint16 AssetPack::COMPRESSED = 1;
+
+/** The mounted packs, the last mounted first */
+static std::vector<std::shared_ptr<AssetPack>> _mounts;
+/** The lock for the mounted packs */
+static std::mutex _mountLock;
+
+/**
+ * Returns a value of the given type in network order at the given address.
+ *
+ * @param data  The address of the value
+ *
+ * @return a value of the given type in network order at the given address.
+ */
+template <typename T>
+static T read_fixed(const Uint8* data) {
+    T value;
+    memcpy(&value,data,sizeof(T));
+    return (T)marshall(value);
+}
+
+#pragma mark -
+#pragma mark Constructors
+/**
+ * Unmaps the pack file and resets all attributes.
+ *
+ * A mounted pack is never disposed, as the mounts hold a reference.
+ */
+void AssetPack::dispose() {
+#if defined(CU_CAN_MMAP)
+    if (_mapped) {
+        munmap((void*)_data,_size);
+    }
+#endif
+    _buffer.clear();
+    _buffer.shrink_to_fit();
+    _entries.clear();
+    _path.clear();
+    _data = nullptr;
+    _names = nullptr;
+    _size = 0;
+    _mapped = false;
+}
+
+/**
+ * Initializes a pack from the given file.
+ *
+ * The file is memory-mapped if the platform allows it, and read whole
+ * otherwise. Only the index is checked here.
+ *
+ * @param path  The path to the pack file
+ *
+ * @return true if initialization was successful.
+ */
+bool AssetPack::init(const std::string& path) {
+    if (_data != nullptr) {
+        CUAssertLog(false, "Pack %s is already initialized", _path.c_str());
+        return false;
+    }
+    _path = filetool::normalize_path(path);
+#if defined(CU_CAN_MMAP)
+    int fd = ::open(_path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat info;
+        void* data = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        // The mapping stays valid after the descriptor is closed
+        ::close(fd);
+        if (data != MAP_FAILED) {
+            _data = (const Uint8*)data;
+            _size = (size_t)info.st_size;
+            _mapped = true;
+        }
+    }
+#endif
+    if (_data == nullptr) {
+        // One sequential read, which also finds Android assets
+        SDL_RWops* source = SDL_RWFromFile(_path.c_str(), "rb");
+        if (source == nullptr) {
+            return false;
+        }
+        Sint64 size = SDL_RWsize(source);
+        _buffer.resize(size > 0 ? (size_t)size : 0);
+        size_t amt = _buffer.empty() ? 0 : SDL_RWread(source, _buffer.data(), 1, _buffer.size());
+        SDL_RWclose(source);
+        if (amt != _buffer.size()) {
+            dispose();
+            return false;
+        }
+        _data = _buffer.data();
+        _size = _buffer.size();
+    }
+
+    if (_size < HEADER_SIZE || memcmp(_data,PACK_MAGIC,4) || read_fixed<Uint32>(_data+4) != PACK_VERSION) {
+        CULogError("File %s is not an asset pack", _path.c_str());
+        dispose();
+        return false;
+    }
+    Uint32 count = read_fixed<Uint32>(_data+8);
+    size_t names = HEADER_SIZE+(size_t)count*ENTRY_SIZE;
+    if (names > _size) {
+        CULogError("Asset pack %s is truncated", _path.c_str());
+        dispose();
+        return false;
+    }
+
+    _names = (const char*)(_data+names);
+    _entries.resize(count);
+    const Uint8* pos = _data+HEADER_SIZE;
+    for(auto it = _entries.begin(); it != _entries.end(); ++it, pos += ENTRY_SIZE) {
+        it->hash   = read_fixed<Uint64>(pos);
+        it->offset = read_fixed<Uint64>(pos+8);
+        it->stored = read_fixed<Uint32>(pos+16);
+        it->size   = read_fixed<Uint32>(pos+20);
+        it->name   = read_fixed<Uint32>(pos+24);
+        it->length = read_fixed<Uint16>(pos+28);
+        it->flags  = read_fixed<Uint16>(pos+30);
+        bool compressed = (it->flags & COMPRESSED) != 0;
+        if (it->offset > _size || it->stored > _size-it->offset || (!compressed && it->stored != it->size) ||
+            names+it->name+it->length > _size || (it != _entries.begin() && (it-1)->hash > it->hash)) {
+            CULogError("Asset pack %s has a corrupt index", _path.c_str());
+            dispose();
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Initializes a pack from the given file in the asset directory.
+ *
+ * @param file  The path to the pack file relative to the asset directory
+ *
+ * @return true if initialization was successful.
+ */
+bool AssetPack::initWithAsset(const std::string& file) {
+    CUAssertLog(!filetool::is_absolute(file), "This initializer does not accept absolute paths");
+    return init(Application::get()->getAssetDirectory()+file);
+}
+
+#pragma mark -
+#pragma mark Files
+/**
+ * Returns the entry of the given file, or nullptr if there is none.
+ *
+ * @param name  The path of the file relative to the asset directory
+ *
+ * @return the entry of the given file, or nullptr if there is none.
+ */
+const AssetPack::Entry* AssetPack::find(const std::string& name) const {
+    Uint64 key = hash(name);
+    auto it = std::lower_bound(_entries.begin(), _entries.end(), key,
+                               [](const Entry& entry, Uint64 value) { return entry.hash < value; });
+    // Distinct names may share a hash, so every entry with it is compared
+    for(; it != _entries.end() && it->hash == key; ++it) {
+        if (it->length == name.size() && !memcmp(_names+it->name,name.data(),name.size())) {
+            return &(*it);
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Frees the buffer of a stream over a decompressed file.
+ *
+ * @param context   The stream to close
+ *
+ * @return 0, as closing cannot fail
+ */
+static int SDLCALL close_buffer(SDL_RWops* context) {
+    SDL_free(context->hidden.mem.base);
+    SDL_FreeRW(context);
+    return 0;
+}
+
+/**
+ * Returns a read-only stream of the given file, or nullptr if there is none.
+ *
+ * A stored file is streamed straight from the pack. A compressed file
+ * is decompressed into a buffer that the stream frees when it is closed.
+ * The caller must close the stream with SDL_RWclose.
+ *
+ * @param name  The path of the file relative to the asset directory
+ *
+ * @return a read-only stream of the given file, or nullptr if there is none.
+ */
+SDL_RWops* AssetPack::open(const std::string& name) const {
+    const Entry* entry = find(name);
+    // SDL has no stream for an empty block of memory
+    if (entry == nullptr || entry->size == 0) {
+        return nullptr;
+    } else if (!(entry->flags & COMPRESSED)) {
+        return SDL_RWFromConstMem(_data+entry->offset,(int)entry->size);
+    }
+
+    Uint8* buffer = (Uint8*)SDL_malloc(entry->size);
+    if (buffer == nullptr || !decompress(_data+entry->offset,entry->stored,buffer,entry->size)) {
+        CULogError("Could not decompress %s in %s", name.c_str(), _path.c_str());
+        SDL_free(buffer);
+        return nullptr;
+    }
+    SDL_RWops* result = SDL_RWFromConstMem(buffer,(int)entry->size);
+    if (result == nullptr) {
+        SDL_free(buffer);
+        return nullptr;
+    }
+    result->close = close_buffer;
+    return result;
+}
+
+/**
+ * Returns the contents of the given file in place, if it is not compressed.
+ *
+ * The contents stay valid for the lifetime of this pack.
+ *
+ * @param name  The path of the file relative to the asset directory
+ * @param size  Set to the size of the file
+ *
+ * @return the contents of the given file, or nullptr if it is compressed or absent.
+ */
+const Uint8* AssetPack::getData(const std::string& name, size_t& size) const {
+    const Entry* entry = find(name);
+    if (entry == nullptr || (entry->flags & COMPRESSED)) {
+        return nullptr;
+    }
+    size = entry->size;
+    return _data+entry->offset;
+}
+
+#pragma mark -
+#pragma mark Virtual File System
+/**
+ * Mounts a pack, so that {@link openAsset} looks in it before the disk.
+ *
+ * Packs mounted later are searched first.
+ *
+ * @param pack  The pack to mount
+ */
+void AssetPack::mount(const std::shared_ptr<AssetPack>& pack) {
+    std::lock_guard<std::mutex> lock(_mountLock);
+    _mounts.insert(_mounts.begin(),pack);
+}
+
+/**
+ * Unmounts every pack.
+ *
+ * No stream opened from a pack may be in use when it is unmounted.
+ */
+void AssetPack::unmountAll() {
+    std::lock_guard<std::mutex> lock(_mountLock);
+    _mounts.clear();
+}
+
+/**
+ * Returns the path of a file relative to the asset directory.
+ *
+ * A path inside the asset directory loses that prefix, and separators
+ * become /. Any other absolute path is returned as the empty string, as
+ * no pack can hold it.
+ *
+ * @param path  The path of the file
+ *
+ * @return the path of a file relative to the asset directory.
+ */
+std::string AssetPack::getAssetName(const std::string& path) {
+    std::string result = path;
+    if (filetool::is_absolute(path)) {
+        std::string root = (Application::get() == nullptr ? "" : Application::get()->getAssetDirectory());
+        result = filetool::normalize_path(path);
+        root = filetool::normalize_path(root);
+        if (root.empty() || result.compare(0,root.size(),root) != 0) {
+            return "";
+        }
+        result = result.substr(root.size());
+    }
+    std::replace(result.begin(), result.end(), '\\', '/');
+    while (!result.empty() && result[0] == '/') {
+        result.erase(0,1);
+    }
+    return result;
+}
+
+/**
+ * Returns true if a mounted pack has the given file.
+ *
+ * @param path  The path of the file, absolute or relative to the asset directory
+ *
+ * @return true if a mounted pack has the given file.
+ */
+bool AssetPack::hasAsset(const std::string& path) {
+    std::lock_guard<std::mutex> lock(_mountLock);
+    if (_mounts.empty()) {
+        return false;
+    }
+    std::string name = getAssetName(path);
+    for(auto it = _mounts.begin(); !name.empty() && it != _mounts.end(); ++it) {
+        if ((*it)->contains(name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Returns a stream of the given file, from a mounted pack or the disk.
+ *
+ * This is the replacement for SDL_RWFromFile when reading assets. The
+ * mode is only used for files on the disk, as packs are read-only.
+ *
+ * @param path  The path of the file, absolute or relative to the asset directory
+ * @param mode  The SDL_RWFromFile mode for files on the disk
+ *
+ * @return a stream of the given file, or nullptr if it cannot be opened.
+ */
+SDL_RWops* AssetPack::openAsset(const std::string& path, const char* mode) {
+    // The packs are copied so that decompression does not hold the lock
+    std::vector<std::shared_ptr<AssetPack>> mounts;
+    {
+        std::lock_guard<std::mutex> lock(_mountLock);
+        mounts = _mounts;
+    }
+    std::string name = mounts.empty() ? "" : getAssetName(path);
+    for(auto it = mounts.begin(); !name.empty() && it != mounts.end(); ++it) {
+        SDL_RWops* result = (*it)->open(name);
+        if (result != nullptr) {
+            return result;
+        }
+    }
+    return SDL_RWFromFile(path.c_str(),mode);
+}
+
+/**
+ * Returns the contents of the given file in a mounted pack, if stored in place.
+ *
+ * This allows files to be read without a copy. The contents stay valid
+ * until the packs are unmounted.
+ *
+ * @param path  The path of the file, absolute or relative to the asset directory
+ * @param size  Set to the size of the file
+ *
+ * @return the contents of the given file, or nullptr if no mounted pack stores it.
+ */
+const Uint8* AssetPack::getAssetData(const std::string& path, size_t& size) {
+    std::lock_guard<std::mutex> lock(_mountLock);
+    std::string name = _mounts.empty() ? "" : getAssetName(path);
+    for(auto it = _mounts.begin(); !name.empty() && it != _mounts.end(); ++it) {
+        const Uint8* result = (*it)->getData(name,size);
+        if (result != nullptr) {
+            return result;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Returns the 64 bit FNV-1a hash of a file name, as used by the index.
+ *
+ * @param name  The path of the file relative to the asset directory
+ *
+ * @return the 64 bit FNV-1a hash of a file name.
+ */
+Uint64 AssetPack::hash(const std::string& name) {
+    Uint64 result = 14695981039346656037ULL;
+    for(auto it = name.begin(); it != name.end(); ++it) {
+        result ^= (Uint8)*it;
+        result *= 1099511628211ULL;
+    }
+    return result;
+}
+
+#pragma mark -
+#pragma mark Compression
+/**
+ * Appends an LZ4 length extension to the output.
+ *
+ * @param output    The compressed data
+ * @param length    The length beyond the 15 held by the token
+ */
+static void append_length(std::vector<Uint8>& output, size_t length) {
+    while (length >= 255) {
+        output.push_back(255);
+        length -= 255;
+    }
+    output.push_back((Uint8)length);
+}
+
+/**
+ * Appends an LZ4 sequence to the output.
+ *
+ * A sequence is a run of literals followed by a match. The last sequence
+ * of a block has no match, which is given by a match length of 0.
+ *
+ * @param output    The compressed data
+ * @param literals  The literals of the sequence
+ * @param count     The number of literals
+ * @param offset    The distance back to the match
+ * @param match     The length of the match, or 0 for the last sequence
+ */
+static void append_sequence(std::vector<Uint8>& output, const Uint8* literals, size_t count,
+                            size_t offset, size_t match) {
+    size_t extra = match ? match-LZ4_MINMATCH : 0;
+    output.push_back((Uint8)((std::min(count,(size_t)15) << 4) | std::min(extra,(size_t)15)));
+    if (count >= 15) {
+        append_length(output,count-15);
+    }
+    output.insert(output.end(),literals,literals+count);
+    if (match) {
+        output.push_back((Uint8)(offset & 0xff));
+        output.push_back((Uint8)(offset >> 8));
+        if (extra >= 15) {
+            append_length(output,extra-15);
+        }
+    }
+}
+
+/**
+ * Returns the given data compressed in the LZ4 block format.
+ *
+ * This is used by the packer; the game only decompresses.
+ *
+ * @param data  The data to compress
+ * @param size  The size of the data
+ *
+ * @return the given data compressed in the LZ4 block format.
+ */
+std::vector<Uint8> AssetPack::compress(const Uint8* data, size_t size) {
+    std::vector<Uint8> result;
+    result.reserve(size+size/255+16);
+    // Positions are stored plus one, so that 0 means empty
+    std::vector<size_t> table((size_t)1 << LZ4_HASHBITS, 0);
+
+    size_t anchor = 0;
+    size_t pos = 0;
+    size_t limit = size > LZ4_MFLIMIT ? size-LZ4_MFLIMIT : 0;
+    while (pos < limit) {
+        Uint32 sequence;
+        memcpy(&sequence,data+pos,4);
+        size_t slot = (sequence*2654435761U) >> (32-LZ4_HASHBITS);
+        size_t candidate = table[slot];
+        table[slot] = pos+1;
+        if (candidate == 0 || pos-(candidate-1) > 65535 || memcmp(data+candidate-1,data+pos,4)) {
+            pos++;
+            continue;
+        }
+
+        size_t ref = candidate-1;
+        size_t length = LZ4_MINMATCH;
+        while (pos+length < size-LZ4_LASTLITERALS && data[ref+length] == data[pos+length]) {
+            length++;
+        }
+        append_sequence(result,data+anchor,pos-anchor,pos-ref,length);
+        pos += length;
+        anchor = pos;
+    }
+    append_sequence(result,data+anchor,size-anchor,0,0);
+    return result;
+}
+
+/**
+ * Decompresses data in the LZ4 block format.
+ *
+ * @param data      The compressed data
+ * @param size      The size of the compressed data
+ * @param output    The buffer for the decompressed data
+ * @param capacity  The exact size of the decompressed data
+ *
+ * @return true if the data decompressed to exactly capacity bytes.
+ */
+bool AssetPack::decompress(const Uint8* data, size_t size, Uint8* output, size_t capacity) {
+    const Uint8* end = data+size;
+    size_t pos = 0;
+    while (data < end) {
+        Uint8 token = *data++;
+        size_t count = token >> 4;
+        if (count == 15) {
+            Uint8 extra;
+            do {
+                if (data == end) return false;
+                extra = *data++;
+                count += extra;
+            } while (extra == 255);
+        }
+        if ((size_t)(end-data) < count || capacity-pos < count) {
+            return false;
+        }
+        memcpy(output+pos,data,count);
+        data += count;
+        pos += count;
+        if (data == end) {
+            break;
+        }
+
+        if (end-data < 2) {
+            return false;
+        }
+        size_t offset = data[0] | ((size_t)data[1] << 8);
+        data += 2;
+        size_t length = (token & 15);
+        if (length == 15) {
+            Uint8 extra;
+            do {
+                if (data == end) return false;
+                extra = *data++;
+                length += extra;
+            } while (extra == 255);
+        }
+        length += LZ4_MINMATCH;
+        if (offset == 0 || offset > pos || capacity-pos < length) {
+            return false;
+        }
+        // Matches may overlap their own output, so they are copied forward
+        const Uint8* source = output+pos-offset;
+        for(size_t ii = 0; ii < length; ii++) {
+            output[pos+ii] = source[ii];
+        }
+        pos += length;
+    }
+    return pos == capacity;
+}
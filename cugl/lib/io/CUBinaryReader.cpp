@@ -51,15 +51,35 @@
 //  Version: 11/28/16
 //
 #include <cugl/io/CUBinaryReader.h>
+#include <cugl/io/CUAssetPack.h>
 #include <cugl/util/CUDebug.h>
 #include <cugl/base/CUApplication.h>
 #include <cugl/base/CUEndian.h>
 #include <cugl/util/CUFiletools.h>
+#include <cugl/assets/CUJsonValue.h>
+#include <cstring>
 
 using namespace cugl;
 
 #define BUFFSIZE 1024
 
+/** The first bytes of a binary JSON file; must match CUBinaryWriter.cpp */
+#define JSON_MAGIC      "CUJB"
+/** The version of the binary JSON encoding */
+#define JSON_VERSION    2
+/** The maximum nesting of arrays and objects, as in the text parser */
+#define JSON_DEPTH      1000
+/** The tags of the binary JSON values; must match CUBinaryWriter.cpp */
+#define JSON_NULL       0
+#define JSON_FALSE      1
+#define JSON_TRUE       2
+#define JSON_INT32      3
+#define JSON_INT64      4
+#define JSON_DOUBLE     5
+#define JSON_STRING     6
+#define JSON_ARRAY      7
+#define JSON_OBJECT     8
+
 #pragma mark -
 #pragma mark Constructors
 
@@ -98,7 +118,7 @@ bool BinaryReader::init(const std::string file) {
 bool BinaryReader::init(const std::string file, unsigned int capacity) {
     CUAssertLog(capacity, "The buffer capacity must be positive");
     _name = filetool::normalize_path(file);
-    _stream = SDL_RWFromFile(_name.c_str(), "rb");
+    _stream = AssetPack::openAsset(_name, "rb");
     if (!_stream) {
         return false;
     }
@@ -152,7 +172,7 @@ bool BinaryReader::initWithAsset(const std::string file, unsigned int capacity)
     _name.append(file);
     _name = filetool::normalize_path(_name);
     
-    _stream = SDL_RWFromFile(_name.c_str(), "rb");
+    _stream = AssetPack::openAsset(_name, "rb");
     if (!_stream) {
         return false;
     }
@@ -180,7 +200,7 @@ void BinaryReader::reset() {
     if (_stream) {
         close();
     }
-    _stream = SDL_RWFromFile(_name.c_str(), "rb");
+    _stream = AssetPack::openAsset(_name, "rb");
     _ssize  = SDL_RWsize(_stream);
     _buffer = new char[_capacity];
     _bufsize = 0;
@@ -457,6 +477,9 @@ size_t BinaryReader::read(char* buffer, size_t maximum, size_t offset) {
     CUAssertLog(ready(), "Attempt to read a finished stream");
     unsigned int pos = (unsigned int)offset;
     while (ready(1) && pos-offset < maximum) {
+        if (_bufoff >= _bufsize) {
+            fill(1);
+        }
         size_t available = _bufsize-_bufoff;
         size_t wanted = maximum-(pos-offset);
         wanted = wanted < available ? wanted : available;
@@ -483,6 +506,9 @@ size_t BinaryReader::read(Uint8* buffer, size_t maximum, size_t offset)  {
     CUAssertLog(ready(), "Attempt to read a finished stream");
     unsigned int pos = (unsigned int)offset;
     while (ready(1) && pos-offset < maximum) {
+        if (_bufoff >= _bufsize) {
+            fill(1);
+        }
         size_t available = _bufsize-_bufoff;
         size_t wanted = maximum-(pos-offset);
         wanted = wanted < available ? wanted : available;
@@ -513,6 +539,9 @@ size_t BinaryReader::read(Sint16* buffer, size_t maximum, size_t offset) {
     unsigned int pos = (unsigned int)offset;
     unsigned int bytes = 2;
     while (ready(bytes) && pos-offset < maximum) {
+        if (_bufoff+bytes > _bufsize) {
+            fill(bytes);
+        }
         size_t available = bytes*((_bufsize-_bufoff)/bytes);
         size_t wanted = (maximum-(pos-offset))*bytes;
         wanted = wanted < available ? wanted : available;
@@ -547,6 +576,9 @@ size_t BinaryReader::read(Uint16* buffer, size_t maximum, size_t offset)  {
     unsigned int pos = (unsigned int)offset;
     unsigned int bytes = 2;
     while (ready(bytes) && pos-offset < maximum) {
+        if (_bufoff+bytes > _bufsize) {
+            fill(bytes);
+        }
         size_t available = bytes*((_bufsize-_bufoff)/bytes);
         size_t wanted = (maximum-(pos-offset))*bytes;
         wanted = wanted < available ? wanted : available;
@@ -582,6 +614,9 @@ size_t BinaryReader::read(Sint32* buffer, size_t maximum, size_t offset) {
     unsigned int pos = (unsigned int)offset;
     unsigned int bytes = 4;
     while (ready(bytes) && pos-offset < maximum) {
+        if (_bufoff+bytes > _bufsize) {
+            fill(bytes);
+        }
         size_t available = bytes*((_bufsize-_bufoff)/bytes);
         size_t wanted = (maximum-(pos-offset))*bytes;
         wanted = wanted < available ? wanted : available;
@@ -616,6 +651,9 @@ size_t BinaryReader::read(Uint32* buffer, size_t maximum, size_t offset) {
     unsigned int pos = (unsigned int)offset;
     unsigned int bytes = 4;
     while (ready(bytes) && pos-offset < maximum) {
+        if (_bufoff+bytes > _bufsize) {
+            fill(bytes);
+        }
         size_t available = bytes*((_bufsize-_bufoff)/bytes);
         size_t wanted = (maximum-(pos-offset))*bytes;
         wanted = wanted < available ? wanted : available;
@@ -650,6 +688,9 @@ size_t BinaryReader::read(Sint64* buffer, size_t maximum, size_t offset) {
     unsigned int pos = (unsigned int)offset;
     unsigned int bytes = 8;
     while (ready(bytes) && pos-offset < maximum) {
+        if (_bufoff+bytes > _bufsize) {
+            fill(bytes);
+        }
         size_t available = bytes*((_bufsize-_bufoff)/bytes);
         size_t wanted = (maximum-(pos-offset))*bytes;
         wanted = wanted < available ? wanted : available;
@@ -684,6 +725,9 @@ size_t BinaryReader::read(Uint64* buffer, size_t maximum, size_t offset) {
     unsigned int pos = (unsigned int)offset;
     unsigned int bytes = 8;
     while (ready(bytes) && pos-offset < maximum) {
+        if (_bufoff+bytes > _bufsize) {
+            fill(bytes);
+        }
         size_t available = bytes*((_bufsize-_bufoff)/bytes);
         size_t wanted = (maximum-(pos-offset))*bytes;
         wanted = wanted < available ? wanted : available;
@@ -718,6 +762,9 @@ size_t BinaryReader::read(float* buffer, size_t maximum, size_t offset) {
     unsigned int pos = (unsigned int)offset;
     unsigned int bytes = 4;
     while (ready(bytes) && pos-offset < maximum) {
+        if (_bufoff+bytes > _bufsize) {
+            fill(bytes);
+        }
         size_t available = bytes*((_bufsize-_bufoff)/bytes);
         size_t wanted = (maximum-(pos-offset))*bytes;
         wanted = wanted < available ? wanted : available;
@@ -752,6 +799,9 @@ size_t BinaryReader::read(double* buffer, size_t maximum, size_t offset) {
     unsigned int pos = (unsigned int)offset;
     unsigned int bytes = 8;
     while (ready(bytes) && pos-offset < maximum) {
+        if (_bufoff+bytes > _bufsize) {
+            fill(bytes);
+        }
         size_t available = bytes*((_bufsize-_bufoff)/bytes);
         size_t wanted = (maximum-(pos-offset))*bytes;
         wanted = wanted < available ? wanted : available;
@@ -766,3 +816,210 @@ size_t BinaryReader::read(double* buffer, size_t maximum, size_t offset) {
     return pos-offset;
 }
 
+
+#pragma mark -
+#pragma mark JSON Reads
+/**
+ * A cursor over the bytes of a binary JSON tree.
+ *
+ * The tree is decoded from memory rather than one read at a time, as the
+ * tags and counts are too small for the stream reads to pay off.
+ */
+typedef struct {
+    /** The next byte to decode */
+    const char* pos;
+    /** The end of the bytes */
+    const char* end;
+} JsonCursor;
+
+/**
+ * Decodes a fixed size value in network order, advancing the cursor.
+ *
+ * @param cursor    the cursor over the bytes
+ * @param value     the value to store the result
+ *
+ * @return true if the value was decoded
+ */
+template <typename T>
+static bool read_fixed(JsonCursor* cursor, T& value) {
+    if ((size_t)(cursor->end-cursor->pos) < sizeof(T)) {
+        return false;
+    }
+    memcpy(&value,cursor->pos,sizeof(T));
+    value = (T)marshall(value);
+    cursor->pos += sizeof(T);
+    return true;
+}
+
+/**
+ * Decodes a string stored as its length followed by its bytes.
+ *
+ * @param cursor    the cursor over the bytes
+ * @param value     the string to store the result
+ *
+ * @return true if the string was decoded
+ */
+static bool read_string(JsonCursor* cursor, std::string& value) {
+    Uint32 length;
+    if (!read_fixed(cursor,length) || (size_t)(cursor->end-cursor->pos) < length) {
+        return false;
+    }
+    value.assign(cursor->pos,length);
+    cursor->pos += length;
+    return true;
+}
+
+/**
+ * Decodes a JSON value and all of its children into the given node.
+ *
+ * @param cursor    the cursor over the bytes
+ * @param value     the node to store the result
+ * @param keys      the key table of the file
+ * @param depth     the nesting depth of value
+ *
+ * @return true if the value was decoded
+ */
+static bool read_value(JsonCursor* cursor, JsonValue* value,
+                       const std::vector<std::string>& keys, int depth) {
+    if (cursor->pos == cursor->end) {
+        return false;
+    }
+    Uint8 tag = (Uint8)*(cursor->pos++);
+    switch (tag) {
+        case JSON_NULL:
+            value->_type = JsonValue::Type::NullType;
+            return true;
+        case JSON_FALSE:
+        case JSON_TRUE:
+            value->_type = JsonValue::Type::BoolType;
+            value->_longValue = (tag == JSON_TRUE);
+            return true;
+        case JSON_INT32:
+        {
+            Sint32 number;
+            value->_type = JsonValue::Type::NumberType;
+            if (!read_fixed(cursor,number)) {
+                return false;
+            }
+            value->_longValue = number;
+            value->_doubleValue = (double)number;
+            return true;
+        }
+        case JSON_INT64:
+        {
+            Sint64 number;
+            value->_type = JsonValue::Type::NumberType;
+            if (!read_fixed(cursor,number)) {
+                return false;
+            }
+            value->_longValue = (long)number;
+            value->_doubleValue = (double)number;
+            return true;
+        }
+        case JSON_DOUBLE:
+            value->_type = JsonValue::Type::NumberType;
+            if (!read_fixed(cursor,value->_doubleValue)) {
+                return false;
+            }
+            value->_longValue = (long)value->_doubleValue;
+            return true;
+        case JSON_STRING:
+            value->_type = JsonValue::Type::StringType;
+            return read_string(cursor,value->_stringValue);
+        case JSON_ARRAY:
+        case JSON_OBJECT:
+            break;
+        default:
+            return false;
+    }
+
+    // Every child takes at least a byte, which bounds a corrupt count
+    bool object = (tag == JSON_OBJECT);
+    value->_type = object ? JsonValue::Type::ObjectType : JsonValue::Type::ArrayType;
+    Uint32 count;
+    if (depth >= JSON_DEPTH || !read_fixed(cursor,count) || (size_t)(cursor->end-cursor->pos) < count) {
+        return false;
+    }
+    value->_children.reserve(count);
+    for(Uint32 ii = 0; ii < count; ii++) {
+        std::shared_ptr<JsonValue> child = std::make_shared<JsonValue>();
+        child->_parent = value;
+        if (object) {
+            Uint32 key;
+            if (!read_fixed(cursor,key) || key >= keys.size()) {
+                return false;
+            }
+            child->_key = keys[key];
+        }
+        if (!read_value(cursor,child.get(),keys,depth+1)) {
+            return false;
+        }
+        value->_children.push_back(std::move(child));
+    }
+    value->reindex();
+    return true;
+}
+
+/**
+ * Returns the JSON tree written by {@link BinaryWriter#writeJson}.
+ *
+ * The tree is rebuilt directly from its tags, without tokenizing any
+ * text. This method returns nullptr if the file does not start with a
+ * binary JSON header, or if it is truncated or corrupt.
+ *
+ * If source is not 0, the tree is only read if it was written from a
+ * text file with that hash. Otherwise the text file has changed since
+ * the tree was baked, and this method returns nullptr as well.
+ *
+ * @param source    the hash of the text file of the tree, or 0 to skip the check
+ *
+ * @return the JSON tree written by {@link BinaryWriter#writeJson}.
+ */
+std::shared_ptr<JsonValue> BinaryReader::readJson(Uint64 source) {
+    if (!ready(13)) {
+        return nullptr;
+    }
+
+    // The rest of the file is the tree, so it is read at once past the buffer
+    size_t buffered = (size_t)(_bufsize-_bufoff);
+    size_t remain = buffered+(size_t)(_ssize-_scursor);
+    std::vector<char> bytes(remain);
+    memcpy(bytes.data(),&(_buffer[_bufoff]),buffered);
+    _bufoff = _bufsize;
+    size_t amt = SDL_RWread(_stream,bytes.data()+buffered,1,remain-buffered);
+    _scursor += amt;
+
+    JsonCursor cursor;
+    cursor.pos = bytes.data();
+    cursor.end = cursor.pos+buffered+amt;
+    if (memcmp(cursor.pos,JSON_MAGIC,4) || (Uint8)cursor.pos[4] != JSON_VERSION) {
+        return nullptr;
+    }
+    cursor.pos += 5;
+
+    Uint64 baked;
+    if (!read_fixed(&cursor,baked)) {
+        return nullptr;
+    } else if (source != 0 && baked != source) {
+        CULog("Binary JSON in '%s' was not baked from the given text file",_name.c_str());
+        return nullptr;
+    }
+
+    Uint32 count;
+    if (!read_fixed(&cursor,count) || (size_t)(cursor.end-cursor.pos)/4 < count) {
+        return nullptr;
+    }
+    std::vector<std::string> keys(count);
+    for(auto it = keys.begin(); it != keys.end(); ++it) {
+        if (!read_string(&cursor,*it)) {
+            return nullptr;
+        }
+    }
+
+    std::shared_ptr<JsonValue> result = std::make_shared<JsonValue>();
+    if (!read_value(&cursor,result.get(),keys,0)) {
+        CULogError("Corrupt binary JSON in '%s'",_name.c_str());
+        return nullptr;
+    }
+    return result;
+}
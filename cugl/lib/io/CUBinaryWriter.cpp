@@ -55,12 +55,29 @@
 #include <cugl/base/CUEndian.h>
 #include <cugl/util/CUDebug.h>
 #include <cugl/util/CUFiletools.h>
+#include <cugl/assets/CUJsonValue.h>
+#include <unordered_map>
 #include <cstring>
 
 using namespace cugl;
 
 #define BUFFSIZE 1024
 
+/** The first bytes of a binary JSON file; must match CUBinaryReader.cpp */
+#define JSON_MAGIC      "CUJB"
+/** The version of the binary JSON encoding; must match CUBinaryReader.cpp */
+#define JSON_VERSION    2
+/** The tags of the binary JSON values; must match CUBinaryReader.cpp */
+#define JSON_NULL       0
+#define JSON_FALSE      1
+#define JSON_TRUE       2
+#define JSON_INT32      3
+#define JSON_INT64      4
+#define JSON_DOUBLE     5
+#define JSON_STRING     6
+#define JSON_ARRAY      7
+#define JSON_OBJECT     8
+
 #pragma mark -
 #pragma mark Constructors
 
@@ -101,7 +118,7 @@ bool BinaryWriter::init(const std::string file) {
 bool BinaryWriter::init(const std::string file, unsigned int capacity) {
     CUAssertLog(capacity >= 8, "Buffer capacity is too small: %d", capacity);
     _name = filetool::normalize_path(file);
-    _stream = SDL_RWFromFile(_name.c_str(), "w");
+    _stream = SDL_RWFromFile(_name.c_str(), "wb");
     if (!_stream) {
         CULogError("%s", SDL_GetError());
         return false;
@@ -804,3 +821,124 @@ void BinaryWriter::write(const double* array, size_t length, size_t offset) {
     
     _bufoff += skip;
 }
+
+
+#pragma mark -
+#pragma mark JSON Writes
+/**
+ * Adds the keys of the objects in a JSON tree to the key table.
+ *
+ * Each distinct key gets the next index, in the order it is first seen.
+ *
+ * @param json  the JSON tree
+ * @param keys  the index of each key seen so far
+ * @param order the keys in the order of their indices
+ */
+static void collect_keys(const JsonValue* json, std::unordered_map<std::string,Uint32>& keys,
+                         std::vector<const std::string*>& order) {
+    bool object = json->isObject();
+    for(auto it = json->_children.begin(); it != json->_children.end(); ++it) {
+        if (object && keys.emplace((*it)->_key,(Uint32)order.size()).second) {
+            order.push_back(&((*it)->_key));
+        }
+        collect_keys(it->get(),keys,order);
+    }
+}
+
+/**
+ * Writes a string as its length followed by its bytes.
+ *
+ * @param writer    the binary writer
+ * @param value     the string to write
+ */
+static void write_string(BinaryWriter* writer, const std::string& value) {
+    writer->writeUint32((Uint32)value.size());
+    writer->write(value.data(),value.size());
+}
+
+/**
+ * Writes a JSON value and all of its children.
+ *
+ * @param writer    the binary writer
+ * @param json      the JSON value to write
+ * @param keys      the index of each object key
+ */
+static void write_value(BinaryWriter* writer, const JsonValue* json,
+                        const std::unordered_map<std::string,Uint32>& keys) {
+    switch (json->type()) {
+        case JsonValue::Type::NullType:
+            writer->writeUint8(JSON_NULL);
+            break;
+        case JsonValue::Type::BoolType:
+            writer->writeUint8(json->_longValue ? JSON_TRUE : JSON_FALSE);
+            break;
+        case JsonValue::Type::NumberType:
+            // Integers keep no double, as the reader can recompute it exactly
+            if ((double)json->_longValue != json->_doubleValue) {
+                writer->writeUint8(JSON_DOUBLE);
+                writer->writeDouble(json->_doubleValue);
+            } else if (json->_longValue >= INT32_MIN && json->_longValue <= INT32_MAX) {
+                writer->writeUint8(JSON_INT32);
+                writer->writeSint32((Sint32)json->_longValue);
+            } else {
+                writer->writeUint8(JSON_INT64);
+                writer->writeSint64((Sint64)json->_longValue);
+            }
+            break;
+        case JsonValue::Type::StringType:
+            writer->writeUint8(JSON_STRING);
+            write_string(writer,json->_stringValue);
+            break;
+        case JsonValue::Type::ArrayType:
+        case JsonValue::Type::ObjectType:
+        {
+            bool object = json->isObject();
+            writer->writeUint8(object ? JSON_OBJECT : JSON_ARRAY);
+            writer->writeUint32((Uint32)json->_children.size());
+            for(auto it = json->_children.begin(); it != json->_children.end(); ++it) {
+                if (object) {
+                    writer->writeUint32(keys.at((*it)->_key));
+                }
+                write_value(writer,it->get(),keys);
+            }
+        }
+            break;
+    }
+}
+
+/**
+ * Writes a JSON tree to the binary file.
+ *
+ * The tree is encoded compactly, so that {@link BinaryReader#readJson}
+ * can rebuild it without any text parsing. Every value is a one byte tag
+ * followed by its payload. Integers are stored in 4 or 8 bytes depending
+ * on their size, and doubles only when they have a fraction. The keys of
+ * the objects are stored once, in a table at the start of the file, and
+ * each object child refers to its key by index.
+ *
+ * The encoding is meant for files that only hold the tree, so it should
+ * be the only thing written to this file.
+ *
+ * The header records the hash of the text file the tree was read from
+ * (see {@link JsonLoader#hashSource}), so that a reader can tell when
+ * the text file has changed since. Use 0 if the tree has no text file.
+ *
+ * @param json      the JSON tree to write
+ * @param source    the hash of the text file of the tree, or 0 for none
+ */
+void BinaryWriter::writeJson(const std::shared_ptr<JsonValue>& json, Uint64 source) {
+    CUAssertLog(_stream, "Attempt to write to a closed stream");
+    CUAssertLog(json != nullptr, "Attempt to write a null JSON tree");
+    std::unordered_map<std::string,Uint32> keys;
+    std::vector<const std::string*> order;
+    collect_keys(json.get(),keys,order);
+
+    write(JSON_MAGIC,4);
+    writeUint8(JSON_VERSION);
+    writeUint64(source);
+    writeUint32((Uint32)order.size());
+    for(auto it = order.begin(); it != order.end(); ++it) {
+        write_string(this,**it);
+    }
+    write_value(this,json.get(),keys);
+}
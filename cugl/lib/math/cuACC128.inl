@@ -47,4 +47,41 @@ static inline float32x4_t vpermq_3102_f32(float32x4_t v) {
     return vextq_f32(temp,temp,3);
 }
 
+/**
+ * Returns the two points in v transformed by an affine matrix
+ *
+ * The points are stored as [x0 y0 x1 y1]. The matrix is given by its
+ * columns, each repeated twice: cx = [m0 m1 m0 m1], cy = [m2 m3 m2 m3]
+ * and ct = [m4 m5 m4 m5] in the layout of Affine2.
+ *
+ * @param v     the two points
+ * @param cx    the first matrix column
+ * @param cy    the second matrix column
+ * @param ct    the translation column
+ */
+static inline float32x4_t vaff2q_f32(float32x4_t v, float32x4_t cx, float32x4_t cy, float32x4_t ct) {
+    float32x4_t xs = vtrn1q_f32(v, v);                              // [x0 x0 x1 x1]
+    float32x4_t ys = vtrn2q_f32(v, v);                              // [y0 y0 y1 y1]
+    return vaddq_f32(vaddq_f32(vmulq_f32(xs, cx), vmulq_f32(ys, cy)), ct);
+}
+
+#elif defined (CU_MATH_VECTOR_SSE)
+/**
+ * Returns the two points in v transformed by an affine matrix
+ *
+ * The points are stored as [x0 y0 x1 y1]. The matrix is given by its
+ * columns, each repeated twice: cx = [m0 m1 m0 m1], cy = [m2 m3 m2 m3]
+ * and ct = [m4 m5 m4 m5] in the layout of Affine2.
+ *
+ * @param v     the two points
+ * @param cx    the first matrix column
+ * @param cy    the second matrix column
+ * @param ct    the translation column
+ */
+static inline __m128 _mm_aff2_ps(__m128 v, __m128 cx, __m128 cy, __m128 ct) {
+    __m128 xs = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2,2,0,0));        // [x0 x0 x1 x1]
+    __m128 ys = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3,3,1,1));        // [y0 y0 y1 y1]
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, cx), _mm_mul_ps(ys, cy)), ct);
+}
+
 #endif
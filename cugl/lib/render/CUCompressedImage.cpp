@@ -0,0 +1,587 @@
+//
+//  CUCompressedImage.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides the class for reading GPU-compressed images from KTX
+//  files. A compressed image holds the blocks of every mipmap level exactly
+//  as they are stored in the file, so a texture can be uploaded without ever
+//  inflating a PNG or converting pixels. The image supports the ETC1, ETC2
+//  and ASTC (LDR) formats. As not every driver samples every format, images
+//  in the ETC family can also be decompressed to RGBA on the CPU.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+#include <SDL/SDL.h>
+#include <mutex>
+#include <cugl/util/CUDebug.h>
+#include <cugl/util/CUFiletools.h>
+#include <cugl/io/CUAssetPack.h>
+#include <cugl/render/CUCompressedImage.h>
+
+using namespace cugl;
+
+/** The internal format of ETC1 files, which are read as ETC2 RGB */
+#define KTX_ETC1_RGB8   0x8D64
+
+const GLenum CompressedImage::ETC2_RGB8    = 0x9274;
+const GLenum CompressedImage::ETC2_RGB8_A1 = 0x9276;
+const GLenum CompressedImage::ETC2_RGBA8   = 0x9278;
+const GLenum CompressedImage::ASTC_4x4     = 0x93B0;
+const GLenum CompressedImage::ASTC_12x12   = 0x93BD;
+
+#pragma mark KTX Container
+/** The first twelve bytes of every KTX (version 1) file */
+static const Uint8 KTX_IDENTIFIER[12] = {
+    0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+/** The size of the KTX header, including the identifier */
+#define KTX_HEADER_SIZE 64
+
+/** The endianness word of a KTX file written in the order of the reader */
+#define KTX_ENDIAN_REF  0x04030201
+
+/** The block sizes of the LDR ASTC formats, in the order of their enums */
+static const int ASTC_BLOCKS[14][2] = {
+    {4,4}, {5,4}, {5,5}, {6,5}, {6,6}, {8,5}, {8,6},
+    {8,8}, {10,5}, {10,6}, {10,8}, {10,10}, {12,10}, {12,12}
+};
+
+/**
+ * Returns the 32-bit word at the given position of a KTX file
+ *
+ * @param data      The file contents
+ * @param pos       The byte position of the word
+ * @param swap      Whether the file was written with the other endianness
+ *
+ * @return the 32-bit word at the given position of a KTX file
+ */
+static Uint32 ktx_word(const Uint8* data, size_t pos, bool swap) {
+    Uint32 word;
+    memcpy(&word, data+pos, sizeof(Uint32));
+    return swap ? SDL_Swap32(word) : word;
+}
+
+#pragma mark -
+#pragma mark ETC Decoding
+/** The modifier pairs of the ETC individual and differential modes */
+static const int ETC_MODIFIERS[8][2] = {
+    {2,8}, {5,17}, {9,29}, {13,42}, {18,60}, {24,80}, {33,106}, {47,183}
+};
+
+/** The distances of the ETC2 T and H modes */
+static const int ETC_DISTANCES[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+/** The modifiers of the EAC alpha channel */
+static const int EAC_MODIFIERS[16][8] = {
+    {-3,-6,-9,-15,2,5,8,14},  {-3,-7,-10,-13,2,6,9,12},
+    {-2,-5,-8,-13,1,4,7,12},  {-2,-4,-6,-13,1,3,5,12},
+    {-3,-6,-8,-12,2,5,7,11},  {-3,-7,-9,-11,2,6,8,10},
+    {-4,-7,-8,-11,3,6,7,10},  {-3,-5,-8,-11,2,4,7,10},
+    {-2,-6,-8,-10,1,5,7,9},   {-2,-5,-8,-10,1,4,7,9},
+    {-2,-4,-8,-10,1,3,7,9},   {-2,-5,-7,-10,1,4,6,9},
+    {-3,-4,-7,-10,2,3,6,9},   {-1,-2,-3,-10,0,1,2,9},
+    {-4,-6,-8,-9,3,5,7,8},    {-3,-5,-7,-9,2,4,6,8}
+};
+
+/** Returns the value clamped to a byte */
+static inline int clamp_byte(int value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+/** Returns a color component of the given bit depth extended to eight bits */
+static inline int extend_bits(int value, int bits) {
+    return (value << (8-bits)) | (value >> (2*bits-8));
+}
+
+/** Returns a three bit two's complement value as an integer */
+static inline int signed3(int value) {
+    return value >= 4 ? value-8 : value;
+}
+
+/**
+ * Writes one pixel of a decoded block
+ *
+ * @param pixels    The 4x4 RGBA block, row by row
+ * @param x         The pixel column
+ * @param y         The pixel row
+ * @param rgb       The color of the pixel
+ * @param alpha     The alpha of the pixel
+ */
+static inline void put_pixel(Uint8* pixels, int x, int y, const int* rgb, int alpha) {
+    Uint8* pixel = pixels+4*(4*y+x);
+    pixel[0] = (Uint8)clamp_byte(rgb[0]);
+    pixel[1] = (Uint8)clamp_byte(rgb[1]);
+    pixel[2] = (Uint8)clamp_byte(rgb[2]);
+    pixel[3] = (Uint8)alpha;
+}
+
+/**
+ * Writes the pixels of a T or H mode block, which pick one of four paint colors
+ *
+ * @param pixels    The 4x4 RGBA block, row by row
+ * @param paint     The paint colors
+ * @param bits      The pixel indices of the block
+ * @param opaque    Whether the block has no transparent pixels
+ */
+static void put_paint(Uint8* pixels, const int paint[4][3], Uint32 bits, bool opaque) {
+    static const int black[3] = { 0, 0, 0 };
+    for(int y = 0; y < 4; y++) {
+        for(int x = 0; x < 4; x++) {
+            int pos = 4*x+y;
+            int index = (((bits >> (16+pos)) & 1) << 1) | ((bits >> pos) & 1);
+            if (!opaque && index == 2) {
+                put_pixel(pixels, x, y, black, 0);
+            } else {
+                put_pixel(pixels, x, y, paint[index], 255);
+            }
+        }
+    }
+}
+
+/**
+ * Decodes an ETC2 RGB block into 4x4 RGBA pixels
+ *
+ * ETC1 blocks are ETC2 blocks that only use the individual and differential
+ * modes. With punchthrough alpha, the differential bit tells whether the
+ * block is opaque instead, and the individual mode does not exist.
+ *
+ * @param src           The 8 bytes of the block
+ * @param pixels        The 4x4 RGBA block, row by row
+ * @param punchthrough  Whether the block has punchthrough alpha
+ */
+static void decode_etc2_rgb(const Uint8* src, Uint8* pixels, bool punchthrough) {
+    static const int black[3] = { 0, 0, 0 };
+    Uint32 bits = ((Uint32)src[4] << 24) | ((Uint32)src[5] << 16) | ((Uint32)src[6] << 8) | src[7];
+    bool diff = (src[3] & 2) != 0;
+    bool opaque = true;
+    if (punchthrough) {
+        opaque = diff;
+        diff = true;
+    }
+
+    int base[2][3];
+    if (!diff) {
+        for(int ii = 0; ii < 3; ii++) {
+            base[0][ii] = extend_bits(src[ii] >> 4, 4);
+            base[1][ii] = extend_bits(src[ii] & 0xf, 4);
+        }
+    } else {
+        int color[3], delta[3];
+        for(int ii = 0; ii < 3; ii++) {
+            color[ii] = src[ii] >> 3;
+            delta[ii] = color[ii]+signed3(src[ii] & 0x7);
+        }
+
+        // An overflowing differential color selects one of the ETC2 modes
+        int paint[4][3];
+        if (delta[0] < 0 || delta[0] > 31) {
+            // T mode
+            int c1[3] = { ((src[0] >> 1) & 0xc) | (src[0] & 0x3), src[1] >> 4, src[1] & 0xf };
+            int c2[3] = { src[2] >> 4, src[2] & 0xf, src[3] >> 4 };
+            int dist = ETC_DISTANCES[((src[3] >> 1) & 0x6) | (src[3] & 0x1)];
+            for(int ii = 0; ii < 3; ii++) {
+                paint[0][ii] = extend_bits(c1[ii], 4);
+                paint[2][ii] = extend_bits(c2[ii], 4);
+                paint[1][ii] = paint[2][ii]+dist;
+                paint[3][ii] = paint[2][ii]-dist;
+            }
+            put_paint(pixels, paint, bits, opaque);
+            return;
+        } else if (delta[1] < 0 || delta[1] > 31) {
+            // H mode
+            int c1[3] = { (src[0] >> 3) & 0xf, ((src[0] & 0x7) << 1) | ((src[1] >> 4) & 0x1),
+                          (src[1] & 0x8) | ((src[1] & 0x3) << 1) | (src[2] >> 7) };
+            int c2[3] = { (src[2] >> 3) & 0xf, ((src[2] & 0x7) << 1) | (src[3] >> 7), (src[3] >> 3) & 0xf };
+            int order = ((c1[0] << 8) | (c1[1] << 4) | c1[2]) >= ((c2[0] << 8) | (c2[1] << 4) | c2[2]) ? 1 : 0;
+            int dist = ETC_DISTANCES[(src[3] & 0x4) | ((src[3] & 0x1) << 1) | order];
+            for(int ii = 0; ii < 3; ii++) {
+                paint[0][ii] = extend_bits(c1[ii], 4)+dist;
+                paint[1][ii] = extend_bits(c1[ii], 4)-dist;
+                paint[2][ii] = extend_bits(c2[ii], 4)+dist;
+                paint[3][ii] = extend_bits(c2[ii], 4)-dist;
+            }
+            put_paint(pixels, paint, bits, opaque);
+            return;
+        } else if (delta[2] < 0 || delta[2] > 31) {
+            // Planar mode, which has no pixel indices
+            int orig[3] = {
+                extend_bits((src[0] >> 1) & 0x3f, 6),
+                extend_bits(((src[0] & 0x1) << 6) | ((src[1] >> 1) & 0x3f), 7),
+                extend_bits(((src[1] & 0x1) << 5) | (src[2] & 0x18) | ((src[2] & 0x3) << 1) | (src[3] >> 7), 6)
+            };
+            int horz[3] = {
+                extend_bits(((src[3] >> 1) & 0x3e) | (src[3] & 0x1), 6),
+                extend_bits(src[4] >> 1, 7),
+                extend_bits(((src[4] & 0x1) << 5) | (src[5] >> 3), 6)
+            };
+            int vert[3] = {
+                extend_bits(((src[5] & 0x7) << 3) | (src[6] >> 5), 6),
+                extend_bits(((src[6] & 0x1f) << 2) | (src[7] >> 6), 7),
+                extend_bits(src[7] & 0x3f, 6)
+            };
+            for(int y = 0; y < 4; y++) {
+                for(int x = 0; x < 4; x++) {
+                    int rgb[3];
+                    for(int ii = 0; ii < 3; ii++) {
+                        rgb[ii] = (x*(horz[ii]-orig[ii])+y*(vert[ii]-orig[ii])+4*orig[ii]+2) >> 2;
+                    }
+                    put_pixel(pixels, x, y, rgb, 255);
+                }
+            }
+            return;
+        }
+
+        for(int ii = 0; ii < 3; ii++) {
+            base[0][ii] = extend_bits(color[ii], 5);
+            base[1][ii] = extend_bits(delta[ii], 5);
+        }
+    }
+
+    // Individual and differential modes modify a base color per subblock
+    bool flip = (src[3] & 1) != 0;
+    int table[2] = { (src[3] >> 5) & 0x7, (src[3] >> 2) & 0x7 };
+    for(int y = 0; y < 4; y++) {
+        for(int x = 0; x < 4; x++) {
+            int pos = 4*x+y;
+            int sub = flip ? (y >= 2) : (x >= 2);
+            bool msb = ((bits >> (16+pos)) & 1) != 0;
+            bool lsb = ((bits >> pos) & 1) != 0;
+            int modifier = ETC_MODIFIERS[table[sub]][lsb ? 1 : 0];
+            if (msb) {
+                modifier = -modifier;
+            }
+            if (!opaque && !lsb) {
+                // Without the opaque bit, the small modifiers become 0 and transparent
+                if (msb) {
+                    put_pixel(pixels, x, y, black, 0);
+                    continue;
+                }
+                modifier = 0;
+            }
+            int rgb[3] = { base[sub][0]+modifier, base[sub][1]+modifier, base[sub][2]+modifier };
+            put_pixel(pixels, x, y, rgb, 255);
+        }
+    }
+}
+
+/**
+ * Decodes an EAC alpha block into the alpha of 4x4 RGBA pixels
+ *
+ * @param src       The 8 bytes of the block
+ * @param pixels    The 4x4 RGBA block, row by row
+ */
+static void decode_eac_alpha(const Uint8* src, Uint8* pixels) {
+    int base = src[0];
+    int multiplier = src[1] >> 4;
+    const int* modifiers = EAC_MODIFIERS[src[1] & 0xf];
+    Uint64 bits = 0;
+    for(int ii = 2; ii < 8; ii++) {
+        bits = (bits << 8) | src[ii];
+    }
+    for(int y = 0; y < 4; y++) {
+        for(int x = 0; x < 4; x++) {
+            int index = (int)((bits >> (45-3*(4*x+y))) & 0x7);
+            pixels[4*(4*y+x)+3] = (Uint8)clamp_byte(base+modifiers[index]*multiplier);
+        }
+    }
+}
+
+
+#pragma mark -
+#pragma mark Constructors
+/**
+ * Deletes the image data and resets all attributes.
+ *
+ * You must reinitialize the image to use it.
+ */
+void CompressedImage::dispose() {
+    _levels.clear();
+    _format = 0;
+    _width = 0;
+    _height = 0;
+}
+
+/**
+ * Initializes an image with the contents of a KTX file in memory.
+ *
+ * @param data  The contents of the file
+ * @param size  The size of the file in bytes
+ *
+ * @return true if initialization was successful.
+ */
+bool CompressedImage::initWithData(const Uint8* data, size_t size) {
+    if (!_levels.empty()) {
+        CUAssertLog(false, "Image is already initialized");
+        return false; // In case asserts are off.
+    }
+    if (size < KTX_HEADER_SIZE || memcmp(data, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0) {
+        CULogError("Image data is not a KTX file");
+        return false;
+    }
+
+    Uint32 endian;
+    memcpy(&endian, data+12, sizeof(Uint32));
+    bool swap = (endian != KTX_ENDIAN_REF);
+    if (swap && SDL_Swap32(endian) != KTX_ENDIAN_REF) {
+        CULogError("KTX file has an invalid endianness");
+        return false;
+    }
+
+    Uint32 gltype   = ktx_word(data, 16, swap);
+    Uint32 glformat = ktx_word(data, 24, swap);
+    GLenum internal = ktx_word(data, 28, swap);
+    Uint32 width    = ktx_word(data, 36, swap);
+    Uint32 height   = ktx_word(data, 40, swap);
+    Uint32 depth    = ktx_word(data, 44, swap);
+    Uint32 elements = ktx_word(data, 48, swap);
+    Uint32 faces    = ktx_word(data, 52, swap);
+    Uint32 levels   = std::max(ktx_word(data, 56, swap), (Uint32)1);
+    Uint32 metadata = ktx_word(data, 60, swap);
+
+    if (internal == KTX_ETC1_RGB8) {
+        internal = ETC2_RGB8;
+    }
+    int bwidth, bheight;
+    getBlockSize(internal, bwidth, bheight);
+    if (gltype != 0 || glformat != 0 || bwidth == 0) {
+        CULogError("KTX format 0x%04X is not a supported compressed format", internal);
+        return false;
+    } else if (width == 0 || height == 0 || depth > 1 || elements > 0 || faces != 1) {
+        CULogError("KTX file is not a 2D texture");
+        return false;
+    }
+
+    Uint32 full = 1;
+    while ((std::max(width, height) >> full) > 0) {
+        full++;
+    }
+    if (levels > full) {
+        CULogError("KTX file has %d mipmap levels, but a %dx%d image has at most %d", levels, width, height, full);
+        return false;
+    }
+
+    size_t pos = KTX_HEADER_SIZE+metadata;
+    std::vector<std::vector<Uint8>> chain;
+    for(Uint32 level = 0; level < levels; level++) {
+        Uint32 w = std::max(width >> level, (Uint32)1);
+        Uint32 h = std::max(height >> level, (Uint32)1);
+        size_t expected = ((w+bwidth-1)/bwidth)*((h+bheight-1)/bheight)*getBlockBytes(internal);
+        if (pos+4 > size) {
+            // The header promises more levels than the file has
+            CULogError("KTX file is missing mipmap level %d of %d", level, levels);
+            return false;
+        }
+        Uint32 bytes = ktx_word(data, pos, swap);
+        pos += 4;
+        if (bytes != expected || pos+bytes > size) {
+            CULogError("KTX mipmap level %d has the wrong size", level);
+            return false;
+        }
+        chain.emplace_back(data+pos, data+pos+bytes);
+        pos += (bytes+3) & ~3;
+    }
+    if (chain.empty()) {
+        CULogError("KTX file has no image data");
+        return false;
+    }
+
+    _format = internal;
+    _width  = (int)width;
+    _height = (int)height;
+    _levels = std::move(chain);
+    return true;
+}
+
+/**
+ * Initializes an image with the contents of a KTX file.
+ *
+ * IMPORTANT: In CUGL, relative path names always refer to the asset
+ * directory. If you wish to load an image from somewhere else, you must
+ * use an absolute pathname.
+ *
+ * @param filename  The KTX file
+ *
+ * @return true if initialization was successful.
+ */
+bool CompressedImage::initWithFile(const std::string filename) {
+    std::string fullpath = filetool::normalize_path(filename);
+    SDL_RWops* source = AssetPack::openAsset(fullpath);
+    if (source == nullptr) {
+        CULogError("Could not load file %s. %s", filename.c_str(), SDL_GetError());
+        return false;
+    }
+
+    Sint64 size = SDL_RWsize(source);
+    std::vector<Uint8> contents(size > 0 ? (size_t)size : 0);
+    size_t read = contents.empty() ? 0 : SDL_RWread(source, contents.data(), 1, contents.size());
+    SDL_RWclose(source);
+    if (read != contents.size() || contents.empty()) {
+        CULogError("Could not read file %s", filename.c_str());
+        return false;
+    }
+    return initWithData(contents.data(), contents.size());
+}
+
+
+#pragma mark -
+#pragma mark Attributes
+/**
+ * Returns the number of bytes of all the mipmap levels.
+ *
+ * This is the memory the image takes on the GPU once uploaded.
+ *
+ * @return the number of bytes of all the mipmap levels.
+ */
+size_t CompressedImage::getByteSize() const {
+    size_t total = 0;
+    for(auto it = _levels.begin(); it != _levels.end(); ++it) {
+        total += it->size();
+    }
+    return total;
+}
+
+
+#pragma mark -
+#pragma mark Decompression
+/**
+ * Returns true if this image can be decompressed on the CPU.
+ *
+ * That is the case for the ETC family, but not for ASTC.
+ *
+ * @return true if this image can be decompressed on the CPU.
+ */
+bool CompressedImage::canDecompress() const {
+    return _format == ETC2_RGB8 || _format == ETC2_RGB8_A1 || _format == ETC2_RGBA8;
+}
+
+/**
+ * Replaces every mipmap level with its RGBA pixels.
+ *
+ * This is the fallback for drivers that cannot sample the format of this
+ * image. The pixels are RGBA8, in the byte order that {@link Texture}
+ * expects for {@link Texture::PixelFormat#RGBA}. Afterwards
+ * {@link isCompressed} is false.
+ *
+ * @return true if the image was decompressed.
+ */
+bool CompressedImage::decompress() {
+    if (!canDecompress()) {
+        return false;
+    }
+
+    size_t bytes = getBlockBytes(_format);
+    Uint8 block[64];
+    for(size_t level = 0; level < _levels.size(); level++) {
+        int w = std::max(_width >> level, 1);
+        int h = std::max(_height >> level, 1);
+        int cols = (w+3)/4;
+        int rows = (h+3)/4;
+        const Uint8* src = _levels[level].data();
+        std::vector<Uint8> pixels(4*w*h);
+        for(int row = 0; row < rows; row++) {
+            for(int col = 0; col < cols; col++) {
+                if (_format == ETC2_RGBA8) {
+                    decode_etc2_rgb(src+8, block, false);
+                    decode_eac_alpha(src, block);
+                } else {
+                    decode_etc2_rgb(src, block, _format == ETC2_RGB8_A1);
+                }
+                src += bytes;
+
+                // Blocks on the edge may hang over the image
+                int bw = std::min(4, w-4*col);
+                int bh = std::min(4, h-4*row);
+                for(int y = 0; y < bh; y++) {
+                    memcpy(pixels.data()+4*((4*row+y)*w+4*col), block+16*y, 4*bw);
+                }
+            }
+        }
+        _levels[level] = std::move(pixels);
+    }
+    _format = 0;
+    return true;
+}
+
+/**
+ * Returns true if the OpenGL driver can sample the given format.
+ *
+ * The supported formats are queried from OpenGL the first time, and so
+ * the first call must take place in the main thread, with the OpenGL
+ * context active. Later calls are safe in any thread.
+ *
+ * @param format    The OpenGL internal format
+ *
+ * @return true if the OpenGL driver can sample the given format.
+ */
+bool CompressedImage::isSupported(GLenum format) {
+    static std::once_flag queried;
+    static std::vector<GLint> formats;
+    std::call_once(queried, [](void) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+        if (count > 0) {
+            formats.resize(count);
+            glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+        }
+    });
+
+#if CU_GL_PLATFORM == CU_GL_OPENGLES
+    // ETC2 is part of OpenGLES 3, even when the driver does not list it
+    if (format == ETC2_RGB8 || format == ETC2_RGB8_A1 || format == ETC2_RGBA8) {
+        return true;
+    }
+#endif
+    return std::find(formats.begin(), formats.end(), (GLint)format) != formats.end();
+}
+
+/**
+ * Returns the width and height of a block of the given format in pixels.
+ *
+ * @param format    The OpenGL internal format
+ * @param width     Set to the block width, or 0 if the format is unknown
+ * @param height    Set to the block height, or 0 if the format is unknown
+ */
+void CompressedImage::getBlockSize(GLenum format, int& width, int& height) {
+    if (format == ETC2_RGB8 || format == ETC2_RGB8_A1 || format == ETC2_RGBA8) {
+        width = height = 4;
+    } else if (format >= ASTC_4x4 && format <= ASTC_12x12) {
+        width  = ASTC_BLOCKS[format-ASTC_4x4][0];
+        height = ASTC_BLOCKS[format-ASTC_4x4][1];
+    } else {
+        width = height = 0;
+    }
+}
+
+/**
+ * Returns the number of bytes of a block of the given format.
+ *
+ * @param format    The OpenGL internal format
+ *
+ * @return the number of bytes of a block of the given format, or 0 if the format is unknown
+ */
+size_t CompressedImage::getBlockBytes(GLenum format) {
+    if (format == ETC2_RGB8 || format == ETC2_RGB8_A1) {
+        return 8;
+    } else if (format == ETC2_RGBA8 || (format >= ASTC_4x4 && format <= ASTC_12x12)) {
+        return 16;
+    }
+    return 0;
+}
@@ -49,6 +49,7 @@
 #include <cugl/util/CUDebug.h>
 #include <cugl/util/CUFiletools.h>
 #include <cugl/util/CUStrings.h>
+#include <cugl/io/CUAssetPack.h>
 #include <cugl/render/CUTexture.h>
 #include <cugl/render/CUFont.h>
 
@@ -671,7 +672,7 @@ bool Font::init(const std::string file, Uint32 size) {
         return false;
     }
     std::string fullpath = filetool::normalize_path(file);
-    _data = TTF_OpenFont(fullpath.c_str(), size);
+    _data = TTF_OpenFontRW(AssetPack::openAsset(fullpath), 1, size);
     if (_data == nullptr) {
         CUAssertLog(false, "Font initialization error: %s", TTF_GetError());
         return false;
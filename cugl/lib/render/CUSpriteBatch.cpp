@@ -54,6 +54,7 @@
 #include <cugl/render/CUFont.h>
 #include <cugl/render/CUGlyphRun.h>
 #include <cugl/render/CUTextLayout.h>
+#include "../math/cuACC128.inl"
 
 /**
  * Default fragment shader
@@ -120,6 +121,9 @@ using namespace cugl;
 /** All values have changed */
 #define DIRTY_ALL_VALS          0xFFF
 
+/** The number of earlier groups a deferred draw is compared against */
+#define SORT_WINDOW             64
+
 /** Clear no buffers */
 #define STENCIL_NONE            0x000
 /** Clear lower buffer */
@@ -130,41 +134,57 @@ using namespace cugl;
 #define STENCIL_BOTH            0x003
 
 /**
- * Fills poly with a mesh defining the given rectangle.
+ * Fills corners with the four corners of the given rectangle.
  *
- * We need this method because we want to allow non-standard
- * polygons that represent a path, and not a triangulated
- * polygon.
+ * The corners are stored as [x0 y0 x1 y1 x2 y2 x3 y3], starting at the
+ * bottom left and going counterclockwise. This replaces a temporary
+ * {@link Poly2}, as sprites are drawn far too often to allocate one.
  *
- * @param poly      The polygon to store the result
+ * @param corners   The array to store the result
  * @param rect      The source rectangle
- * @param solid     Whether to triangulate the rectangle
- */
-static void makeRect(Poly2& poly, const Rect& rect, bool solid) {
-    poly.vertices.reserve(4);
-    poly.vertices.push_back(rect.origin);
-    poly.vertices.push_back(Vec2(rect.origin.x+rect.size.width, rect.origin.y));
-    poly.vertices.push_back(rect.origin+rect.size);
-    poly.vertices.push_back(Vec2(rect.origin.x, rect.origin.y+rect.size.height));
-    if (solid) {
-        poly.indices.reserve(6);
-        poly.indices.push_back(0);
-        poly.indices.push_back(1);
-        poly.indices.push_back(2);
-        poly.indices.push_back(0);
-        poly.indices.push_back(2);
-        poly.indices.push_back(3);
-    } else {
-        poly.indices.reserve(8);
-        poly.indices.push_back(0);
-        poly.indices.push_back(1);
-        poly.indices.push_back(1);
-        poly.indices.push_back(2);
-        poly.indices.push_back(2);
-        poly.indices.push_back(3);
-        poly.indices.push_back(3);
-        poly.indices.push_back(0);
-    }
+ */
+static inline void makeQuad(float* corners, const Rect& rect) {
+    float left   = rect.origin.x;
+    float bottom = rect.origin.y;
+    float right  = rect.origin.x+rect.size.width;
+    float top    = rect.origin.y+rect.size.height;
+    corners[0] = left;  corners[1] = bottom;
+    corners[2] = right; corners[3] = bottom;
+    corners[4] = right; corners[5] = top;
+    corners[6] = left;  corners[7] = top;
+}
+
+/**
+ * Transforms the four corners of a quad in place.
+ *
+ * The corners are stored as [x0 y0 x1 y1 x2 y2 x3 y3]. Where vectorization
+ * is supported, two corners are transformed at a time. The result is the
+ * same as applying the transform to each corner as a {@link Vec2}.
+ *
+ * @param corners   The corners to transform
+ * @param mat       The transform to apply
+ */
+static inline void transformQuad(float* corners, const Affine2& mat) {
+#if defined (CU_MATH_VECTOR_SSE)
+    __m128 cx = _mm_setr_ps(mat.m[0], mat.m[1], mat.m[0], mat.m[1]);
+    __m128 cy = _mm_setr_ps(mat.m[2], mat.m[3], mat.m[2], mat.m[3]);
+    __m128 ct = _mm_setr_ps(mat.m[4], mat.m[5], mat.m[4], mat.m[5]);
+    _mm_storeu_ps(corners,   _mm_aff2_ps(_mm_loadu_ps(corners),   cx, cy, ct));
+    _mm_storeu_ps(corners+4, _mm_aff2_ps(_mm_loadu_ps(corners+4), cx, cy, ct));
+#elif defined (CU_MATH_VECTOR_NEON64)
+    float32x4_t cx = {mat.m[0], mat.m[1], mat.m[0], mat.m[1]};
+    float32x4_t cy = {mat.m[2], mat.m[3], mat.m[2], mat.m[3]};
+    float32x4_t ct = {mat.m[4], mat.m[5], mat.m[4], mat.m[5]};
+    vst1q_f32(corners,   vaff2q_f32(vld1q_f32(corners),   cx, cy, ct));
+    vst1q_f32(corners+4, vaff2q_f32(vld1q_f32(corners+4), cx, cy, ct));
+#else
+    for(int ii = 0; ii < 8; ii += 2) {
+        float x = corners[ii];
+        float y = corners[ii+1];
+        corners[ii  ] = mat.m[0]*x+mat.m[2]*y+mat.m[4];
+        corners[ii+1] = mat.m[1]*x+mat.m[3]*y+mat.m[5];
+    }
+#endif
 }
 
 #pragma mark -
@@ -278,6 +298,81 @@ public:
         type = 0;
         dirty = 0;
     }
+
+    /**
+     * Returns true if this context draws the same way as the given one.
+     *
+     * The draws of two matching contexts may be merged into a single call.
+     * Subtextures match if they are on the same texture page, unless they
+     * are blurred, as the blur step depends on the texture size.
+     *
+     * @param other The context to compare
+     *
+     * @return true if this context draws the same way as the given one.
+     */
+    bool matches(const Context* other) const {
+        if (command != other->command || type != other->type || blendEq != other->blendEq ||
+            srcRGB != other->srcRGB || srcAlpha != other->srcAlpha ||
+            dstRGB != other->dstRGB || dstAlpha != other->dstAlpha ||
+            stencil != other->stencil || blockptr != other->blockptr ||
+            zDepth != other->zDepth || blur != other->blur) {
+            return false;
+        } else if (perspective != other->perspective && *perspective != *(other->perspective)) {
+            return false;
+        } else if (texture == nullptr || other->texture == nullptr) {
+            return texture == other->texture;
+        }
+        return blur == 0 ? texture->getBuffer() == other->texture->getBuffer() : texture == other->texture;
+    }
+
+    /**
+     * Returns the dirty bits needed to switch from this context to the next.
+     *
+     * Stencil clears are not part of the state, so they are never included.
+     *
+     * @param next  The context drawn after this one
+     *
+     * @return the dirty bits needed to switch from this context to the next.
+     */
+    GLuint diff(const Context* next) const {
+        GLuint result = 0;
+        if (blendEq != next->blendEq) {
+            result |= DIRTY_BLENDEQUATION;
+        }
+        if (srcRGB != next->srcRGB || srcAlpha != next->srcAlpha) {
+            result |= DIRTY_SRC_FUNCTION;
+        }
+        if (dstRGB != next->dstRGB || dstAlpha != next->dstAlpha) {
+            result |= DIRTY_DST_FUNCTION;
+        }
+        if (zDepth != next->zDepth) {
+            result |= DIRTY_DEPTHVALUE;
+        }
+        if (type != next->type) {
+            result |= DIRTY_DRAWTYPE;
+        }
+        if (perspective != next->perspective && *perspective != *(next->perspective)) {
+            result |= DIRTY_PERSPECTIVE;
+        }
+        if (stencil != next->stencil) {
+            result |= DIRTY_STENCIL_EFFECT;
+        }
+        if (blockptr != next->blockptr) {
+            result |= DIRTY_UNIBLOCK;
+        }
+        bool same = texture == next->texture;
+        if (!same && texture != nullptr && next->texture != nullptr) {
+            if (texture->getBuffer() != next->texture->getBuffer()) {
+                result |= DIRTY_TEXTURE;
+            }
+        } else if (!same) {
+            result |= DIRTY_TEXTURE;
+        }
+        if (blur != next->blur || (!same && next->blur != 0)) {
+            result |= DIRTY_BLURSTEP;
+        }
+        return result;
+    }
     
     /** The first vertex index position for this set of uniforms */
     GLuint first;
@@ -326,6 +421,7 @@ SpriteBatch::SpriteBatch() :
 _initialized(false),
 _active(false),
 _inflight(false),
+_deferred(false),
 _vertData(nullptr),
 _indxData(nullptr),
 _color(Color4f::WHITE),
@@ -340,7 +436,6 @@ _callTotal(0) {
     _vertbuff = nullptr;
     _unifbuff = nullptr;
     _gradient = nullptr;
-    _scissor  = nullptr;
 }
 
 /**
@@ -362,7 +457,7 @@ void SpriteBatch::dispose() {
     _vertbuff = nullptr;
     _unifbuff = nullptr;
     _gradient = nullptr;
-    _scissor  = nullptr;
+    _scissors.clear();
     
     _vertMax  = 0;
     _vertSize = 0;
@@ -375,6 +470,7 @@ void SpriteBatch::dispose() {
     
     _initialized = false;
     _inflight = false;
+    _deferred = false;
     _active = false;
 }
 
@@ -459,7 +555,8 @@ bool SpriteBatch::init(unsigned int capacity, const std::shared_ptr<Shader>& sha
     
     _shader = shader;
     
-    _vertbuff = VertexBuffer::alloc(sizeof(SpriteVertex2));
+    // The batch reloads the buffer on every flush, so stream it through a ring
+    _vertbuff = VertexBuffer::allocWithStream(sizeof(SpriteVertex2), capacity, capacity*3);
     _vertbuff->setupAttribute("aPosition", 2, GL_FLOAT, GL_FALSE,
                               offsetof(cugl::SpriteVertex2,position));
     _vertbuff->setupAttribute("aColor",    4, GL_UNSIGNED_BYTE, GL_TRUE,
@@ -579,6 +676,13 @@ void SpriteBatch::setTexture(const std::shared_ptr<Texture>& texture) {
     if (texture == _context->texture) {
         return;
     }
+    // Subtextures of the same atlas page do not break the batch. The blur
+    // step depends on the texture size, so it must still be recorded.
+    if (texture != nullptr && _context->texture != nullptr && _context->blur == 0 &&
+        _context->texture->getBuffer() == texture->getBuffer()) {
+        _context->texture = texture;
+        return;
+    }
 
     if (_inflight) { record(); }
     if (texture == nullptr) {
@@ -698,8 +802,10 @@ void SpriteBatch::setGradient(const std::shared_ptr<Gradient>& gradient) {
  * @return The active scissor mask for this sprite batch
  */
 std::shared_ptr<Scissor> SpriteBatch::getScissor() const {
-    if (_scissor != nullptr) {
-        return Scissor::alloc(_scissor);
+    if (!_scissors.empty()) {
+        std::shared_ptr<Scissor> result = std::make_shared<Scissor>();
+        result->set(_scissors.back());
+        return result;
     }
     return nullptr;
 }
@@ -717,10 +823,13 @@ std::shared_ptr<Scissor> SpriteBatch::getScissor() const {
  * This method acquires a copy of the scissor. Changes to the original
  * scissor mask after calling this method have no effect.
  *
+ * The scissor replaces the top of the scissor stack (see
+ * {@link #pushScissor}). Setting it to nullptr empties the stack.
+ *
  * @param scissor   The active scissor mask for this sprite batch
  */
 void SpriteBatch::setScissor(const std::shared_ptr<Scissor>& scissor) {
-    if (scissor == _scissor) {
+    if (scissor == nullptr && _scissors.empty()) {
         return;
     }
     
@@ -729,11 +838,59 @@ void SpriteBatch::setScissor(const std::shared_ptr<Scissor>& scissor) {
         // Active gradient is not null
         _context->dirty = _context->dirty | DIRTY_UNIBLOCK | DIRTY_DRAWTYPE;
         _context->type = _context->type & ~TYPE_SCISSOR;
-        _scissor = nullptr;
+        _scissors.clear();
     } else {
         _context->dirty = _context->dirty | DIRTY_UNIBLOCK | DIRTY_DRAWTYPE;
         _context->type = _context->type | TYPE_SCISSOR;
-        _scissor = Scissor::alloc(scissor);
+        if (_scissors.empty()) {
+            _scissors.push_back(*scissor);
+        } else {
+            _scissors.back() = *scissor;
+        }
+    }
+}
+
+/**
+ * Pushes a scissor mask on the scissor stack of this sprite batch
+ *
+ * The scissor becomes the active scissor mask, intersected with the
+ * previous active mask (if any) by {@link Scissor#intersect}. As with
+ * {@link #setScissor}, it is in the coordinate system of
+ * {@link getPerspective}. The previous mask is restored by
+ * {@link #popScissor}.
+ *
+ * Unlike {@link #setScissor}, this method does not allocate any memory
+ * once the stack is deep enough. This makes it the preferred way to
+ * clip nested scene graph nodes on every frame.
+ *
+ * @param scissor   The scissor mask to push
+ */
+void SpriteBatch::pushScissor(const Scissor& scissor) {
+    if (_inflight) { record(); }
+    _context->dirty = _context->dirty | DIRTY_UNIBLOCK | DIRTY_DRAWTYPE;
+    _context->type = _context->type | TYPE_SCISSOR;
+    _scissors.push_back(scissor);
+    if (_scissors.size() > 1) {
+        _scissors.back().intersect(_scissors[_scissors.size()-2]);
+    }
+}
+
+/**
+ * Pops the active scissor mask from the scissor stack of this sprite batch
+ *
+ * This restores the mask that was active before the matching call to
+ * {@link #pushScissor}. Popping an empty stack does nothing.
+ */
+void SpriteBatch::popScissor() {
+    if (_scissors.empty()) {
+        return;
+    }
+    
+    if (_inflight) { record(); }
+    _context->dirty = _context->dirty | DIRTY_UNIBLOCK | DIRTY_DRAWTYPE;
+    _scissors.pop_back();
+    if (_scissors.empty()) {
+        _context->type = _context->type & ~TYPE_SCISSOR;
     }
 }
 
@@ -1143,6 +1300,9 @@ void SpriteBatch::flush() {
     } else if (_context->first != _indxSize) {
         record();
     }
+    if (_deferred && _history.size() > 1) {
+        sortHistory();
+    }
     
     // Load all the vertex data at once
     _vertbuff->loadVertexData(_vertData, _vertSize);
@@ -2584,6 +2744,111 @@ void SpriteBatch::unwind() {
     _history.clear();
 }
 
+/**
+ * Reorders the drawing context history to merge compatible draws.
+ *
+ * This method is called by {@link #flush} in deferred mode. Each context
+ * is moved back to the latest earlier context with the same state, as
+ * long as it does not overlap any context in between. The indices of the
+ * merged contexts are rewritten so that each merged context is a single
+ * range, and the dirty bits are recomputed for the new order.
+ *
+ * A stencil effect, a stencil clear or a change of perspective is a barrier
+ * that no context moves across. The bounding boxes are in the coordinates
+ * of each perspective, so they cannot be compared across a change.
+ */
+void SpriteBatch::sortHistory() {
+    // The bounding box of each context, as min x, min y, max x, max y
+    size_t count = _history.size();
+    std::vector<float> bounds(4*count);
+    for(size_t ii = 0; ii < count; ii++) {
+        Context* next = _history[ii];
+        float* box = bounds.data()+4*ii;
+        box[0] = box[1] =  std::numeric_limits<float>::infinity();
+        box[2] = box[3] = -std::numeric_limits<float>::infinity();
+        for(GLuint jj = next->first; jj < next->last; jj++) {
+            const Vec2& point = _vertData[_indxData[jj]].position;
+            box[0] = std::min(box[0],point.x);
+            box[1] = std::min(box[1],point.y);
+            box[2] = std::max(box[2],point.x);
+            box[3] = std::max(box[3],point.y);
+        }
+    }
+
+    // Merge each context into the latest compatible group that it can pass.
+    // Touching edges are not overlaps, so adjacent tiles may be merged.
+    std::vector<size_t> heads;
+    std::vector<std::vector<size_t>> groups;
+    std::vector<float> extents;
+    size_t fence = 0;
+    for(size_t ii = 0; ii < count; ii++) {
+        Context* next = _history[ii];
+        const float* box = bounds.data()+4*ii;
+        Context* prev = ii > 0 ? _history[ii-1] : nullptr;
+        bool barrier = next->stencil != StencilEffect::NATIVE ||
+                       (next->dirty & (DIRTY_STENCIL_CLEAR | DIRTY_STENCIL_EFFECT)) ||
+                       (prev != nullptr && prev->perspective != next->perspective &&
+                        *(prev->perspective) != *(next->perspective));
+        size_t target = groups.size();
+        size_t limit = std::max(fence, groups.size() > SORT_WINDOW ? groups.size()-SORT_WINDOW : 0);
+        for(size_t jj = groups.size(); !barrier && jj > limit; jj--) {
+            if (_history[heads[jj-1]]->matches(next)) {
+                target = jj-1;
+                break;
+            }
+            const float* other = extents.data()+4*(jj-1);
+            if (box[0] < other[2] && other[0] < box[2] && box[1] < other[3] && other[1] < box[3]) {
+                break;
+            }
+        }
+        if (target == groups.size()) {
+            heads.push_back(ii);
+            groups.push_back(std::vector<size_t>());
+            extents.insert(extents.end(), box, box+4);
+            if (barrier) {
+                fence = groups.size();
+            }
+        }
+        groups[target].push_back(ii);
+        float* extent = extents.data()+4*target;
+        extent[0] = std::min(extent[0],box[0]);
+        extent[1] = std::min(extent[1],box[1]);
+        extent[2] = std::max(extent[2],box[2]);
+        extent[3] = std::max(extent[3],box[3]);
+    }
+    if (groups.size() == count) {
+        return;
+    }
+
+    // Rewrite the indices so that each group is a single range
+    std::vector<GLuint> indices;
+    indices.reserve(_indxSize);
+    std::vector<Context*> sorted;
+    sorted.reserve(groups.size());
+    for(size_t ii = 0; ii < groups.size(); ii++) {
+        Context* head = _history[heads[ii]];
+        GLuint first = (GLuint)indices.size();
+        for(auto it = groups[ii].begin(); it != groups[ii].end(); ++it) {
+            Context* next = _history[*it];
+            indices.insert(indices.end(), _indxData+next->first, _indxData+next->last);
+            if (next != head) {
+                delete next;
+            }
+        }
+        head->first = first;
+        head->last  = (GLuint)indices.size();
+        if (!sorted.empty()) {
+            head->dirty = sorted.back()->diff(head) | (head->dirty & DIRTY_STENCIL_CLEAR);
+        }
+        sorted.push_back(head);
+    }
+    std::memcpy(_indxData, indices.data(), indices.size()*sizeof(GLuint));
+    _history.swap(sorted);
+
+    // The next context assumed the state of the last context in the old order
+    _context->dirty = _context->dirty | _history.back()->diff(_context);
+}
+
 /**
  * Sets the active uniform block to agree with the gradient and stroke.
  *
@@ -2599,8 +2864,8 @@ void SpriteBatch::setUniformBlock(Context* context) {
         flush();
     }
     float data[40];
-    if (_scissor != nullptr) {
-        _scissor->getData(data);
+    if (!_scissors.empty()) {
+        _scissors.back().getData(data);
     } else {
         std::memset(data,0,16*sizeof(float));
     }
@@ -3036,51 +3301,10 @@ unsigned int SpriteBatch::prepare(const Rect rect) {
         flush();
     }
     
-    Texture* texture = _context->texture.get();
-    float tsmax, tsmin;
-    float ttmax, ttmin;
-    
-    if (texture != nullptr) {
-        tsmax = texture->getMaxS();
-        tsmin = texture->getMinS();
-        ttmax = texture->getMaxT();
-        ttmin = texture->getMinT();
-    } else {
-        tsmax = 1.0f; tsmin = 0.0f;
-        ttmax = 1.0f; ttmin = 0.0f;
-    }
-    
     setUniformBlock(_context);
-    Poly2 poly;
-    makeRect(poly, rect, _context->command == GL_TRIANGLES);
-    unsigned int vstart = _vertSize;
-    int ii = 0;
-    GLuint clr = _color.getPacked();
-    for(auto it = poly.vertices.begin(); it != poly.vertices.end(); ++it) {
-        Vec2 point = *it;
-        _vertData[vstart+ii].position = point;
-        point.x = (point.x-rect.origin.x)/rect.size.width;
-        point.y = 1-(point.y-rect.origin.y)/rect.size.height;
-        _vertData[vstart+ii].texcoord.x = point.x*tsmax+(1-point.x)*tsmin;
-        _vertData[vstart+ii].texcoord.y = point.y*ttmax+(1-point.y)*ttmin;
-        _vertData[vstart+ii].gradcoord.x = point.x+(1-point.x);
-        _vertData[vstart+ii].gradcoord.y = point.y+(1-point.y);
-        _vertData[vstart+ii].color = clr;
-        
-        ii++;
-    }
-    
-    int jj = 0;
-    unsigned int istart = _indxSize;
-    for(auto it = poly.indices.begin(); it != poly.indices.end(); ++it) {
-        _indxData[istart+jj] = vstart+(*it);
-        jj++;
-    }
-    
-    _vertSize += ii;
-    _indxSize += jj;
-    _inflight = true;
-    return ii;
+    float corners[8];
+    makeQuad(corners, rect);
+    return prepareQuad(corners);
 }
 
 /**
@@ -3105,6 +3329,28 @@ unsigned int SpriteBatch::prepare(const Rect rect, const Affine2& mat) {
         flush();
     }
 
+    setUniformBlock(_context);
+    float corners[8];
+    makeQuad(corners, rect);
+    transformQuad(corners, mat);
+    return prepareQuad(corners);
+}
+
+/**
+ * Returns the number of vertices added to the drawing buffer.
+ *
+ * This method is the fast path of {@link #prepare} for rectangles. It
+ * writes the four corners straight into the vertex buffer, with the
+ * texture coordinates of the rectangle, instead of going through a
+ * temporary {@link Poly2}. The corners are in the order bottom left,
+ * bottom right, top right and top left, already transformed. The caller
+ * must make room in the buffers and set the uniform block first.
+ *
+ * @param corners   The quad corners as [x0 y0 x1 y1 x2 y2 x3 y3]
+ *
+ * @return the number of vertices added to the drawing buffer.
+ */
+unsigned int SpriteBatch::prepareQuad(const float* corners) {
     Texture* texture = _context->texture.get();
     float tsmax, tsmin;
     float ttmax, ttmin;
@@ -3118,39 +3364,40 @@ unsigned int SpriteBatch::prepare(const Rect rect, const Affine2& mat) {
         tsmax = 1.0f; tsmin = 0.0f;
         ttmax = 1.0f; ttmin = 0.0f;
     }
-    
-    setUniformBlock(_context);
-    Poly2 poly;
-    makeRect(poly, rect, _context->command == GL_TRIANGLES);
 
-    unsigned int vstart = _vertSize;
-    int ii = 0;
+    // The bottom of the rectangle has the top texture coordinate
     GLuint clr = _color.getPacked();
-    for(auto it = poly.vertices.begin(); it != poly.vertices.end(); ++it) {
-        Vec2 point = *it;
-        _vertData[vstart+ii].position = point*mat;
-        point.x = (point.x-rect.origin.x)/rect.size.width;
-        point.y = 1-(point.y-rect.origin.y)/rect.size.height;
-        _vertData[vstart+ii].texcoord.x = point.x*tsmax+(1-point.x)*tsmin;
-        _vertData[vstart+ii].texcoord.y = point.y*ttmax+(1-point.y)*ttmin;
-        _vertData[vstart+ii].gradcoord.x = point.x+(1-point.x);
-        _vertData[vstart+ii].gradcoord.y = point.y+(1-point.y);
-        _vertData[vstart+ii].color = clr;
-
-        ii++;
-    }
-    
-    int jj = 0;
-    unsigned int istart = _indxSize;
-    for(auto it = poly.indices.begin(); it != poly.indices.end(); ++it) {
-        _indxData[istart+jj] = vstart+(*it);
-        jj++;
+    unsigned int vstart = _vertSize;
+    SpriteVertex2* vert = _vertData+vstart;
+    vert[0].position.set(corners[0],corners[1]);
+    vert[0].texcoord.set(tsmin,ttmax);
+    vert[1].position.set(corners[2],corners[3]);
+    vert[1].texcoord.set(tsmax,ttmax);
+    vert[2].position.set(corners[4],corners[5]);
+    vert[2].texcoord.set(tsmax,ttmin);
+    vert[3].position.set(corners[6],corners[7]);
+    vert[3].texcoord.set(tsmin,ttmin);
+    for(int ii = 0; ii < 4; ii++) {
+        vert[ii].gradcoord.set(1,1);
+        vert[ii].color = clr;
+    }
+
+    GLuint* indx = _indxData+_indxSize;
+    if (_context->command == GL_TRIANGLES) {
+        indx[0] = vstart;   indx[1] = vstart+1; indx[2] = vstart+2;
+        indx[3] = vstart;   indx[4] = vstart+2; indx[5] = vstart+3;
+        _indxSize += 6;
+    } else {
+        indx[0] = vstart;   indx[1] = vstart+1;
+        indx[2] = vstart+1; indx[3] = vstart+2;
+        indx[4] = vstart+2; indx[5] = vstart+3;
+        indx[6] = vstart+3; indx[7] = vstart;
+        _indxSize += 8;
     }
-    
-    _vertSize += ii;
-    _indxSize += jj;
+
+    _vertSize += 4;
     _inflight = true;
-    return ii;
+    return 4;
 }
 
 /**
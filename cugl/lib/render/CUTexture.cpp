@@ -34,7 +34,9 @@
 #include <sstream>
 #include <cugl/util/CUDebug.h>
 #include <cugl/util/CUFiletools.h>
+#include <cugl/io/CUAssetPack.h>
 #include <cugl/render/CUTexture.h>
+#include <cugl/render/CUCompressedImage.h>
 
 using namespace cugl;
 
@@ -172,6 +174,7 @@ _width(0),
 _height(0),
 _name(""),
 _pixelFormat(PixelFormat::RGBA),
+_compression(0),
 _minFilter(GL_LINEAR),
 _magFilter(GL_LINEAR),
 _wrapS(GL_CLAMP_TO_EDGE),
@@ -199,6 +202,7 @@ void Texture::dispose() {
         _buffer = 0;
         _width = 0; _height = 0;
         _pixelFormat = PixelFormat::RGBA;
+        _compression = 0;
         _name = "";
         _minFilter = GL_LINEAR; _magFilter = GL_LINEAR;
         _wrapS = GL_CLAMP_TO_EDGE; _wrapT = GL_CLAMP_TO_EDGE;
@@ -284,6 +288,9 @@ bool Texture::initWithData(const void *data, int width, int height, Texture::Pix
  *
  * This method can load any file format supported by SDL_Image.  This
  * includes (but is not limited to) PNG, JPEG, GIF, TIFF, BMP and PCX.
+ * It can also load KTX files of the formats in {@link CompressedImage}.
+ * Their data is uploaded without decoding it, unless the OpenGL driver
+ * does not support the format and it can be decompressed on the CPU.
  *
  * The texture will be stored in RGBA format, even if it is a file format
  * that does not support transparency (e.g. JPEG).
@@ -293,8 +300,22 @@ bool Texture::initWithData(const void *data, int width, int height, Texture::Pix
  * @return true if initialization was successful.
  */
 bool Texture::initWithFile(const std::string filename) {
+    if (filetool::base_suffix(filename) == "ktx") {
+        std::shared_ptr<CompressedImage> image = CompressedImage::allocWithFile(filename);
+        if (image == nullptr) {
+            return false;
+        } else if (!CompressedImage::isSupported(image->getFormat()) && !image->decompress()) {
+            CULogError("Texture format of %s is not supported by this device", filename.c_str());
+            return false;
+        }
+        bool result = initWithCompressed(image);
+        if (result) setName(filename);
+        return result;
+    }
+
     std::string fullpath = filetool::normalize_path(filename);
-    SDL_Surface* surface = IMG_Load(fullpath.c_str());
+    std::string suffix = filetool::base_suffix(fullpath);
+    SDL_Surface* surface = IMG_LoadTyped_RW(AssetPack::openAsset(fullpath), 1, suffix.c_str());
     if (surface == nullptr) {
         CULogError("Could not load file %s. %s", filename.c_str(), SDL_GetError());
         return false;
@@ -318,6 +339,84 @@ bool Texture::initWithFile(const std::string filename) {
     return result;
 }
 
+/**
+ * Initializes an texture with the mipmap levels of a compressed image.
+ *
+ * Initializing a texture requires the use of texture offset 0.  Any texture
+ * bound to that offset will be unbound.  In addition, once initialization
+ * is done, this texture will not longer be bound as well.
+ *
+ * The levels are uploaded as they are, without decoding them, so the
+ * OpenGL driver must support the format of the image (see
+ * {@link CompressedImage#isSupported}). An image that was decompressed
+ * on the CPU is uploaded as RGBA instead. If the image has more than one
+ * level, the texture has mipmaps.
+ *
+ * @param image     The compressed image
+ *
+ * @return true if initialization was successful.
+ */
+bool Texture::initWithCompressed(const std::shared_ptr<CompressedImage>& image) {
+    CUAssertLog(image != nullptr && image->getLevelCount() > 0, "Compressed image is empty");
+    GLenum error;
+
+    if (_buffer) {
+        CUAssertLog(false, "Texture is already initialized");
+        return false; // In case asserts are off.
+    }
+
+    glGenTextures(1, &_buffer);
+    if (_buffer == 0) {
+        error = glGetError();
+        CULogError("Could not allocate texture. %s", gl_error_name(error).c_str());
+        return false;
+    }
+
+    _width  = image->getWidth();
+    _height = image->getHeight();
+    _pixelFormat = PixelFormat::RGBA;
+    _compression = image->getFormat();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, _buffer);
+
+    GLint levels = (GLint)image->getLevelCount();
+    for(GLint level = 0; level < levels; level++) {
+        GLsizei width  = std::max((GLsizei)(_width  >> level), 1);
+        GLsizei height = std::max((GLsizei)(_height >> level), 1);
+        const std::vector<Uint8>& data = image->getLevel(level);
+        if (_compression) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, _compression, width, height, 0,
+                                   (GLsizei)data.size(), data.data());
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+        }
+    }
+
+    error = glGetError();
+    if (error) {
+        CULogError("Could not initialize texture. %s", gl_error_name(error).c_str());
+        glDeleteTextures(1, &_buffer);
+        _buffer = 0;
+        _compression = 0;
+        return false;
+    }
+
+    // A chain that stops before 1x1 is only complete with a max level
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels-1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, _minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, _magFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, _wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, _wrapT);
+    _hasMipmaps = levels > 1;
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    std::stringstream ss;
+    ss << "@" << image.get();
+    setName(ss.str());
+    return true;
+}
+
 /**
  * Returns a blank texture that can be used to make solid shapes.
  *
@@ -366,6 +465,9 @@ const Texture& Texture::set(const void *data) {
     if (!isActive()) {
         CUAssertLog(false,"Texture %s is not currently active.",_name.c_str());
         return *this;
+    } else if (_compression) {
+        CUAssertLog(false,"Texture %s is compressed.",_name.c_str());
+        return *this;
     }
 
     glTexImage2D(GL_TEXTURE_2D, 0, (GLenum)_pixelFormat, _width, _height, 0,
@@ -379,9 +481,17 @@ const Texture& Texture::set(const void *data) {
 /**
  * Returns the number of bytes in a single pixel of this texture.
  *
- * @return the number of bytes in a single pixel of this texture.
+ * A compressed texture has no bytes per pixel. For such a texture this is
+ * the number of bytes in a single block instead, which covers the pixels
+ * of {@link CompressedImage#getBlockSize}.
+ *
+ * @return the number of bytes in a single pixel (or block) of this texture.
  */
 unsigned int Texture::getByteSize() const {
+    GLenum compression = getCompression();
+    if (compression) {
+        return (unsigned int)CompressedImage::getBlockBytes(compression);
+    }
     switch (_pixelFormat) {
         case Texture::PixelFormat::RGBA:
             return 4;
@@ -411,9 +521,18 @@ unsigned int Texture::getByteSize() const {
  * texture can have mipmaps.  In addition, mipmaps can only be built if the
  * texture size is a power of two.
  *
+ * A compressed texture cannot build mipmaps, and keeps the ones of the
+ * image it was created with (if any).
+ *
  * This method is only successful if the texture is currently active.
  */
 void Texture::buildMipMaps() {
+    if (_compression) {
+        if (!_hasMipmaps) {
+            CUWarn("Texture %s is compressed and has no mipmaps in its file.",_name.c_str());
+        }
+        return;
+    }
     CUAssertLog(nextPOT(_width)  == _width,  "Width  %d is not a power of two", _width);
     CUAssertLog(nextPOT(_height) == _height, "Height %d is not a power of two", _height);
     CUAssertLog(_parent == nullptr, "Cannot build mipmaps for a subtexture");
@@ -563,9 +682,9 @@ std::shared_ptr<Texture> Texture::getSubTexture(GLfloat minS, GLfloat maxS,
     // Filters, wrap, and binding defer to parent.
     // These values can be left alone.
     
-    // Set the size information
-    result->_width  = (unsigned int)((maxS-minS)*source->_width);
-    result->_height = (unsigned int)((maxT-minT)*source->_height);
+    // Set the size information (rounded, as pixel bounds rarely divide exactly)
+    result->_width  = (unsigned int)((maxS-minS)*source->_width+0.5f);
+    result->_height = (unsigned int)((maxT-minT)*source->_height+0.5f);
     result->_minS = minS;
     result->_maxS = maxS;
     result->_minT = minT;
@@ -763,7 +882,8 @@ std::string Texture::toString(bool verbose) const {
  * Returns true if able to save the texture to the given file.
  *
  * The image will be saved as a PNG file.  If the suffix of file is not
- * .png, then this suffix will be added.
+ * .png, then this suffix will be added. A compressed texture cannot be
+ * saved, as its blocks cannot be read back as pixels.
  *
  * IMPORTANT: In CUGL, relative path names always refer to the asset
  * directory, which is a read-only directory.  Therefore, the file must
@@ -785,6 +905,10 @@ bool Texture::save(const std::string file) {
     } else if (!filetool::is_absolute(file)) {
         CUAssertLog(false, "Data may not be saved to the asset directory.");
         return false;
+    } else if (getCompression()) {
+        // glGetTexImage cannot read compressed blocks back as pixels
+        CUAssertLog(false, "Texture %s is compressed and cannot be saved.",_name.c_str());
+        return false;
     }
 
     // Make sure file is named properly.
@@ -33,9 +33,44 @@
 #include <cugl/render/CUVertexBuffer.h>
 #include <cugl/render/CUShader.h>
 #include <cugl/render/CUTexture.h>
+#include <cstring>
 
 using namespace cugl;
 
+/** How long to wait on a fence before checking again, in nanoseconds */
+#define FENCE_TIMEOUT 1000000000
+
+/**
+ * Waits until the GPU has passed the given fence, and then deletes it.
+ *
+ * @param fence The fence to wait on
+ */
+static void waitFence(GLsync fence) {
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+    while (status == GL_TIMEOUT_EXPIRED) {
+        status = glClientWaitSync(fence, 0, FENCE_TIMEOUT);
+    }
+    CUAssertLog(status != GL_WAIT_FAILED, "VertexBuffer: could not wait on fence");
+    glDeleteSync(fence);
+}
+
+/**
+ * Returns a write-only mapping of a range of the bound buffer.
+ *
+ * The mapping is unsynchronized, as the caller has checked with a fence that
+ * the range is not in use. It returns nullptr if the buffer cannot be mapped.
+ *
+ * @param target    The buffer target
+ * @param offset    The start of the range in bytes
+ * @param length    The length of the range in bytes
+ *
+ * @return a write-only mapping of a range of the bound buffer.
+ */
+static void* mapRange(GLenum target, GLintptr offset, GLsizeiptr length) {
+    return glMapBufferRange(target, offset, length, GL_MAP_WRITE_BIT |
+                            GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
 #pragma mark Constructors
 /**
  * Creates an uninitialized vertex buffer.
@@ -46,6 +81,9 @@ VertexBuffer::VertexBuffer() :
 _vertArray(0),
 _vertBuffer(0),
 _indxBuffer(0),
+_segments(0),
+_vertRing(),
+_indxRing(),
 _stride(0) {
     _shader = nullptr;
 }
@@ -102,6 +140,54 @@ bool VertexBuffer::init(GLsizei stride) {
     return true;
 }
 
+/**
+ * Initializes this vertex buffer to stream data of the given stride.
+ *
+ * A streaming vertex buffer allocates its storage as a ring of segments,
+ * each large enough for the given number of vertices and indices. Every
+ * call to {@link #loadVertexData} or {@link #loadIndexData} writes its
+ * data after that of the previous call, through an unsynchronized mapping.
+ * When a load does not fit in the current segment, the segment is fenced
+ * and the load moves on to the next one, waiting until the GPU is done
+ * with it. With three segments, the CPU can fill one segment while the
+ * GPU draws the other two. The ring grows if a load does not fit in a
+ * segment at all.
+ *
+ * Indices are always relative to the vertices of the latest load, just
+ * as for a buffer that is not streaming. The offsets of the draw calls
+ * are also unchanged.
+ *
+ * @param stride    The size of a single piece of vertex data.
+ * @param vertices  The vertex capacity of each segment
+ * @param indices   The index capacity of each segment
+ * @param segments  The number of segments in the ring
+ *
+ * @return true if initialization was successful.
+ */
+bool VertexBuffer::initWithStream(GLsizei stride, GLsizei vertices, GLsizei indices, GLsizei segments) {
+    CUAssertLog(segments > 0, "The number of segments must be positive");
+    if (!init(stride)) {
+        return false;
+    }
+    _segments = segments;
+    _vertRing.slice = std::max(vertices,1);
+    _indxRing.slice = std::max(indices,1);
+    _vertRing.fences.assign(segments, nullptr);
+    _indxRing.fences.assign(segments, nullptr);
+
+    // Allocate the rings once. They are only reallocated if a load does not fit.
+    bind();
+    glBufferData( GL_ARRAY_BUFFER, _stride * _vertRing.slice * _segments, nullptr, GL_STREAM_DRAW );
+    glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * _indxRing.slice * _segments, nullptr, GL_STREAM_DRAW );
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        CULogError("Could not allocate vertex stream. %s", gl_error_name(error).c_str());
+        dispose();
+        return false;
+    }
+    return true;
+}
+
 /**
  * Deletes the vertex buffer, freeing all resources.
  *
@@ -113,6 +199,16 @@ void VertexBuffer::dispose() {
     }
     _enabled.clear();
     _attributes.clear();
+    for(Ring* ring : { &_vertRing, &_indxRing }) {
+        for(auto it = ring->fences.begin(); it != ring->fences.end(); ++it) {
+            if (*it != nullptr) {
+                glDeleteSync(*it);
+            }
+        }
+        *ring = Ring();
+    }
+    _rebased.clear();
+    _segments = 0;
     glDeleteBuffers(1,&_indxBuffer);
     glDeleteBuffers(1,&_vertBuffer);
     glDeleteVertexArrays(1,&_vertArray);
@@ -233,6 +329,49 @@ bool VertexBuffer::isBound() const {
 
 #pragma mark -
 #pragma mark Vertex Processing
+/**
+ * Returns the position in the given ring for a load of the given size.
+ *
+ * The ring moves on to the next segment if the load does not fit in the
+ * current one, waiting until the GPU is done with it. The storage grows
+ * if the load does not fit in any segment. The buffer of the ring must
+ * be bound.
+ *
+ * @param ring      The ring to write
+ * @param target    The buffer target of the ring
+ * @param size      The number of elements to load
+ * @param unit      The size of an element in bytes
+ *
+ * @return the position in the given ring for a load of the given size.
+ */
+GLsizei VertexBuffer::reserve(Ring& ring, GLenum target, GLsizei size, GLsizei unit) {
+    if (size > ring.slice) {
+        // A larger ring orphans the old storage, so no fence is needed
+        ring.slice = std::max(size, 2*ring.slice);
+        glBufferData( target, unit * ring.slice * _segments, nullptr, GL_STREAM_DRAW );
+        for(auto it = ring.fences.begin(); it != ring.fences.end(); ++it) {
+            if (*it != nullptr) {
+                glDeleteSync(*it);
+                *it = nullptr;
+            }
+        }
+        ring.segment = 0;
+        ring.cursor  = 0;
+    } else if (ring.cursor+size > ring.slice) {
+        // Fence the draws from this segment, and wait until the next is free
+        ring.fences[ring.segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        ring.segment = (ring.segment+1) % _segments;
+        ring.cursor  = 0;
+        if (ring.fences[ring.segment] != nullptr) {
+            waitFence(ring.fences[ring.segment]);
+            ring.fences[ring.segment] = nullptr;
+        }
+    }
+    ring.base = ring.segment * ring.slice + ring.cursor;
+    ring.cursor += size;
+    return ring.base;
+}
+
 /**
  * Loads the given vertex buffer with data.
  *
@@ -252,6 +391,10 @@ bool VertexBuffer::isBound() const {
  * can amortize the uniform changes.  For quads and other simple meshes, 
  * you should always choose GL_STREAM_DRAW.
  *
+ * If this buffer is streaming, the usage is ignored. The data is written
+ * after the latest load in the ring, and the indices must be loaded again
+ * after it.
+ *
  * This method will only succeed if this buffer is actively bound.
  *
  * @param data  The data to load
@@ -260,7 +403,18 @@ bool VertexBuffer::isBound() const {
  */
 void VertexBuffer::loadVertexData(const void * data, GLsizei size, GLenum usage) {
     //CUAssertLog(isBound(), "Vertex buffer is not bound"); // Problems on android emulator for now
-    glBufferData( GL_ARRAY_BUFFER, _stride * size, data, usage );
+    if (!_segments) {
+        glBufferData( GL_ARRAY_BUFFER, _stride * size, data, usage );
+    } else {
+        GLsizei base = reserve(_vertRing, GL_ARRAY_BUFFER, size, _stride);
+        void* target = mapRange(GL_ARRAY_BUFFER, _stride * base, _stride * size);
+        if (target != nullptr) {
+            std::memcpy(target, data, _stride * size);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        } else {
+            glBufferSubData( GL_ARRAY_BUFFER, _stride * base, _stride * size, data );
+        }
+    }
     
     GLenum error = glGetError();
     CUAssertLog(error == GL_NO_ERROR, "VertexBuffer: %s", gl_error_name(error).c_str());
@@ -286,6 +440,10 @@ void VertexBuffer::loadVertexData(const void * data, GLsizei size, GLenum usage)
  * you should always choose GL_STREAM_DRAW and push as much computation to the
  * CPU as possible.
  *
+ * If this buffer is streaming, the usage is ignored. The indices are
+ * written after the latest load in the ring, and refer to the latest
+ * vertex data.
+ *
  * This method will only succeed if this buffer is actively bound.
  *
  * @param data  The indices to load
@@ -294,7 +452,28 @@ void VertexBuffer::loadVertexData(const void * data, GLsizei size, GLenum usage)
  */
 void VertexBuffer::loadIndexData(const void * data, GLsizei size, GLenum usage) {
     //CUAssertLog(isBound(), "Vertex buffer is not bound"); // Problems on android emulator for now
-    glBufferData( GL_ELEMENT_ARRAY_BUFFER, size * sizeof(GLuint), data, usage );
+    if (!_segments) {
+        glBufferData( GL_ELEMENT_ARRAY_BUFFER, size * sizeof(GLuint), data, usage );
+    } else {
+        GLsizei base = reserve(_indxRing, GL_ELEMENT_ARRAY_BUFFER, size, sizeof(GLuint));
+        
+        // The indices refer to the latest vertex data
+        const GLuint* source = (const GLuint*)data;
+        GLuint* target = (GLuint*)mapRange(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * base, sizeof(GLuint) * size);
+        bool mapped = target != nullptr;
+        if (!mapped) {
+            _rebased.resize(size);
+            target = _rebased.data();
+        }
+        for(GLsizei ii = 0; ii < size; ii++) {
+            target[ii] = source[ii]+_vertRing.base;
+        }
+        if (mapped) {
+            glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+        } else {
+            glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * base, sizeof(GLuint) * size, target );
+        }
+    }
     GLenum error = glGetError();
     CUAssertLog(error == GL_NO_ERROR, "VertexBuffer: %s", gl_error_name(error).c_str());
 }
@@ -322,7 +501,7 @@ void VertexBuffer::loadIndexData(const void * data, GLsizei size, GLenum usage)
  */
 void VertexBuffer::draw(GLenum mode, GLsizei count, GLsizei offset) {
     //CUAssertLog(isBound(), "Vertex buffer is not bound"); // Problems on android emulator for now
-    glDrawElements(mode, count, GL_UNSIGNED_INT, (void*)(offset * sizeof(GLuint)));
+    glDrawElements(mode, count, GL_UNSIGNED_INT, (void*)((offset+_indxRing.base) * sizeof(GLuint)));
 }
 
 /**
@@ -356,7 +535,7 @@ void VertexBuffer::draw(GLenum mode, GLsizei count, GLsizei offset) {
  */
 void VertexBuffer::drawInstanced(GLenum mode, GLsizei count, GLsizei instance, GLsizei offset) {
     //CUAssertLog(isBound(), "Vertex buffer is not bound"); // Problems on android emulator for now
-    glDrawElementsInstanced(mode, count, GL_UNSIGNED_INT, (void*)(offset * sizeof(GLuint)), instance);
+    glDrawElementsInstanced(mode, count, GL_UNSIGNED_INT, (void*)((offset+_indxRing.base) * sizeof(GLuint)), instance);
 }
 
 
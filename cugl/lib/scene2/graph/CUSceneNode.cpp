@@ -66,6 +66,8 @@ _anchor(Vec2::ANCHOR_BOTTOM_LEFT),
 _scale(Vec2::ONE),
 _angle(0),
 _useTransform(false),
+_stamp(0),
+_renderDirty(true),
 _parent(nullptr),
 _graph(nullptr),
 _childOffset(-2),
@@ -265,6 +267,9 @@ void SceneNode::dispose() {
     _transform = Affine2::IDENTITY;
     _useTransform = false;
     _combined = Affine2::IDENTITY;
+    _stamp++;
+    _renderList.clear();
+    _renderDirty = true;
     _parent = nullptr;
     _graph = nullptr;
     _childOffset = -2;
@@ -298,6 +303,7 @@ std::shared_ptr<SceneNode> SceneNode::copy(const std::shared_ptr<SceneNode>& dst
     dst->_transform = _transform;
     dst->_useTransform = _useTransform;
     dst->_combined = _combined;
+    dst->_stamp++;
     dst->_tag = _tag;
     dst->_name = _name;
     dst->_hashOfName = _hashOfName;
@@ -324,6 +330,7 @@ void SceneNode::setPosition(float x, float y) {
     _combined.m[4] += (x-_position.x);
     _combined.m[5] += (y-_position.y);
     _position.set(x,y);
+    _stamp++;
 }
 
 /**
@@ -500,6 +507,7 @@ void SceneNode::updateTransform() {
         _combined.m[4] += _position.x-offset.x;
         _combined.m[5] += _position.y-offset.y;
      }
+    _stamp++;
 }
 
 
@@ -602,7 +610,7 @@ void SceneNode::addChild(const std::shared_ptr<SceneNode>& child) {
     _children.push_back(child);
     child->setParent(this);
     child->pushScene(_graph);
-    
+    invalidateRenderList();
 }
 
 /**
@@ -626,6 +634,7 @@ void SceneNode::swapChild(const std::shared_ptr<SceneNode>& child1,
     child1->setParent(nullptr);
     child2->pushScene(_graph);
     child1->pushScene(nullptr);
+    invalidateRenderList();
     
     // Check if we are dirty and/or inherit children
     if (inherit) {
@@ -656,6 +665,7 @@ void SceneNode::removeChild(unsigned int pos) {
         _children[ii]->_childOffset = ii;
     }
     _children.resize(_children.size()-1);
+    invalidateRenderList();
 }
 
 /**
@@ -719,6 +729,7 @@ void SceneNode::removeAllChildren() {
         (*it)->pushScene(nullptr);
     }
     _children.clear();
+    invalidateRenderList();
 }
 
 /**
@@ -736,6 +747,18 @@ void SceneNode::pushScene(Scene2* scene) {
     }
 }
 
+/**
+ * Marks the render lists of this node and its ancestors as out of date.
+ *
+ * This must be called whenever a child is added or removed, as any
+ * ancestor may have been rendered as a root.
+ */
+void SceneNode::invalidateRenderList() {
+    for(SceneNode* node = this; node != nullptr; node = node->_parent) {
+        node->_renderDirty = true;
+    }
+}
+
 /**
  * Arranges the child of this node using the layout manager.
  *
@@ -764,6 +787,13 @@ void SceneNode::doLayout() {
  * transform of this Node.  In addition, if hasRelativeColor() is true, it
  * will blend the Node color with the given tint.
  *
+ * This node keeps its subtree as a flattened render list, which is only
+ * rebuilt when a child is added or removed below it. The world transform
+ * of each node is cached in the list, and only recomputed when its
+ * transform or that of an ancestor changes. Descendants are drawn with
+ * {@link #draw}, unless {@link #rendersChildren} is true for them. So a
+ * subclass that overrides this method must also override that one.
+ *
  * @param batch     The SpriteBatch to draw with.
  * @param matrix    The global transformation matrix.
  * @param tint      The tint to blend with the Node color.
@@ -771,31 +801,116 @@ void SceneNode::doLayout() {
 void SceneNode::render(const std::shared_ptr<SpriteBatch>& batch, const Affine2& transform, Color4 tint) {
     if (!_isVisible) { return; }
     
-    Affine2 matrix;
-    Affine2::multiply(_combined,transform,&matrix);
-    Color4 color = _tintColor;
-    if (_hasParentColor) {
-        color *= tint;
+    if (_renderDirty) {
+        _renderList.clear();
+        flatten(_renderList,0,true);
+        _renderDirty = false;
+    }
+    bool based = transform == _renderBase;
+    if (!based) {
+        _renderBase = transform;
     }
     
-    std::shared_ptr<Scissor> active = batch->getScissor();
-    if (_scissor) {
-        std::shared_ptr<Scissor> local = Scissor::alloc(_scissor);
-        local->multiply(matrix);
-        if (active) {
-            local->intersect(active);
+    // The entries of a subtree follow its root, so parents are done first
+    Uint32 size = (Uint32)_renderList.size();
+    for(Uint32 ii = 0; ii < size; ) {
+        while (!_renderClips.empty() && _renderClips.back() <= ii) {
+            batch->popScissor();
+            _renderClips.pop_back();
+        }
+        
+        RenderEntry& entry = _renderList[ii];
+        SceneNode* node = entry.node;
+        const Affine2& parent = ii ? _renderList[entry.parent].world : transform;
+        Color4 color = ii ? _renderList[entry.parent].tint : tint;
+        bool moved = entry.stale || entry.stamp != node->_stamp;
+        moved = moved || (ii ? _renderList[entry.parent].moved : !based);
+        if (entry.barrier) {
+            node->render(batch, parent, color);
+            ii = entry.end;
+            continue;
+        } else if (!node->_isVisible) {
+            // A hidden subtree is skipped, so it is recomputed once shown
+            entry.stale = entry.stale || moved;
+            ii = entry.end;
+            continue;
+        }
+        
+        if (moved) {
+            Affine2::multiply(node->_combined,parent,&entry.world);
+            entry.stamp = node->_stamp;
+            entry.stale = false;
+        }
+        entry.moved = moved;
+        entry.tint = node->_tintColor;
+        if (node->_hasParentColor) {
+            entry.tint *= color;
         }
-        batch->setScissor(local);
+        
+        if (node->_scissor) {
+            node->pushScissor(batch,*(node->_scissor),entry.world);
+            _renderClips.push_back(entry.end);
+        }
+        node->draw(batch,entry.world,entry.tint);
+        ii++;
+    }
+    
+    while (!_renderClips.empty()) {
+        batch->popScissor();
+        _renderClips.pop_back();
     }
+}
 
-    draw(batch,matrix,color);
-    for(auto it = _children.begin(); it != _children.end(); ++it) {
-        (*it)->render(batch, matrix, color);
+/**
+ * Appends this node and its descendants to the given render list.
+ *
+ * The entries are appended in pre-order. The subtree of a barrier (see
+ * {@link #rendersChildren}) is not appended, unless it is the root.
+ *
+ * @param list      The render list to append to
+ * @param parent    The position of the parent entry
+ * @param root      Whether this node is the root of the list
+ */
+void SceneNode::flatten(std::vector<RenderEntry>& list, Uint32 parent, bool root) {
+    Uint32 index = (Uint32)list.size();
+    RenderEntry entry;
+    entry.node = this;
+    entry.parent = parent;
+    entry.stamp = _stamp;
+    entry.stale = true;
+    entry.moved = true;
+    entry.barrier = !root && rendersChildren();
+    list.push_back(entry);
+    if (!entry.barrier) {
+        for(auto it = _children.begin(); it != _children.end(); ++it) {
+            (*it)->flatten(list, index, false);
+        }
     }
+    list[index].end = (Uint32)list.size();
+}
 
-    if (_scissor) {
-        batch->setScissor(active);
+/**
+ * Pushes a scissor of this node on the scissor stack of the SpriteBatch.
+ *
+ * The scissor is in the coordinate system of this node, and is applied
+ * with the given global transform. The transformed scissor is cached, so
+ * that it is only recomputed when the scissor or the transform changes.
+ * The caller must pop the scissor with {@link SpriteBatch#popScissor}
+ * once this node and its children are drawn.
+ *
+ * @param batch     The SpriteBatch to draw with.
+ * @param scissor   The scissor in the coordinate system of this node.
+ * @param transform The global transformation matrix.
+ */
+void SceneNode::pushScissor(const std::shared_ptr<SpriteBatch>& batch, const Scissor& scissor, const Affine2& transform) {
+    // The default values agree, as the empty scissor is unchanged by the identity
+    if (transform != _clipMatrix || scissor != _clipSource) {
+        _clipSource = scissor;
+        _clipMatrix = transform;
+        _clipped = scissor;
+        _clipped *= transform;
     }
+    batch->pushScissor(_clipped);
 }
 
 /**
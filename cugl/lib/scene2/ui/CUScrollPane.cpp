@@ -1090,21 +1090,11 @@ void ScrollPane::render(const std::shared_ptr<SpriteBatch>& batch, const Affine2
         color *= tint;
     }
     
-    std::shared_ptr<Scissor> active = batch->getScissor();
-    if (_panemask) {
-        std::shared_ptr<Scissor> local = Scissor::alloc(_panemask);
-        local->multiply(matrix);
-        if (active) {
-            local->intersect(active);
-        }
-        batch->setScissor(local);
-    } else if (_scissor) {
-        std::shared_ptr<Scissor> local = Scissor::alloc(_scissor);
-        local->multiply(matrix);
-        if (active) {
-            local->intersect(active);
-        }
-        batch->setScissor(local);
+    // The pane mask replaces the node scissor
+    const std::shared_ptr<Scissor>& mask = _panemask ? _panemask : _scissor;
+    bool clipped = mask != nullptr;
+    if (clipped) {
+        pushScissor(batch,*mask,matrix);
     }
 
     draw(batch,matrix,color);
@@ -1113,7 +1103,7 @@ void ScrollPane::render(const std::shared_ptr<SpriteBatch>& batch, const Affine2
         (*it)->render(batch, matrix, color);
     }
 
-    if (_scissor) {
-        batch->setScissor(active);
+    if (clipped) {
+        batch->popScissor();
     }
 }
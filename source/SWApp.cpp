@@ -32,6 +32,7 @@ void SwitchWitchApp::onStartup() {
 //    CULog("start up");
     _assets = AssetManager::alloc();
     _batch  = SpriteBatch::alloc();
+    // The batch draws immediately. Only GameScene defers its draws (setDeferred).
     auto cam = OrthographicCamera::alloc(getDisplaySize());
     
 #ifdef CU_TOUCH_SCREEN
@@ -43,6 +44,13 @@ void SwitchWitchApp::onStartup() {
     Input::activate<Keyboard>();
 #endif
     
+    // Shipped builds hold their assets in a pack, which is read before loose files.
+    // The switchwitch-pack tool builds it (see build-apple/README.md).
+    std::shared_ptr<AssetPack> pack = AssetPack::allocWithAsset("assets.pack");
+    if (pack != nullptr) {
+        AssetPack::mount(pack);
+    }
+
     // Bare bones asset loading (textures only)
     _assets->attach<Texture>(TextureLoader::alloc()->getHook());
     _assets->attach<Sound>(SoundLoader::alloc()->getHook());
@@ -55,8 +63,15 @@ void SwitchWitchApp::onStartup() {
     _scene = LOAD;
     _loading.init(_assets);
     
-    // Queue up the other assets (EMPTY in this case)
-    _assets->loadDirectoryAsync("json/assets.json",nullptr);
+    // Queue up the other assets, from the packed atlas pages if they were built
+    std::string directory = "json/assets.json";
+    if (AssetPack::hasAsset("json/assets-atlas.json") ||
+        filetool::file_exists(getAssetDirectory() + "json/assets-atlas.json")) {
+        directory = "json/assets-atlas.json";
+    } else {
+        CULog("No atlas pages; run switchwitch-atlas to build them");
+    }
+    _assets->loadDirectoryAsync(directory,nullptr);
     
     AudioEngine::start();
     Application::onStartup(); // YOU MUST END with call to parent
@@ -86,6 +101,7 @@ void SwitchWitchApp::onShutdown() {
     Input::deactivate<Mouse>();
 
     AudioEngine::stop();
+    AssetPack::unmountAll();
     Application::onShutdown();  // YOU MUST END with call to parent
 }
 
@@ -172,7 +188,7 @@ void SwitchWitchApp::update(float timestep) {
                 int level_num = _levelMap.getLevel();
                 if (level_num > 0) {
                     _levelMap.setActive(false);
-                    _gameplay.setLevel(_assets->get<JsonValue>("level" + std::to_string(level_num)));
+                    _gameplay.setLevel(level_num);
                     _gameplay.setActive(true);
                     _gameplay.enterLevel();
                     _gameplay.setCurrLevel(level_num);
@@ -203,6 +219,8 @@ void SwitchWitchApp::update(float timestep) {
                 _scene = State::MAP;
                 _gameplay.setActive(false);
                 _gameplay.reset();
+                // The map needs none of the tutorial animations
+                _gameplay.releaseTutorials();
                 _levelMap.setActive(true);
             }
             break;
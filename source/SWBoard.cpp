@@ -7,8 +7,57 @@
 //
 
 #include "SWBoard.hpp"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 using namespace cugl;
 
+/** The attacks of a square without a unit */
+static const vector<Unit::AttackOffset> NO_ATTACKS;
+
+/**
+ * Returns the index of the lowest set bit of a non-zero mask.
+ */
+static inline int lowestBit(uint64_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+/**
+ * Returns the Zobrist key of one feature of a square.
+ *
+ * This stands in for the usual table of random numbers indexed by square,
+ * feature and value. Computing the keys on demand means boards of any size
+ * and subtypes interned at run time need no table.
+ */
+static inline uint64_t zobristKey(int index, int feature, int value) {
+    uint64_t key = ((uint64_t)index << 40) ^ ((uint64_t)feature << 32) ^ (uint32_t)value;
+    key += 0x9e3779b97f4a7c15ULL;
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+    return key ^ (key >> 31);
+}
+
+/**
+ * Returns the Zobrist key of an attack pattern of a square.
+ *
+ * Each offset of the pattern is keyed by its place in the pattern, so two
+ * patterns have the same key only if they list the same offsets in order.
+ */
+static uint64_t attackKey(int index, int feature, const vector<Vec2>& attack) {
+    uint64_t key = zobristKey(index, feature, (int)attack.size());
+    for (size_t i = 0; i < attack.size(); i++) {
+        int offset = ((int)i << 16) ^ (((int)attack[i].x & 0xff) << 8) ^ ((int)attack[i].y & 0xff);
+        key ^= zobristKey(index, feature + 1, offset);
+    }
+    return key;
+}
+
 #pragma mark Constructors
 /**
  * Initializes a board with the given size
@@ -22,15 +71,131 @@ bool Board::init(int columns, int rows) {
     _matrix = vector<shared_ptr<Square>>(rows * columns);
     _rows = rows;
     _columns = columns;
+    _colors.assign(rows * columns, Unit::Color::NONE);
+    _subtypes.assign(rows * columns, -1);
+    _directions.assign(rows * columns, -1);
+    _interactable.assign(rows * columns, false);
+    _basicAttacks.assign(rows * columns, &NO_ATTACKS);
+    _specialAttacks.assign(rows * columns, &NO_ATTACKS);
+    _useMasks = rows * columns <= MAX_MASK_SQUARES;
+    _basicMasks.assign(rows * columns, 0);
+    _specialMasks.assign(rows * columns, 0);
+    std::fill(_colorMasks, _colorMasks + 4, 0);
+    _kingMask = 0;
+    _interactableMask = 0;
+    _records = std::make_shared<vector<shared_ptr<const SquareRecord>>>(rows * columns);
+    _hash = 0;
     for (int i = 0; i < rows; i++) {
         for (int j = 0; j < columns; j++) {
             // The first index of the matrix should be the x position while the second index should be the y position.
             _matrix[flattenPos(j, i)] = Square::alloc(cugl::Vec2(j, i));
+            updateSquare(flattenPos(j, i));
         }
     }
     return true;
 }
 
+#pragma mark -
+#pragma mark Packed Board State
+/**
+ * Copies the unit and square at a flattened index into the packed board state.
+ *
+ * @param index the flattened position of the square.
+ */
+void Board::updateSquare(int index) {
+    const shared_ptr<Square>& square = _matrix[index];
+    _interactable[index] = square->isInteractable();
+    Unit* unit = square->getUnit().get();
+    if (unit == nullptr) {
+        _colors[index] = Unit::Color::NONE;
+        _subtypes[index] = -1;
+        _directions[index] = -1;
+        _basicAttacks[index] = &NO_ATTACKS;
+        _specialAttacks[index] = &NO_ATTACKS;
+    } else {
+        int subtype = unit->getSubTypeId();
+        int direction = Unit::directionToId(unit->getDirection());
+        // The rotated attacks only depend on the unit type and direction.
+        if (subtype != _subtypes[index] || direction != _directions[index]) {
+            _subtypes[index] = subtype;
+            _directions[index] = direction;
+            _basicAttacks[index] = &unit->getBasicAttackRotated();
+            _specialAttacks[index] = &unit->getSpecialAttackRotated();
+            updateAttackMasks(index);
+        }
+        _colors[index] = unit->getColor();
+    }
+    updateRecord(index);
+    if (!_useMasks) return;
+    uint64_t bit = uint64_t(1) << index;
+    for (int c = 0; c < 4; c++) {
+        _colorMasks[c] &= ~bit;
+    }
+    _kingMask &= ~bit;
+    _interactableMask &= ~bit;
+    if (unit == nullptr) {
+        _basicMasks[index] = 0;
+        _specialMasks[index] = 0;
+        return;
+    }
+    _colorMasks[_colors[index]] |= bit;
+    if (isKing(index)) _kingMask |= bit;
+    if (_interactable[index]) _interactableMask |= bit;
+}
+
+/**
+ * Recomputes the basic and special attack bitboards of a square from
+ * its rotated attacks.
+ */
+void Board::updateAttackMasks(int index) {
+    if (!_useMasks) return;
+    uint64_t basic = 0;
+    uint64_t special = 0;
+    for (const Unit::AttackOffset& offset : *_basicAttacks[index]) {
+        int target = offsetIndex(index, offset);
+        if (target >= 0) basic |= uint64_t(1) << target;
+    }
+    for (const Unit::AttackOffset& offset : *_specialAttacks[index]) {
+        int target = offsetIndex(index, offset);
+        if (target >= 0) special |= uint64_t(1) << target;
+    }
+    _basicMasks[index] = basic;
+    _specialMasks[index] = special;
+}
+
+/**
+ * Returns if the unit on the square at a flattened index is a king.
+ */
+bool Board::isKing(int index) const {
+    return _subtypes[index] == Unit::KING;
+}
+
+/**
+ * Returns the squares in a bitboard, ordered by flattened index.
+ *
+ * @param mask the bitboard of squares
+ * @return a list of squares in the mask.
+ */
+vector<shared_ptr<Square>> Board::maskToSquares(uint64_t mask) {
+    vector<shared_ptr<Square>> result;
+    for (; mask; mask &= mask - 1) {
+        result.push_back(_matrix[lowestBit(mask)]);
+    }
+    return result;
+}
+
+/**
+ * Converts a list of flattened indices to the squares at those indices.
+ */
+vector<shared_ptr<Square>> Board::toSquares(const vector<int>& indices) {
+    vector<shared_ptr<Square>> result;
+    result.reserve(indices.size());
+    for (int index : indices) {
+        result.push_back(_matrix[index]);
+    }
+    return result;
+}
+
 #pragma mark -
 #pragma mark Properties
 /**
@@ -74,6 +239,23 @@ void Board::switchUnits(cugl::Vec2 pos1, cugl::Vec2 pos2){
     shared_ptr<Unit> unitTwo = squareTwo->getUnit();
     squareOne->setUnit(unitTwo);
     squareTwo->setUnit(unitOne);
+    // Units always move with their packed state, so the cached attacks are swapped too.
+    int indexOne = flattenPos(pos1.x, pos1.y);
+    int indexTwo = flattenPos(pos2.x, pos2.y);
+    std::swap(_basicAttacks[indexOne], _basicAttacks[indexTwo]);
+    std::swap(_specialAttacks[indexOne], _specialAttacks[indexTwo]);
+    std::swap(_subtypes[indexOne], _subtypes[indexTwo]);
+    std::swap(_directions[indexOne], _directions[indexTwo]);
+    // So do the records, though the keys of the two squares change with them.
+    vector<shared_ptr<const SquareRecord>>& records = mutableRecords();
+    _hash ^= squareKey(indexOne, *records[indexOne]) ^ squareKey(indexTwo, *records[indexTwo]);
+    std::swap(records[indexOne], records[indexTwo]);
+    _hash ^= squareKey(indexOne, *records[indexOne]) ^ squareKey(indexTwo, *records[indexTwo]);
+    // The attack masks are relative to the square, so they must be recomputed.
+    updateAttackMasks(indexOne);
+    updateAttackMasks(indexTwo);
+    updateSquare(indexOne);
+    updateSquare(indexTwo);
 }
 
 /**
@@ -87,6 +269,7 @@ void Board::switchUnits(cugl::Vec2 pos1, cugl::Vec2 pos2){
 void Board::switchAndRotateUnits(cugl::Vec2 pos1, cugl::Vec2 pos2) {
     Vec2 positionOneUnitDirection = getSquare(pos2)->getPosition() - getSquare(pos1)->getPosition();
     getSquare(pos1)->getUnit()->setDirection(positionOneUnitDirection);
+    updateSquare(pos1);
     // The following line is commented out for alpha release (to test only changing direction of originally selected unit). 
 //    getSquare(pos2)->getUnit()->setDirection(-1 * positionOneUnitDirection);
     switchUnits(pos1, pos2);
@@ -99,56 +282,93 @@ void Board::switchAndRotateUnits(cugl::Vec2 pos1, cugl::Vec2 pos2) {
 * @return a list of squares being attacked.
 */
 vector<shared_ptr<Square>> Board::getAttackedSquares(cugl::Vec2 pos) {
-    vector<shared_ptr<Square>> result;
-    vector<shared_ptr<Square>> ptdResult;
+    vector<int> result;
+    vector<int> ptdResult;
 
     if (!doesSqaureExist(pos)) {
-        return result;
-    }
-    auto attackingSquare = getSquare(pos);
-    for (Vec2 vector : attackingSquare->getUnit()->getBasicAttackRotated()) {
-        Vec2 squarePos = vector + attackingSquare->getPosition();
-        auto attackedSquare = getSquare(squarePos);
-        if (doesSqaureExist(squarePos) && attackedSquare->isInteractable() && attackingSquare->isInteractable() && (attackingSquare->getUnit()->getColor() != attackedSquare->getUnit()->getColor() || attackedSquare->getUnit()->getSubType() == "king")) {
-            getAttackedSquares_h(result, ptdResult, attackedSquare);
+        return vector<shared_ptr<Square>>();
+    }
+    int attacker = flattenPos(pos.x, pos.y);
+    if (_useMasks) {
+        uint64_t attacked, ptd;
+        resolveAttack(attacker, attacked, ptd);
+        return maskToSquares(attacked);
+    }
+    vector<char> visited(_matrix.size(), false);
+    for (const Unit::AttackOffset& offset : *_basicAttacks[attacker]) {
+        int target = offsetIndex(attacker, offset);
+        if (target >= 0 && _interactable[attacker] && isHostile(attacker, target)) {
+            getAttackedSquares_h(result, visited, ptdResult, target);
         }
     }
-    return result;
+    return toSquares(result);
 }
 
-void Board::getAttackedSquares_h(vector<shared_ptr<Square>> &listOfAttackedSquares, vector<shared_ptr<Square>> &listOfProtectedSquares, shared_ptr<Square> attackingSquare) {
-    if (std::find(listOfAttackedSquares.begin(), listOfAttackedSquares.end(), attackingSquare) != listOfAttackedSquares.end()) {
+/**
+ * Resolves the full chain reaction started by the unit on a square as bitboards.
+ *
+ * Every attacked square spreads the attack to the hostile squares under its
+ * special attack, so the attacked set is grown one wave at a time until no
+ * new square is reached. The protected set collects the friendly squares
+ * under the initial basic attack and under every special attack in the chain.
+ *
+ * @param index the flattened position of the attacker square
+ * @param attacked set to the squares being attacked
+ * @param protectedSquares set to the squares being protected
+ */
+void Board::resolveAttack(int index, uint64_t& attacked, uint64_t& protectedSquares) const {
+    attacked = 0;
+    protectedSquares = 0;
+    if (!_interactable[index]) return;
+    protectedSquares = _basicMasks[index] & friendlyMask(index);
+    uint64_t frontier = _basicMasks[index] & hostileMask(index);
+    while (frontier) {
+        attacked |= frontier;
+        uint64_t next = 0;
+        for (uint64_t mask = frontier; mask; mask &= mask - 1) {
+            int square = lowestBit(mask);
+            next |= _specialMasks[square] & hostileMask(square);
+            protectedSquares |= _specialMasks[square] & friendlyMask(square);
+        }
+        frontier = next & ~attacked;
+    }
+}
+
+void Board::getAttackedSquares_h(vector<int> &listOfAttackedSquares, vector<char> &visited, vector<int> &listOfProtectedSquares, int attackingSquare) {
+    if (visited[attackingSquare]) {
         return;
     }
-    else {
-        listOfAttackedSquares.push_back(attackingSquare);
-        for (Vec2 vector : attackingSquare->getUnit()->getSpecialAttackRotated()) {
-            Vec2 squarePos = vector + attackingSquare->getPosition();
-            if (doesSqaureExist(squarePos) && getSquare(squarePos)->isInteractable() && attackingSquare->getUnit()->getColor() == getSquare(squarePos)->getUnit()->getColor() && getSquare(squarePos)->getUnit()->getSubType() != "king"){
-                listOfProtectedSquares.push_back(getSquare(squarePos));
-            }
-            if (doesSqaureExist(squarePos) && getSquare(squarePos)->isInteractable() && (attackingSquare->getUnit()->getColor() != getSquare(squarePos)->getUnit()->getColor() || getSquare(squarePos)->getUnit()->getSubType() == "king")) {
-                getAttackedSquares_h(listOfAttackedSquares, listOfProtectedSquares, getSquare(squarePos));
-            }
+    visited[attackingSquare] = true;
+    listOfAttackedSquares.push_back(attackingSquare);
+    for (const Unit::AttackOffset& offset : *_specialAttacks[attackingSquare]) {
+        int target = offsetIndex(attackingSquare, offset);
+        if (target < 0) continue;
+        if (isFriendly(attackingSquare, target)) {
+            listOfProtectedSquares.push_back(target);
+        }
+        if (isHostile(attackingSquare, target)) {
+            getAttackedSquares_h(listOfAttackedSquares, visited, listOfProtectedSquares, target);
         }
     }
 }
 
 vector<shared_ptr<Square>> Board::getInitallyAttackedSquares(cugl::Vec2 pos, bool basic) {
-    vector<shared_ptr<Square>> result;
+    vector<int> result;
     if (!doesSqaureExist(pos)) {
-        return result;
-    }
-    auto attackingSquare = getSquare(pos);
-    vector<Vec2> attackedSquares = basic ? attackingSquare->getUnit()->getBasicAttackRotated() : attackingSquare->getUnit()->getSpecialAttackRotated();
-    for (Vec2 vector : attackedSquares) {
-        Vec2 squarePos = vector + attackingSquare->getPosition();
-        auto attackedSquare = getSquare(squarePos);
-        if (doesSqaureExist(squarePos) && attackingSquare->isInteractable() && attackedSquare->isInteractable() && (attackingSquare->getUnit()->getColor() != attackedSquare->getUnit()->getColor() || attackedSquare->getUnit()->getSubType() == "king")) {
-            result.push_back(attackedSquare);
+        return vector<shared_ptr<Square>>();
+    }
+    int attacker = flattenPos(pos.x, pos.y);
+    if (_useMasks) {
+        if (!_interactable[attacker]) return vector<shared_ptr<Square>>();
+        return maskToSquares((basic ? _basicMasks[attacker] : _specialMasks[attacker]) & hostileMask(attacker));
+    }
+    for (const Unit::AttackOffset& offset : basic ? *_basicAttacks[attacker] : *_specialAttacks[attacker]) {
+        int target = offsetIndex(attacker, offset);
+        if (target >= 0 && _interactable[attacker] && isHostile(attacker, target)) {
+            result.push_back(target);
         }
     }
-    return result;
+    return toSquares(result);
 }
 
 /**
@@ -158,40 +378,148 @@ vector<shared_ptr<Square>> Board::getInitallyAttackedSquares(cugl::Vec2 pos, boo
  * @return a list of squares being attacked.
  */
 vector<shared_ptr<Square>> Board::getProtectedSquares(cugl::Vec2 pos){
-    vector<shared_ptr<Square>> result;
-    vector<shared_ptr<Square>> ptdResult;
+    vector<int> result;
+    vector<int> ptdResult;
     if (!doesSqaureExist(pos)) {
-        return result;
-    }
-    auto attackingSquare = getSquare(pos);
-    for (Vec2 vector : attackingSquare->getUnit()->getBasicAttackRotated()) {
-        Vec2 squarePos = vector + attackingSquare->getPosition();
-        auto attackedSquare = getSquare(squarePos);
-        if (doesSqaureExist(squarePos) && attackingSquare->isInteractable() && attackedSquare->isInteractable() && attackingSquare->getUnit()->getColor() == attackedSquare->getUnit()->getColor() && attackedSquare->getUnit()->getSubType() != "king"){
-            ptdResult.push_back(attackedSquare);
+        return vector<shared_ptr<Square>>();
+    }
+    int attacker = flattenPos(pos.x, pos.y);
+    if (_useMasks) {
+        uint64_t attacked, ptd;
+        resolveAttack(attacker, attacked, ptd);
+        return maskToSquares(ptd);
+    }
+    vector<char> visited(_matrix.size(), false);
+    for (const Unit::AttackOffset& offset : *_basicAttacks[attacker]) {
+        int target = offsetIndex(attacker, offset);
+        if (target < 0 || !_interactable[attacker]) continue;
+        if (isFriendly(attacker, target)) {
+            ptdResult.push_back(target);
         }
-        if (doesSqaureExist(squarePos) && attackingSquare->isInteractable() && attackedSquare->isInteractable() && (attackingSquare->getUnit()->getColor() != attackedSquare->getUnit()->getColor() || attackedSquare->getUnit()->getSubType() == "king")) {
-            getAttackedSquares_h(result,ptdResult, attackedSquare);
+        if (isHostile(attacker, target)) {
+            getAttackedSquares_h(result, visited, ptdResult, target);
         }
     }
-    return ptdResult;
+    return toSquares(ptdResult);
 }
 
 vector<shared_ptr<Square>> Board::getInitiallyProtectedSquares(cugl::Vec2 pos, bool basic) {
-    CULog("call get protected");
-    vector<shared_ptr<Square>> result;
+    vector<int> result;
     if (!doesSqaureExist(pos)) {
-        return result;
-    }
-    auto attackingSquare = getSquare(pos);
-    vector<Vec2> attackedSquares = basic ? attackingSquare->getUnit()->getBasicAttackRotated() : attackingSquare->getUnit()->getSpecialAttackRotated();
-    for (Vec2 vector : attackedSquares) {
-        Vec2 squarePos = vector + attackingSquare->getPosition();
-        auto attackedSquare = getSquare(squarePos);
-        if (doesSqaureExist(squarePos) && attackingSquare->isInteractable() && attackedSquare->isInteractable() && attackingSquare->getUnit()->getColor() == attackedSquare->getUnit()->getColor() && attackedSquare->getUnit()->getSubType() != "king") {
-            result.push_back(attackedSquare);
-            CULog("pushed");
+        return vector<shared_ptr<Square>>();
+    }
+    int attacker = flattenPos(pos.x, pos.y);
+    if (_useMasks) {
+        if (!_interactable[attacker]) return vector<shared_ptr<Square>>();
+        return maskToSquares((basic ? _basicMasks[attacker] : _specialMasks[attacker]) & friendlyMask(attacker));
+    }
+    for (const Unit::AttackOffset& offset : basic ? *_basicAttacks[attacker] : *_specialAttacks[attacker]) {
+        int target = offsetIndex(attacker, offset);
+        if (target >= 0 && _interactable[attacker] && isFriendly(attacker, target)) {
+            result.push_back(target);
         }
     }
-    return result;
+    return toSquares(result);
+}
+
+#pragma mark -
+#pragma mark Snapshots
+/**
+ * Replaces the record of a square if it no longer matches the square,
+ * and updates the board hash.
+ *
+ * This runs on every updateSquare, so it only allocates when the values
+ * of the square actually changed.
+ */
+void Board::updateRecord(int index) {
+    Unit* unit = _matrix[index]->getUnit().get();
+    int unitsNeededToKill = unit == nullptr ? 0 : unit->getUnitsNeededToKill();
+    bool moveable = unit != nullptr && unit->isMoveable();
+    shared_ptr<const SquareRecord> current = (*_records)[index];
+    if (current != nullptr && current->subtype == _subtypes[index] && current->color == _colors[index] &&
+        current->direction == _directions[index] && current->unitsNeededToKill == unitsNeededToKill &&
+        current->moveable == moveable && current->interactable == (bool)_interactable[index] &&
+        (unit == nullptr || (current->basicAttack == unit->getBasicAttack() && current->specialAttack == unit->getSpecialAttack()))) {
+        return;
+    }
+    shared_ptr<SquareRecord> record = std::make_shared<SquareRecord>();
+    record->subtype = _subtypes[index];
+    record->color = _colors[index];
+    record->direction = _directions[index];
+    record->unitsNeededToKill = unitsNeededToKill;
+    record->moveable = moveable;
+    record->interactable = _interactable[index];
+    if (unit != nullptr) {
+        record->basicAttack = unit->getBasicAttack();
+        record->specialAttack = unit->getSpecialAttack();
+    }
+    if (current != nullptr) _hash ^= squareKey(index, *current);
+    _hash ^= squareKey(index, *record);
+    mutableRecords()[index] = record;
+}
+
+/**
+ * Returns the record table, copying it first if a snapshot shares it.
+ */
+vector<shared_ptr<const Board::SquareRecord>>& Board::mutableRecords() {
+    if (_records.use_count() > 1) {
+        _records = std::make_shared<vector<shared_ptr<const SquareRecord>>>(*_records);
+    }
+    return *_records;
+}
+
+/**
+ * Returns the Zobrist key of a square record at a flattened index.
+ *
+ * Every value that {@link restore} writes back is part of the key, so boards
+ * that restore differently never share a hash.
+ */
+uint64_t Board::squareKey(int index, const SquareRecord& record) {
+    return zobristKey(index, 0, record.subtype) ^ zobristKey(index, 1, record.color) ^
+           zobristKey(index, 2, record.direction) ^ zobristKey(index, 3, record.unitsNeededToKill) ^
+           zobristKey(index, 4, record.interactable) ^ zobristKey(index, 5, record.moveable) ^
+           attackKey(index, 6, record.basicAttack) ^ attackKey(index, 8, record.specialAttack);
+}
+
+/**
+ * Restores the board to a snapshot of this board.
+ *
+ * The units already on the board are modified in place to match the
+ * snapshot. Their states and views are left to the caller, which should
+ * refresh the returned squares. Squares without a unit are left alone.
+ * Only squares that differ from the snapshot are touched.
+ *
+ * @param snapshot a snapshot taken from this board.
+ * @return the flattened positions of the squares that were changed.
+ */
+vector<int> Board::restore(const Snapshot& snapshot) {
+    vector<int> changed;
+    if (!snapshot.isValid() || snapshot._records == _records || snapshot._records->size() != _matrix.size()) {
+        return changed;
+    }
+    // Adopt the saved records first, so that updating the restored squares
+    // finds them unchanged and shares them instead of making new ones.
+    shared_ptr<vector<shared_ptr<const SquareRecord>>> previous = _records;
+    _records = std::const_pointer_cast<vector<shared_ptr<const SquareRecord>>>(snapshot._records);
+    _hash = snapshot._hash;
+    for (int i = 0; i < (int)_matrix.size(); i++) {
+        const shared_ptr<const SquareRecord>& record = (*_records)[i];
+        if (record == (*previous)[i]) continue;
+        const shared_ptr<Square>& square = _matrix[i];
+        const shared_ptr<Unit>& unit = square->getUnit();
+        square->setInteractable(record->interactable);
+        if (unit != nullptr && record->subtype >= 0) {
+            unit->setSubType(Unit::idToSubType(record->subtype));
+            unit->setColor(record->color);
+            unit->setDirection(Unit::idToDirection(record->direction));
+            unit->setBasicAttack(record->basicAttack);
+            unit->setSpecialAttack(record->specialAttack);
+            unit->setUnitsNeededToKill(record->unitsNeededToKill);
+            unit->setMoveable(record->moveable);
+            unit->setSpecial(Unit::isSpecialSubType(record->subtype));
+        }
+        updateSquare(i);
+        changed.push_back(i);
+    }
+    return changed;
 }
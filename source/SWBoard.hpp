@@ -14,6 +14,59 @@
 
 class Board
 {
+public:
+    /**
+     * Everything needed to put a square back the way it was: the square's
+     * interactability and the values of the unit on it. Records never change
+     * once made, so a board and all of its snapshots share them.
+     */
+    struct SquareRecord {
+        /** The subtype id of the unit, or -1 if there is no unit */
+        int subtype;
+        /** The color of the unit */
+        Unit::Color color;
+        /** The direction id of the unit */
+        int direction;
+        /** The number of units needed to kill the unit */
+        int unitsNeededToKill;
+        /** Whether the unit can be swapped */
+        bool moveable;
+        /** Whether the square is interactable */
+        bool interactable;
+        /** The unrotated basic attack of the unit */
+        vector<cugl::Vec2> basicAttack;
+        /** The unrotated special attack of the unit */
+        vector<cugl::Vec2> specialAttack;
+    };
+
+    /**
+     * A saved state of a board.
+     *
+     * Taking a snapshot is O(1): the snapshot shares the square records of
+     * the board, and the board only copies its record table the next time
+     * one of its squares changes. Restoring a snapshot only touches the
+     * squares that differ from it.
+     */
+    class Snapshot {
+    private:
+        /** The record of every square, indexed by flattenPos */
+        shared_ptr<const vector<shared_ptr<const SquareRecord>>> _records;
+        /** The Zobrist hash of the board when the snapshot was taken */
+        uint64_t _hash;
+
+        friend class Board;
+
+    public:
+        /** Creates an empty snapshot that cannot be restored */
+        Snapshot() : _hash(0) {}
+
+        /** Returns the Zobrist hash of the saved board */
+        uint64_t getHash() const { return _hash; }
+
+        /** Returns whether this snapshot holds a board */
+        bool isValid() const { return _records != nullptr; }
+    };
+
 private:
     /** The number of rows on the board */
     int _rows;
@@ -24,10 +77,72 @@ private:
     /** Square matrix on this board */
     vector<shared_ptr<Square>> _matrix;
 
+    /**
+     * The packed board state. The squares and their units in _matrix remain
+     * the data of the board; every array below is a mirror of them, indexed
+     * by {@link flattenPos}, so that attack resolution and search can scan
+     * the board without dereferencing squares or units. Only what those
+     * scans read is mirrored. Call {@link updateSquare} after changing a unit
+     * in place.
+     */
+    /** The color of the unit on each square */
+    vector<Unit::Color> _colors;
+
+    /** The subtype id of the unit on each square (see Unit::subTypeToId) */
+    vector<int> _subtypes;
+
+    /** The direction id of the unit on each square (see Unit::directionToId) */
+    vector<int> _directions;
+
+    /** Whether each square is interactable */
+    vector<char> _interactable;
+
+    /** The rotated basic attack of the unit on each square, in the table of Unit */
+    vector<const vector<Unit::AttackOffset>*> _basicAttacks;
+
+    /** The rotated special attack of the unit on each square, in the table of Unit */
+    vector<const vector<Unit::AttackOffset>*> _specialAttacks;
+
+    /**
+     * Bitboards used by the attack resolver. Bit i of a mask stands for the
+     * square at flattened index i. They are only maintained for boards with
+     * at most {@link MAX_MASK_SQUARES} squares; larger boards fall back to
+     * walking the packed arrays.
+     */
+    /** Whether the attack bitboards are maintained for this board */
+    bool _useMasks;
+
+    /** The squares hit by the basic attack of the unit on each square */
+    vector<uint64_t> _basicMasks;
+
+    /** The squares hit by the special attack of the unit on each square */
+    vector<uint64_t> _specialMasks;
+
+    /** The occupied squares holding a unit of each color, indexed by Unit::Color */
+    uint64_t _colorMasks[4];
+
+    /** The squares holding a king */
+    uint64_t _kingMask;
+
+    /** The squares that are interactable and hold a unit */
+    uint64_t _interactableMask;
+
+    /**
+     * The record of every square, shared with the snapshots of this board.
+     * The table is copied before it is changed if a snapshot still uses it.
+     */
+    shared_ptr<vector<shared_ptr<const SquareRecord>>> _records;
+
+    /** The Zobrist hash of the board: the XOR of the keys of all square records */
+    uint64_t _hash;
+
     /** The Polygon-Node that represents this board */
     shared_ptr<cugl::scene2::PolygonNode> _viewNode;
 
 public:
+    /** The largest board that the attack bitboards can represent */
+    static const int MAX_MASK_SQUARES = 64;
+
 #pragma mark Constructors
     /**
      * Creates an uninitialized Unit.
@@ -105,7 +220,12 @@ public:
      *
      * @return a vector of all squares.
      */
-    vector<shared_ptr<Square>> getAllSquares() { return _matrix; }
+    const vector<shared_ptr<Square>>& getAllSquares() { return _matrix; }
+
+    /**
+     * Returns the number of squares on the board.
+     */
+    int getNumberOfSquares() { return (int)_matrix.size(); }
 
     /**
      * Sets a square in a position on the board. 
@@ -117,6 +237,7 @@ public:
     void setSquare(cugl::Vec2 position, shared_ptr<Square> square) { 
         square->setPosition(position);
         _matrix[flattenPos(position.x, position.y)] = square;
+        invalidateSquare(flattenPos(position.x, position.y));
     }
 
     /**
@@ -126,6 +247,28 @@ public:
      */
     void setSquare(shared_ptr<Square> square) { setSquare(square->getPosition(), square); }
     
+    /**
+     * Sets the unit on the square at a position.
+     *
+     * @param position the position of the square.
+     * @param unit the unit that will be placed on the square.
+     */
+    void setUnit(cugl::Vec2 position, shared_ptr<Unit> unit) {
+        getSquare(position)->setUnit(unit);
+        invalidateSquare(flattenPos(position.x, position.y));
+    }
+
+    /**
+     * Sets if the square at a position is interactable.
+     *
+     * @param position the position of the square.
+     * @param interactable whether the square is interactable.
+     */
+    void setInteractable(cugl::Vec2 position, bool interactable) {
+        getSquare(position)->setInteractable(interactable);
+        updateSquare(position);
+    }
+
     /**
      * Returns the Polygon-Node that represents the board's view.
      *
@@ -186,16 +329,203 @@ public:
 
     vector<shared_ptr<Square>> getInitiallyProtectedSquares(cugl::Vec2 pos, bool basic);
 
+    /**
+     * Returns if attacks on this board can be resolved with bitboards,
+     * which is the case when it has at most {@link MAX_MASK_SQUARES} squares.
+     */
+    bool usesMasks() const { return _useMasks; }
+
+    /**
+     * Resolves the full chain reaction started by the unit on a square as bitboards.
+     *
+     * The attacked and protected masks hold exactly the squares returned by
+     * {@link getAttackedSquares} and {@link getProtectedSquares}. This may only
+     * be called if {@link usesMasks} is true.
+     *
+     * @param index the flattened position of the attacker square
+     * @param attacked set to the squares being attacked
+     * @param protectedSquares set to the squares being protected
+     */
+    void resolveAttack(int index, uint64_t& attacked, uint64_t& protectedSquares) const;
+
+    /**
+     * Returns the squares in a bitboard, ordered by flattened index.
+     *
+     * @param mask the bitboard of squares
+     * @return a list of squares in the mask.
+     */
+    vector<shared_ptr<Square>> maskToSquares(uint64_t mask);
+
     /**
      * Flattens two coordinate number as one number. Used for organizing the _matrix.
      */
     int flattenPos(int x, int y) { return x * _rows + y; }
 
+    /**
+     * Returns the position of the square at a flattened index.
+     */
+    cugl::Vec2 unflattenPos(int index) { return cugl::Vec2(index / _rows, index % _rows); }
+
+#pragma mark -
+#pragma mark Packed Board State
+    /**
+     * Copies the unit and square at a position into the packed board state.
+     *
+     * Board methods keep the packed state up to date on their own. This only
+     * needs to be called after a unit on this board was modified directly,
+     * for example by changing its color, subtype, direction or state.
+     *
+     * @param position the position of the square.
+     */
+    void updateSquare(cugl::Vec2 position) { updateSquare(flattenPos(position.x, position.y)); }
+
+    /**
+     * Copies the unit and square at a flattened index into the packed board state.
+     *
+     * @param index the flattened position of the square.
+     */
+    void updateSquare(int index);
+
+    /**
+     * Returns the color of the unit on the square at a flattened index.
+     */
+    Unit::Color getColor(int index) const { return _colors[index]; }
+
+    /**
+     * Returns the subtype id of the unit on the square at a flattened index.
+     */
+    int getSubTypeId(int index) const { return _subtypes[index]; }
+
+    /**
+     * Returns the direction id of the unit on the square at a flattened index.
+     */
+    int getDirectionId(int index) const { return _directions[index]; }
+
+    /**
+     * Returns if the square at a flattened index is interactable.
+     */
+    bool isInteractable(int index) const { return _interactable[index]; }
+
+    /**
+     * Returns if the unit on the square at a flattened index is a king.
+     */
+    bool isKing(int index) const;
+
+#pragma mark -
+#pragma mark Snapshots
+    /**
+     * Returns the Zobrist hash of the board.
+     *
+     * The hash covers the interactability of every square and the subtype,
+     * color, direction and units needed to kill of every unit. It is kept
+     * up to date as squares change, so reading it is free.
+     */
+    uint64_t getHash() const { return _hash; }
+
+    /**
+     * Returns a snapshot of the board. This does not copy any square.
+     */
+    Snapshot snapshot() const {
+        Snapshot result;
+        result._records = _records;
+        result._hash = _hash;
+        return result;
+    }
+
+    /**
+     * Restores the board to a snapshot of this board.
+     *
+     * The units already on the board are modified in place to match the
+     * snapshot. Their states and views are left to the caller, which should
+     * refresh the returned squares. Squares without a unit are left alone.
+     * Only squares that differ from the snapshot are touched.
+     *
+     * @param snapshot a snapshot taken from this board.
+     * @return the flattened positions of the squares that were changed.
+     */
+    vector<int> restore(const Snapshot& snapshot);
+
 private: 
+    /**
+     * Recomputes the basic and special attack bitboards of a square from
+     * its rotated attacks.
+     */
+    void updateAttackMasks(int index);
+
+    /**
+     * Returns the squares that the unit on a square can hit.
+     */
+    uint64_t hostileMask(int index) const {
+        return _interactableMask & (~_colorMasks[_colors[index]] | _kingMask);
+    }
+
+    /**
+     * Returns the squares that the unit on a square protects.
+     */
+    uint64_t friendlyMask(int index) const {
+        return _interactableMask & _colorMasks[_colors[index]] & ~_kingMask;
+    }
+
+    /**
+     * Replaces the record of a square if it no longer matches the square,
+     * and updates the board hash.
+     */
+    void updateRecord(int index);
+
+    /**
+     * Returns the record table, copying it first if a snapshot shares it.
+     */
+    vector<shared_ptr<const SquareRecord>>& mutableRecords();
+
+    /**
+     * Returns the Zobrist key of a square record at a flattened index.
+     */
+    static uint64_t squareKey(int index, const SquareRecord& record);
+
+    /**
+     * Rebuilds all packed state of a square, including its cached attacks.
+     * Used when the unit on a square is replaced rather than modified.
+     */
+    void invalidateSquare(int index) {
+        _subtypes[index] = -1;
+        updateSquare(index);
+    }
+
+    /**
+     * Returns the flattened index of the square at an offset from another square,
+     * or -1 if there is no square there.
+     */
+    int offsetIndex(int index, const Unit::AttackOffset& offset) {
+        int x = index / _rows + offset.x;
+        int y = index % _rows + offset.y;
+        return (x >= 0 && x < _columns && y >= 0 && y < _rows) ? flattenPos(x, y) : -1;
+    }
+
+    /**
+     * Returns if the attacker can hit the target: the target must be interactable
+     * and either a king or a unit of a different color.
+     */
+    bool isHostile(int attacker, int target) const {
+        return _interactable[target] && (_colors[attacker] != _colors[target] || isKing(target));
+    }
+
+    /**
+     * Returns if the attacker protects the target: the target must be interactable,
+     * not a king and a unit of the same color.
+     */
+    bool isFriendly(int attacker, int target) const {
+        return _interactable[target] && _colors[attacker] == _colors[target] && !isKing(target);
+    }
+
+    /**
+     * Converts a list of flattened indices to the squares at those indices.
+     */
+    vector<shared_ptr<Square>> toSquares(const vector<int>& indices);
+
     /**
      * Helper function for finding attacked squares.
      */
-    void getAttackedSquares_h(vector<shared_ptr<Square>> &listOfAttackedSquares, vector<shared_ptr<Square>> &listOfProtectedSquares, shared_ptr<Square> attackingSquare);
+    void getAttackedSquares_h(vector<int> &listOfAttackedSquares, vector<char> &visited, vector<int> &listOfProtectedSquares, int attackingSquare);
 #pragma mark -
 };
 #endif /* SWBoard_hpp */
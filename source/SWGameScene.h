@@ -23,8 +23,11 @@
 #include <time.h>
 #include "SWSquare.hpp"
 #include "SWUnit.hpp"
+#include "SWUnitTextureSet.hpp"
+#include "SWNodePool.h"
 #include "SWBoard.hpp"
 #include "SWLevel.h"
+#include "SWSimulation.h"
 #include "SWInputController.h"
 #include <cugl/audio/CUAudioEngine.h>
 #include <cugl/scene2/actions/CUActionManager.h>
@@ -62,7 +65,6 @@ protected:
     // MODELS should be shared pointers or a data structure of shared pointers
     /** The JSON value for the levels */
     std::shared_ptr<cugl::JsonValue> _boardJson;
-    std::shared_ptr<cugl::JsonValue> _levelJson;
     
     // current level, corresponds to board's ID.
     int _currLevel;
@@ -90,6 +92,10 @@ protected:
     
     // hash map for unit textures
     std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> _textures;
+    // texture table shared by all units
+    std::shared_ptr<UnitTextureSet> _unitTextures;
+    // pool of the shields and upcoming unit icons, kept across resets
+    std::shared_ptr<NodePool> _nodePool;
     // hash map for units with different types
     std::unordered_map<std::string, std::shared_ptr<Unit>> _unitTypes;
     // hash map for cumulative unit probabilities
@@ -146,6 +152,28 @@ protected:
     shared_ptr<Level> _level;
     /** _currentCellLayer[i][j] is the current unit lookup depth at cell [i, j] in the board */
     vector<int> _currentReplacementDepth;
+    /** The rules of the game, which resolve each turn before it is animated */
+    shared_ptr<Simulation> _simulation;
+    /** The number of events of the simulation log already shown on screen */
+    size_t _presentedEvents;
+
+    /** A turn that can be returned to with undo, redo or restart */
+    struct HistoryEntry {
+        /** The board at the start of the turn */
+        Board::Snapshot board;
+        /** The simulation at the start of the turn */
+        Simulation::Snapshot simulation;
+        /** The replacement depth of every cell at the start of the turn */
+        vector<int> replacementDepth;
+        /** The remaining turns */
+        int turns;
+        /** The score so far */
+        int score;
+    };
+    /** The start of every turn played so far, with the first entry being the start of the level */
+    vector<HistoryEntry> _history;
+    /** The entry in _history that matches the board on screen */
+    int _historyIndex = -1;
 
 #pragma mark -
 #pragma mark Model Variables
@@ -309,6 +337,10 @@ protected:
     std::shared_ptr<Square> _kingSquare;
     vector<shared_ptr<Square>> _attackedSquares;
     vector<shared_ptr<Square>> _protectedSquares;
+    /** The square of the unit that attacks each square in the turn, or -1 */
+    vector<int> _attackedBy;
+    /** The square of the unit that protects each square in the turn, or -1 */
+    vector<int> _protectedBy;
     std::shared_ptr<Square> _initalAttackSquare;
 
     /** Whther the player pressed restart button*/
@@ -352,8 +384,14 @@ protected:
     /** The amout of time every frame should play for */
     float _time_per_frame = 0.3f;
     
-    /** This map stores a texture for every tutorial */
-    unordered_map<std::string, shared_ptr<Texture>> _tutorialTextures;
+    /** The asset directory of the tutorial animations, which are loaded on demand */
+    shared_ptr<JsonValue> _tutorialDirectory;
+    /** The asset group of the tutorial animation of this level, or "" for none */
+    std::shared_ptr<std::string> _tutorialGroup = std::make_shared<std::string>();
+    /** The asset group of the tutorial animation of the next level, or "" for none */
+    std::shared_ptr<std::string> _nextTutorialGroup = std::make_shared<std::string>();
+    /** The asset group of the animation in the help menu, or "" for none */
+    std::shared_ptr<std::string> _helpGroup = std::make_shared<std::string>();
     std::shared_ptr<scene2::SpriteNode> _tutorialNode;
     std::shared_ptr<scene2::SceneNode> _tutorialNode2;
     
@@ -457,7 +495,35 @@ public:
      * Resets the status of the game with the board JSON.
      */
     void reset(std::shared_ptr<cugl::JsonValue> boardJSON);
+
+    /**
+     * Resets the status of the game with the given level.
+     */
+    void reset(shared_ptr<Level> level);
     
+    /**
+     * Restarts the level with the same starting board.
+     *
+     * Unlike {@link #reset}, the level is not reloaded from JSON. Only the
+     * squares that changed since the start of the level are restored. The
+     * units that respawn are drawn from a new seed.
+     */
+    void restart();
+
+    /**
+     * Returns the board to the start of the previous turn.
+     *
+     * @return false if there is no turn to undo.
+     */
+    bool undo();
+
+    /**
+     * Replays the last turn that was undone.
+     *
+     * @return false if there is no turn to redo.
+     */
+    bool redo();
+
     /**
      * Sets whether the scene is currently active
      *
@@ -476,6 +542,33 @@ public:
      */
     void setLevel(shared_ptr<cugl::JsonValue> levelJSON);
 
+    /**
+     * Sets the level that will be played.
+     *
+     * The level is only read, so the same level can be played again.
+     *
+     * @param level the level to play
+     */
+    void setLevel(shared_ptr<Level> level);
+
+    /**
+     * Sets the level that will be played by its number.
+     *
+     * @param levelNumber   the number of the level, starting at 1
+     */
+    void setLevel(int levelNumber) { setLevel(loadLevel(levelNumber)); }
+
+    /**
+     * Loads a level by its number.
+     *
+     * The compiled levels/boardN.swl is memory-mapped if it exists, and
+     * levels/boardN.json is read otherwise.
+     *
+     * @param levelNumber   the number of the level, starting at 1
+     * @return the level, or nullptr if it cannot be found
+     */
+    shared_ptr<Level> loadLevel(int levelNumber);
+
     /**
      * Get the current level of the board
      */
@@ -504,6 +597,41 @@ public:
     void setHelpAnimation();
     
     void helpPressButton();
+
+    /**
+     * Returns the key of the tutorial animation of a level.
+     *
+     * @param level the number of the level
+     * @return the key of the tutorial texture, or "" if the level has none
+     */
+    std::string getTutorialKey(int level) const;
+
+    /**
+     * Replaces the tutorial animation held in an asset group with another.
+     *
+     * Each tutorial animation is a sprite sheet of over 50 MB, so they are
+     * not part of the main asset directory. Each one is an asset group of its
+     * own, loaded in the background while it is shown (or is about to be).
+     * The new group is loaded before the old one is unloaded, so an animation
+     * that stays on screen is never reloaded.
+     *
+     * The group is a shared string, as the load callback checks it when the
+     * group arrives, which may be after this scene is gone.
+     *
+     * @param held      the group to replace, set to the new one
+     * @param key       the tutorial texture to hold, or "" for none
+     * @param callback  called with the texture once it is loaded, if still held
+     */
+    void holdTutorial(const std::shared_ptr<std::string>& held, const std::string& key,
+                      std::function<void(const shared_ptr<Texture>&)> callback);
+
+    /**
+     * Unloads every tutorial animation held by this scene.
+     *
+     * The animation nodes are emptied too, as they would keep the textures
+     * in memory.
+     */
+    void releaseTutorials();
     
 //    Size getDimen( ) { return _dimen; }
     
@@ -545,33 +673,20 @@ public:
     
 private:
     /**
-     * Generate a random unit type with the given probabilities
-     * @param probs    A mapping between unit type and probability. Probabilities should sum to 1.0
-     * @return  The randomly generated unit type as a string
-     */
-    std::string generateRandomUnitType(std::map<std::string, float> probs);
-    
-    /**
-     * Generate a random color with the given probabilities
-     * @param probs  A mapping between Unit::Color and probability. Probabilities should sum to 1.0
-     * @return  The randomly generated Unit::Color
-     */
-    Unit::Color generateRandomUnitColor(std::map<Unit::Color, float> probs);
-    
-    /**
-     * Generate a uniformly-random direction
-     * @return The random direction as a Vec2
+     * Records the current board as the start of a new turn.
+     *
+     * Any turns that were undone are discarded.
      */
-    Vec2 generateRandomDirection();
-    
+    void pushHistory();
+
     /**
-     * Generates a mapping between Unit::Color and the probability that the color should be respawned.
-     * Scans the current board to tally current color counts, and returns probabilities based on the inverted relative sums.
-     * @return The mapping between Unit::Color and probabilities
+     * Returns the board to an entry of the history and refreshes the view
+     * of every square that changed.
+     *
+     * @param index the entry of _history to restore
      */
-    std::map<Unit::Color, float> generateColorProbabilities();
-    
-    
+    void restoreHistory(int index);
+
     /**
      * Get the pattern for a unit provided its type and color
      * @param type     The sub-type of the unit
@@ -637,11 +752,29 @@ private:
      */
     void updateSquareTexture(shared_ptr<Square> square);
     
-    void replaceUnitOnSquare(shared_ptr<Square> sq);
+    /**
+     * Shows a unit that the simulation respawned on a square.
+     *
+     * @param sq        the square of the unit
+     * @param respawn   the RESPAWN event of the unit
+     */
+    void replaceUnitOnSquare(shared_ptr<Square> sq, const Simulation::Event& respawn);
     
     void showResultText(bool success, std::shared_ptr<cugl::scene2::SceneNode> node);
     
+    /**
+     * Shows the respawns and the score of the turn that is being animated.
+     */
     void respawnAttackedSquares();
+
+    /**
+     * Takes the attacked and protected squares of a turn from its events.
+     *
+     * The simulation decides every attack. The scene only animates them.
+     *
+     * @param events    the events of the turn
+     */
+    void setTurnEvents(const vector<Simulation::Event>& events);
     
     void deconfirmSwap();
     
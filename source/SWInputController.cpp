@@ -40,6 +40,8 @@ InputController::InputController() : _active(false),
                                      _saveDown(false),
                                      _playDown(false),
                                      _debugDown(false),
+                                     _undoDown(false),
+                                     _redoDown(false),
                                      _mouseKey(0),
                                      _touchKey(1)
 {
@@ -142,6 +144,8 @@ void InputController::update()
     _debugDown = keys->keyPressed(KeyCode::D) && keys->keyDown(KeyCode::LEFT_CTRL);
     _resetDown = keys->keyPressed(KeyCode::R);
     _escapeDown = keys->keyPressed(KeyCode::ESCAPE);
+    _undoDown = keys->keyPressed(KeyCode::Z) && keys->keyDown(KeyCode::LEFT_CTRL);
+    _redoDown = keys->keyPressed(KeyCode::Y) && keys->keyDown(KeyCode::LEFT_CTRL);
     
     _currDown = _mouseDown;
     _currPos = _mousePos;
@@ -71,6 +71,10 @@ protected:
     bool _resetDown;
     /** Whether the escape key is down*/
     bool _escapeDown;
+    /** Whether the undo key is down*/
+    bool _undoDown;
+    /** Whether the redo key is down*/
+    bool _redoDown;
     
 protected:
 	/** The key for the mouse listeners */
@@ -287,6 +291,20 @@ public:
      */
     bool isEscapeDown() const { return _escapeDown; }
 
+    /**
+     * Returns if the undo key (Ctrl+Z) is down.
+     *
+     * @returns if the undo key is down.
+     */
+    bool isUndoDown() const { return _undoDown; }
+
+    /**
+     * Returns if the redo key (Ctrl+Y) is down.
+     *
+     * @returns if the redo key is down.
+     */
+    bool isRedoDown() const { return _redoDown; }
+
 #pragma mark -
 #pragma mark Mouse Callbacks
 private:
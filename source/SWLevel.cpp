@@ -7,8 +7,94 @@
 //
 
 #include "SWLevel.h"
+#include "SWMappedFile.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
 using namespace cugl;
 
+/** The size of the fixed part of a binary level in bytes */
+#define BINARY_HEADER_SIZE 52
+
+/** The size of a palette entry of a binary level in bytes */
+#define BINARY_PALETTE_ENTRY_SIZE 5
+
+/** The palette index of a square that has no unit */
+#define NO_UNIT 0xFFFF
+
+/**
+ * Reads the little-endian values of a binary level.
+ *
+ * Reading past the end of the data returns zeros and marks the reader as
+ * failed, so a truncated file is detected once at the end.
+ */
+class LevelReader {
+private:
+    const uint8_t* _pos;
+    const uint8_t* _end;
+    bool _failed;
+
+public:
+    LevelReader(const uint8_t* data, size_t size) : _pos(data), _end(data + size), _failed(false) {}
+
+    /** Returns whether any read went past the end of the data */
+    bool failed() const { return _failed; }
+
+    /** Returns the next n bytes, or nullptr if there are not enough */
+    const uint8_t* bytes(size_t n) {
+        if (_failed || (size_t)(_end - _pos) < n) {
+            _failed = true;
+            return nullptr;
+        }
+        const uint8_t* result = _pos;
+        _pos += n;
+        return result;
+    }
+
+    uint8_t u8() {
+        const uint8_t* b = bytes(1);
+        return b == nullptr ? 0 : b[0];
+    }
+
+    int8_t i8() { return (int8_t)u8(); }
+
+    uint16_t u16() {
+        const uint8_t* b = bytes(2);
+        return b == nullptr ? 0 : (uint16_t)(b[0] | (b[1] << 8));
+    }
+
+    int32_t i32() {
+        const uint8_t* b = bytes(4);
+        return b == nullptr ? 0 : (int32_t)((uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24));
+    }
+
+    uint64_t u64() {
+        uint64_t low = (uint32_t)i32();
+        return low | ((uint64_t)(uint32_t)i32() << 32);
+    }
+};
+
+/**
+ * Appends little-endian values to a binary level.
+ */
+static void writeU8(vector<uint8_t>& out, int value) {
+    out.push_back((uint8_t)value);
+}
+
+static void writeU16(vector<uint8_t>& out, int value) {
+    writeU8(out, value & 0xFF);
+    writeU8(out, (value >> 8) & 0xFF);
+}
+
+static void writeI32(vector<uint8_t>& out, int value) {
+    uint32_t bits = (uint32_t)value;
+    for (int i = 0; i < 4; i++) writeU8(out, (bits >> (8 * i)) & 0xFF);
+}
+
+static void writeU64(vector<uint8_t>& out, uint64_t value) {
+    for (int i = 0; i < 8; i++) writeU8(out, (value >> (8 * i)) & 0xFF);
+}
+
 #pragma mark Constructors
 /**
  * Initializes a level with the given board size
@@ -16,9 +102,11 @@ using namespace cugl;
  * @param rows The number of rows on the board.
  * @param columns The number of columns on the board.
  */
-bool Level::init(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> textures, int columns, int rows) {
+bool Level::init(const std::shared_ptr<UnitTextureSet>& textures, int columns, int rows) {
+    _textures = textures;
     _rows = rows;
     _columns = columns;
+    sourceHash = 0;
     levelID = 0;
     maxTurns = 0;
     oneStarThreshold = 0;
@@ -34,7 +122,9 @@ bool Level::init(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>>
  *
  * @param JSON values
  */
-bool Level::init(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> textures, shared_ptr<JsonValue> levelJSON) {
+bool Level::init(const std::shared_ptr<UnitTextureSet>& textures, shared_ptr<JsonValue> levelJSON) {
+    _textures = textures;
+    sourceHash = 0;
     levelID = levelJSON->getInt("id");
     maxTurns = levelJSON->getInt("total-swap-allowed");
     // Rows and Columns
@@ -52,23 +142,196 @@ bool Level::init(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>>
     
     for (auto layer : layersInBoardJson)
     {
-        auto board = Board::alloc(_columns, _rows);
         auto units = layer->children();
         for (auto i = 0; i < units.size(); i++) {
-            auto sq = board->getAllSquares()[i];
             auto unitDirection = Vec2(units[i]->get("direction")->asFloatArray().at(0), units[i]->get("direction")->asFloatArray().at(1));
-            auto unitColorStr = units[i]->getString("color");
+            auto unitColor = Unit::stringToColor(units[i]->getString("color"));
             auto unitSubType = units[i]->getString("sub-type");
             auto unitsNeededToKill = units[i]->getInt("unitsNeededToKill");
-            sq->setInteractable(unitSubType != "empty");
-            auto unitColor = unitSubType == "king" ? Unit::Color::NONE : Unit::stringToColor(unitColorStr);
-            sq->setUnit(Unit::alloc(textures, unitSubType, unitColor, unitDirection, unitSubType != "king", unitSubType != "basic" && unitSubType != "random" && unitSubType != "king", unitsNeededToKill));
+            addLayerUnit(unitSubType, unitColor, unitDirection, unitsNeededToKill);
         }
-        auto test = addBoard(board);
+        // Squares missing from the JSON have no unit
+        _boards.push_back(nullptr);
+        _cells.resize(_boards.size() * _rows * _columns, NO_UNIT);
+    }
+    _squares.resize(_cells.size());
+    return true;
+}
+
+/**
+ * Initializes a level from its binary form.
+ *
+ * @param textures  the textures of the units
+ * @param data      the binary level
+ * @param size      the size of the binary level in bytes
+ * @return false if the data is not a valid binary level.
+ */
+bool Level::initWithBinary(const std::shared_ptr<UnitTextureSet>& textures, const uint8_t* data, size_t size) {
+    _textures = textures;
+    LevelReader reader(data, size);
+    const uint8_t* magic = reader.bytes(4);
+    if (magic == nullptr || memcmp(magic, BINARY_MAGIC, 4) != 0 || reader.u16() != BINARY_VERSION) {
+        return false;
+    }
+    reader.u16();
+    sourceHash = reader.u64();
+    levelID = reader.i32();
+    maxTurns = reader.i32();
+    oneStarThreshold = reader.i32();
+    twoStarThreshold = reader.i32();
+    threeStarThreshold = reader.i32();
+    numOfKings = reader.i32();
+    squareSize = reader.i32();
+    _columns = reader.u8();
+    _rows = reader.u8();
+    int layers = reader.u8();
+    int paletteSize = reader.u8();
+    int stringCount = reader.u8();
+    int background = reader.u8();
+    int unitTypeCount = reader.u8();
+    reader.u8();
+
+    vector<int> unitTypeStrings(unitTypeCount);
+    for (int i = 0; i < unitTypeCount; i++) unitTypeStrings[i] = reader.u8();
+    vector<std::string> strings(stringCount);
+    for (int i = 0; i < stringCount; i++) {
+        int length = reader.u8();
+        const uint8_t* chars = reader.bytes(length);
+        if (chars != nullptr) strings[i].assign((const char*)chars, length);
+    }
+    if (reader.failed() || background >= stringCount) return false;
+    backgroundName = strings[background];
+    unitTypes.clear();
+    for (int index : unitTypeStrings) {
+        if (index >= stringCount) return false;
+        unitTypes.push_back(strings[index]);
+    }
+
+    const uint8_t* palette = reader.bytes(paletteSize * BINARY_PALETTE_ENTRY_SIZE);
+    const uint8_t* cells = reader.bytes(layers * _rows * _columns);
+    if (reader.failed()) return false;
+
+    // The layers stay encoded until their squares are asked for
+    _palette.clear();
+    for (int i = 0; i < paletteSize; i++) {
+        const uint8_t* entry = palette + i * BINARY_PALETTE_ENTRY_SIZE;
+        if (entry[0] >= stringCount || entry[1] > Unit::Color::NONE) return false;
+        _palette.push_back({ strings[entry[0]], (Unit::Color)entry[1], Vec2((int8_t)entry[2], (int8_t)entry[3]), entry[4] });
+    }
+    _cells.assign(cells, cells + layers * _rows * _columns);
+    for (uint16_t cell : _cells) {
+        if (cell >= paletteSize) return false;
     }
+    _boards.assign(layers, nullptr);
+    _squares.assign(_cells.size(), nullptr);
     return true;
 }
 
+/**
+ * Returns a newly allocated level read from a file.
+ *
+ * @param textures  the textures of the units
+ * @param path      the path of the level file
+ * @return a newly allocated level, or nullptr if the file cannot be read.
+ */
+shared_ptr<Level> Level::allocWithFile(const std::shared_ptr<UnitTextureSet>& textures, const std::string& path) {
+    std::shared_ptr<MappedFile> file = MappedFile::alloc(path);
+    if (file == nullptr) return nullptr;
+    if (file->getSize() >= 4 && memcmp(file->getData(), BINARY_MAGIC, 4) == 0) {
+        return allocWithBinary(textures, file->getData(), file->getSize());
+    }
+    std::shared_ptr<JsonValue> json = JsonValue::allocWithJson(std::string((const char*)file->getData(), file->getSize()));
+    return json == nullptr ? nullptr : alloc(textures, json);
+}
+
+/**
+ * Returns the hash of a JSON level file, as stored in its binary level.
+ *
+ * This is 64-bit FNV-1a, which is plenty to notice an edited file.
+ *
+ * @param data  the contents of the JSON level file
+ * @param size  the size of the file in bytes
+ * @return the hash of the file, never 0.
+ */
+uint64_t Level::hashSource(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+    return hash == 0 ? 1 : hash;
+}
+
+/**
+ * Adds a unit read from a level file to the next square of the layers.
+ */
+void Level::addLayerUnit(const std::string& subtype, Unit::Color color, Vec2 direction, int unitsNeededToKill) {
+    LayerUnit unit = { subtype, subtype == "king" ? Unit::Color::NONE : color, direction, unitsNeededToKill };
+    auto it = std::find(_palette.begin(), _palette.end(), unit);
+    if (it == _palette.end()) {
+        _palette.push_back(unit);
+        it = _palette.end() - 1;
+    }
+    _cells.push_back((uint16_t)(it - _palette.begin()));
+}
+
+/**
+ * Builds the square of a layer from its palette entry.
+ *
+ * @param cell  the index of the square in _cells
+ */
+shared_ptr<Square> Level::buildSquare(int cell) {
+    int index = cell % (_rows * _columns);
+    shared_ptr<Square> square = Square::alloc(Vec2(index / _rows, index % _rows));
+    if (_cells[cell] != NO_UNIT) {
+        const LayerUnit& unit = _palette[_cells[cell]];
+        const std::string& subtype = unit.subtype;
+        square->setInteractable(subtype != "empty");
+        square->setUnit(Unit::alloc(_textures, subtype, unit.color, unit.direction, Unit::isMoveableSubType(Unit::subTypeToId(subtype)), Unit::isSpecialSubType(Unit::subTypeToId(subtype)), unit.unitsNeededToKill));
+    }
+    return square;
+}
+
+/**
+ * Adds a board to the level, increaseing the depth of the level.
+ */
+bool Level::addBoard(shared_ptr<Board> board) {
+    bool valid = board->getNumberOfRows() == _rows && board->getNumberOfColumns() == _columns;
+    if (valid) {
+        _boards.push_back(board);
+        _cells.resize(_boards.size() * _rows * _columns, NO_UNIT);
+        _squares.insert(_squares.end(), board->getAllSquares().begin(), board->getAllSquares().end());
+    }
+    return valid;
+}
+
+/**
+ * Removes a board at a certain depth
+ */
+void Level::removeBoard(int depth) {
+    int size = _rows * _columns;
+    _boards.erase(_boards.begin() + depth);
+    _cells.erase(_cells.begin() + depth * size, _cells.begin() + (depth + 1) * size);
+    _squares.erase(_squares.begin() + depth * size, _squares.begin() + (depth + 1) * size);
+}
+
+/**
+ * Gets a board at a certain depth, building it the first time.
+ */
+shared_ptr<Board> Level::getBoard(int depth) {
+    if (_boards[depth] == nullptr) {
+        // Squares handed out before are kept, so that their units stay the same
+        auto board = Board::alloc(_columns, _rows);
+        int size = _rows * _columns;
+        for (int i = 0; i < size; i++) {
+            int cell = depth * size + i;
+            if (_squares[cell] == nullptr) _squares[cell] = buildSquare(cell);
+            board->setSquare(board->getAllSquares()[i]->getPosition(), _squares[cell]);
+        }
+        _boards[depth] = board;
+    }
+    return _boards[depth];
+}
+
 /**
  * Converts the level to a JsonValue
  */
@@ -90,9 +353,10 @@ shared_ptr<JsonValue> Level::convertToJSON() {
     boardJSON->appendChild("unit-types", unitTypeArray);
     numOfKings = 0;
     shared_ptr<cugl::JsonValue> boardArray = cugl::JsonValue::allocArray();
-    for (shared_ptr<Board> board : _boards) {
+    for (int depth = 0; depth < _boards.size(); depth++) {
+        shared_ptr<Board> board = getBoard(depth);
         shared_ptr<cugl::JsonValue> squareOccupantArray = cugl::JsonValue::allocArray();
-        for (shared_ptr<Square> square : board->getAllSquares()) {
+        for (const shared_ptr<Square>& square : board->getAllSquares()) {
             auto unit = square->getUnit();
             auto unitJSON = cugl::JsonValue::allocObject();
             unitJSON->appendChild("type", cugl::JsonValue::alloc("unit"));
@@ -104,7 +368,7 @@ shared_ptr<JsonValue> Level::convertToJSON() {
             unitJSON->appendChild("direction", unitDirectionJSON);
             unitJSON->appendChild("unitsNeededToKill", cugl::JsonValue::alloc((long int)unit->getUnitsNeededToKill()));
             squareOccupantArray->appendChild(unitJSON);
-            if (unit->getSubType() == "king") numOfKings++;
+            if (unit->getSubTypeId() == Unit::KING) numOfKings++;
         }
         boardArray->appendChild(squareOccupantArray);
     }
@@ -113,6 +377,83 @@ shared_ptr<JsonValue> Level::convertToJSON() {
     return boardJSON;
 }
 
+/**
+ * Converts the level to its binary form.
+ *
+ * The palette and strings follow the order in which they first appear, so
+ * converting the same level twice gives the same bytes.
+ */
+vector<uint8_t> Level::convertToBinary() {
+    vector<std::string> strings;
+    std::map<std::string, int> stringIndex;
+    auto intern = [&](const std::string& str) {
+        auto it = stringIndex.find(str);
+        if (it != stringIndex.end()) return it->second;
+        strings.push_back(str);
+        stringIndex[str] = (int)strings.size() - 1;
+        return (int)strings.size() - 1;
+    };
+    int background = intern(backgroundName);
+    vector<int> unitTypeStrings;
+    for (const std::string& unitType : unitTypes) unitTypeStrings.push_back(intern(unitType));
+
+    // The palette holds every distinct (subtype, color, direction, units needed) in the level
+    vector<uint8_t> palette;
+    std::map<vector<uint8_t>, int> paletteIndex;
+    vector<uint8_t> cells;
+    for (int depth = 0; depth < _boards.size(); depth++) {
+        for (const shared_ptr<Square>& square : getBoard(depth)->getAllSquares()) {
+            auto unit = square->getUnit();
+            vector<uint8_t> entry = {
+                (uint8_t)intern(unit->getSubType()),
+                (uint8_t)unit->getColor(),
+                (uint8_t)(int8_t)unit->getDirection().x,
+                (uint8_t)(int8_t)unit->getDirection().y,
+                (uint8_t)unit->getUnitsNeededToKill()
+            };
+            auto it = paletteIndex.find(entry);
+            if (it == paletteIndex.end()) {
+                it = paletteIndex.emplace(entry, (int)paletteIndex.size()).first;
+                palette.insert(palette.end(), entry.begin(), entry.end());
+            }
+            cells.push_back((uint8_t)it->second);
+        }
+    }
+    bool fits = paletteIndex.size() <= 255 && strings.size() <= 255 && unitTypeStrings.size() <= 255 && _boards.size() <= 255 && _rows <= 255 && _columns <= 255;
+    for (const std::string& str : strings) fits = fits && str.size() <= 255;
+    if (!fits) return vector<uint8_t>();
+
+    vector<uint8_t> out;
+    out.reserve(BINARY_HEADER_SIZE + unitTypeStrings.size() + palette.size() + cells.size() + 16 * strings.size());
+    out.insert(out.end(), BINARY_MAGIC, BINARY_MAGIC + 4);
+    writeU16(out, BINARY_VERSION);
+    writeU16(out, 0);
+    writeU64(out, sourceHash);
+    writeI32(out, levelID);
+    writeI32(out, maxTurns);
+    writeI32(out, oneStarThreshold);
+    writeI32(out, twoStarThreshold);
+    writeI32(out, threeStarThreshold);
+    writeI32(out, numOfKings);
+    writeI32(out, squareSize);
+    writeU8(out, _columns);
+    writeU8(out, _rows);
+    writeU8(out, (int)_boards.size());
+    writeU8(out, (int)paletteIndex.size());
+    writeU8(out, (int)strings.size());
+    writeU8(out, background);
+    writeU8(out, (int)unitTypeStrings.size());
+    writeU8(out, 0);
+    for (int index : unitTypeStrings) writeU8(out, index);
+    for (const std::string& str : strings) {
+        writeU8(out, (int)str.size());
+        out.insert(out.end(), str.begin(), str.end());
+    }
+    out.insert(out.end(), palette.begin(), palette.end());
+    out.insert(out.end(), cells.begin(), cells.end());
+    return out;
+}
+
 #pragma mark -
 #pragma mark Properties
 /**
@@ -122,7 +463,10 @@ shared_ptr<JsonValue> Level::convertToJSON() {
  * @return the replacement square
  */
 shared_ptr<Square> Level::getReplacementSquare(cugl::Vec2 squarePosition, int depth) {
-    return _boards[depth]->getSquare(squarePosition);
+    if (_boards[depth] != nullptr) return _boards[depth]->getSquare(squarePosition);
+    int cell = depth * _rows * _columns + (int)squarePosition.x * _rows + (int)squarePosition.y;
+    if (_squares[cell] == nullptr) _squares[cell] = buildSquare(cell);
+    return _squares[cell];
 }
 
 /**
@@ -13,16 +13,79 @@
 #include "SWBoard.hpp"
 #include <cugl/cugl.h>
 
+/**
+ * A level: its settings, its starting board and all of its replacement boards.
+ *
+ * Levels are authored as JSON (see {@link #convertToJSON}) and shipped in a
+ * compact binary form made by the level compiler in tools/. All numbers in
+ * the binary form are little-endian:
+ *
+ *     header       "SWLV", u16 version, u16 reserved, u64 source hash
+ *                  i32 id, turns, one/two/three-star conditions, kings, square size
+ *                  u8 columns, rows, layers, palette size
+ *                  u8 string count, background string, unit type count, reserved
+ *     unit types   one u8 string index per unit type
+ *     strings      u8 length followed by the characters, for every string
+ *     palette      u8 subtype string, u8 color, i8 direction x, i8 direction y,
+ *                  u8 units needed to kill, for every distinct unit
+ *     cells        one u8 palette index per square, layer after layer, in
+ *                  Board::flattenPos order
+ */
 class Level
 {
+public:
+    /** The first four bytes of a binary level */
+    static constexpr const char* BINARY_MAGIC = "SWLV";
+    /** The version of the binary level format */
+    static const int BINARY_VERSION = 2;
+
 private:
-    /** Boards store the initial board and all replacement boards */
+    /** A distinct unit of the level, as stored in the level file */
+    struct LayerUnit {
+        std::string subtype;
+        Unit::Color color;
+        cugl::Vec2 direction;
+        int unitsNeededToKill;
+
+        bool operator==(const LayerUnit& other) const {
+            return subtype == other.subtype && color == other.color && direction == other.direction && unitsNeededToKill == other.unitsNeededToKill;
+        }
+    };
+
+    /**
+     * Boards store the initial board and all replacement boards. A board is
+     * only built once it is asked for with getBoard, and stays null before.
+     */
     vector<shared_ptr<Board>> _boards;
 
+    /** Every distinct unit of the level */
+    vector<LayerUnit> _palette;
+
+    /**
+     * The palette index of every square of every layer, indexed by
+     * depth * rows * columns + Board::flattenPos. Layers added with addBoard
+     * have no palette entries, as their board is built already.
+     */
+    vector<uint16_t> _cells;
+
+    /**
+     * The squares handed out so far, indexed like _cells. Squares are built
+     * the first time they are asked for, one unit at a time.
+     */
+    vector<shared_ptr<Square>> _squares;
+
+    /** The textures of the units */
+    std::shared_ptr<UnitTextureSet> _textures;
+
     int _rows;
     int _columns;
 
 public:
+    /**
+     * The hash of the JSON level this level was compiled from (see
+     * {@link #hashSource}), or 0 if it was not read from a binary level
+     */
+    uint64_t sourceHash;
     /** The ID of the level */
     int levelID;
     /** The maximum number of turns  */
@@ -61,14 +124,24 @@ public:
      * @param rows The number of rows on the board.
      * @param columns The number of columns on the board.
      */
-    bool init(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> textures, int columns, int rows);
+    bool init(const std::shared_ptr<UnitTextureSet>& textures, int columns, int rows);
 
     /**
      * Initializes a level given JSON values
      *
      * @param JSON values
      */
-    bool init(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> textures, shared_ptr<JsonValue> levelJSON);
+    bool init(const std::shared_ptr<UnitTextureSet>& textures, shared_ptr<JsonValue> levelJSON);
+
+    /**
+     * Initializes a level from its binary form.
+     *
+     * @param textures  the textures of the units
+     * @param data      the binary level
+     * @param size      the size of the binary level in bytes
+     * @return false if the data is not a valid binary level.
+     */
+    bool initWithBinary(const std::shared_ptr<UnitTextureSet>& textures, const uint8_t* data, size_t size);
 
 #pragma mark -
 #pragma mark Static Constructors
@@ -81,7 +154,7 @@ public:
      * @param columns the number of columns on the board.
      * @return a newly allocated Board.
      */
-    static shared_ptr<Level> alloc(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> textures, int columns, int rows) {
+    static shared_ptr<Level> alloc(const std::shared_ptr<UnitTextureSet>& textures, int columns, int rows) {
         std::shared_ptr<Level> result = std::make_shared<Level>();
         return (result->init(textures, columns, rows) ? result : nullptr);
     }
@@ -94,11 +167,48 @@ public:
      * @param columns the number of columns on the board.
      * @return a newly allocated Board.
      */
-    static shared_ptr<Level> alloc(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> textures, shared_ptr<JsonValue> levelJSON) {
+    static shared_ptr<Level> alloc(const std::shared_ptr<UnitTextureSet>& textures, shared_ptr<JsonValue> levelJSON) {
         std::shared_ptr<Level> result = std::make_shared<Level>();
         return (result->init(textures, levelJSON) ? result : nullptr);
     }
 
+    /**
+     * Returns a newly allocated level read from its binary form.
+     *
+     * @param textures  the textures of the units
+     * @param data      the binary level
+     * @param size      the size of the binary level in bytes
+     * @return a newly allocated level, or nullptr if the data is not valid.
+     */
+    static shared_ptr<Level> allocWithBinary(const std::shared_ptr<UnitTextureSet>& textures, const uint8_t* data, size_t size) {
+        std::shared_ptr<Level> result = std::make_shared<Level>();
+        return (result->initWithBinary(textures, data, size) ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated level read from a file.
+     *
+     * The file is memory-mapped and read in place. It may hold either a
+     * binary level or a JSON level.
+     *
+     * @param textures  the textures of the units
+     * @param path      the path of the level file
+     * @return a newly allocated level, or nullptr if the file cannot be read.
+     */
+    static shared_ptr<Level> allocWithFile(const std::shared_ptr<UnitTextureSet>& textures, const std::string& path);
+
+    /**
+     * Returns the hash of a JSON level file, as stored in its binary level.
+     *
+     * A binary level whose {@link #sourceHash} differs from the hash of its
+     * JSON file was compiled before the JSON was last edited.
+     *
+     * @param data  the contents of the JSON level file
+     * @param size  the size of the file in bytes
+     * @return the hash of the file, never 0.
+     */
+    static uint64_t hashSource(const uint8_t* data, size_t size);
+
 #pragma mark -
 #pragma mark Identifiers
     /**
@@ -115,25 +225,17 @@ public:
     /**
      * Adds a blank board to the level, increaseing the depth of the level.
      */
-    void addBlankBoard() { _boards.push_back(Board::alloc(_columns, _rows)); }
+    void addBlankBoard() { addBoard(Board::alloc(_columns, _rows)); }
 
     /**
      * Adds a board to the level, increaseing the depth of the level. Returns whether the addition was successful.
      */
-    bool addBoard(shared_ptr<Board> board) { 
-        bool valid = board->getNumberOfRows() == _rows && board->getNumberOfColumns() == _columns;
-        auto rows = board->getNumberOfRows();
-        auto columns = board->getNumberOfColumns();
-        if (valid) {
-            _boards.push_back(board);
-        }
-        return valid;
-    }
+    bool addBoard(shared_ptr<Board> board);
 
     /**
      * Removes a board at a certain depth
      */
-    void removeBoard(int depth) { _boards.erase(_boards.begin() + depth); }
+    void removeBoard(int depth);
 
     /** 
      * Returns whether a board exists at a certain depth.
@@ -145,14 +247,20 @@ public:
 
     /**
      * Gets a board at a certain depth. 
+     *
+     * This builds every unit of the board the first time it is called for
+     * a depth. Use {@link #getReplacementSquare} to read single squares.
      * 
      * @param the depth of the board
      * @return the board at that depth
      */
-    shared_ptr<Board> getBoard(int depth) { return _boards[depth]; }
+    shared_ptr<Board> getBoard(int depth);
 
     /** 
      * Gets the square that should replace the current square.
+     *
+     * Only this square is built the first time it is asked for, so the
+     * deep replacement layers that are never reached cost no units.
      * 
      * @param the position of the square.
      * @return the replacement square
@@ -171,6 +279,30 @@ public:
      * Converts the level to a JsonValue
      */
     shared_ptr<JsonValue> convertToJSON();
+
+    /**
+     * Converts the level to its binary form.
+     *
+     * The binary level records {@link #sourceHash}, which the level compiler
+     * sets to the hash of the JSON file.
+     *
+     * @return the binary level, or an empty vector if the level does not fit
+     *         the format (more than 255 distinct units, rows or layers).
+     */
+    vector<uint8_t> convertToBinary();
+
+private:
+    /**
+     * Adds a unit read from a level file to the next square of the layers.
+     */
+    void addLayerUnit(const std::string& subtype, Unit::Color color, cugl::Vec2 direction, int unitsNeededToKill);
+
+    /**
+     * Builds the square of a layer from its palette entry.
+     *
+     * @param cell  the index of the square in _cells
+     */
+    shared_ptr<Square> buildSquare(int cell);
 #pragma mark -
 };
 #endif /* SWBoard_hpp */
@@ -51,6 +51,7 @@ bool LevelEditorScene::init(const std::shared_ptr<cugl::AssetManager>& assets)
     // GetJSONValuesFromAssets
     std::shared_ptr<cugl::JsonValue> constants = assets->get<JsonValue>("constants");
     std::shared_ptr<cugl::JsonValue> boardMembers = assets->get<JsonValue>("boardMember");
+    Unit::loadSubTypes(boardMembers->get("unit"));
 
     // Initialize Constants
     int sceneHeight = constants->getInt("scene-height");
@@ -90,6 +91,7 @@ bool LevelEditorScene::init(const std::shared_ptr<cugl::AssetManager>& assets)
     for (string textureName : textureVec) {
         _textures.insert({ textureName, assets->get<Texture>(textureName) });
     }
+    _unitTextures = UnitTextureSet::alloc(_textures);
 
     // Allocate Layout
     _rootNode = scene2::SceneNode::allocWithBounds(getSize());
@@ -126,9 +128,9 @@ bool LevelEditorScene::init(const std::shared_ptr<cugl::AssetManager>& assets)
                 _level->maxTurns++;
                 _level->addBoard(allocBasicBoard(_level->getNumberOfColumns(), _level->getNumberOfRows()));
                 // Make sure that empty squares are kept.
-                for (auto square : _level->getBoard(_currentBoardTurn)->getAllSquares()) {
+                for (const auto& square : _level->getBoard(_currentBoardTurn)->getAllSquares()) {
                     auto squarePosition = square->getPosition();
-                    if (_level->getBoard(_currentBoardTurn)->getSquare(squarePosition)->getUnit()->getSubType() == "empty") {
+                    if (_level->getBoard(_currentBoardTurn)->getSquare(squarePosition)->getUnit()->getSubTypeId() == Unit::EMPTY) {
                         _level->getBoard(_currentBoardTurn + 1)->getSquare(squarePosition)->getUnit()->setSubType("empty");
                     }
                 }
@@ -264,7 +266,7 @@ bool LevelEditorScene::init(const std::shared_ptr<cugl::AssetManager>& assets)
         }
 
         // store the default color:red for this type of unit
-        shared_ptr<Unit> unit = Unit::alloc(_textures, subtypeString, Unit::Color::RED, basicAttackVec, specialAttackVec, Vec2(0, -1), subtypeString != "king");
+        shared_ptr<Unit> unit = Unit::alloc(_unitTextures, subtypeString, Unit::Color::RED, basicAttackVec, specialAttackVec, Vec2(0, -1), subtypeString != "king");
         _unitTypes.insert({ child->key(), unit });
     }
 
@@ -328,7 +330,7 @@ bool LevelEditorScene::init(const std::shared_ptr<cugl::AssetManager>& assets)
     for (auto element : _unitTypes) {
         auto square = _selectionBoard->getAllSquares()[i];
         auto unitType = element.second;        
-        square->setUnit(unitType);
+        _selectionBoard->setUnit(square->getPosition(), unitType);
         auto test = getUnitType(unitType->getSubType(), Unit::colorToString(unitType->getColor()));
 //        auto unitNode = scene2::PolygonNode::allocWithTexture(_textures.at(getUnitType(unitType->getSubType(), Unit::colorToString(unitType->getColor()))));
         auto unitNode = scene2::SpriteNode::alloc(_textures.at(getUnitType(unitType->getSubType(), Unit::colorToString(unitType->getColor()))), 1, 1);
@@ -339,7 +341,7 @@ bool LevelEditorScene::init(const std::shared_ptr<cugl::AssetManager>& assets)
     }
 
     // Initialize Level
-    _level = Level::alloc(_textures, _maxBoardWidth, _maxBoardHeight);
+    _level = Level::alloc(_unitTextures, _maxBoardWidth, _maxBoardHeight);
     _level->addBoard(allocBasicBoard(_maxBoardWidth, _maxBoardHeight));
     _level->squareSize = defaultSquareSize;
 
@@ -464,7 +466,7 @@ void LevelEditorScene::update(float timestep)
     if (_selectedSquare != NULL && _currentState == State::CHANGING_BOARD) {
         auto unit = currentBoard->getSquare(_selectedSquare->getPosition())->getUnit();
         bool change = false;
-        if (unit->getSubType() != "king") {
+        if (unit->getSubTypeId() != Unit::KING) {
             if (_input.isDirectionKeyDown()) {
                 unit->setDirection(_input.directionPressed());
                 updateBoardNode();
@@ -584,8 +586,8 @@ shared_ptr<Board> LevelEditorScene::allocBasicBoard(int width, int height) {
             Vec2 unitDirection = Unit::getDefaultDirection();
             auto unitTemplate = _unitTypes.at(unitSubType);
             Unit::Color c = Unit::stringToColor(unitColor);
-            shared_ptr<Unit> unit = Unit::alloc(_textures, unitSubType, c, unitTemplate->getBasicAttack(), unitTemplate->getSpecialAttack(), unitDirection, unitSubType != "king");
-            sq->setUnit(unit);
+            shared_ptr<Unit> unit = Unit::alloc(_unitTextures, unitSubType, c, unitTemplate->getBasicAttack(), unitTemplate->getSpecialAttack(), unitDirection, unitSubType != "king");
+            result->setUnit(squarePosition, unit);
         }
     }
     return result;
@@ -597,15 +599,17 @@ void LevelEditorScene::updateBoardNode() {
         for (int j = 0; j < _maxBoardHeight; ++j) {
             auto squarePosition = Vec2(i, j);
             if (!currentBoard->doesSqaureExist(squarePosition)) {
-                _board->getSquare(squarePosition)->setInteractable(false);
+                _board->setInteractable(squarePosition, false);
                 _board->getSquare(squarePosition)->getViewNode()->setVisible(false);
                 continue;
             }
+            // Units are edited in place, so refresh the packed state of the level board.
+            currentBoard->updateSquare(squarePosition);
             auto unit = currentBoard->getSquare(squarePosition)->getUnit();
             auto unitNode = _board->getSquare(squarePosition)->getUnit()->getViewNode();
             unitNode->setAngle(unit->getAngleBetweenDirectionAndDefault());
             unitNode->setTexture(_textures.at(getUnitType(unit->getSubType(), Unit::colorToString(unit->getColor()))));
-            _board->getSquare(squarePosition)->setInteractable(true);
+            _board->setInteractable(squarePosition, true);
             _board->getSquare(squarePosition)->getViewNode()->setVisible(true);
         }
     }
@@ -652,7 +656,7 @@ void LevelEditorScene::showBoard() {
     _changeBoardSizeButton->setColor(Color4::BLUE);
     if (_rows != _level->getNumberOfRows() || _columns != _level->getNumberOfColumns()) {
         // Initialize Level
-        auto newLevel = Level::alloc(_textures, _columns, _rows);
+        auto newLevel = Level::alloc(_unitTextures, _columns, _rows);
         newLevel->addBoard(allocBasicBoard(_columns, _rows));
         setLevel(newLevel);
     }
@@ -15,6 +15,7 @@
 #include <unordered_set>
 #include "SWSquare.hpp"
 #include "SWUnit.hpp"
+#include "SWUnitTextureSet.hpp"
 #include "SWBoard.hpp"
 #include "SWLevel.h"
 #include "SWInputController.h"
@@ -49,6 +50,8 @@ protected:
 
     // hash map for unit textures
     std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> _textures;
+    // texture table shared by all units
+    std::shared_ptr<UnitTextureSet> _unitTextures;
     // hash map for units with different types
     std::unordered_map<std::string, std::shared_ptr<Unit>> _unitTypes;
 
@@ -0,0 +1,79 @@
+//
+//  SWMappedFile.cpp
+//  SwitchWitch
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include "SWMappedFile.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SW_CAN_MMAP 1
+#endif
+using namespace cugl;
+
+#pragma mark Constructors
+/**
+ * Opens the file at the given path.
+ *
+ * @param path  the path of the file
+ * @return true if the file could be opened.
+ */
+bool MappedFile::init(const std::string& path) {
+    dispose();
+    // The pack stays mounted until shutdown, so its contents need no copy
+    _data = AssetPack::getAssetData(path, _size);
+    if (_data != nullptr) return true;
+#if defined(SW_CAN_MMAP)
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat info;
+        void* data = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        // The mapping stays valid after the descriptor is closed
+        close(fd);
+        if (data != MAP_FAILED) {
+            _data = (const uint8_t*)data;
+            _size = (size_t)info.st_size;
+            _mapped = true;
+            return true;
+        }
+    }
+#endif
+    // Fall back to reading the whole file, which also finds Android assets
+    SDL_RWops* file = AssetPack::openAsset(path);
+    if (file == nullptr) return false;
+    Sint64 size = SDL_RWsize(file);
+    bool success = size > 0;
+    if (success) {
+        _buffer.resize((size_t)size);
+        success = SDL_RWread(file, _buffer.data(), 1, _buffer.size()) == _buffer.size();
+    }
+    SDL_RWclose(file);
+    if (!success) {
+        _buffer.clear();
+        return false;
+    }
+    _data = _buffer.data();
+    _size = _buffer.size();
+    return true;
+}
+
+/**
+ * Disposes the file, unmapping its contents.
+ */
+void MappedFile::dispose() {
+#if defined(SW_CAN_MMAP)
+    if (_mapped) munmap((void*)_data, _size);
+#endif
+    _buffer.clear();
+    _buffer.shrink_to_fit();
+    _data = nullptr;
+    _size = 0;
+    _mapped = false;
+}
@@ -0,0 +1,97 @@
+//
+//  SWMappedFile.h
+//  SwitchWitch
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#ifndef SWMappedFile_h
+#define SWMappedFile_h
+
+#include <cugl/cugl.h>
+
+/**
+ * A read-only view of the contents of a file.
+ *
+ * Where the platform allows it, the file is memory-mapped, so opening it does
+ * not copy or allocate anything and pages are only read when they are used.
+ * Files that cannot be mapped, such as the assets packed inside an Android
+ * APK, are read into a buffer through SDL instead. A file stored in a
+ * mounted AssetPack is viewed in place in the pack. Either way the contents
+ * stay valid until the file is disposed.
+ */
+class MappedFile
+{
+private:
+    /** The contents of the file */
+    const uint8_t* _data;
+
+    /** The size of the file in bytes */
+    size_t _size;
+
+    /** Whether _data is a memory mapping rather than _buffer */
+    bool _mapped;
+
+    /** The contents of the file if it could not be mapped */
+    vector<uint8_t> _buffer;
+
+public:
+#pragma mark Constructors
+    /**
+     * Creates an unopened file.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a file on the
+     * heap, use one of the static constructors instead.
+     */
+    MappedFile() : _data(nullptr), _size(0), _mapped(false) {}
+
+    /**
+     * Disposes the file, unmapping its contents.
+     */
+    ~MappedFile() { dispose(); }
+
+    /**
+     * Disposes the file, unmapping its contents.
+     */
+    void dispose();
+
+    /**
+     * Opens the file at the given path.
+     *
+     * @param path  the path of the file
+     * @return true if the file could be opened.
+     */
+    bool init(const std::string& path);
+
+#pragma mark -
+#pragma mark Static Constructors
+    /**
+     * Returns a newly opened file.
+     *
+     * @param path  the path of the file
+     * @return a newly opened file, or nullptr if it could not be opened.
+     */
+    static std::shared_ptr<MappedFile> alloc(const std::string& path) {
+        std::shared_ptr<MappedFile> result = std::make_shared<MappedFile>();
+        return (result->init(path) ? result : nullptr);
+    }
+
+#pragma mark -
+#pragma mark Contents
+    /**
+     * Returns the contents of the file.
+     */
+    const uint8_t* getData() const { return _data; }
+
+    /**
+     * Returns the size of the file in bytes.
+     */
+    size_t getSize() const { return _size; }
+
+    /**
+     * Returns whether the file is memory-mapped rather than read into memory.
+     */
+    bool isMapped() const { return _mapped; }
+};
+
+#endif /* SWMappedFile_h */
@@ -0,0 +1,87 @@
+//
+//  SWNodePool.cpp
+//  SwitchWitch
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include "SWNodePool.h"
+using namespace cugl;
+
+#pragma mark Constructors
+/**
+ * Initializes an empty pool.
+ *
+ * @param capacity  the most nodes of each kind that the pool keeps
+ * @return true if initialization was successful.
+ */
+bool NodePool::init(size_t capacity) {
+    _capacity = capacity;
+    _sprites.reserve(capacity);
+    _polygons.reserve(capacity);
+    return true;
+}
+
+#pragma mark -
+#pragma mark Nodes
+/**
+ * Returns a filmstrip showing the first frame of a single-row sprite sheet.
+ *
+ * @param texture   the sprite sheet
+ * @param frames    the number of frames in the sheet
+ * @return a filmstrip of the sheet
+ */
+std::shared_ptr<scene2::SpriteNode> NodePool::obtainSprite(const std::shared_ptr<Texture>& texture, int frames) {
+    std::shared_ptr<scene2::SpriteNode> node = takeFree(_sprites);
+    if (node == nullptr) return scene2::SpriteNode::alloc(texture, 1, frames);
+    // Back on the first frame, the sheet region starts at the origin as in a new node
+    node->setFrame(0);
+    releaseChildren(node);
+    node->dispose();
+    node->initWithSprite(texture, 1, frames);
+    return node;
+}
+
+/**
+ * Returns a polygon node showing a whole texture.
+ *
+ * @param texture   the texture of the node
+ * @return a polygon node of the texture
+ */
+std::shared_ptr<scene2::PolygonNode> NodePool::obtainPolygon(const std::shared_ptr<Texture>& texture) {
+    std::shared_ptr<scene2::PolygonNode> node = takeFree(_polygons);
+    if (node == nullptr) return scene2::PolygonNode::allocWithTexture(texture);
+    releaseChildren(node);
+    node->dispose();
+    node->initWithTexture(texture);
+    return node;
+}
+
+/**
+ * Hands a filmstrip back to the pool.
+ */
+void NodePool::release(const std::shared_ptr<scene2::SpriteNode>& node) {
+    if (node != nullptr && _sprites.size() < _capacity) _sprites.push_back(node);
+}
+
+/**
+ * Hands a polygon node back to the pool.
+ */
+void NodePool::release(const std::shared_ptr<scene2::PolygonNode>& node) {
+    if (node != nullptr && _polygons.size() < _capacity) _polygons.push_back(node);
+}
+
+/**
+ * Hands every child of a node back to the pool and removes them from it.
+ */
+void NodePool::releaseChildren(const std::shared_ptr<scene2::SceneNode>& node) {
+    for (const std::shared_ptr<scene2::SceneNode>& child : node->getChildren()) {
+        std::shared_ptr<scene2::SpriteNode> sprite = std::dynamic_pointer_cast<scene2::SpriteNode>(child);
+        if (sprite != nullptr) {
+            release(sprite);
+            continue;
+        }
+        release(std::dynamic_pointer_cast<scene2::PolygonNode>(child));
+    }
+    node->removeAllChildren();
+}
@@ -0,0 +1,126 @@
+//
+//  SWNodePool.h
+//  SwitchWitch
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#ifndef SWNodePool_h
+#define SWNodePool_h
+
+#include <cugl/cugl.h>
+
+/**
+ * A pool of the scene nodes that a scene keeps creating and throwing away.
+ *
+ * Nodes handed back with release are reset in place and handed out again
+ * instead of allocating new ones. A released node is only reused once
+ * nothing else holds it, so a node that is still in the scene graph, or
+ * still referenced by the scene, is never handed out twice. Such nodes stay
+ * in the pool until they are free.
+ *
+ * One pool is made per scene and shared by everything in it.
+ */
+class NodePool
+{
+private:
+    /** The released filmstrips */
+    vector<std::shared_ptr<cugl::scene2::SpriteNode>> _sprites;
+
+    /** The released polygon nodes */
+    vector<std::shared_ptr<cugl::scene2::PolygonNode>> _polygons;
+
+    /** The most nodes of each kind that the pool keeps */
+    size_t _capacity;
+
+    /**
+     * Removes and returns a node of the list that nothing else holds, or
+     * nullptr if there is none.
+     */
+    template <typename T>
+    static std::shared_ptr<T> takeFree(vector<std::shared_ptr<T>>& nodes) {
+        for (size_t i = nodes.size(); i-- > 0;) {
+            if (nodes[i].use_count() == 1) {
+                std::shared_ptr<T> node = nodes[i];
+                nodes[i] = nodes.back();
+                nodes.pop_back();
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+public:
+#pragma mark Constructors
+    /**
+     * Creates an empty pool.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a pool on the
+     * heap, use one of the static constructors instead.
+     */
+    NodePool() : _capacity(0) {}
+
+    /**
+     * Initializes an empty pool.
+     *
+     * @param capacity  the most nodes of each kind that the pool keeps
+     * @return true if initialization was successful.
+     */
+    bool init(size_t capacity);
+
+#pragma mark -
+#pragma mark Static Constructors
+    /**
+     * Returns a newly allocated empty pool.
+     *
+     * @param capacity  the most nodes of each kind that the pool keeps
+     * @return a newly allocated empty pool.
+     */
+    static std::shared_ptr<NodePool> alloc(size_t capacity = 256) {
+        std::shared_ptr<NodePool> result = std::make_shared<NodePool>();
+        return (result->init(capacity) ? result : nullptr);
+    }
+
+#pragma mark -
+#pragma mark Nodes
+    /**
+     * Returns a filmstrip showing the first frame of a single-row sprite sheet.
+     *
+     * The node is as if it were newly allocated with SpriteNode::alloc.
+     *
+     * @param texture   the sprite sheet
+     * @param frames    the number of frames in the sheet
+     * @return a filmstrip of the sheet
+     */
+    std::shared_ptr<cugl::scene2::SpriteNode> obtainSprite(const std::shared_ptr<cugl::Texture>& texture, int frames);
+
+    /**
+     * Returns a polygon node showing a whole texture.
+     *
+     * The node is as if it were newly allocated with
+     * PolygonNode::allocWithTexture.
+     *
+     * @param texture   the texture of the node
+     * @return a polygon node of the texture
+     */
+    std::shared_ptr<cugl::scene2::PolygonNode> obtainPolygon(const std::shared_ptr<cugl::Texture>& texture);
+
+    /**
+     * Hands a filmstrip back to the pool. It is reused once nothing else holds it.
+     */
+    void release(const std::shared_ptr<cugl::scene2::SpriteNode>& node);
+
+    /**
+     * Hands a polygon node back to the pool. It is reused once nothing else holds it.
+     */
+    void release(const std::shared_ptr<cugl::scene2::PolygonNode>& node);
+
+    /**
+     * Hands every child of a node back to the pool and removes them from it.
+     *
+     * Children that are not polygon nodes are only removed.
+     */
+    void releaseChildren(const std::shared_ptr<cugl::scene2::SceneNode>& node);
+};
+
+#endif /* SWNodePool_h */
@@ -0,0 +1,506 @@
+//
+//  SWSimulation.cpp
+//  SwitchWitch
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include "SWSimulation.h"
+using namespace cugl;
+
+/** The probability of each color for random units on the starting board */
+#define STARTING_COLOR_PROBABILITY 0.33f
+
+/**
+ * Returns whether two events are the same.
+ */
+bool Simulation::Event::operator==(const Event& other) const {
+    return type == other.type && turn == other.turn && square == other.square && this->other == other.other &&
+           value == other.value && subtype == other.subtype && color == other.color &&
+           direction == other.direction && needed == other.needed;
+}
+
+#pragma mark Constructors
+/**
+ * Initializes a simulation with the unit types of the game.
+ *
+ * @param unitTypes             a unit of every subtype, keyed by subtype
+ * @param respawnProbabilities  the respawn weight of each type that a random unit may become
+ * @return true if initialization was successful.
+ */
+bool Simulation::init(const std::unordered_map<std::string, std::shared_ptr<Unit>>& unitTypes, const std::map<std::string, float>& respawnProbabilities) {
+    if (unitTypes.empty() || respawnProbabilities.empty()) return false;
+    _unitTypes = unitTypes;
+    _respawnProbabilities = respawnProbabilities;
+    return true;
+}
+
+/**
+ * Initializes a simulation with the unit and constants JSON of the game.
+ *
+ * The unit types and respawn weights are read the same way as in GameScene.
+ *
+ * @param boardMembers  the contents of boardMember.json
+ * @param constants     the contents of constants.json
+ * @return true if initialization was successful.
+ */
+bool Simulation::init(const std::shared_ptr<cugl::JsonValue>& boardMembers, const std::shared_ptr<cugl::JsonValue>& constants) {
+    std::shared_ptr<JsonValue> units = boardMembers->get("unit");
+    if (units == nullptr) return false;
+    Unit::loadSubTypes(units);
+    std::unordered_map<std::string, std::shared_ptr<Unit>> unitTypes;
+    for (const auto& child : units->children()) {
+        vector<Vec2> basicAttack;
+        for (const auto& attack : child->get("basic-attack")->children()) {
+            basicAttack.push_back(Vec2(attack->get(0)->asFloat(), attack->get(1)->asFloat()));
+        }
+        vector<Vec2> specialAttack;
+        for (const auto& attack : child->get("special-attack")->children()) {
+            specialAttack.push_back(Vec2(attack->get(0)->asFloat(), attack->get(1)->asFloat()));
+        }
+        unitTypes[child->key()] = Unit::alloc(nullptr, child->key(), Unit::Color::RED, basicAttack, specialAttack, Vec2(0, -1), child->key() != "king");
+    }
+    std::map<std::string, float> respawnProbabilities;
+    for (const std::string& name : constants->get("probability-respawn")->asStringArray()) {
+        respawnProbabilities[name] = static_cast<float>(units->get(name)->get("probability-respawn")->asInt());
+    }
+    return init(unitTypes, respawnProbabilities);
+}
+
+#pragma mark -
+#pragma mark Playing
+/**
+ * Starts a new game of a level, clearing the log.
+ *
+ * The random units of the starting board are drawn from the seed.
+ *
+ * @param level the level to play
+ * @param seed  the seed of every random unit of the game
+ */
+void Simulation::start(const std::shared_ptr<Level>& level, uint64_t seed) {
+    _level = level;
+    _seed = seed;
+    _random = seed;
+    _board = Board::alloc(level->getNumberOfColumns(), level->getNumberOfRows());
+    _replacementDepth.assign(_board->getNumberOfSquares(), 0);
+    _turnsLeft = level->maxTurns;
+    _score = 0;
+    _outcome = PLAYING;
+    _log.clear();
+    _turnStart = 0;
+
+    std::map<Unit::Color, float> startingColorProbabilities = {
+        {Unit::Color::RED, STARTING_COLOR_PROBABILITY},
+        {Unit::Color::GREEN, STARTING_COLOR_PROBABILITY},
+        {Unit::Color::BLUE, STARTING_COLOR_PROBABILITY}};
+    // Random units are drawn square by square in the order GameScene lays them out
+    for (int i = 0; i < level->getNumberOfColumns(); i++) {
+        for (int j = 0; j < level->getNumberOfRows(); j++) {
+            Vec2 position(i, j);
+            std::shared_ptr<Unit> unit = level->getReplacementSquare(position, 0)->getUnit();
+            std::string subtype = unit->getSubType();
+            Unit::Color color = boardColor(unit->getColor());
+            Vec2 direction = unit->getDirection();
+            if (subtype == "random") {
+                subtype = pickWeighted(_respawnProbabilities);
+                color = pickWeighted(startingColorProbabilities);
+                direction = randomDirection();
+            }
+            _board->setUnit(position, makeUnit(subtype, color, direction, unit->getUnitsNeededToKill()));
+            _board->setInteractable(position, subtype != "empty");
+        }
+    }
+    _respawnSeed = _random;
+}
+
+/**
+ * Draws the respawns of the game from a new seed, keeping the starting board.
+ *
+ * @param seed  the seed of the random units respawned during the game
+ * @return false if a turn was already played, in which case nothing happens.
+ */
+bool Simulation::reseed(uint64_t seed) {
+    if (_board == nullptr || !_log.empty()) return false;
+    _respawnSeed = seed;
+    _random = seed;
+    return true;
+}
+
+/**
+ * Returns whether the unit on one square may be swapped with another.
+ *
+ * The squares must be adjacent and hold movable units, and the game must
+ * not be over.
+ */
+bool Simulation::isLegalSwap(int from, int to) {
+    int squares = _board == nullptr ? 0 : _board->getNumberOfSquares();
+    if (_outcome != PLAYING || from < 0 || to < 0 || from >= squares || to >= squares) return false;
+    Vec2 fromPosition = _board->unflattenPos(from);
+    Vec2 toPosition = _board->unflattenPos(to);
+    if (fromPosition.distance(toPosition) != 1) return false;
+    if (!_board->isInteractable(from) || !_board->isInteractable(to) || _board->isKing(from)) return false;
+    return _board->getAllSquares()[from]->getUnit()->isMoveable() && _board->getAllSquares()[to]->getUnit()->isMoveable();
+}
+
+/**
+ * Returns the legal swaps of the board as (from, to) pairs.
+ */
+vector<std::pair<int, int>> Simulation::getLegalSwaps() {
+    vector<std::pair<int, int>> result;
+    if (_board == nullptr) return result;
+    for (int from = 0; from < _board->getNumberOfSquares(); from++) {
+        for (const Vec2& direction : Unit::getAllPossibleDirections()) {
+            Vec2 position = _board->unflattenPos(from) + direction;
+            if (!_board->doesSqaureExist(position)) continue;
+            int to = _board->flattenPos(position.x, position.y);
+            if (isLegalSwap(from, to)) result.push_back({ from, to });
+        }
+    }
+    return result;
+}
+
+/**
+ * Plays a turn: swaps two units and resolves the attack that follows.
+ *
+ * This follows the turn as GameScene animates it. A unit attacked by fewer
+ * units than it needs to die survives. If a king dies, every unit that died
+ * with it scores a point and the game is won. If a king survives an attack,
+ * the game is lost.
+ *
+ * @param from  the flattened position of the selected square
+ * @param to    the flattened position of the square it is swapped with
+ * @return false if the swap is not legal, in which case nothing happens.
+ */
+bool Simulation::playTurn(int from, int to) {
+    if (!isLegalSwap(from, to)) return false;
+    _turnStart = _log.size();
+    _turnsLeft--;
+    Vec2 toPosition = _board->unflattenPos(to);
+    logEvent(Event::SWAP, from).other = to;
+    _board->switchAndRotateUnits(_board->unflattenPos(from), toPosition);
+
+    vector<int> attacked;
+    vector<char> isAttacked(_board->getNumberOfSquares(), false);
+    for (const std::shared_ptr<Square>& square : _board->getAttackedSquares(toPosition)) {
+        int index = _board->flattenPos(square->getPosition().x, square->getPosition().y);
+        attacked.push_back(index);
+        isAttacked[index] = true;
+    }
+    vector<int> attackedBy;
+    vector<int> protectedBy;
+    findAttackers(to, isAttacked, attackedBy, protectedBy);
+    int count = (int)attacked.size();
+    for (int index : attacked) {
+        logEvent(Event::ATTACK, index, count).other = attackedBy[index];
+    }
+    vector<char> isProtected(_board->getNumberOfSquares(), false);
+    for (const std::shared_ptr<Square>& square : _board->getProtectedSquares(toPosition)) {
+        int index = _board->flattenPos(square->getPosition().x, square->getPosition().y);
+        if (isAttacked[index] || isProtected[index]) continue;
+        isProtected[index] = true;
+        logEvent(Event::PROTECT, index).other = protectedBy[index];
+    }
+
+    vector<int> killed;
+    int kingKilled = -1;
+    int kingSurvived = -1;
+    for (int index : attacked) {
+        bool king = _board->isKing(index);
+        if (count < _board->getAllSquares()[index]->getUnit()->getUnitsNeededToKill()) {
+            if (king) kingSurvived = index;
+            continue;
+        }
+        if (king) kingKilled = index;
+        killed.push_back(index);
+        logEvent(Event::KILL, index);
+    }
+    if (kingKilled >= 0) {
+        int points = (int)killed.size();
+        _score += points;
+        logEvent(Event::KING_KILLED, kingKilled, points);
+        _outcome = WON;
+    } else if (kingSurvived >= 0) {
+        logEvent(Event::KING_SURVIVED, kingSurvived, count);
+        _outcome = LOST;
+    } else if (_turnsLeft <= 0) {
+        _outcome = LOST;
+    }
+    // Dead kings stay on the board, everything else respawns in attack order
+    for (int index : killed) {
+        if (!_board->isKing(index)) respawn(index);
+    }
+    return true;
+}
+
+/**
+ * Returns the events of a turn without playing it.
+ *
+ * The turn is played and then undone, so the game, its log and its random
+ * number generator are left as they were.
+ *
+ * @param from  the flattened position of the selected square
+ * @param to    the flattened position of the square it is swapped with
+ * @return the events of the turn, or none if the swap is not legal.
+ */
+vector<Simulation::Event> Simulation::previewTurn(int from, int to) {
+    Snapshot saved = snapshot();
+    size_t turnStart = _turnStart;
+    if (!playTurn(from, to)) return vector<Event>();
+    vector<Event> result(_log.begin() + _turnStart, _log.end());
+    restore(saved);
+    _turnStart = turnStart;
+    return result;
+}
+
+/**
+ * Starts the level again with the same seeds and plays the swaps of a log.
+ *
+ * @param log   the log of an earlier game of the same level and seed
+ * @return true if the replayed game logged exactly the same events.
+ */
+bool Simulation::replay(const vector<Event>& log) {
+    if (_level == nullptr) return false;
+    uint64_t respawnSeed = _respawnSeed;
+    start(_level, _seed);
+    reseed(respawnSeed);
+    for (const Event& event : log) {
+        if (event.type == Event::SWAP && !playTurn(event.square, event.other)) return false;
+    }
+    return _log == log;
+}
+
+/**
+ * Returns whether the unit on a square was killed in the last turn.
+ *
+ * @param square    the flattened position of the square
+ */
+bool Simulation::wasKilled(int square) const {
+    for (size_t i = _turnStart; i < _log.size(); i++) {
+        if (_log[i].type == Event::KILL && _log[i].square == square) return true;
+    }
+    return false;
+}
+
+#pragma mark -
+#pragma mark Snapshots
+/**
+ * Returns a snapshot of the game.
+ */
+Simulation::Snapshot Simulation::snapshot() const {
+    Snapshot result;
+    result.board = _board->snapshot();
+    result.replacementDepth = _replacementDepth;
+    result.turnsLeft = _turnsLeft;
+    result.score = _score;
+    result.outcome = _outcome;
+    result.random = _random;
+    result.events = _log.size();
+    return result;
+}
+
+/**
+ * Returns the game to a snapshot of it, dropping the events logged since.
+ */
+void Simulation::restore(const Snapshot& snapshot) {
+    _board->restore(snapshot.board);
+    _replacementDepth = snapshot.replacementDepth;
+    _turnsLeft = snapshot.turnsLeft;
+    _score = snapshot.score;
+    _outcome = snapshot.outcome;
+    _random = snapshot.random;
+    _log.resize(std::min(_log.size(), snapshot.events));
+    _turnStart = _log.size();
+}
+
+#pragma mark -
+#pragma mark Rules
+/**
+ * Returns the next number of the random number generator in [0, 1).
+ *
+ * The generator is splitmix64, which is fast, and needs nothing but its state
+ * to be saved and restored.
+ */
+double Simulation::nextRandom() {
+    uint64_t value = (_random += 0x9e3779b97f4a7c15ULL);
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return (value >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Returns a choice picked by weight with the next random number.
+ *
+ * If the total weight is not a number, no choice is reached and the first
+ * one is returned.
+ */
+template <typename T>
+T Simulation::pickWeighted(const std::map<T, float>& weights) {
+    float total = 0.0;
+    for (const auto& weight : weights) {
+        total += weight.second;
+    }
+    float choice = total * nextRandom();
+    float cumulative = 0.0;
+    for (const auto& weight : weights) {
+        if (cumulative + weight.second >= choice) return weight.first;
+        cumulative += weight.second;
+    }
+    return weights.begin()->first;
+}
+
+/**
+ * Returns a random direction.
+ */
+Vec2 Simulation::randomDirection() {
+    vector<Vec2> directions = Unit::getAllPossibleDirections();
+    int index = std::min((int)(nextRandom() * directions.size()), (int)directions.size() - 1);
+    return directions[index];
+}
+
+/**
+ * Returns the color weights of random respawns, which favour the colors
+ * that are rarest on the board.
+ *
+ * A color missing from the board counts as one unit, so that it gets the
+ * largest weight instead of an infinite one. Kings are red on the board
+ * (see {@link #boardColor}), so they count as red.
+ */
+std::map<Unit::Color, float> Simulation::respawnColorProbabilities() {
+    std::map<Unit::Color, float> probabilities = {
+        {Unit::Color::RED, 0.0f},
+        {Unit::Color::GREEN, 0.0f},
+        {Unit::Color::BLUE, 0.0f}};
+    std::map<Unit::Color, int> counts = {
+        {Unit::Color::RED, 0},
+        {Unit::Color::GREEN, 0},
+        {Unit::Color::BLUE, 0}};
+    int total = _board->getNumberOfSquares();
+    for (int i = 0; i < total; i++) {
+        auto count = counts.find(_board->getColor(i));
+        if (count != counts.end()) count->second++;
+    }
+    float cumulative = 0.0;
+    for (auto& probability : probabilities) {
+        probability.second = static_cast<float>(total) / std::max(counts.at(probability.first), 1);
+        cumulative += probability.second;
+    }
+    for (auto& probability : probabilities) {
+        probability.second /= cumulative;
+    }
+    return probabilities;
+}
+
+/**
+ * Returns a new unit of the given type for the board.
+ */
+std::shared_ptr<Unit> Simulation::makeUnit(const std::string& subtype, Unit::Color color, Vec2 direction, int needed) {
+    const std::shared_ptr<Unit>& type = _unitTypes.at(subtype);
+    int id = Unit::subTypeToId(subtype);
+    return Unit::alloc(nullptr, subtype, color, type->getBasicAttack(), type->getSpecialAttack(), direction, Unit::isMoveableSubType(id), Unit::isSpecialSubType(id), needed);
+}
+
+/**
+ * Replaces the unit on a square with the next unit of its replacement layers.
+ *
+ * Random units get a color that is rare on the board, a random direction and
+ * a random type. A square that has run out of layers becomes empty. The unit
+ * is changed in place, as GameScene changes the unit it shows.
+ */
+void Simulation::respawn(int index) {
+    Vec2 position = _board->unflattenPos(index);
+    std::map<Unit::Color, float> colorProbabilities = respawnColorProbabilities();
+    int depth = ++_replacementDepth[index];
+    const std::shared_ptr<Unit>& unit = _board->getAllSquares()[index]->getUnit();
+
+    std::string subtype = "empty";
+    Unit::Color color = unit->getColor();
+    Vec2 direction = unit->getDirection();
+    int needed = 0;
+    if (_level->doesBoardExist(depth)) {
+        std::shared_ptr<Unit> replacement = _level->getReplacementSquare(position, depth)->getUnit();
+        subtype = replacement->getSubType();
+        color = boardColor(replacement->getColor());
+        direction = replacement->getDirection();
+        needed = replacement->getUnitsNeededToKill();
+        if (subtype == "random") {
+            color = pickWeighted(colorProbabilities);
+            direction = randomDirection();
+            subtype = pickWeighted(_respawnProbabilities);
+        }
+    }
+
+    const std::shared_ptr<Unit>& type = _unitTypes.at(subtype);
+    unit->setDirection(direction);
+    unit->setColor(color);
+    unit->setSubType(subtype);
+    unit->setBasicAttack(type->getBasicAttack());
+    unit->setSpecialAttack(type->getSpecialAttack());
+    unit->setSpecial(Unit::isSpecialSubType(unit->getSubTypeId()));
+    unit->setMoveable(Unit::isMoveableSubType(unit->getSubTypeId()));
+    unit->setUnitsNeededToKill(needed);
+    _board->setInteractable(position, subtype != "empty");
+
+    Event& event = logEvent(Event::RESPAWN, index, depth);
+    event.subtype = unit->getSubTypeId();
+    event.color = color;
+    event.direction = Unit::directionToId(direction);
+    event.needed = needed;
+}
+
+/**
+ * Finds the unit that attacks or protects each square in the attack from a
+ * square.
+ *
+ * The attack spreads one wave at a time: the attacker hits the squares under
+ * its basic attack, and every unit hit then attacks with its special attack.
+ * Each square is credited to the first unit that reaches it, which is the
+ * order in which GameScene animates the chain.
+ *
+ * @param origin        the flattened position of the attacker square
+ * @param isAttacked    whether each square is attacked in the turn
+ * @param attackedBy    set to the attacker of each square, or -1
+ * @param protectedBy   set to the protector of each square, or -1
+ */
+void Simulation::findAttackers(int origin, const vector<char>& isAttacked, vector<int>& attackedBy, vector<int>& protectedBy) {
+    attackedBy.assign(_board->getNumberOfSquares(), -1);
+    protectedBy.assign(_board->getNumberOfSquares(), -1);
+    vector<int> wave = { origin };
+    bool basic = true;
+    while (!wave.empty()) {
+        vector<int> next;
+        for (int attacker : wave) {
+            Vec2 position = _board->unflattenPos(attacker);
+            for (const std::shared_ptr<Square>& square : _board->getInitallyAttackedSquares(position, basic)) {
+                int index = _board->flattenPos(square->getPosition().x, square->getPosition().y);
+                if (!isAttacked[index] || attackedBy[index] >= 0) continue;
+                attackedBy[index] = attacker;
+                next.push_back(index);
+            }
+            for (const std::shared_ptr<Square>& square : _board->getInitiallyProtectedSquares(position, basic)) {
+                int index = _board->flattenPos(square->getPosition().x, square->getPosition().y);
+                if (protectedBy[index] < 0) protectedBy[index] = attacker;
+            }
+        }
+        wave = next;
+        basic = false;
+    }
+}
+
+/**
+ * Appends an event of the current turn to the log.
+ */
+Simulation::Event& Simulation::logEvent(Event::Type type, int square, int value) {
+    Event event;
+    event.type = type;
+    event.turn = _level->maxTurns - _turnsLeft;
+    event.square = square;
+    event.other = -1;
+    event.value = value;
+    event.subtype = -1;
+    event.color = -1;
+    event.direction = -1;
+    event.needed = -1;
+    _log.push_back(event);
+    return _log.back();
+}
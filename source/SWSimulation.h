@@ -0,0 +1,383 @@
+//
+//  SWSimulation.h
+//  SwitchWitch
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#ifndef SWSimulation_h
+#define SWSimulation_h
+
+#include "SWLevel.h"
+#include <cugl/cugl.h>
+#include <map>
+#include <unordered_map>
+
+/**
+ * The rules of a SwitchWitch game, without any rendering or timing.
+ *
+ * A simulation owns a board of its own, built from a level, and plays whole
+ * turns on it: a swap, the chain of attacks it starts, the deaths, the
+ * respawns from the replacement layers, and the score. Each turn is resolved
+ * at once when it is played, and everything that happened is appended to an
+ * event log. GameScene plays the turn here as soon as the player confirms a
+ * swap, and then only animates the events, so the frame rate and the length
+ * of the animations cannot change the outcome of a game.
+ *
+ * Random units are drawn from a generator seeded when the level is started,
+ * so a seed and the swaps of the log replay exactly the same game. Nothing
+ * here needs textures or a window, which allows tools to play many games
+ * per second.
+ */
+class Simulation
+{
+public:
+    /** Something that happened during a turn */
+    struct Event {
+        enum Type {
+            /** The unit on square was moved to other and turned to face it */
+            SWAP,
+            /** The unit on square was attacked by the unit on other, and value units were attacked in all */
+            ATTACK,
+            /** The unit on square was protected by the friendly unit on other */
+            PROTECT,
+            /** The unit on square was killed */
+            KILL,
+            /** The unit on square was replaced by the given unit of layer value */
+            RESPAWN,
+            /** The king on square was killed and value points were scored */
+            KING_KILLED,
+            /** The king on square was attacked by too few units and survived */
+            KING_SURVIVED
+        };
+
+        /** The type of the event */
+        Type type;
+        /** The turn of the event, starting at 1 */
+        int turn;
+        /** The flattened position of the square (see Board::flattenPos) */
+        int square;
+        /** The flattened position of the other square of a swap, of the attacker or of the protector, or -1 */
+        int other;
+        /** The number of attacked units, the points scored or the layer */
+        int value;
+        /** The subtype, color, direction id and units needed to kill of a respawned unit */
+        int subtype;
+        int color;
+        int direction;
+        int needed;
+
+        bool operator==(const Event& other) const;
+        bool operator!=(const Event& other) const { return !(*this == other); }
+    };
+
+    /** The state of the game after the last turn */
+    enum Outcome {
+        /** The game goes on */
+        PLAYING,
+        /** The king was killed */
+        WON,
+        /** The king survived an attack, or no turns are left */
+        LOST
+    };
+
+    /**
+     * A saved simulation. Like Board::Snapshot, it shares the board with the
+     * simulation instead of copying it.
+     */
+    struct Snapshot {
+        Board::Snapshot board;
+        vector<int> replacementDepth;
+        int turnsLeft;
+        int score;
+        Outcome outcome;
+        uint64_t random;
+        size_t events;
+    };
+
+private:
+    /** The unit types by subtype, whose attacks are copied into new units */
+    std::unordered_map<std::string, std::shared_ptr<Unit>> _unitTypes;
+
+    /** The respawn weight of each type that a random unit may become */
+    std::map<std::string, float> _respawnProbabilities;
+
+    /** The level being played */
+    std::shared_ptr<Level> _level;
+
+    /** The board of the game, with units that have no textures */
+    std::shared_ptr<Board> _board;
+
+    /** The replacement layer of the unit on each square */
+    vector<int> _replacementDepth;
+
+    /** The number of turns the player has left */
+    int _turnsLeft;
+
+    /** The score of the player */
+    int _score;
+
+    /** The state of the game */
+    Outcome _outcome;
+
+    /** The seed of the game */
+    uint64_t _seed;
+
+    /** The state of the random number generator when the first turn starts */
+    uint64_t _respawnSeed;
+
+    /** The state of the random number generator */
+    uint64_t _random;
+
+    /** Everything that happened in the game so far */
+    vector<Event> _log;
+
+    /** The index in the log of the first event of the last turn */
+    size_t _turnStart;
+
+#pragma mark Constructors
+public:
+    /**
+     * Creates an empty simulation.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a simulation
+     * on the heap, use one of the static constructors instead.
+     */
+    Simulation() : _turnsLeft(0), _score(0), _outcome(PLAYING), _seed(0), _respawnSeed(0), _random(0), _turnStart(0) {}
+
+    /**
+     * Initializes a simulation with the unit types of the game.
+     *
+     * @param unitTypes             a unit of every subtype, keyed by subtype
+     * @param respawnProbabilities  the respawn weight of each type that a random unit may become
+     * @return true if initialization was successful.
+     */
+    bool init(const std::unordered_map<std::string, std::shared_ptr<Unit>>& unitTypes, const std::map<std::string, float>& respawnProbabilities);
+
+    /**
+     * Initializes a simulation with the unit and constants JSON of the game.
+     *
+     * @param boardMembers  the contents of boardMember.json
+     * @param constants     the contents of constants.json
+     * @return true if initialization was successful.
+     */
+    bool init(const std::shared_ptr<cugl::JsonValue>& boardMembers, const std::shared_ptr<cugl::JsonValue>& constants);
+
+#pragma mark -
+#pragma mark Static Constructors
+    /**
+     * Returns a newly allocated simulation with the unit types of the game.
+     *
+     * @param unitTypes             a unit of every subtype, keyed by subtype
+     * @param respawnProbabilities  the respawn weight of each type that a random unit may become
+     * @return a newly allocated simulation.
+     */
+    static std::shared_ptr<Simulation> alloc(const std::unordered_map<std::string, std::shared_ptr<Unit>>& unitTypes, const std::map<std::string, float>& respawnProbabilities) {
+        std::shared_ptr<Simulation> result = std::make_shared<Simulation>();
+        return (result->init(unitTypes, respawnProbabilities) ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated simulation with the unit and constants JSON of the game.
+     *
+     * @param boardMembers  the contents of boardMember.json
+     * @param constants     the contents of constants.json
+     * @return a newly allocated simulation.
+     */
+    static std::shared_ptr<Simulation> alloc(const std::shared_ptr<cugl::JsonValue>& boardMembers, const std::shared_ptr<cugl::JsonValue>& constants) {
+        std::shared_ptr<Simulation> result = std::make_shared<Simulation>();
+        return (result->init(boardMembers, constants) ? result : nullptr);
+    }
+
+#pragma mark -
+#pragma mark Playing
+    /**
+     * Starts a new game of a level, clearing the log.
+     *
+     * The random units of the starting board are drawn from the seed.
+     *
+     * @param level the level to play
+     * @param seed  the seed of every random unit of the game
+     */
+    void start(const std::shared_ptr<Level>& level, uint64_t seed);
+
+    /**
+     * Draws the respawns of the game from a new seed, keeping the starting board.
+     *
+     * This is how a level is restarted: the board is put back as it was, but
+     * the units that respawn differ from the last try. A replay of the game
+     * uses the new seed too. Reseeding is only possible before the first turn.
+     *
+     * @param seed  the seed of the random units respawned during the game
+     * @return false if a turn was already played, in which case nothing happens.
+     */
+    bool reseed(uint64_t seed);
+
+    /**
+     * Returns whether the unit on one square may be swapped with another.
+     *
+     * The squares must be adjacent and hold movable units, and the game must
+     * not be over.
+     */
+    bool isLegalSwap(int from, int to);
+
+    /**
+     * Returns the legal swaps of the board as (from, to) pairs.
+     */
+    vector<std::pair<int, int>> getLegalSwaps();
+
+    /**
+     * Plays a turn: swaps two units and resolves the attack that follows.
+     *
+     * The selected unit turns to face the square it moves to and attacks from
+     * there. Every killed unit other than a king is replaced by the next unit
+     * of its replacement layers.
+     *
+     * @param from  the flattened position of the selected square
+     * @param to    the flattened position of the square it is swapped with
+     * @return false if the swap is not legal, in which case nothing happens.
+     */
+    bool playTurn(int from, int to);
+
+    /**
+     * Returns the events of a turn without playing it.
+     *
+     * GameScene uses this to preview a swap before the player confirms it.
+     *
+     * @param from  the flattened position of the selected square
+     * @param to    the flattened position of the square it is swapped with
+     * @return the events of the turn, or none if the swap is not legal.
+     */
+    vector<Event> previewTurn(int from, int to);
+
+    /**
+     * Starts the level again with the same seeds and plays the swaps of a log.
+     *
+     * @param log   the log of an earlier game of the same level and seed
+     * @return true if the replayed game logged exactly the same events.
+     */
+    bool replay(const vector<Event>& log);
+
+#pragma mark -
+#pragma mark Attributes
+    /**
+     * Returns the board of the game. Its units have no textures.
+     */
+    const std::shared_ptr<Board>& getBoard() const { return _board; }
+
+    /**
+     * Returns the replacement layer of the unit on each square.
+     */
+    const vector<int>& getReplacementDepth() const { return _replacementDepth; }
+
+    /**
+     * Returns the number of turns the player has left.
+     */
+    int getTurnsLeft() const { return _turnsLeft; }
+
+    /**
+     * Returns the score of the player.
+     */
+    int getScore() const { return _score; }
+
+    /**
+     * Returns the state of the game.
+     */
+    Outcome getOutcome() const { return _outcome; }
+
+    /**
+     * Returns the seed of the game.
+     */
+    uint64_t getSeed() const { return _seed; }
+
+    /**
+     * Returns everything that happened in the game so far.
+     */
+    const vector<Event>& getLog() const { return _log; }
+
+    /**
+     * Returns the index in the log of the first event of the last turn.
+     */
+    size_t getTurnStart() const { return _turnStart; }
+
+    /**
+     * Returns whether the unit on a square was killed in the last turn.
+     *
+     * @param square    the flattened position of the square
+     */
+    bool wasKilled(int square) const;
+
+    /**
+     * Returns the color a unit of a level has on the board.
+     *
+     * Levels give kings no color, but GameScene has always played them as
+     * red, so they count as red units when the colors of respawns are
+     * weighed. The solver uses the same rule.
+     *
+     * @param color the color of the unit in the level
+     */
+    static Unit::Color boardColor(Unit::Color color) {
+        return color == Unit::Color::NONE ? Unit::Color::RED : color;
+    }
+
+#pragma mark -
+#pragma mark Snapshots
+    /**
+     * Returns a snapshot of the game.
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * Returns the game to a snapshot of it, dropping the events logged since.
+     */
+    void restore(const Snapshot& snapshot);
+
+private:
+#pragma mark -
+#pragma mark Rules
+    /**
+     * Returns the next number of the random number generator in [0, 1).
+     */
+    double nextRandom();
+
+    /**
+     * Returns a choice picked by weight with the next random number, exactly
+     * like the weighted choices that GameScene used to make.
+     */
+    template <typename T>
+    T pickWeighted(const std::map<T, float>& weights);
+
+    /**
+     * Finds the unit that attacks or protects each square in the attack from
+     * a square, crediting each square to the first unit that reaches it.
+     */
+    void findAttackers(int origin, const vector<char>& isAttacked, vector<int>& attackedBy, vector<int>& protectedBy);
+
+    /**
+     * Returns a random direction.
+     */
+    cugl::Vec2 randomDirection();
+
+    /**
+     * Returns the color weights of random respawns, which favour the colors
+     * that are rarest on the board.
+     */
+    std::map<Unit::Color, float> respawnColorProbabilities();
+
+    /**
+     * Returns a new unit of the given type for the board.
+     */
+    std::shared_ptr<Unit> makeUnit(const std::string& subtype, Unit::Color color, cugl::Vec2 direction, int needed);
+
+    /**
+     * Replaces the unit on a square with the next unit of its replacement layers.
+     */
+    void respawn(int index);
+
+    /**
+     * Appends an event of the current turn to the log.
+     */
+    Event& logEvent(Event::Type type, int square, int value = 0);
+};
+
+#endif /* SWSimulation_h */
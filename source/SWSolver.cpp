@@ -0,0 +1,466 @@
+//
+//  SWSolver.cpp
+//  SwitchWitch
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include "SWSolver.h"
+#include "SWSimulation.h"
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+using namespace cugl;
+
+/** The most outcomes a thread keeps before clearing its transposition table */
+#define MAX_TABLE_SIZE (1 << 22)
+
+/** The probability of each color for random units on the starting board (see Simulation::start) */
+#define STARTING_COLOR_PROBABILITY 0.33f
+
+/**
+ * Returns the index of the lowest set bit of a non-zero mask.
+ */
+static inline int lowestBit(uint64_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+/**
+ * Returns the number of set bits in a mask.
+ */
+static inline int countBits(uint64_t mask) {
+#if defined(_MSC_VER)
+    return (int)__popcnt64(mask);
+#else
+    return __builtin_popcountll(mask);
+#endif
+}
+
+/**
+ * Returns a well mixed 64-bit value (the splitmix64 finalizer).
+ */
+static inline uint64_t mix(uint64_t value) {
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+/**
+ * Returns the first choice whose running weight reaches the given fraction
+ * of the total weight, exactly like the weighted choices of Simulation.
+ *
+ * If the total weight is not a number, no choice is reached and the first
+ * one is returned, which is what happens in the game.
+ */
+template <typename T>
+static T pickWeighted(const vector<std::pair<T, float>>& weights, double random) {
+    float total = 0.0;
+    for (const auto& weight : weights) {
+        total += weight.second;
+    }
+    float choice = total * random;
+    float cumulative = 0.0;
+    for (const auto& weight : weights) {
+        if (cumulative + weight.second >= choice) return weight.first;
+        cumulative += weight.second;
+    }
+    return weights.front().first;
+}
+
+#pragma mark Constructors
+/**
+ * Initializes a solver with the unit and constants JSON of the game.
+ *
+ * @param boardMembers  the contents of boardMember.json
+ * @param constants     the contents of constants.json
+ * @param threads       the number of worker threads
+ * @return true if initialization was successful.
+ */
+bool Solver::init(const std::shared_ptr<cugl::JsonValue>& boardMembers, const std::shared_ptr<cugl::JsonValue>& constants, int threads) {
+    std::shared_ptr<JsonValue> units = boardMembers->get("unit");
+    if (units == nullptr) return false;
+    // Loading the subtypes also fills the rotated pattern table
+    Unit::loadSubTypes(units);
+    _subtypeCount = Unit::getSubTypeCount();
+
+    // Simulation keeps the respawn weights in a map, so random units pick their type in name order
+    std::map<std::string, float> respawnProbabilities;
+    for (const std::string& name : constants->get("probability-respawn")->asStringArray()) {
+        respawnProbabilities[name] = units->get(name)->getFloat("probability-respawn");
+    }
+    _respawnWeights.clear();
+    for (const auto& probability : respawnProbabilities) {
+        _respawnWeights.push_back({ Unit::subTypeToId(probability.first), probability.second });
+    }
+    if (_respawnWeights.empty()) _respawnWeights.push_back({ Unit::BASIC, 0.0f });
+
+    _threads = std::max(threads, 1);
+    return true;
+}
+
+#pragma mark -
+#pragma mark Rules
+/**
+ * Copies the layers of a level and precomputes the attack bitboards.
+ *
+ * @return false if the level is too large to solve.
+ */
+bool Solver::loadLevel(const std::shared_ptr<Level>& level) {
+    _rows = level->getNumberOfRows();
+    _columns = level->getNumberOfColumns();
+    _squares = _rows * _columns;
+    _maxTurns = level->maxTurns;
+    if (_squares > MAX_SQUARES || !level->doesBoardExist(0)) return false;
+
+    _layers.clear();
+    for (int depth = 0; level->doesBoardExist(depth); depth++) {
+        std::shared_ptr<Board> board = level->getBoard(depth);
+        vector<LayerUnit> layer(_squares);
+        for (int i = 0; i < _squares; i++) {
+            const std::shared_ptr<Unit>& unit = board->getAllSquares()[i]->getUnit();
+            LayerUnit& layerUnit = layer[i];
+            layerUnit.subtype = board->getSubTypeId(i);
+            if (layerUnit.subtype < 0 || layerUnit.subtype >= _subtypeCount) return false;
+            layerUnit.color = Simulation::boardColor(board->getColor(i));
+            layerUnit.direction = std::max(board->getDirectionId(i), 0);
+            layerUnit.needed = unit->getUnitsNeededToKill();
+        }
+        _layers.push_back(layer);
+    }
+
+    // Use the same rotated patterns as the units in the game
+    int subtypes = _subtypeCount;
+    _basicMasks.assign(subtypes * 4 * _squares, 0);
+    _specialMasks.assign(subtypes * 4 * _squares, 0);
+    for (int subtype = 0; subtype < subtypes; subtype++) {
+        for (int direction = 0; direction < 4; direction++) {
+            const vector<Unit::AttackOffset>& basic = Unit::getRotatedAttack(subtype, direction, false);
+            const vector<Unit::AttackOffset>& special = Unit::getRotatedAttack(subtype, direction, true);
+            for (int i = 0; i < _squares; i++) {
+                auto toMask = [&](const vector<Unit::AttackOffset>& attacks) {
+                    uint64_t mask = 0;
+                    for (const Unit::AttackOffset& attack : attacks) {
+                        int x = i / _rows + attack.x;
+                        int y = i % _rows + attack.y;
+                        if (x < 0 || x >= _columns || y < 0 || y >= _rows) continue;
+                        mask |= uint64_t(1) << (x * _rows + y);
+                    }
+                    return mask;
+                };
+                _basicMasks[maskIndex(subtype, direction, i)] = toMask(basic);
+                _specialMasks[maskIndex(subtype, direction, i)] = toMask(special);
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns the starting board of the level for the current seed.
+ */
+Solver::State Solver::initialState() const {
+    State state;
+    memset(&state, 0, sizeof(State));
+    vector<std::pair<int, float>> colorWeights;
+    for (int c = Unit::Color::RED; c <= Unit::Color::BLUE; c++) {
+        colorWeights.push_back({ c, STARTING_COLOR_PROBABILITY });
+    }
+    for (int i = 0; i < _squares; i++) {
+        const LayerUnit& unit = _layers[0][i];
+        if (unit.subtype == Unit::RANDOM) {
+            int direction = std::min((int)(draw(i, 0, 2) * 4), 3);
+            setUnit(state, i, pickWeighted(_respawnWeights, draw(i, 0, 0)), pickWeighted(colorWeights, draw(i, 0, 1)), direction, unit.needed);
+        } else {
+            setUnit(state, i, unit.subtype, unit.color, unit.direction, unit.needed);
+        }
+    }
+    return state;
+}
+
+/**
+ * Places a unit on a square of the board.
+ */
+void Solver::setUnit(State& state, int index, int subtype, int color, int direction, int needed) const {
+    uint64_t bit = uint64_t(1) << index;
+    state.colorMasks[state.colors[index]] &= ~bit;
+    state.colorMasks[color] |= bit;
+    state.colors[index] = color;
+    state.subtypes[index] = subtype;
+    state.directions[index] = direction;
+    state.needed[index] = needed;
+    if (subtype == Unit::KING) state.kingMask |= bit;
+    else state.kingMask &= ~bit;
+    if (subtype != Unit::EMPTY) state.interactableMask |= bit;
+    else state.interactableMask &= ~bit;
+}
+
+/**
+ * Replaces a killed unit with the unit from the next layer.
+ *
+ * This follows Simulation::respawn. Random units get a color that
+ * is rarer on the current board, a random direction and a random type.
+ */
+void Solver::respawn(State& state, int index) const {
+    int depth = ++state.depths[index];
+    if (depth >= (int)_layers.size()) {
+        // The level has run out of replacements for this square
+        setUnit(state, index, Unit::EMPTY, state.colors[index], 0, 0);
+        return;
+    }
+    const LayerUnit& unit = _layers[depth][index];
+    if (unit.subtype != Unit::RANDOM) {
+        setUnit(state, index, unit.subtype, unit.color, unit.direction, unit.needed);
+        return;
+    }
+    vector<std::pair<int, float>> colorWeights;
+    float cumulative = 0.0;
+    for (int c = Unit::Color::RED; c <= Unit::Color::BLUE; c++) {
+        // A missing color counts as one unit, as in Simulation
+        float inverse = static_cast<float>(_squares) / std::max(countBits(state.colorMasks[c]), 1);
+        colorWeights.push_back({ c, inverse });
+        cumulative += inverse;
+    }
+    for (auto& weight : colorWeights) {
+        weight.second /= cumulative;
+    }
+    int direction = std::min((int)(draw(index, depth, 2) * 4), 3);
+    setUnit(state, index, pickWeighted(_respawnWeights, draw(index, depth, 0)), pickWeighted(colorWeights, draw(index, depth, 1)), direction, unit.needed);
+}
+
+/**
+ * Returns the squares attacked by the unit on a square (see Board::resolveAttack).
+ */
+uint64_t Solver::resolveAttack(const State& state, int index) const {
+    uint64_t attacked = 0;
+    if (!(state.interactableMask & (uint64_t(1) << index))) return attacked;
+    uint64_t frontier = _basicMasks[maskIndex(state.subtypes[index], state.directions[index], index)] & hostileMask(state, index);
+    while (frontier) {
+        attacked |= frontier;
+        uint64_t next = 0;
+        for (uint64_t mask = frontier; mask; mask &= mask - 1) {
+            int square = lowestBit(mask);
+            next |= _specialMasks[maskIndex(state.subtypes[square], state.directions[square], square)] & hostileMask(state, square);
+        }
+        frontier = next & ~attacked;
+    }
+    return attacked;
+}
+
+/**
+ * Returns a deterministic random number in [0, 1) for a square and depth.
+ */
+double Solver::draw(int index, int depth, int salt) const {
+    uint64_t value = mix(_seed ^ mix(((uint64_t)index << 32) | ((uint64_t)depth << 8) | (uint64_t)salt));
+    return (value >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Returns a hash of a board together with the remaining turns.
+ */
+uint64_t Solver::hash(const State& state, int turns) const {
+    uint64_t result = mix((uint64_t)turns);
+    for (int i = 0; i < _squares; i++) {
+        uint64_t square = (uint64_t)state.colors[i] | ((uint64_t)state.subtypes[i] << 8) | ((uint64_t)state.directions[i] << 16) |
+                          ((uint64_t)state.needed[i] << 24) | ((uint64_t)state.depths[i] << 32) | ((uint64_t)i << 40);
+        result = mix(result ^ square);
+    }
+    return result;
+}
+
+#pragma mark -
+#pragma mark Search
+/**
+ * Returns whether a swap from one square to an adjacent one is legal.
+ *
+ * Both squares must be interactable and neither may hold a king.
+ */
+bool Solver::isLegalSwap(const State& state, int from, int to) const {
+    uint64_t movable = state.interactableMask & ~state.kingMask;
+    return (movable & (uint64_t(1) << from)) && (movable & (uint64_t(1) << to));
+}
+
+/**
+ * Returns the legal swaps of a board as (from, to) pairs.
+ */
+vector<std::pair<int, int>> Solver::legalSwaps(const State& state) const {
+    vector<std::pair<int, int>> result;
+    for (int from = 0; from < _squares; from++) {
+        for (int direction = 0; direction < 4; direction++) {
+            Vec2 offset = Unit::idToDirection(direction);
+            int x = from / _rows + (int)offset.x;
+            int y = from % _rows + (int)offset.y;
+            if (x < 0 || x >= _columns || y < 0 || y >= _rows) continue;
+            int to = x * _rows + y;
+            if (isLegalSwap(state, from, to)) result.push_back({ from, to });
+        }
+    }
+    return result;
+}
+
+/**
+ * Applies a swap, resolving the attack and every respawn.
+ *
+ * As in the game, the selected unit turns to face the square it moves to,
+ * and then attacks from there.
+ *
+ * @param state     the board, modified in place
+ * @param from      the selected square
+ * @param to        the square swapped with
+ * @param score     set to the score if the swap kills the king
+ * @return 1 if the king was killed, -1 if the king survived an attack,
+ *         and 0 if the king was not attacked.
+ */
+int Solver::applySwap(State& state, int from, int to, int& score) const {
+    int direction = Unit::directionToId(Vec2(to / _rows - from / _rows, to % _rows - from % _rows));
+    int color = state.colors[from];
+    int subtype = state.subtypes[from];
+    int needed = state.needed[from];
+    setUnit(state, from, state.subtypes[to], state.colors[to], state.directions[to], state.needed[to]);
+    setUnit(state, to, subtype, color, direction, needed);
+
+    uint64_t attacked = resolveAttack(state, to);
+    int count = countBits(attacked);
+    if (attacked & state.kingMask) {
+        int king = lowestBit(attacked & state.kingMask);
+        if (count < state.needed[king]) return -1;
+        score = 0;
+        for (uint64_t mask = attacked; mask; mask &= mask - 1) {
+            if (state.needed[lowestBit(mask)] <= count) score++;
+        }
+        return 1;
+    }
+    for (uint64_t mask = attacked; mask; mask &= mask - 1) {
+        int square = lowestBit(mask);
+        if (state.needed[square] <= count) respawn(state, square);
+    }
+    return 0;
+}
+
+/**
+ * Returns the best outcome reachable from a board with the remaining turns.
+ *
+ * The outcome is only kept in the transposition table if the node limit was
+ * not reached, as a search that was cut short may have missed a win.
+ */
+Solver::Outcome Solver::search(Worker& worker, const State& state, int turns) {
+    Outcome best = { -1, -1 };
+    uint64_t key = hash(state, turns);
+    auto entry = worker.table.find(key);
+    if (entry != worker.table.end()) return entry->second;
+
+    for (const auto& swap : legalSwaps(state)) {
+        Outcome outcome = searchSwap(worker, state, swap.first, swap.second, turns);
+        best.score = std::max(best.score, outcome.score);
+        if (outcome.swaps > 0 && (best.swaps < 0 || outcome.swaps < best.swaps)) best.swaps = outcome.swaps;
+    }
+    if (isOverLimit()) return best;
+    if (worker.table.size() >= MAX_TABLE_SIZE) worker.table.clear();
+    worker.table[key] = best;
+    return best;
+}
+
+/**
+ * Returns the outcome of a swap followed by the best play.
+ */
+Solver::Outcome Solver::searchSwap(Worker& worker, const State& state, int from, int to, int turns) {
+    worker.nodes++;
+    if (_nodeLimit > 0 && ++_nodes > _nodeLimit) return { -1, -1 };
+    State next = state;
+    int score = 0;
+    int result = applySwap(next, from, to, score);
+    if (result > 0) return { score, 1 };
+    if (result < 0 || turns <= 1) return { -1, -1 };
+    Outcome outcome = search(worker, next, turns - 1);
+    if (outcome.swaps > 0) outcome.swaps++;
+    return outcome;
+}
+
+#pragma mark -
+#pragma mark Solving
+/**
+ * Solves a level for one seed of the random units.
+ *
+ * The seed is only meaningful to the solver. It does not match the
+ * random number generator of Simulation or of the game.
+ *
+ * @param level the level to solve
+ * @param seed  the seed that decides every random unit
+ * @return the outcome of the search
+ */
+Solver::Result Solver::solve(const std::shared_ptr<Level>& level, uint64_t seed) {
+    Result result;
+    result.levelID = level->levelID;
+    result.maxScore = -1;
+    result.minSwaps = -1;
+    result.stars = 0;
+    result.nodes = 0;
+    result.searchedTurns = 0;
+    result.complete = false;
+    _seed = seed;
+    _nodes = 0;
+    if (!loadLevel(level)) {
+        CULogError("Level %d is too large to solve", level->levelID);
+        return result;
+    }
+
+    State start = initialState();
+    vector<std::pair<int, int>> swaps = legalSwaps(start);
+    vector<Worker> workers(_threads);
+    for (Worker& worker : workers) {
+        worker.nodes = 0;
+    }
+    std::shared_ptr<ThreadPool> pool = ThreadPool::alloc(_threads);
+
+    // Deepen one turn at a time, so that the fewest swaps are found early
+    // and a search that runs out of boards still reports full turns.
+    for (int turns = 1; turns <= _maxTurns; turns++) {
+        vector<Outcome> outcomes(swaps.size(), Outcome{ -1, -1 });
+        std::atomic<int> nextSwap(0);
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+        int done = 0;
+
+        // Every thread takes the next unsearched first swap until none are left
+        for (int t = 0; t < _threads; t++) {
+            pool->addTask([&, t]() {
+                for (int i = nextSwap++; i < (int)swaps.size(); i = nextSwap++) {
+                    outcomes[i] = searchSwap(workers[t], start, swaps[i].first, swaps[i].second, turns);
+                }
+                std::unique_lock<std::mutex> lock(doneMutex);
+                done++;
+                doneCondition.notify_all();
+            });
+        }
+        {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            doneCondition.wait(lock, [&]() { return done == _threads; });
+        }
+
+        for (const Outcome& outcome : outcomes) {
+            result.maxScore = std::max(result.maxScore, outcome.score);
+            if (outcome.swaps > 0 && (result.minSwaps < 0 || outcome.swaps < result.minSwaps)) result.minSwaps = outcome.swaps;
+        }
+        if (isOverLimit()) break;
+        result.searchedTurns = turns;
+    }
+    // Releasing the pool joins its threads
+    pool = nullptr;
+
+    for (const Worker& worker : workers) {
+        result.nodes += worker.nodes;
+    }
+    result.stars = result.maxScore >= 0 ? level->getNumberOfStars(result.maxScore) : 0;
+    result.complete = result.searchedTurns == _maxTurns;
+    return result;
+}
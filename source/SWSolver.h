@@ -0,0 +1,288 @@
+//
+//  SWSolver.h
+//  SwitchWitch
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#ifndef SWSolver_h
+#define SWSolver_h
+
+#include "SWLevel.h"
+#include <cugl/cugl.h>
+#include <atomic>
+#include <unordered_map>
+
+/**
+ * A headless solver for SwitchWitch levels.
+ *
+ * The solver replays the rules of Simulation on a compact copy of the board
+ * and searches every sequence of swaps allowed by the level. A game ends on
+ * the first swap that reaches the king: it is won if enough units attack the
+ * king, and the score of the game is the number of attacked units that die
+ * on that swap. The solver reports the best such score, and the fewest swaps
+ * needed to kill the king at all.
+ *
+ * Random units are resolved with a deterministic hash of the seed, the square
+ * and the replacement depth, so one seed fixes one possible game. Use several
+ * seeds to see how much a level depends on luck. The seeds only exist in the
+ * solver: a seed does not reproduce the respawns of a Simulation or of the
+ * game, which draw from their own generator in the order of play.
+ *
+ * The search uses no rendering and no textures. The first swaps of a level
+ * are shared out between the threads of a cugl::ThreadPool, and every thread
+ * keeps a transposition table keyed by a hash of the board.
+ */
+class Solver
+{
+public:
+    /** The outcome of solving a level with a single seed */
+    struct Result {
+        /** The ID of the level */
+        int levelID;
+        /** The best score of a won game, or -1 if the king cannot be killed */
+        int maxScore;
+        /** The fewest swaps needed to kill the king, or -1 if it cannot be killed */
+        int minSwaps;
+        /** The number of stars earned by the best score */
+        int stars;
+        /** The number of boards searched */
+        long long nodes;
+        /** The number of turns that were searched exhaustively */
+        int searchedTurns;
+        /** Whether every turn of the level was searched within the node limit */
+        bool complete;
+
+        /** Returns whether the king can be killed */
+        bool isKillable() const { return minSwaps > 0; }
+    };
+
+    /** The largest board the solver can search */
+    static const int MAX_SQUARES = Board::MAX_MASK_SQUARES;
+
+private:
+    /** The compact board state searched by the solver */
+    struct State {
+        /** The squares holding a unit of each color (kings count as red) */
+        uint64_t colorMasks[3];
+        /** The squares holding a king */
+        uint64_t kingMask;
+        /** The squares that are interactable */
+        uint64_t interactableMask;
+        /** The color of the unit on each square */
+        uint8_t colors[MAX_SQUARES];
+        /** The subtype id of the unit on each square */
+        uint8_t subtypes[MAX_SQUARES];
+        /** The direction id of the unit on each square */
+        uint8_t directions[MAX_SQUARES];
+        /** The units needed to kill the unit on each square */
+        uint8_t needed[MAX_SQUARES];
+        /** The replacement depth of each square */
+        uint8_t depths[MAX_SQUARES];
+    };
+
+    /** A unit of a replacement layer, as stored in the level */
+    struct LayerUnit {
+        int subtype;
+        int color;
+        int direction;
+        int needed;
+    };
+
+    /** The best outcome reachable from a board */
+    struct Outcome {
+        /** The best score of a won game, or -1 if there is none */
+        int score;
+        /** The fewest swaps to kill the king, or -1 if there is none */
+        int swaps;
+    };
+
+    /** The search state of a single thread */
+    struct Worker {
+        /** Exact outcomes keyed by board hash and remaining turns */
+        std::unordered_map<uint64_t, Outcome> table;
+        /** The number of boards searched by this thread */
+        long long nodes;
+    };
+
+    /** The number of subtypes whose attack patterns are in the rotated pattern table of Unit */
+    int _subtypeCount;
+
+    /** The respawn weight of each subtype that a random unit may become, in name order */
+    vector<std::pair<int, float>> _respawnWeights;
+
+    /** The number of worker threads */
+    int _threads;
+
+    /** The maximum number of boards to search per level */
+    long long _nodeLimit;
+
+    /** The level being solved */
+    int _rows;
+    int _columns;
+    int _squares;
+    int _maxTurns;
+    vector<vector<LayerUnit>> _layers;
+    uint64_t _seed;
+
+    /** The attack bitboards indexed by (subtype * 4 + direction) * squares + square */
+    vector<uint64_t> _basicMasks;
+    vector<uint64_t> _specialMasks;
+
+    /** The number of boards searched so far by all threads */
+    std::atomic<long long> _nodes;
+
+#pragma mark Constructors
+public:
+    /**
+     * Creates an uninitialized solver.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a solver on
+     * the heap, use one of the static constructors instead.
+     */
+    Solver() : _subtypeCount(0), _threads(1), _nodeLimit(0), _rows(0), _columns(0), _squares(0), _maxTurns(0), _seed(0), _nodes(0) {}
+
+    /**
+     * Initializes a solver with the unit and constants JSON of the game.
+     *
+     * @param boardMembers  the contents of boardMember.json
+     * @param constants     the contents of constants.json
+     * @param threads       the number of worker threads
+     * @return true if initialization was successful.
+     */
+    bool init(const std::shared_ptr<cugl::JsonValue>& boardMembers, const std::shared_ptr<cugl::JsonValue>& constants, int threads = 4);
+
+#pragma mark -
+#pragma mark Static Constructors
+    /**
+     * Returns a newly allocated solver.
+     *
+     * @param boardMembers  the contents of boardMember.json
+     * @param constants     the contents of constants.json
+     * @param threads       the number of worker threads
+     * @return a newly allocated solver.
+     */
+    static std::shared_ptr<Solver> alloc(const std::shared_ptr<cugl::JsonValue>& boardMembers, const std::shared_ptr<cugl::JsonValue>& constants, int threads = 4) {
+        std::shared_ptr<Solver> result = std::make_shared<Solver>();
+        return (result->init(boardMembers, constants, threads) ? result : nullptr);
+    }
+
+#pragma mark -
+#pragma mark Solving
+    /**
+     * Sets the maximum number of boards to search per level.
+     *
+     * When the limit is reached the search stops early and the result is
+     * marked as incomplete. The best score found so far is still reported,
+     * and the fewest swaps are exact if they are within the turns that were
+     * fully searched. A limit of 0 searches every board.
+     */
+    void setNodeLimit(long long limit) { _nodeLimit = limit; }
+
+    /**
+     * Solves a level for one seed of the random units.
+     *
+     * The seed is only meaningful to the solver. It does not match the
+     * random number generator of Simulation or of the game.
+     *
+     * @param level the level to solve
+     * @param seed  the seed that decides every random unit
+     * @return the outcome of the search
+     */
+    Result solve(const std::shared_ptr<Level>& level, uint64_t seed = 0);
+
+private:
+#pragma mark -
+#pragma mark Rules
+    /**
+     * Copies the layers of a level and precomputes the attack bitboards.
+     *
+     * @return false if the level is too large to solve.
+     */
+    bool loadLevel(const std::shared_ptr<Level>& level);
+
+    /**
+     * Returns the starting board of the level for the current seed.
+     */
+    State initialState() const;
+
+    /**
+     * Places a unit on a square of the board.
+     */
+    void setUnit(State& state, int index, int subtype, int color, int direction, int needed) const;
+
+    /**
+     * Replaces a killed unit with the unit from the next layer.
+     */
+    void respawn(State& state, int index) const;
+
+    /**
+     * Returns the squares attacked by the unit on a square (see Board::resolveAttack).
+     */
+    uint64_t resolveAttack(const State& state, int index) const;
+
+    /**
+     * Returns the squares that the unit on a square may attack.
+     */
+    uint64_t hostileMask(const State& state, int index) const {
+        return state.interactableMask & (~state.colorMasks[state.colors[index]] | state.kingMask);
+    }
+
+    /**
+     * Returns the bitboard of a subtype facing a direction from a square.
+     */
+    int maskIndex(int subtype, int direction, int index) const {
+        return (subtype * 4 + direction) * _squares + index;
+    }
+
+    /**
+     * Returns a deterministic random number in [0, 1) for a square and depth.
+     */
+    double draw(int index, int depth, int salt) const;
+
+    /**
+     * Returns a hash of a board together with the remaining turns.
+     */
+    uint64_t hash(const State& state, int turns) const;
+
+    /**
+     * Returns whether the search has searched more boards than the node limit.
+     */
+    bool isOverLimit() const { return _nodeLimit > 0 && _nodes > _nodeLimit; }
+
+#pragma mark -
+#pragma mark Search
+    /**
+     * Returns whether a swap from one square to an adjacent one is legal.
+     */
+    bool isLegalSwap(const State& state, int from, int to) const;
+
+    /**
+     * Applies a swap, resolving the attack and every respawn.
+     *
+     * @param state     the board, modified in place
+     * @param from      the selected square
+     * @param to        the square swapped with
+     * @param score     set to the score if the swap kills the king
+     * @return 1 if the king was killed, -1 if the king survived an attack,
+     *         and 0 if the king was not attacked.
+     */
+    int applySwap(State& state, int from, int to, int& score) const;
+
+    /**
+     * Returns the legal swaps of a board as (from, to) pairs.
+     */
+    vector<std::pair<int, int>> legalSwaps(const State& state) const;
+
+    /**
+     * Returns the best outcome reachable from a board with the remaining turns.
+     */
+    Outcome search(Worker& worker, const State& state, int turns);
+
+    /**
+     * Returns the outcome of a swap followed by the best play.
+     */
+    Outcome searchSwap(Worker& worker, const State& state, int from, int to, int turns);
+};
+
+#endif /* SWSolver_h */
@@ -0,0 +1,64 @@
+//
+//  SWSpriteSheetNode.cpp
+//  SwitchWitch
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include "SWSpriteSheetNode.h"
+using namespace cugl;
+
+#pragma mark Sheets
+/**
+ * Replaces the sprite sheet of this node and shows its first frame.
+ *
+ * The node is resized to the frames of the new sheet. Its position,
+ * anchor, scale and children are left alone. The corners of the frame and
+ * of the mesh drawn from it are moved in place, and only the texture
+ * coordinates are recomputed, so nothing is allocated. A node with an
+ * antialiased fringe, or one that has not been drawn yet, has its mesh
+ * rebuilt on the next draw instead.
+ *
+ * @param texture   the sprite sheet, a single row of frames
+ * @param frames    the number of frames in the sheet
+ */
+void SpriteSheetNode::setSheet(const std::shared_ptr<Texture>& texture, int frames) {
+    if (texture == _texture && frames == _size) {
+        setFrame(0);
+        return;
+    }
+    Size size = texture->getSize();
+    size.width /= frames;
+    Size frame = _polygon.getBounds().size;
+    Size content = getContentSize();
+    _cols = frames;
+    _size = frames;
+    _frame = 0;
+    _bounds.origin.setZero();
+    _bounds.size = size;
+    // The first frame of a single row starts at the origin of the texture
+    _offset.setZero();
+    _texture = texture;
+    if (frame.width <= 0 || frame.height <= 0 || content.width <= 0 || content.height <= 0) {
+        setPolygon(Rect(Vec2::ZERO, size));
+        return;
+    }
+
+    // The frame is a rectangle at the origin, so scaling its corners resizes it
+    for (auto it = _polygon.vertices.begin(); it != _polygon.vertices.end(); ++it) {
+        it->x *= size.width / frame.width;
+        it->y *= size.height / frame.height;
+    }
+    // Skips the TexturedNode override, which throws the mesh away
+    SceneNode::setContentSize(size);
+    if (!_rendered || _fringe > 0) {
+        clearRenderData();
+        return;
+    }
+    for (auto it = _mesh.vertices.begin(); it != _mesh.vertices.end(); ++it) {
+        it->position.x *= size.width / content.width;
+        it->position.y *= size.height / content.height;
+    }
+    // A shift of nothing recomputes the texture coordinates of the mesh in place
+    shiftTexture(0, 0);
+}
@@ -0,0 +1,68 @@
+//
+//  SWSpriteSheetNode.h
+//  SwitchWitch
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#ifndef SWSpriteSheetNode_h
+#define SWSpriteSheetNode_h
+
+#include <cugl/cugl.h>
+
+/**
+ * A filmstrip whose sprite sheet can be replaced in place.
+ *
+ * A plain SpriteNode is tied to the sheet it was created with, so showing a
+ * different animation used to mean allocating a new node. This node keeps
+ * its place in the scene graph, its transform and its children, and only
+ * swaps the texture, the frame size and the frame count. All sheets are a
+ * single row of frames, as every unit animation in the game is.
+ */
+class SpriteSheetNode : public cugl::scene2::SpriteNode
+{
+public:
+#pragma mark Constructors
+    /**
+     * Creates an uninitialized node.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a node on the
+     * heap, use one of the static constructors instead.
+     */
+    SpriteSheetNode() : SpriteNode() {
+        _classname = "SpriteSheetNode";
+    }
+
+#pragma mark -
+#pragma mark Static Constructors
+    /**
+     * Returns a newly allocated node showing the first frame of a sheet.
+     *
+     * @param texture   the sprite sheet, a single row of frames
+     * @param frames    the number of frames in the sheet
+     * @return a newly allocated node showing the first frame of a sheet.
+     */
+    static std::shared_ptr<SpriteSheetNode> alloc(const std::shared_ptr<cugl::Texture>& texture, int frames) {
+        std::shared_ptr<SpriteSheetNode> result = std::make_shared<SpriteSheetNode>();
+        return (result->initWithSprite(texture, 1, frames) ? result : nullptr);
+    }
+
+#pragma mark -
+#pragma mark Sheets
+    /**
+     * Replaces the sprite sheet of this node and shows its first frame.
+     *
+     * The node is resized to the frames of the new sheet. Its position,
+     * anchor, scale and children are left alone. The corners of the frame and
+     * of the mesh drawn from it are moved in place, and only the texture
+     * coordinates are recomputed, so nothing is allocated. A node with an
+     * antialiased fringe, or one that has not been drawn yet, has its mesh
+     * rebuilt on the next draw instead.
+     *
+     * @param texture   the sprite sheet, a single row of frames
+     * @param frames    the number of frames in the sheet
+     */
+    void setSheet(const std::shared_ptr<cugl::Texture>& texture, int frames);
+};
+
+#endif /* SWSpriteSheetNode_h */
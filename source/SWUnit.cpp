@@ -7,6 +7,9 @@
 //
 
 #include "SWUnit.hpp"
+#include "SWUnitTextureSet.hpp"
+#include <deque>
+#include <mutex>
 using namespace cugl;
 
 //void Unit::initalizeTextureMap(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> textures, std::string subtype, Unit::Color color) {
@@ -25,15 +28,16 @@ using namespace cugl;
  * @param direction the direction the unit is facing
  * @return true if initialization was successful.
  */
-bool Unit::init(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> textures, const std::string subtype, const Color color, cugl::Vec2 direction, bool moveable, bool special, int unitsNeededToKill)
+bool Unit::init(const std::shared_ptr<UnitTextureSet>& textures, const std::string subtype, const Color color, cugl::Vec2 direction, bool moveable, bool special, int unitsNeededToKill)
 {
     this->_subtype = subtype;
+    this->_subtypeId = subTypeToId(subtype);
     this->_color = color;
     this->_direction = direction;
     this->_is_special_unit = special;
     this->_moveable = moveable;
     this->_unitsNeededToKill = unitsNeededToKill;
-    this->_textureMap = textures;
+    this->_textures = textures;
     this->_hasBeenHit = false;
 //    this->_time_since_last_frame = fmod(((float) rand() / (RAND_MAX)), this->_time_per_frame); // Initalize a random animation offset
 //    initalizeTextureMap(textures, subtype, color);
@@ -49,9 +53,10 @@ bool Unit::init(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>>
  * @param direction the direction the unit is facing
  * @return true if initialization was successful.
  */
-bool Unit::init(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> textures, const std::string subtype, const Color color, vector<cugl::Vec2> basicAttack, vector<cugl::Vec2> specialAttack, cugl::Vec2 direction, bool moveable, bool special, int unitsNeededToKill)
+bool Unit::init(const std::shared_ptr<UnitTextureSet>& textures, const std::string subtype, const Color color, vector<cugl::Vec2> basicAttack, vector<cugl::Vec2> specialAttack, cugl::Vec2 direction, bool moveable, bool special, int unitsNeededToKill)
 {
     this->_subtype = subtype;
+    this->_subtypeId = subTypeToId(subtype);
     this->_color = color;
     this->_basicAttack = basicAttack;
     this->_direction = direction;
@@ -59,60 +64,23 @@ bool Unit::init(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>>
     this->_moveable = moveable;
     this->_is_special_unit = special;
     this->_unitsNeededToKill = unitsNeededToKill;
-    this->_textureMap = textures;
+    this->_textures = textures;
     this->_hasBeenHit = false;
 //    this->_time_since_last_frame = fmod(((float) rand() / (RAND_MAX)), this->_time_per_frame); // Initalize a random animation offset
 //    initalizeTextureMap(textures, subtype, color);
     return true;
 }
 
-std::shared_ptr<cugl::Texture> Unit::getTextureForUnit(const std::string subtype, const Color color, const State state) {
-    std::string colorString = Unit::colorToString(color);
-    std::string defaultTextureName = subtype + "-" + colorString;
-    std::string idleTextureName = subtype + "-idle-" + colorString;
-    std::string hitTextureName = subtype + "-hit-" + colorString;
-    // <Hedy>
-    std::string selectedStartTextureName = subtype + "-" + colorString + "-selected-start";
-    std::string selectedEndTextureName = subtype + "-" + colorString + "-selected-end";
-    // <Hedy/>
-    std::string targetedTextureName = subtype + "-target-" + colorString;
-//    CULog("targetedTexture: %s", targetedTextureName.c_str());
-    std::string attackTextureName = subtype + "-attack-" + colorString;
-    std::string dyingTextureName = subtype + "-dying-" + colorString;
-    std::string respawningTextureName = subtype + "-respawning-" + colorString;
-    switch (state) {
-        case IDLE:
-            return _textureMap.count(idleTextureName) > 0 ? _textureMap.at(idleTextureName) : _textureMap.at(defaultTextureName);
-        case PROTECTED:
-            return _textureMap.count(idleTextureName) > 0 ? _textureMap.at(idleTextureName) : _textureMap.at(defaultTextureName);
-        case HIT:
-            return _textureMap.count(hitTextureName) > 0 ? _textureMap.at(hitTextureName)
-            : _textureMap.at(defaultTextureName);
-        // <Hedy>
-        case SELECTED_START:
-            return _textureMap.count(selectedStartTextureName) > 0 ? _textureMap.at(selectedStartTextureName) : _textureMap.at(defaultTextureName);
-        case SELECTED_END:
-            return _textureMap.count(selectedEndTextureName) > 0 ? _textureMap.at(selectedEndTextureName) : _textureMap.at(defaultTextureName);
-        // <Hedy/>
-        case TARGETED:
-            return _textureMap.count(targetedTextureName) > 0 ? _textureMap.at(targetedTextureName) : _textureMap.at(defaultTextureName);
-        case ATTACKING_SPECIAL:
-            return _textureMap.count(attackTextureName) > 0 ? _textureMap.at(attackTextureName) : _textureMap.at(defaultTextureName);
-        case ATTACKING_BASIC:
-            return _textureMap.at(defaultTextureName);
-        case DYING:
-            return _textureMap.count(dyingTextureName) > 0 ? _textureMap.at(dyingTextureName) : _textureMap.at(defaultTextureName);
-        case DEAD:
-            return _textureMap.at("transparent");
-        case RESPAWNING:
-            return _textureMap.count(respawningTextureName) > 0 ? _textureMap.at(respawningTextureName) : _textureMap.at(defaultTextureName);
-        default:
-            return _textureMap.at(defaultTextureName);
-    }
+/**
+ * Returns the texture for this unit in the given state.
+ *
+ * @param state the unit state
+ * @return the texture for the state
+ */
+const std::shared_ptr<cugl::Texture>& Unit::getTextureForState(State state) {
+    return _textures->getTexture(_subtypeId, _color, state);
 }
 
-
-
 void Unit::setState(State s) {
     _state = s;
     //<Hedy>
@@ -120,32 +88,29 @@ void Unit::setState(State s) {
     // moving animation is a special case
     completedAnimation = false;
     // <Hedy/>
-    std::shared_ptr<scene2::SpriteNode> newNode;
-    int framesInAnimation = animationFrameCounts[s];
+    const UnitTextureSet::Clip& clip = _textures->getClip(_subtypeId, _color, s);
+    int framesInAnimation = clip.frames;
 //    if (_subtype == "king" && s == DYING) framesInAnimation = 5; // King dying animation is a special case
-    if (s == ATTACKING_BASIC || (_subtype == "basic" && s == ATTACKING_SPECIAL)) {
-        framesInAnimation = 1; // Basic attack animation is a special case
-        _initialPos = _viewNode->getPosition();
+    if (s == ATTACKING_BASIC || (_subtypeId == BASIC && s == ATTACKING_SPECIAL)) {
+        _initialPos = _viewNode->getPosition(); // Basic attack animation is a special case
     }
-    newNode = scene2::SpriteNode::alloc(getTextureForUnit(this->_subtype, this->_color, s), 1, framesInAnimation);
+    showClip(clip.texture, framesInAnimation);
     if (s == State::HIT) _hasBeenHit = true;
     if (s == State::PROTECTED) {
-        auto shieldNode = scene2::SpriteNode::alloc(_textureMap.at("shield"),1,1);
-//            std::shared_ptr<cugl::scene2::AnchoredLayout> unitLayout = scene2::AnchoredLayout::alloc();
-        shieldNode->setScale(1 / _viewNode->getScale());
-        shieldNode->setAnchor(Vec2::ANCHOR_CENTER);
-        shieldNode->setPosition(Vec2(newNode->getWidth() / 2.0f, newNode->getHeight() / 2.0f));
-//            newNode->setAnchor(Vec2::ANCHOR_CENTER);
-        newNode->addChild(shieldNode);
-//            unitLayout->add
-            
+        if (_shieldNode == nullptr) {
+            _shieldNode = scene2::PolygonNode::allocWithTexture(_textures->getShield());
+            _shieldNode->setAnchor(Vec2::ANCHOR_CENTER);
+        }
+        _shieldNode->setScale(1 / _viewNode->getScale());
+        _shieldNode->setPosition(Vec2(_viewNode->getContentWidth() / 2.0f, _viewNode->getContentHeight() / 2.0f));
+        _viewNode->addChild(_shieldNode);
     }
     if (s == IDLE) { // Speed up the animation if part of a chain
         _time_per_animation = DEFAULT_TIME_PER_ANIMATION;
         _chainCount = 0;
 //        _doAnimate = false;
     } else {
-        if (_subtype != "king") {
+        if (_subtypeId != KING) {
             _time_per_animation = std::max(0.2f, DEFAULT_TIME_PER_ANIMATION - _chainCount * ANIMATION_SPEEDUP_FACTOR);
         }
 //        _doAnimate = true;
@@ -158,10 +123,8 @@ void Unit::setState(State s) {
     _time_since_last_flash = 0.0f;
     _time_since_last_frame = 0.0f;
     _time_since_start_animation = 0.0f;
-    newNode->setAnchor(Vec2::ANCHOR_CENTER + Vec2(0, -0.2));
-    newNode->setVisible(true);
-//    newNode->setLayout()
-    _viewNode = newNode;
+    _viewNode->setAnchor(Vec2::ANCHOR_CENTER + Vec2(0, -0.2));
+    _viewNode->setVisible(true);
     }
 }
 
@@ -176,59 +139,68 @@ void Unit::setSelectedEnd(std::shared_ptr<cugl::Texture> texture)
 {
     _state = SELECTED_END;
     completedAnimation = false;
-    std::shared_ptr<scene2::SpriteNode> newNode;
-    int framesInAnimation = animationFrameCounts[SELECTED_END];
-    newNode = scene2::SpriteNode::alloc(texture, 1, framesInAnimation);
+    int framesInAnimation = _textures->getClip(_subtypeId, _color, SELECTED_END).frames;
+    showClip(texture, framesInAnimation);
     _time_per_frame = _time_per_animation / framesInAnimation;
     _time_since_last_flash = 0.0f;
     _time_since_last_frame = 0.0f;
     _time_since_start_animation = 0.0f;
-    newNode->setAnchor(Vec2::ANCHOR_CENTER + Vec2(0, -0.2));
-    newNode->setVisible(true);
-    _viewNode = newNode;
+    _viewNode->setAnchor(Vec2::ANCHOR_CENTER + Vec2(0, -0.2));
+    _viewNode->setVisible(true);
 };
 //<Hedy/>
 
 /**
- * Retuns the angle between the direction of the unit and the default direction in radians.
+ * Shows an animation on the view of this unit, starting at its first frame.
  *
- * @returns the angle between direction and default direction
+ * The view keeps its place in the scene graph and its transform, and only
+ * its sprite sheet is swapped. It is created on the first call.
+ *
+ * @param texture   the sprite sheet of the animation
+ * @param frames    the number of frames in the sheet
  */
-float Unit::getAngleBetweenDirectionAndDefault()
-{
-    int negativeY = _direction.y < 0 ? -1 : 1;
-    return negativeY * acosf(Vec2::dot(_direction, getDefaultDirection()) / (_direction.length() * getDefaultDirection().length()));
+void Unit::showClip(const std::shared_ptr<Texture>& texture, int frames) {
+    std::shared_ptr<SpriteSheetNode> sheet = std::dynamic_pointer_cast<SpriteSheetNode>(_viewNode);
+    if (sheet == nullptr) {
+        // Views set from outside, as in the level editor, cannot swap their sheet
+        sheet = SpriteSheetNode::alloc(texture, frames);
+        if (_viewNode != nullptr) {
+            sheet->setScale(_viewNode->getScale());
+            sheet->setPosition(_viewNode->getPosition());
+        }
+        _viewNode = sheet;
+        return;
+    }
+    // A new view would have come without the shield or the hover effects
+    sheet->removeAllChildren();
+    sheet->setSheet(texture, frames);
+    sheet->setColor(Color4::WHITE);
 }
 
 /**
- * Returns a list of vec2 representing all attacks in a basic attack
- * allready rotated based on direction the unit is facing.
- * The direction of attacks is based on the units default direction.
+ * Retuns the angle between the direction of the unit and the default direction in radians.
  *
- * @return unit's basic attack pattern already rotated.
+ * @returns the angle between direction and default direction
  */
-vector<cugl::Vec2> Unit::getBasicAttackRotated()
+float Unit::getAngleBetweenDirectionAndDefault()
 {
-    vector<cugl::Vec2> result = _basicAttack;
-    std::transform(result.begin(), result.end(), result.begin(), [&](Vec2 vec)
-                   { vec.rotate(getAngleBetweenDirectionAndDefault()); return Vec2(round(vec.x), round(vec.y)); });
-
-    return result;
+    int negativeY = _direction.y < 0 ? -1 : 1;
+    return negativeY * acosf(Vec2::dot(_direction, getDefaultDirection()) / (_direction.length() * getDefaultDirection().length()));
 }
 
 /**
- * Returns a list of vec2 representing all attacks in a special attack
- * allready rotated based on direction the unit is facing.
- * The direction of attacks is based on the units default direction.
+ * Returns an attack pattern of this unit from the shared rotated pattern
+ * table. A subtype missing from the table is added with the patterns of
+ * this unit. A subtype already in the table keeps its patterns.
  *
- * @return unit's special attack pattern already rotated.
+ * @param special whether to return the special attack instead of the basic one
  */
-vector<cugl::Vec2> Unit::getSpecialAttackRotated()
+const vector<Unit::AttackOffset>& Unit::getRotatedAttack(bool special)
 {
-    vector<cugl::Vec2> result = _specialAttack;
-    std::transform(result.begin(), result.end(), result.begin(), [&](Vec2 vec)
-                   { vec.rotate(getAngleBetweenDirectionAndDefault()); return Vec2(round(vec.x), round(vec.y)); });
-    return result;
+    const vector<AttackOffset>& attack = getRotatedAttack(_subtypeId, directionToId(_direction), special);
+    if (!attack.empty() || (special ? _specialAttack : _basicAttack).empty()) return attack;
+    setSubTypeAttacks(_subtypeId, _basicAttack, _specialAttack);
+    return getRotatedAttack(_subtypeId, directionToId(_direction), special);
 }
 
 void Unit::update(float dt) {
@@ -247,7 +219,7 @@ void Unit::update(float dt) {
             break;
         }
         case ATTACKING_SPECIAL: {
-            if (_subtype == "basic") { // basic units have a special attack effect
+            if (_subtypeId == BASIC) { // basic units have a special attack effect
                 float timeBeforeMovement = _time_per_animation / 4.0f; // begin the movement effect after 1/4 animation is complete
                 if (_time_since_start_animation <= _time_per_animation / 2.0f && _time_since_start_animation >= timeBeforeMovement) {
                     Vec2 newPos = _initialPos + _direction * _basicAttackDistance * ((_time_since_start_animation - timeBeforeMovement) / timeBeforeMovement);
@@ -303,6 +275,125 @@ void Unit::update(float dt) {
 //    }
 }
 
+/**
+ * Returns the lock of the subtype names and the rotated pattern table.
+ *
+ * Units are made by asset loader threads and solver threads as well as the
+ * main thread, and any of them may intern a subtype.
+ */
+static std::mutex& subTypeMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+/**
+ * Returns the table of interned subtype names, indexed by subtype id.
+ *
+ * A deque never moves its elements when it grows, so the names handed out
+ * by Unit::idToSubType stay valid as subtypes are added.
+ */
+static std::deque<std::string>& subTypeNames() {
+    // The built-in subtypes must be listed in the same order as Unit::SubType.
+    static std::deque<std::string> names = { "basic", "random", "empty", "king", "diagonal" };
+    return names;
+}
+
+int Unit::subTypeToId(const std::string& subtype) {
+    std::lock_guard<std::mutex> lock(subTypeMutex());
+    std::deque<std::string>& names = subTypeNames();
+    for (int i = 0; i < names.size(); i++) {
+        if (names[i] == subtype) return i;
+    }
+    names.push_back(subtype);
+    return (int)names.size() - 1;
+}
+
+const std::string& Unit::idToSubType(int id) {
+    std::lock_guard<std::mutex> lock(subTypeMutex());
+    return subTypeNames().at(id);
+}
+
+void Unit::loadSubTypes(const std::shared_ptr<cugl::JsonValue>& json) {
+    for (int i = 0; i < json->size(); i++) {
+        std::shared_ptr<JsonValue> unit = json->get(i);
+        int subtype = subTypeToId(unit->key());
+        auto readAttack = [&](const char* key) {
+            vector<Vec2> attack;
+            std::shared_ptr<JsonValue> list = unit->get(key);
+            if (list == nullptr) return attack;
+            for (const auto& offset : list->children()) {
+                attack.push_back(Vec2(offset->get(0)->asFloat(), offset->get(1)->asFloat()));
+            }
+            return attack;
+        };
+        setSubTypeAttacks(subtype, readAttack("basic-attack"), readAttack("special-attack"));
+    }
+}
+
+int Unit::getSubTypeCount() {
+    std::lock_guard<std::mutex> lock(subTypeMutex());
+    return (int)subTypeNames().size();
+}
+
+/** The attack patterns of one subtype, rotated to each direction */
+struct RotatedAttacks {
+    /** The basic [0] and special [1] patterns, indexed by direction id */
+    vector<Unit::AttackOffset> attacks[4][2];
+    /** Whether the patterns were set. They never change afterwards. */
+    bool isSet = false;
+};
+
+/**
+ * Returns the rotated pattern table, indexed by subtype id.
+ *
+ * A deque never moves its elements when it grows, so the patterns handed
+ * out by Unit::getRotatedAttack stay valid as subtypes are added.
+ */
+static std::deque<RotatedAttacks>& rotatedAttackTable() {
+    static std::deque<RotatedAttacks> table;
+    return table;
+}
+
+/**
+ * Returns an attack pattern rotated from the default direction to another
+ * direction, rounded to whole squares.
+ */
+static vector<Unit::AttackOffset> rotateAttack(const vector<Vec2>& attack, Vec2 direction) {
+    int negativeY = direction.y < 0 ? -1 : 1;
+    float angle = negativeY * acosf(Vec2::dot(direction, Unit::getDefaultDirection()) / (direction.length() * Unit::getDefaultDirection().length()));
+    vector<Unit::AttackOffset> result;
+    result.reserve(attack.size());
+    for (Vec2 vec : attack) {
+        vec.rotate(angle);
+        result.push_back({ (int)round(vec.x), (int)round(vec.y) });
+    }
+    return result;
+}
+
+void Unit::setSubTypeAttacks(int subtype, const vector<Vec2>& basicAttack, const vector<Vec2>& specialAttack) {
+    if (subtype < 0) return;
+    std::lock_guard<std::mutex> lock(subTypeMutex());
+    std::deque<RotatedAttacks>& table = rotatedAttackTable();
+    while ((int)table.size() <= subtype) {
+        table.emplace_back();
+    }
+    // Patterns already handed out may be in use on another thread
+    if (table[subtype].isSet) return;
+    for (int direction = 0; direction < 4; direction++) {
+        table[subtype].attacks[direction][0] = rotateAttack(basicAttack, idToDirection(direction));
+        table[subtype].attacks[direction][1] = rotateAttack(specialAttack, idToDirection(direction));
+    }
+    table[subtype].isSet = true;
+}
+
+const vector<Unit::AttackOffset>& Unit::getRotatedAttack(int subtype, int direction, bool special) {
+    static const vector<AttackOffset> none;
+    std::lock_guard<std::mutex> lock(subTypeMutex());
+    const std::deque<RotatedAttacks>& table = rotatedAttackTable();
+    if (subtype < 0 || subtype >= (int)table.size() || !table[subtype].isSet) return none;
+    return table[subtype].attacks[direction < 0 ? 0 : direction][special ? 1 : 0];
+}
+
 bool Unit::animationShouldLoop(State s) {
     switch (s) {
         case IDLE:
@@ -11,12 +11,15 @@
 
 #include <cugl/cugl.h>
 #include "SWSquareOccupant.hpp"
+#include "SWSpriteSheetNode.h"
 #include <math.h>
 #include <algorithm>
 #include <unordered_map>
 
 using namespace cugl;
 
+class UnitTextureSet;
+
 /**
  * Model class representing an unit.
  */
@@ -50,6 +53,31 @@ public:
         PROTECTED,
         RESPAWNING
     };
+
+    /** The number of states a unit can take */
+    static const int NUM_STATES = RESPAWNING + 1;
+
+    /** The square offset of one attack, rotated to the direction of a unit */
+    struct AttackOffset {
+        int x;
+        int y;
+    };
+
+    /**
+     * Ids of the subtypes that gameplay code treats specially.
+     *
+     * These are the first entries of the subtype table (see {@link subTypeToId}).
+     * Every other subtype listed in boardMember.json is assigned the next
+     * free id when {@link loadSubTypes} is called.
+     */
+    enum SubType
+    {
+        BASIC,
+        RANDOM,
+        EMPTY,
+        KING,
+        DIAGONAL
+    };
     
     /** True if the unit has completed the animation cycle of its current state */
     bool completedAnimation = false;
@@ -66,6 +94,9 @@ private:
     /** The name of the unit subtype*/
     std::string _subtype;
 
+    /** The interned id of the unit subtype */
+    int _subtypeId;
+
     /** The basic attacks of this unit*/
     vector<cugl::Vec2> _basicAttack;
 
@@ -81,11 +112,14 @@ private:
     /** The state of this unit. */
     State _state = IDLE;
     
-    /** This map stores a texture for every state the unit can take */
-    unordered_map<std::string, shared_ptr<Texture>> _textureMap;
+    /** The shared texture set that stores a texture for every state the unit can take */
+    shared_ptr<UnitTextureSet> _textures;
 
-    /** The Sprite-Node that represents this unit */
+    /** The Sprite-Node that represents this unit, kept across state changes */
     shared_ptr<cugl::scene2::SpriteNode> _viewNode;
+
+    /** The shield drawn over the unit while it is protected, created when first needed */
+    shared_ptr<cugl::scene2::PolygonNode> _shieldNode;
     
     /** The elapsed time since the sprite frame was incremented */
     float _time_since_last_frame = 0.0f;
@@ -133,22 +167,6 @@ private:
     
     /** The distance the basic unit's attack should move the sprite in attacking direction */
     float _basicAttackDistance = 50.0f;
-    
-    std::unordered_map<State, int, std::hash<int>> animationFrameCounts = {
-        { IDLE, 2 },
-        { HIT, 1 },
-        //<Hedy>
-        {SELECTED_START, 5},
-        {SELECTED_END, 5},
-        //<Hedy/>
-        { TARGETED, 4 },
-        { ATTACKING_SPECIAL, 18 },
-        { ATTACKING_BASIC, 2 },
-        { DYING, 5 },
-        { DEAD, 1 },
-        { PROTECTED, 2 },
-        { RESPAWNING, 1 }
-    };
 
 #pragma mark Constructors
 public:
@@ -176,12 +194,45 @@ public:
      * @param direction the direction the unit is facing
      * @return true if initialization was successful.
      */
-    bool init(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> textures, const std::string subtype, const Color color, vector<cugl::Vec2> basicAttack, vector<cugl::Vec2> specialAttack, cugl::Vec2 direction, bool moveable, bool special = false, int unitsNeededToKill = 0);
+    bool init(const std::shared_ptr<UnitTextureSet>& textures, const std::string subtype, const Color color, vector<cugl::Vec2> basicAttack, vector<cugl::Vec2> specialAttack, cugl::Vec2 direction, bool moveable, bool special = false, int unitsNeededToKill = 0);
 
 
-    bool init(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> textures, const std::string subtype, const Color color, cugl::Vec2 direction, bool moveable, bool special, int unitsNeededToKill);
+    bool init(const std::shared_ptr<UnitTextureSet>& textures, const std::string subtype, const Color color, cugl::Vec2 direction, bool moveable, bool special, int unitsNeededToKill);
     
-    std::shared_ptr<cugl::Texture> getTextureForUnit(const std::string subtype, const Color color, const State state);
+    /**
+     * Returns the texture for this unit in the given state.
+     *
+     * @param state the unit state
+     * @return the texture for the state
+     */
+    const std::shared_ptr<cugl::Texture>& getTextureForState(State state);
+
+    /**
+     * Returns an attack pattern of this unit from the shared rotated pattern
+     * table. A subtype missing from the table is added with the patterns of
+     * this unit.
+     *
+     * @param special whether to return the special attack instead of the basic one
+     */
+    const vector<AttackOffset>& getRotatedAttack(bool special);
+
+    /**
+     * Shows an animation on the view of this unit, starting at its first frame.
+     *
+     * The view keeps its place in the scene graph and its transform, and only
+     * its sprite sheet is swapped. It is created on the first call.
+     *
+     * @param texture   the sprite sheet of the animation
+     * @param frames    the number of frames in the sheet
+     */
+    void showClip(const std::shared_ptr<cugl::Texture>& texture, int frames);
+
+    /**
+     * Returns the shared texture set of this unit.
+     *
+     * @return the unit's texture set
+     */
+    const std::shared_ptr<UnitTextureSet>& getTextureSet() const { return _textures; }
     
 //    void initalizeTextureMap(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> textures, const std::string subtype, const Color color);
 #pragma mark -
@@ -195,7 +246,7 @@ public:
      * @param direction the direction the unit is facing
      * @return a newly allocated Unit.
      */
-    static std::shared_ptr<Unit>alloc(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> textures, const std::string subtype, const Color color, vector<cugl::Vec2> basicAttack, vector<cugl::Vec2> specialAttack, cugl::Vec2 direction, bool moveable, bool special = false, int unitsNeededToKill = 0) {
+    static std::shared_ptr<Unit>alloc(const std::shared_ptr<UnitTextureSet>& textures, const std::string subtype, const Color color, vector<cugl::Vec2> basicAttack, vector<cugl::Vec2> specialAttack, cugl::Vec2 direction, bool moveable, bool special = false, int unitsNeededToKill = 0) {
         std::shared_ptr<Unit> result = std::make_shared<Unit>();
         return (result->init(textures, subtype, color, basicAttack, specialAttack, direction, moveable, special, unitsNeededToKill) ? result : nullptr);
     }
@@ -207,7 +258,7 @@ public:
      * @param direction the direction the unit is facing
      * @return a newly allocated Unit.
      */
-    static std::shared_ptr<Unit>alloc(std::unordered_map<std::string, std::shared_ptr<cugl::Texture>> textures, const std::string subtype, const Color color, cugl::Vec2 direction, bool moveable, bool special = false, int unitsNeededToKill = 0) {
+    static std::shared_ptr<Unit>alloc(const std::shared_ptr<UnitTextureSet>& textures, const std::string subtype, const Color color, cugl::Vec2 direction, bool moveable, bool special = false, int unitsNeededToKill = 0) {
         std::shared_ptr<Unit> result = std::make_shared<Unit>();
         return (result->init(textures, subtype, color, direction, moveable, special, unitsNeededToKill) ? result : nullptr);
     }
@@ -236,24 +287,142 @@ public:
         return vector<cugl::Vec2>{Vec2::UNIT_X, Vec2::UNIT_X * -1, Vec2::UNIT_Y, Vec2::UNIT_Y * -1};
     }
 
+    /**
+     * Returns the index of a direction in {@link getAllPossibleDirections}.
+     *
+     * This is the compact representation used by the packed board arrays.
+     *
+     * @param d the direction
+     * @returns the index of the direction, or -1 if it is not a cardinal direction
+     */
+    static int directionToId(cugl::Vec2 d)
+    {
+        if (d == Vec2(1,0)) {return 0;}
+        else if (d == Vec2(-1,0)) {return 1;}
+        else if (d == Vec2(0,1)) {return 2;}
+        else if (d == Vec2(0,-1)) {return 3;}
+        return -1;
+    }
+
+    /**
+     * Returns the direction for an index produced by {@link directionToId}.
+     *
+     * @param id the index of the direction
+     * @returns the direction
+     */
+    static cugl::Vec2 idToDirection(int id)
+    {
+        return id >= 0 && id < 4 ? getAllPossibleDirections()[id] : getDefaultDirection();
+    }
+
+    /**
+     * Returns the integer id of a subtype name.
+     *
+     * Names are interned the first time they are seen, so the id of a
+     * subtype is stable for the lifetime of the program. This is safe to
+     * call from any thread. The built-in
+     * subtypes "basic", "random", "empty" and "king" always have the ids
+     * 0 to 3, in that order.
+     *
+     * @param subtype the name of the subtype
+     * @returns the id of the subtype
+     */
+    static int subTypeToId(const std::string& subtype);
+
+    /**
+     * Returns the subtype name for an id produced by {@link subTypeToId}.
+     *
+     * @param id the id of the subtype
+     * @returns the name of the subtype
+     */
+    static const std::string& idToSubType(int id);
+
+    /**
+     * Returns whether units of a subtype can be swapped.
+     *
+     * Every unit but a king can be moved. All code that makes or restores a
+     * unit uses this, so that a unit means the same thing wherever it is made.
+     *
+     * @param subtype the id of the subtype
+     */
+    static bool isMoveableSubType(int subtype) { return subtype != KING; }
+
+    /**
+     * Returns whether units of a subtype are special units.
+     *
+     * Basic units and kings are not special. All code that makes or restores
+     * a unit uses this, so that a unit means the same thing wherever it is made.
+     *
+     * @param subtype the id of the subtype
+     */
+    static bool isSpecialSubType(int subtype) { return subtype != BASIC && subtype != RANDOM && subtype != KING; }
+
+    /**
+     * Interns every subtype defined in the "unit" object of boardMember.json,
+     * and fills the rotated pattern table with their attacks.
+     *
+     * Subtypes are assigned ids in file order after the built-in {@link SubType}
+     * ids. Calling this more than once is harmless. Call it on the main thread
+     * before units are made elsewhere, so that every subtype has its patterns
+     * from boardMember.json.
+     *
+     * @param json the "unit" object of boardMember.json
+     */
+    static void loadSubTypes(const std::shared_ptr<cugl::JsonValue>& json);
+
+    /**
+     * Returns the number of interned subtypes.
+     */
+    static int getSubTypeCount();
+
+    /**
+     * Sets the attack patterns of a subtype in the shared rotated pattern table.
+     *
+     * The patterns are rotated to each of the four directions here, once, so
+     * that looking up the attacks of a unit needs no floating point.
+     * {@link loadSubTypes} calls this for every subtype in boardMember.json.
+     * Only the first patterns set for a subtype are kept, so that the patterns
+     * handed out by {@link getRotatedAttack} never change while other threads
+     * read them.
+     *
+     * @param subtype the id of the subtype
+     * @param basicAttack the basic attack pattern, facing the default direction
+     * @param specialAttack the special attack pattern, facing the default direction
+     */
+    static void setSubTypeAttacks(int subtype, const vector<cugl::Vec2>& basicAttack, const vector<cugl::Vec2>& specialAttack);
+
+    /**
+     * Returns the attack pattern of a subtype rotated to a direction.
+     *
+     * The reference stays valid, and the pattern unchanged, for the lifetime
+     * of the program. This is safe to call from any thread.
+     *
+     * @param subtype the id of the subtype
+     * @param direction the direction id (see {@link directionToId})
+     * @param special whether to return the special attack instead of the basic one
+     * @return the rotated pattern, empty if the subtype has no patterns
+     */
+    static const vector<AttackOffset>& getRotatedAttack(int subtype, int direction, bool special);
+
     /**
      * Returns the string data representation of the color according to JSON conventions
      *
      * @param c the color
      * @returns the string of the color
      */
-    static std::string colorToString(Color c)
+    static const std::string& colorToString(Color c)
     {
+        static const std::string names[] = { "red", "green", "blue" };
         switch (c)
         {
         case Color::RED:
-            return "red";
+            return names[0];
         case Color::GREEN:
-            return "green";
+            return names[1];
         case Color::BLUE:
-            return "blue";
+            return names[2];
         default:
-            return "red";
+            return names[0];
         }
     }
     
@@ -283,12 +452,13 @@ public:
      * @param c the direction
      * @returns the string of the direction
      */
-    static std::string directionToString(cugl::Vec2 d)
+    static const std::string& directionToString(cugl::Vec2 d)
     {
-        if (d == Vec2(1,0)) {return "right";}
-        else if (d == Vec2(-1,0)) {return "left";}
-        else if (d== Vec2(0,1)) {return "up";}
-        else {return "down";}
+        static const std::string names[] = { "right", "left", "up", "down" };
+        if (d == Vec2(1,0)) {return names[0];}
+        else if (d == Vec2(-1,0)) {return names[1];}
+        else if (d== Vec2(0,1)) {return names[2];}
+        else {return names[3];}
     }
 
     /**
@@ -320,14 +490,26 @@ public:
      *
      * @return unit's subtype.
      */
-    std::string getSubType() { return _subtype; }
+    const std::string& getSubType() const { return _subtype; }
+
+    /**
+     * Returns the interned id of the unit's subtype.
+     *
+     * Compare against {@link SubType} values instead of comparing names.
+     *
+     * @return unit's subtype id.
+     */
+    int getSubTypeId() const { return _subtypeId; }
 
     /**
      * Sets the subtype of the unit as a string.
      *
      * @return unit's subtype.
      */
-    void setSubType(std::string subtype) { _subtype = subtype; }
+    void setSubType(const std::string& subtype) {
+        _subtype = subtype;
+        _subtypeId = subTypeToId(subtype);
+    }
 
     /**
      * Returns a list of vec2 representing all attacks
@@ -335,16 +517,18 @@ public:
      *
      * @return unit's basic attack pattern
      */
-    vector<cugl::Vec2> getBasicAttack() { return _basicAttack; }
+    const vector<cugl::Vec2>& getBasicAttack() { return _basicAttack; }
 
     /**
-     * Returns a list of vec2 representing all attacks in a basic attack
-     * allready rotated based on direction the unit is facing.
-     * The direction of attacks is based on the units default direction.
+     * Returns the square offsets of the basic attack of this unit,
+     * already rotated to the direction the unit is facing.
+     *
+     * This is a lookup in the shared rotated pattern table. Units facing no
+     * cardinal direction use the pattern of the default direction.
      *
      * @return unit's basic attack pattern already rotated.
      */
-    vector<cugl::Vec2> getBasicAttackRotated();
+    const vector<AttackOffset>& getBasicAttackRotated() { return getRotatedAttack(false); }
 
     /**
      * Sets the unit's basic attack. The basic attack is represented as a list of vec2 representing
@@ -361,16 +545,18 @@ public:
      *
      * @return unit's special attack pattern
      */
-    vector<cugl::Vec2> getSpecialAttack() { return _specialAttack; }
+    const vector<cugl::Vec2>& getSpecialAttack() { return _specialAttack; }
 
     /**
-     * Returns a list of vec2 representing all attacks in a special attack
-     * allready rotated based on direction the unit is facing.
-     * The direction of attacks is based on the units default direction.
+     * Returns the square offsets of the special attack of this unit,
+     * already rotated to the direction the unit is facing.
+     *
+     * This is a lookup in the shared rotated pattern table. Units facing no
+     * cardinal direction use the pattern of the default direction.
      *
      * @return unit's special attack pattern already rotated.
      */
-    vector<cugl::Vec2> getSpecialAttackRotated();
+    const vector<AttackOffset>& getSpecialAttackRotated() { return getRotatedAttack(true); }
 
     /**
      * Sets the unit's special attack. The special attack is represented as a list of vec2 representing
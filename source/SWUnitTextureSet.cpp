@@ -0,0 +1,104 @@
+//
+//  SWUnitTextureSet.cpp
+//  SwitchWitch
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include "SWUnitTextureSet.hpp"
+using namespace cugl;
+
+/**
+ * Returns the texture with the given name, or nullptr if there is none.
+ */
+static shared_ptr<Texture> findTexture(const std::unordered_map<std::string, std::shared_ptr<cugl::Texture>>& textures, const std::string& name) {
+    auto it = textures.find(name);
+    return it != textures.end() ? it->second : nullptr;
+}
+
+/**
+ * Returns the number of frames in the sprite sheet of a unit state.
+ */
+static int framesForState(int subtype, Unit::State state) {
+    switch (state) {
+        case Unit::State::IDLE:
+        case Unit::State::PROTECTED:
+            return 2;
+        case Unit::State::SELECTED_START:
+        case Unit::State::SELECTED_END:
+        case Unit::State::DYING:
+            return 5;
+        case Unit::State::TARGETED:
+            return 4;
+        case Unit::State::ATTACKING_SPECIAL:
+            // Basic units attack with their default texture, like every basic attack
+            return subtype == Unit::BASIC ? 1 : 18;
+        default:
+            return 1;
+    }
+}
+
+/**
+ * Initializes the texture set from a map of texture names to textures.
+ *
+ * Every subtype interned at this point (see Unit::loadSubTypes) gets a
+ * row in the table. States without a texture of their own fall back to
+ * the default "subtype-color" texture.
+ *
+ * @param textures the textures of the game, keyed by name
+ * @return true if initialization was successful.
+ */
+bool UnitTextureSet::init(const std::unordered_map<std::string, std::shared_ptr<cugl::Texture>>& textures) {
+    _subtypeCount = Unit::getSubTypeCount();
+    _table.assign(_subtypeCount * 3 * Unit::NUM_STATES, Clip());
+    _transparent = findTexture(textures, "transparent");
+    _shield = findTexture(textures, "shield");
+    for (int subtype = 0; subtype < _subtypeCount; subtype++) {
+        const std::string& name = Unit::idToSubType(subtype);
+        for (int c = Unit::Color::RED; c <= Unit::Color::BLUE; c++) {
+            Unit::Color color = (Unit::Color)c;
+            const std::string& colorString = Unit::colorToString(color);
+            shared_ptr<Texture> defaultTexture = findTexture(textures, name + "-" + colorString);
+            auto lookup = [&](const std::string& textureName) {
+                shared_ptr<Texture> texture = findTexture(textures, textureName);
+                return texture != nullptr ? texture : defaultTexture;
+            };
+            auto set = [&](Unit::State state, const shared_ptr<Texture>& texture) {
+                Clip& clip = _table[tableIndex(subtype, color, state)];
+                clip.texture = texture;
+                clip.frames = framesForState(subtype, state);
+            };
+            shared_ptr<Texture> idle = lookup(name + "-idle-" + colorString);
+            set(Unit::State::IDLE, idle);
+            set(Unit::State::PROTECTED, idle);
+            set(Unit::State::HIT, lookup(name + "-hit-" + colorString));
+            // <Hedy>
+            set(Unit::State::SELECTED_START, lookup(name + "-" + colorString + "-selected-start"));
+            set(Unit::State::SELECTED_END, lookup(name + "-" + colorString + "-selected-end"));
+            // <Hedy/>
+            set(Unit::State::TARGETED, lookup(name + "-target-" + colorString));
+            set(Unit::State::ATTACKING_SPECIAL, lookup(name + "-attack-" + colorString));
+            set(Unit::State::ATTACKING_BASIC, defaultTexture);
+            set(Unit::State::DYING, lookup(name + "-dying-" + colorString));
+            set(Unit::State::DEAD, _transparent);
+            set(Unit::State::RESPAWNING, lookup(name + "-respawning-" + colorString));
+            set(Unit::State::SELECTED_MOVING, defaultTexture);
+            set(Unit::State::SELECTED_NONE, defaultTexture);
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns the animation clip for a unit of the given subtype and color in the given state.
+ *
+ * @param subtype the subtype id of the unit
+ * @param color the color of the unit
+ * @param state the state of the unit
+ * @return the clip, whose texture is nullptr if there is none
+ */
+const UnitTextureSet::Clip& UnitTextureSet::getClip(int subtype, Unit::Color color, Unit::State state) const {
+    static const Clip none;
+    if (subtype < 0 || subtype >= _subtypeCount) return none;
+    return _table[tableIndex(subtype, color, state)];
+}
@@ -0,0 +1,129 @@
+//
+//  SWUnitTextureSet.hpp
+//  SwitchWitch
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#ifndef SWUnitTextureSet_hpp
+#define SWUnitTextureSet_hpp
+
+#include <cugl/cugl.h>
+#include "SWUnit.hpp"
+
+/**
+ * An immutable table of every texture a unit can display.
+ *
+ * Textures are indexed by (subtype id, color, state), so looking one up is a
+ * single array access. One texture set is built per scene and shared by all
+ * of its units, which means that creating a unit no longer copies the texture
+ * map of the whole game.
+ *
+ * Each entry is an animation clip: the sprite sheet of the state together
+ * with its number of frames, so a unit changing state only has to swap the
+ * sheet of its view.
+ */
+class UnitTextureSet
+{
+public:
+    /** The animation of a unit in one state */
+    struct Clip {
+        /** The sprite sheet of the animation, a single row of frames */
+        shared_ptr<Texture> texture;
+        /** The number of frames in the sheet */
+        int frames = 1;
+    };
+
+private:
+    /** The number of subtypes in the table */
+    int _subtypeCount;
+
+    /** The clip of every (subtype, color, state) triple */
+    vector<Clip> _table;
+
+    /** The texture drawn for dead units */
+    shared_ptr<Texture> _transparent;
+
+    /** The texture drawn over protected units */
+    shared_ptr<Texture> _shield;
+
+    /**
+     * Returns the position of a (subtype, color, state) triple in the table.
+     * Units without a color use the red textures.
+     */
+    int tableIndex(int subtype, Unit::Color color, Unit::State state) const {
+        int c = color == Unit::Color::NONE ? Unit::Color::RED : color;
+        return (subtype * 3 + c) * Unit::NUM_STATES + state;
+    }
+
+public:
+#pragma mark Constructors
+    /**
+     * Creates an uninitialized texture set.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a texture set
+     * on the heap, use one of the static constructors instead.
+     */
+    UnitTextureSet() : _subtypeCount(0) {}
+
+    /**
+     * Initializes the texture set from a map of texture names to textures.
+     *
+     * Every subtype interned at this point (see Unit::loadSubTypes) gets a
+     * row in the table. States without a texture of their own fall back to
+     * the default "subtype-color" texture.
+     *
+     * @param textures the textures of the game, keyed by name
+     * @return true if initialization was successful.
+     */
+    bool init(const std::unordered_map<std::string, std::shared_ptr<cugl::Texture>>& textures);
+
+#pragma mark -
+#pragma mark Static Constructors
+    /**
+     * Returns a newly allocated texture set.
+     *
+     * @param textures the textures of the game, keyed by name
+     * @return a newly allocated texture set.
+     */
+    static std::shared_ptr<UnitTextureSet> alloc(const std::unordered_map<std::string, std::shared_ptr<cugl::Texture>>& textures) {
+        std::shared_ptr<UnitTextureSet> result = std::make_shared<UnitTextureSet>();
+        return (result->init(textures) ? result : nullptr);
+    }
+
+#pragma mark -
+#pragma mark Textures
+    /**
+     * Returns the texture for a unit of the given subtype and color in the given state.
+     *
+     * @param subtype the subtype id of the unit
+     * @param color the color of the unit
+     * @param state the state of the unit
+     * @return the texture, or nullptr if there is none
+     */
+    const std::shared_ptr<cugl::Texture>& getTexture(int subtype, Unit::Color color, Unit::State state) const {
+        return getClip(subtype, color, state).texture;
+    }
+
+    /**
+     * Returns the animation clip for a unit of the given subtype and color in the given state.
+     *
+     * @param subtype the subtype id of the unit
+     * @param color the color of the unit
+     * @param state the state of the unit
+     * @return the clip, whose texture is nullptr if there is none
+     */
+    const Clip& getClip(int subtype, Unit::Color color, Unit::State state) const;
+
+    /**
+     * Returns the texture drawn for dead units.
+     */
+    const std::shared_ptr<cugl::Texture>& getTransparent() const { return _transparent; }
+
+    /**
+     * Returns the texture drawn over protected units.
+     */
+    const std::shared_ptr<cugl::Texture>& getShield() const { return _shield; }
+};
+
+#endif /* SWUnitTextureSet_hpp */
@@ -0,0 +1,336 @@
+//
+//  SWAssetPackerMain.cpp
+//  SwitchWitch
+//
+//  A command line tool that packs the asset directory into a single
+//  assets.pack (see CUAssetPack.h for the layout). The game mounts the pack
+//  at startup, and every texture, sound, font, JSON file and level is then
+//  read from it instead of from hundreds of loose files. On platforms that
+//  allow it the pack is memory-mapped, so no file is copied at all.
+//
+//  Files in formats that are already compressed (PNG, OGG, KTX, ...) are
+//  stored as they are. The other files are compressed with LZ4 when it
+//  saves at least an eighth of their size. Hidden files and MP3 files are
+//  left out; the MP3 decoder opens its files itself, so they must stay loose.
+//  Every file is read back from the pack and compared before the tool ends,
+//  and a baked JSON file or a compiled level fails the pack if its text file
+//  changed since it was built, as the game would read the old contents. The pack is then
+//  mounted the way the game mounts it, and each file must be found by
+//  AssetPack::hasAsset. With --check, the tool only runs these checks on a
+//  pack built before, against the files on the disk now.
+//
+//  The tool only needs the I/O classes of CUGL. The switchwitch-pack target
+//  of the Xcode project builds it. Elsewhere, compile this file with
+//  cugl/include on the include path, and link it against CUGL and SDL2.
+//
+//  Usage:
+//
+//      switchwitch-pack [--assets DIR] [--out FILE] [--align N] [--store] [--check]
+//
+//  Run it as the last step of a release build, after the atlas, the baked
+//  JSON and the compiled levels, and ship the pack with the MP3 files. The
+//  pack is not kept in the repository; build-apple/README.md lists the steps.
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include <cugl/cugl.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+using namespace cugl;
+
+/** The alignment of the contents of each file unless --align is given */
+#define DEFAULT_ALIGN 16
+/** The name of the pack in the asset directory */
+#define PACK_NAME "assets.pack"
+
+/** A file to pack */
+struct PackFile {
+    /** The path of the file relative to the asset directory */
+    std::string name;
+    /** The contents of the file, compressed if compressed is true */
+    std::string data;
+    /** The size of the file before compression */
+    size_t size;
+    /** Whether the contents are compressed */
+    bool compressed;
+    /** The offset of the contents in the pack */
+    size_t offset;
+};
+
+/**
+ * Returns the contents of a file, or false if it cannot be read.
+ */
+static bool readFile(const std::string& path, std::string& contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+/**
+ * Adds the paths of all files below a directory, relative to the root.
+ */
+static void listFiles(const std::string& root, const std::string& prefix, vector<std::string>& names) {
+    std::string directory = prefix.empty() ? root : root + "/" + prefix;
+    vector<std::string> contents = filetool::dir_contents(directory);
+    std::sort(contents.begin(), contents.end());
+    for (const std::string& path : contents) {
+        std::string leaf = filetool::split_path(path).second;
+        if (leaf.empty() || leaf[0] == '.') continue;
+        std::string name = prefix.empty() ? leaf : prefix + "/" + leaf;
+        if (filetool::is_dir(path)) {
+            listFiles(root, name, names);
+        } else {
+            names.push_back(name);
+        }
+    }
+}
+
+/**
+ * Returns true if a file of the asset directory is left out of the pack.
+ */
+static bool isLoose(const std::string& name) {
+    std::string suffix = filetool::base_suffix(name);
+    std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
+    return suffix == "mp3" || name == PACK_NAME;
+}
+
+/**
+ * Returns true if a file was built from a text file that has changed since.
+ *
+ * The game reads a baked JSON file or a compiled level without its text
+ * file, so a stale one must not be packed. Other files are never stale.
+ *
+ * @param assets    The assets directory
+ * @param name      The file, relative to the assets directory
+ */
+static bool isStale(const std::string& assets, const std::string& name) {
+    std::string suffix = filetool::base_suffix(name);
+    std::string text;
+    if (suffix == "jsonb") {
+        readFile(assets + "/" + name.substr(0, name.size()-1), text);
+        std::shared_ptr<BinaryReader> reader = BinaryReader::alloc(assets + "/" + name);
+        return reader == nullptr || reader->readJson(JsonLoader::hashSource(text)) == nullptr;
+    } else if (suffix == "swl") {
+        // The hash is a little-endian u64 after the magic, version and reserved
+        // field, and Level::hashSource is the same FNV-1a as JsonLoader::hashSource
+        std::string level;
+        readFile(assets + "/" + name, level);
+        if (!readFile(assets + "/" + name.substr(0, name.size()-3) + "json", text)) {
+            return false;
+        }
+        Uint64 hash = 0;
+        for (int i = 0; i < 8 && level.size() >= 16; i++) {
+            hash |= (Uint64)(Uint8)level[8+i] << (8*i);
+        }
+        return hash != JsonLoader::hashSource(text);
+    }
+    return false;
+}
+
+/**
+ * Returns the exit status of the checks of a pack against the asset directory.
+ *
+ * Every file must read back from the pack exactly as it is on the disk, and
+ * no baked file or compiled level may be stale. The pack is then mounted, as SWApp mounts it,
+ * and AssetPack::hasAsset must find every file, so that the loaders read
+ * them from the pack.
+ *
+ * @param out       The pack to check
+ * @param assets    The assets directory
+ * @param names     The files that must be in the pack
+ *
+ * @return 0 if the pack passes, 1 if a file is wrong or missing, and 2 if the pack cannot be read.
+ */
+static int checkPack(const std::string& out, const std::string& assets, const vector<std::string>& names) {
+    std::shared_ptr<AssetPack> result = AssetPack::alloc(out);
+    if (result == nullptr) {
+        fprintf(stderr, "Could not read back %s\n", out.c_str());
+        return 2;
+    }
+    int status = 0;
+    if (result->size() != names.size()) {
+        fprintf(stderr, "%s has %zu files, not %zu\n", out.c_str(), result->size(), names.size());
+        status = 1;
+    }
+    for (const std::string& name : names) {
+        std::string original;
+        readFile(assets + "/" + name, original);
+        std::string contents(original.size(), '\0');
+        SDL_RWops* stream = result->open(name);
+        bool same = original.empty() ? result->contains(name) :
+                    stream != nullptr && SDL_RWread(stream, &contents[0], 1, contents.size()) == contents.size() &&
+                    contents == original;
+        if (stream != nullptr) SDL_RWclose(stream);
+        if (!same) {
+            fprintf(stderr, "%s does not read back from the pack\n", name.c_str());
+            status = 1;
+        }
+        if (isStale(assets, name)) {
+            fprintf(stderr, "%s is stale; run %s\n", name.c_str(),
+                    filetool::base_suffix(name) == "swl" ? "switchwitch-levelc" : "switchwitch-jsonbake");
+            status = 1;
+        }
+    }
+
+    AssetPack::mount(result);
+    size_t found = 0;
+    for (const std::string& name : names) {
+        if (AssetPack::hasAsset(name)) {
+            found++;
+        } else {
+            fprintf(stderr, "%s is not found in the mounted pack\n", name.c_str());
+            status = 1;
+        }
+    }
+    AssetPack::unmountAll();
+    printf("%zu of %zu files found in the mounted pack %s\n", found, names.size(), out.c_str());
+    return status;
+}
+
+/**
+ * Appends a number in network order.
+ */
+static void appendNumber(std::string& out, Uint64 value, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) {
+        out.push_back((char)((value >> (8 * i)) & 0xff));
+    }
+}
+
+/**
+ * Prints the usage of the tool.
+ */
+static void printUsage(const char* name) {
+    printf("usage: %s [--assets DIR] [--out FILE] [--align N] [--store] [--check]\n", name);
+    printf("  --assets DIR   the assets directory of the game (default: assets)\n");
+    printf("  --out FILE     the pack to write (default: DIR/%s)\n", PACK_NAME);
+    printf("  --align N      the alignment of each file in the pack (default: %d)\n", DEFAULT_ALIGN);
+    printf("  --store        store every file without compression\n");
+    printf("  --check        only check the pack against the asset directory\n");
+}
+
+/**
+ * Packs the asset directory and checks the pack.
+ *
+ * The exit status is 1 if a file does not read back from the pack as it is
+ * on the disk or is not found in the mounted pack, and 2 if the assets
+ * cannot be read or the pack written.
+ */
+int main(int argc, char* argv[]) {
+    std::string assets = "assets";
+    std::string out;
+    size_t align = DEFAULT_ALIGN;
+    bool store = false;
+    bool check = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--assets" && hasValue) {
+            assets = argv[++i];
+        } else if (arg == "--out" && hasValue) {
+            out = argv[++i];
+        } else if (arg == "--align" && hasValue) {
+            align = (size_t)std::max(atoi(argv[++i]), 1);
+        } else if (arg == "--store") {
+            store = true;
+        } else if (arg == "--check") {
+            check = true;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (out.empty()) {
+        out = assets + "/" PACK_NAME;
+    }
+
+    vector<std::string> names;
+    listFiles(assets, "", names);
+    names.erase(std::remove_if(names.begin(), names.end(), [&](const std::string& name) {
+        return isLoose(name) || assets + "/" + name == out;
+    }), names.end());
+    if (check) {
+        return checkPack(out, assets, names);
+    }
+
+    vector<PackFile> files;
+    size_t loose = 0;
+    int compressed = 0;
+    for (const std::string& name : names) {
+        std::string suffix = filetool::base_suffix(name);
+        std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
+        PackFile file = { name, "", 0, false, 0 };
+        if (!readFile(assets + "/" + name, file.data)) {
+            fprintf(stderr, "Could not read %s/%s\n", assets.c_str(), name.c_str());
+            return 2;
+        }
+        file.size = file.data.size();
+        loose += file.size;
+        // Formats that are compressed already would only waste decompression time
+        bool packed = suffix == "png" || suffix == "jpg" || suffix == "gif" || suffix == "ogg" || suffix == "ktx";
+        if (!store && !packed && file.size > 0) {
+            std::vector<Uint8> lz4 = AssetPack::compress((const Uint8*)file.data.data(), file.size);
+            if (lz4.size() <= file.size - file.size / 8) {
+                file.data.assign((const char*)lz4.data(), lz4.size());
+                file.compressed = true;
+                compressed++;
+            }
+        }
+        files.push_back(file);
+    }
+
+    // The index is sorted by hash, while the contents stay in directory order
+    vector<size_t> order(files.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return AssetPack::hash(files[a].name) < AssetPack::hash(files[b].name);
+    });
+    std::string nameTable;
+    vector<size_t> nameOffsets(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        nameOffsets[i] = nameTable.size();
+        nameTable += files[i].name;
+    }
+    size_t offset = 16 + 32 * files.size() + nameTable.size();
+    for (PackFile& file : files) {
+        offset = (offset + align - 1) / align * align;
+        file.offset = offset;
+        offset += file.data.size();
+    }
+
+    std::string pack = "CUPK";
+    appendNumber(pack, 1, 4);
+    appendNumber(pack, files.size(), 4);
+    appendNumber(pack, align, 4);
+    for (size_t index : order) {
+        const PackFile& file = files[index];
+        appendNumber(pack, AssetPack::hash(file.name), 8);
+        appendNumber(pack, file.offset, 8);
+        appendNumber(pack, file.data.size(), 4);
+        appendNumber(pack, file.size, 4);
+        appendNumber(pack, nameOffsets[index], 4);
+        appendNumber(pack, file.name.size(), 2);
+        appendNumber(pack, file.compressed ? AssetPack::COMPRESSED : 0, 2);
+    }
+    pack += nameTable;
+    for (const PackFile& file : files) {
+        pack.resize(file.offset, '\0');
+        pack += file.data;
+    }
+
+    std::ofstream output(out, std::ios::binary);
+    output.write(pack.data(), pack.size());
+    output.close();
+    if (!output) {
+        fprintf(stderr, "Could not write %s\n", out.c_str());
+        return 2;
+    }
+
+    printf("%zu files, %d compressed: %zu bytes loose, %zu bytes packed in %s\n",
+           files.size(), compressed, loose, pack.size(), out.c_str());
+    return checkPack(out, assets, names);
+}
@@ -0,0 +1,262 @@
+//
+//  SWAtlasPackerMain.cpp
+//  SwitchWitch
+//
+//  A command line tool that packs the textures of the asset directory into a
+//  few large atlas pages. Every texture drawn from the same page shares one
+//  GPU texture, so SpriteBatch can draw a board of squares, units and icons
+//  without flushing between them, and the game opens a handful of files
+//  instead of hundreds.
+//
+//  The tool reads json/assets.json, packs every texture that is a plain file
+//  entry and small enough, and writes the pages to textures/atlas/. It then
+//  writes json/assets-atlas.json, a copy of assets.json where the packed
+//  textures are replaced by the pages. Each page lists its textures under
+//  "atlas" with an empty "prefix", so TextureLoader registers them under
+//  their original keys and get<Texture>("square") keeps working. The game
+//  loads assets-atlas.json instead of assets.json when it exists.
+//
+//  Textures with sampler settings (wrap, filters, mipmaps), textures that
+//  are already atlases and textures larger than --max stay as they are.
+//  Each piece is padded by extruding its border pixels, so linear filtering
+//  never samples a neighbour on the page.
+//
+//  The tool needs the JSON classes of CUGL and SDL2_image. The
+//  switchwitch-atlas target of the Xcode project builds it. Elsewhere,
+//  compile this file with cugl/include on the include path, and link it
+//  against CUGL, SDL2 and SDL2_image. The pages are not kept in the
+//  repository; build-apple/README.md lists when to run the asset tools.
+//
+//  Usage:
+//
+//      switchwitch-atlas [--assets DIR] [--page N] [--max N] [--padding N]
+//
+//  Run it again whenever a texture or assets.json changes.
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include <cugl/cugl.h>
+#include <SDL_image.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+using namespace cugl;
+
+/** The width and height of an atlas page unless --page is given */
+#define DEFAULT_PAGE    4096
+/** The largest width or height of a packed texture unless --max is given */
+#define DEFAULT_MAX     2400
+/** The pixels extruded around each packed texture unless --padding is given */
+#define DEFAULT_PADDING 2
+
+/** The directory of the pages, relative to the assets directory */
+#define ATLAS_DIR  "textures/atlas/"
+/** The asset directory written by the tool, relative to the assets directory */
+#define ATLAS_JSON "json/assets-atlas.json"
+
+/** A texture to pack */
+struct Piece {
+    /** The key of the texture in the asset directory */
+    std::string key;
+    /** The image of the texture, in RGBA32 */
+    SDL_Surface* image;
+    /** The page of the texture once packed */
+    int page;
+    /** The top left pixel of the texture on its page, inside the padding */
+    int x;
+    int y;
+};
+
+/**
+ * Returns the contents of a JSON file, or nullptr if it cannot be read.
+ */
+static std::shared_ptr<JsonValue> readJson(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) return nullptr;
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return JsonValue::allocWithJson(contents.str());
+}
+
+/**
+ * Prints the usage of the tool.
+ */
+static void printUsage(const char* name) {
+    printf("usage: %s [--assets DIR] [--page N] [--max N] [--padding N]\n", name);
+    printf("  --assets DIR   the assets directory of the game (default: assets)\n");
+    printf("  --page N       the width and height of an atlas page (default: %d)\n", DEFAULT_PAGE);
+    printf("  --max N        the largest texture to pack; larger ones stay apart (default: %d)\n", DEFAULT_MAX);
+    printf("  --padding N    the border pixels extruded around each texture (default: %d)\n", DEFAULT_PADDING);
+}
+
+/**
+ * Places the pieces on pages of the given size, in shelves.
+ *
+ * The pieces are sorted by height so that each shelf is filled with pieces
+ * of nearly the same height. Most textures of the game are sprite sheets of
+ * one row of equally sized frames, so little space is lost to the shelves.
+ *
+ * @return the used height of each page
+ */
+static vector<int> packShelves(vector<Piece>& pieces, int pageSize, int padding) {
+    std::stable_sort(pieces.begin(), pieces.end(), [](const Piece& a, const Piece& b) {
+        return a.image->h != b.image->h ? a.image->h > b.image->h : a.image->w > b.image->w;
+    });
+
+    vector<int> heights;
+    int shelfX = 0, shelfY = 0, shelfHeight = 0;
+    for (Piece& piece : pieces) {
+        int width = piece.image->w + 2 * padding;
+        int height = piece.image->h + 2 * padding;
+        if (heights.empty() || shelfX + width > pageSize) {
+            // Start a new shelf below the last one, or a new page
+            shelfY += shelfHeight;
+            shelfX = 0;
+            shelfHeight = 0;
+            if (heights.empty() || shelfY + height > pageSize) {
+                heights.push_back(0);
+                shelfY = 0;
+            }
+        }
+        piece.page = (int)heights.size() - 1;
+        piece.x = shelfX + padding;
+        piece.y = shelfY + padding;
+        shelfX += width;
+        shelfHeight = std::max(shelfHeight, height);
+        heights.back() = std::max(heights.back(), shelfY + shelfHeight);
+    }
+    return heights;
+}
+
+/**
+ * Copies a piece onto its page, extruding its border into the padding.
+ */
+static void blitPiece(const Piece& piece, SDL_Surface* page, int padding) {
+    SDL_Surface* image = piece.image;
+    for (int y = -padding; y < image->h + padding; y++) {
+        int sy = std::min(std::max(y, 0), image->h - 1);
+        const Uint32* src = (const Uint32*)((const Uint8*)image->pixels + sy * image->pitch);
+        Uint32* dst = (Uint32*)((Uint8*)page->pixels + (piece.y + y) * page->pitch) + piece.x;
+        for (int x = -padding; x < image->w + padding; x++) {
+            dst[x] = src[std::min(std::max(x, 0), image->w - 1)];
+        }
+    }
+}
+
+/**
+ * Packs the textures of assets.json and writes the pages and assets-atlas.json.
+ *
+ * The exit status is 2 if the asset directory or a page cannot be written.
+ */
+int main(int argc, char* argv[]) {
+    std::string assets = "assets";
+    int pageSize = DEFAULT_PAGE;
+    int maxSize = DEFAULT_MAX;
+    int padding = DEFAULT_PADDING;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--assets" && hasValue) {
+            assets = argv[++i];
+        } else if (arg == "--page" && hasValue) {
+            pageSize = std::max(atoi(argv[++i]), 64);
+        } else if (arg == "--max" && hasValue) {
+            maxSize = std::max(atoi(argv[++i]), 1);
+        } else if (arg == "--padding" && hasValue) {
+            padding = std::max(atoi(argv[++i]), 0);
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    maxSize = std::min(maxSize, pageSize - 2 * padding);
+
+    std::shared_ptr<JsonValue> directory = readJson(assets + "/json/assets.json");
+    if (directory == nullptr || directory->get("textures") == nullptr) {
+        fprintf(stderr, "Could not read the textures of %s/json/assets.json\n", assets.c_str());
+        return 2;
+    }
+    std::shared_ptr<JsonValue> textures = directory->get("textures");
+
+    vector<Piece> pieces;
+    int skipped = 0;
+    for (int i = 0; i < textures->size(); i++) {
+        std::shared_ptr<JsonValue> entry = textures->get(i);
+        // Only plain files are packed; anything with settings keeps its own texture
+        if (!entry->isString() && (!entry->isObject() || entry->size() != 1 || !entry->has("file"))) {
+            skipped++;
+            continue;
+        }
+        std::string file = entry->isString() ? entry->asString() : entry->getString("file");
+        SDL_Surface* loaded = IMG_Load((assets + "/" + file).c_str());
+        if (loaded == nullptr) {
+            fprintf(stderr, "Could not load %s (%s): left out\n", file.c_str(), entry->key().c_str());
+            skipped++;
+            continue;
+        }
+        SDL_Surface* image = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(loaded);
+        if (image == nullptr || image->w > maxSize || image->h > maxSize) {
+            if (image != nullptr) SDL_FreeSurface(image);
+            skipped++;
+            continue;
+        }
+        pieces.push_back({entry->key(), image, 0, 0, 0});
+    }
+
+    vector<int> heights = packShelves(pieces, pageSize, padding);
+    if (!heights.empty() && !filetool::is_dir(assets + "/" ATLAS_DIR) && !filetool::dir_create(assets + "/" ATLAS_DIR)) {
+        fprintf(stderr, "Could not create %s/%s\n", assets.c_str(), ATLAS_DIR);
+        return 2;
+    }
+    vector<std::shared_ptr<JsonValue>> atlases;
+    for (int page = 0; page < heights.size(); page++) {
+        // The last page is usually short, so it is cut to the height it uses
+        SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, pageSize, heights[page], 32, SDL_PIXELFORMAT_RGBA32);
+        SDL_FillRect(surface, nullptr, 0);
+        std::shared_ptr<JsonValue> atlas = JsonValue::allocObject();
+        for (const Piece& piece : pieces) {
+            if (piece.page != page) continue;
+            blitPiece(piece, surface, padding);
+            std::shared_ptr<JsonValue> bounds = JsonValue::allocArray();
+            bounds->appendValue((long)piece.x);
+            bounds->appendValue((long)piece.y);
+            bounds->appendValue((long)(piece.x + piece.image->w));
+            bounds->appendValue((long)(piece.y + piece.image->h));
+            atlas->appendChild(piece.key, bounds);
+        }
+
+        std::string file = ATLAS_DIR "page" + to_string(page) + ".png";
+        if (IMG_SavePNG(surface, (assets + "/" + file).c_str()) != 0) {
+            fprintf(stderr, "Could not write %s/%s: %s\n", assets.c_str(), file.c_str(), SDL_GetError());
+            return 2;
+        }
+        SDL_FreeSurface(surface);
+        printf("%s  %dx%d  %d textures\n", file.c_str(), pageSize, heights[page], (int)atlas->size());
+
+        std::shared_ptr<JsonValue> entry = JsonValue::allocObject();
+        entry->appendValue("file", file);
+        entry->appendValue("prefix", std::string(""));
+        entry->appendChild("atlas", atlas);
+        atlases.push_back(entry);
+    }
+
+    // The pages replace the textures packed on them
+    for (const Piece& piece : pieces) {
+        textures->removeChild(piece.key);
+        SDL_FreeSurface(piece.image);
+    }
+    for (int page = 0; page < atlases.size(); page++) {
+        textures->appendChild("atlas-page" + to_string(page), atlases[page]);
+    }
+
+    std::ofstream out(assets + "/" ATLAS_JSON);
+    out << directory->toString() << std::endl;
+    if (!out) {
+        fprintf(stderr, "Could not write %s/%s\n", assets.c_str(), ATLAS_JSON);
+        return 2;
+    }
+    printf("%d textures on %d pages, %d left apart, in %s\n", (int)pieces.size(), (int)atlases.size(), skipped, ATLAS_JSON);
+    return 0;
+}
@@ -0,0 +1,171 @@
+//
+//  SWJsonBakerMain.cpp
+//  SwitchWitch
+//
+//  A command line tool that bakes the JSON files of the game into the binary
+//  JSON encoding of BinaryWriter::writeJson. Each FILE.json is written next to
+//  it as FILE.jsonb, which JsonLoader and AssetManager read instead of the
+//  text file, so the game builds those trees at startup without parsing any
+//  text. Every baked file is read back and compared against the text file.
+//
+//  A baked file records the hash of the text file it was baked from. The
+//  game reads a baked file without opening its text file, so it does not
+//  notice a stale one. With --check, the tool bakes nothing and fails if a
+//  baked file is missing or was baked from an older text file, and
+//  switchwitch-pack runs the same check on every baked file it packs.
+//
+//  The level files are not baked, as the game reads the compiled levels of
+//  switchwitch-levelc instead.
+//
+//  The tool only needs the JSON and I/O classes of CUGL. The
+//  switchwitch-jsonbake target of the Xcode project builds it. Elsewhere,
+//  compile this file with cugl/include on the include path, and link it
+//  against CUGL and SDL2.
+//
+//  Usage:
+//
+//      switchwitch-jsonbake [--assets DIR] [--check] [FILE.json ...]
+//
+//  Without files it bakes json/assets.json, json/assets-atlas.json if it
+//  exists, json/loading.json, and the JSON files that assets.json lists.
+//  Run it again whenever one of those files changes, or the game keeps
+//  reading the old contents.
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include <cugl/cugl.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+using namespace cugl;
+
+/**
+ * Returns the contents of a text file, or "" if it cannot be read.
+ */
+static std::string readText(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) return "";
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+/**
+ * Returns the contents of a JSON file, or nullptr if it cannot be read.
+ */
+static std::shared_ptr<JsonValue> readJson(const std::string& path) {
+    std::string text = readText(path);
+    return text.empty() ? nullptr : JsonValue::allocWithJson(text);
+}
+
+/**
+ * Returns whether a file can be opened.
+ */
+static bool fileExists(const std::string& path) {
+    std::ifstream file(path);
+    return file.good();
+}
+
+/**
+ * Returns the size of a file in bytes, or 0 if it cannot be opened.
+ */
+static long fileSize(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    return file ? (long)file.tellg() : 0;
+}
+
+/**
+ * Prints the usage of the tool.
+ */
+static void printUsage(const char* name) {
+    printf("usage: %s [--assets DIR] [--check] [FILE.json ...]\n", name);
+    printf("  --assets DIR   the assets directory of the game (default: assets)\n");
+    printf("  --check        only check that the baked files match the text files\n");
+}
+
+/**
+ * Bakes or checks the given files and prints a report line for each of them.
+ *
+ * The exit status is 1 if a baked file does not read back as its text file,
+ * or with --check, if a baked file is missing or stale. It is 2 if a file
+ * cannot be read or written.
+ */
+int main(int argc, char* argv[]) {
+    std::string assets = "assets";
+    vector<std::string> paths;
+    bool check = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--assets" && hasValue) {
+            assets = argv[++i];
+        } else if (arg == "--check") {
+            check = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            printUsage(argv[0]);
+            return 2;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        paths.push_back(assets + "/json/assets.json");
+        if (fileExists(assets + "/json/assets-atlas.json")) {
+            paths.push_back(assets + "/json/assets-atlas.json");
+        }
+        paths.push_back(assets + "/json/loading.json");
+        std::shared_ptr<JsonValue> directory = readJson(paths.front());
+        std::shared_ptr<JsonValue> jsons = directory == nullptr ? nullptr : directory->get("jsons");
+        for (int i = 0; jsons != nullptr && i < jsons->size(); i++) {
+            paths.push_back(assets + "/" + jsons->get(i)->asString());
+        }
+    }
+
+    int status = 0;
+    printf("%-40s %8s %8s %s\n", "file", "text", "baked", "same");
+    for (const std::string& path : paths) {
+        std::string text = readText(path);
+        std::shared_ptr<JsonValue> json = text.empty() ? nullptr : JsonValue::allocWithJson(text);
+        if (json == nullptr) {
+            fprintf(stderr, "Could not read %s\n", path.c_str());
+            status = 2;
+            continue;
+        }
+
+        std::string baked = JsonLoader::getBakedPath(path);
+        Uint64 source = JsonLoader::hashSource(text);
+        if (check) {
+            // A stale baked file logs and reads as nullptr
+            std::shared_ptr<BinaryReader> reader = BinaryReader::alloc(baked);
+            std::shared_ptr<JsonValue> result = reader == nullptr ? nullptr : reader->readJson(source);
+            bool same = result != nullptr && result->toString(false) == json->toString(false);
+            if (!same) {
+                status = std::max(status, 1);
+            }
+            printf("%-40s %8ld %8ld %s\n", path.c_str(), fileSize(path), fileSize(baked),
+                   same ? "ok" : reader == nullptr ? "MISSING" : "STALE");
+            continue;
+        }
+
+        std::shared_ptr<BinaryWriter> writer = BinaryWriter::alloc(baked);
+        if (writer == nullptr) {
+            fprintf(stderr, "Could not write %s\n", baked.c_str());
+            status = 2;
+            continue;
+        }
+        writer->writeJson(json, source);
+        writer->close();
+
+        std::shared_ptr<BinaryReader> reader = BinaryReader::alloc(baked);
+        std::shared_ptr<JsonValue> result = reader == nullptr ? nullptr : reader->readJson(source);
+        bool same = result != nullptr && result->toString(false) == json->toString(false);
+        if (!same) {
+            // A wrong baked file would be read by the game, so it is removed
+            std::remove(baked.c_str());
+            status = std::max(status, 1);
+        }
+        printf("%-40s %8ld %8ld %s\n", path.c_str(), fileSize(path), fileSize(baked), same ? "ok" : "DIFFERENT");
+    }
+    return status;
+}
@@ -0,0 +1,186 @@
+//
+//  SWJsonBenchMain.cpp
+//  SwitchWitch
+//
+//  A command line tool that measures how fast the JSON files of the game are
+//  parsed. Each file is parsed many times in two ways: by JsonValue, which
+//  builds its tree in a single pass, and by cJSON followed by a conversion to
+//  JsonValue, which is how JsonValue used to parse. The tool reports the time
+//  and the number of heap allocations per parse of both, and checks that the
+//  two trees are identical.
+//
+//  The tool needs the JSON classes of CUGL and cJSON. The switchwitch-jsonbench
+//  target of the Xcode project builds it. Elsewhere, compile this file with
+//  cugl/include and cugl/external on the include path, and link it against
+//  CUGL and SDL2. Build it optimized, as the timings mean little otherwise.
+//
+//  Usage:
+//
+//      switchwitch-jsonbench [--assets DIR] [--runs N] [FILE.json ...]
+//
+//  Without files it parses json/assets.json, the other JSON files that it
+//  lists, and every levels/boardN.json.
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include <cugl/cugl.h>
+#include <cJSON/cJSON.h>
+#include <chrono>
+#include <fstream>
+#include <new>
+#include <sstream>
+using namespace cugl;
+
+/** The number of times each file is parsed unless --runs is given */
+#define DEFAULT_RUNS 200
+
+/** The number of heap allocations so far, by new or by cJSON */
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* result = malloc(size > 0 ? size : 1);
+    if (result == nullptr) {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept {
+    free(ptr);
+}
+
+/**
+ * Allocates memory for cJSON, counting the allocation.
+ */
+static void* countedMalloc(size_t size) {
+    allocations++;
+    return malloc(size);
+}
+
+/**
+ * Returns the contents of a file, or false if it cannot be read.
+ */
+static bool readFile(const std::string& path, std::string& contents) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+/**
+ * Returns whether a file can be opened.
+ */
+static bool fileExists(const std::string& path) {
+    std::ifstream file(path);
+    return file.good();
+}
+
+/**
+ * Returns the tree that cJSON builds for a JSON string, as a JsonValue.
+ */
+static std::shared_ptr<JsonValue> parseWithCJSON(const std::string& json) {
+    cJSON* node = cJSON_ParseWithOpts(json.c_str(), nullptr, 0);
+    if (node == nullptr) {
+        return nullptr;
+    }
+    std::shared_ptr<JsonValue> result = JsonValue::toJsonValue(node);
+    cJSON_Delete(node);
+    return result;
+}
+
+/**
+ * Prints the usage of the tool.
+ */
+static void printUsage(const char* name) {
+    printf("usage: %s [--assets DIR] [--runs N] [FILE.json ...]\n", name);
+    printf("  --assets DIR   the assets directory of the game (default: assets)\n");
+    printf("  --runs N       the number of times each file is parsed (default: %d)\n", DEFAULT_RUNS);
+}
+
+/**
+ * Parses the given files and prints a report line for each of them.
+ *
+ * The exit status is 1 if the two parsers disagree on a file.
+ */
+int main(int argc, char* argv[]) {
+    std::string assets = "assets";
+    int runs = DEFAULT_RUNS;
+    vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--assets" && hasValue) {
+            assets = argv[++i];
+        } else if (arg == "--runs" && hasValue) {
+            runs = std::max(atoi(argv[++i]), 1);
+        } else if (arg.rfind("--", 0) == 0) {
+            printUsage(argv[0]);
+            return 2;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        std::string directory;
+        paths.push_back(assets + "/json/assets.json");
+        if (readFile(paths.back(), directory)) {
+            std::shared_ptr<JsonValue> jsons = JsonValue::allocWithJson(directory)->get("jsons");
+            for (int i = 0; jsons != nullptr && i < jsons->size(); i++) {
+                paths.push_back(assets + "/" + jsons->get(i)->asString());
+            }
+        }
+        for (int i = 1; fileExists(assets + "/levels/board" + to_string(i) + ".json"); i++) {
+            paths.push_back(assets + "/levels/board" + to_string(i) + ".json");
+        }
+    }
+
+    cJSON_Hooks hooks = { countedMalloc, free };
+    cJSON_InitHooks(&hooks);
+
+    int status = 0;
+    double totalNative = 0, totalCJSON = 0;
+    printf("%-40s %8s %10s %10s %8s %8s %7s %s\n", "file", "bytes", "native us", "cJSON us", "allocs", "allocs", "speedup", "same");
+    for (const std::string& path : paths) {
+        std::string json;
+        if (!readFile(path, json)) {
+            fprintf(stderr, "Could not read %s\n", path.c_str());
+            status = 2;
+            continue;
+        }
+
+        size_t start = allocations;
+        auto begin = std::chrono::steady_clock::now();
+        std::shared_ptr<JsonValue> native;
+        for (int run = 0; run < runs; run++) {
+            native = JsonValue::allocWithJson(json);
+        }
+        double nativeTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / runs;
+        size_t nativeAllocs = (allocations - start) / runs;
+
+        start = allocations;
+        begin = std::chrono::steady_clock::now();
+        std::shared_ptr<JsonValue> converted;
+        for (int run = 0; run < runs; run++) {
+            converted = parseWithCJSON(json);
+        }
+        double cjsonTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / runs;
+        size_t cjsonAllocs = (allocations - start) / runs;
+
+        bool same = native != nullptr && converted != nullptr && native->toString(false) == converted->toString(false);
+        if (!same) status = 1;
+        totalNative += nativeTime;
+        totalCJSON += cjsonTime;
+        printf("%-40s %8zu %10.1f %10.1f %8zu %8zu %6.2fx %s\n", path.c_str(), json.size(), nativeTime, cjsonTime,
+               nativeAllocs, cjsonAllocs, cjsonTime / std::max(nativeTime, 1e-9), same ? "ok" : "DIFFERENT");
+    }
+    printf("total: %.1f us native, %.1f us cJSON, %.2fx\n", totalNative, totalCJSON, totalCJSON / std::max(totalNative, 1e-9));
+    return status;
+}
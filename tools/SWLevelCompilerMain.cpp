@@ -0,0 +1,156 @@
+//
+//  SWLevelCompilerMain.cpp
+//  SwitchWitch
+//
+//  A command line tool that compiles JSON levels into the binary level format
+//  read by Level::allocWithFile (see SWLevel.h for the layout). Each
+//  LEVEL.json is loaded through Level, so the binary holds exactly what the
+//  game would have built from the JSON, and is written next to it as
+//  LEVEL.swl. Every binary is read back and compared against the JSON level
+//  before it is written. The binary records a hash of the JSON file. The game
+//  reads a binary level without opening its JSON, so with --check the tool
+//  writes nothing and fails if a binary is missing or was compiled from an
+//  older JSON. switchwitch-pack runs the same check on every binary it packs.
+//
+//  The tool only needs the model classes of the game and the JSON and math
+//  classes of CUGL. The switchwitch-levelc target of the Xcode project builds
+//  it. Elsewhere, compile this file together with SWLevel.cpp,
+//  SWMappedFile.cpp, SWBoard.cpp, SWSquare.cpp, SWUnit.cpp,
+//  SWUnitTextureSet.cpp and SWSpriteSheetNode.cpp from source/, with
+//  cugl/include and source/ on the include path, and link it against CUGL
+//  and SDL2.
+//
+//  Usage:
+//
+//      switchwitch-levelc [--assets DIR] [--check] [LEVEL.json ...]
+//
+//  Without level files it compiles every assets/levels/boardN.json in order.
+//  Run it again whenever a level is changed in the level editor.
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include "SWLevel.h"
+#include <fstream>
+#include <sstream>
+using namespace cugl;
+
+/**
+ * Reads the contents of a file, returning false if it cannot be read.
+ */
+static bool readFile(const std::string& path, std::string& contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::stringstream stream;
+    stream << file.rdbuf();
+    contents = stream.str();
+    return true;
+}
+
+/**
+ * Returns whether a file can be opened.
+ */
+static bool fileExists(const std::string& path) {
+    std::ifstream file(path);
+    return file.good();
+}
+
+/**
+ * Returns whether two levels hold the same settings and units.
+ */
+static bool sameLevel(const std::shared_ptr<Level>& a, const std::shared_ptr<Level>& b) {
+    if (a->sourceHash != b->sourceHash || a->levelID != b->levelID || a->maxTurns != b->maxTurns || a->oneStarThreshold != b->oneStarThreshold ||
+        a->twoStarThreshold != b->twoStarThreshold || a->threeStarThreshold != b->threeStarThreshold ||
+        a->numOfKings != b->numOfKings || a->squareSize != b->squareSize || a->backgroundName != b->backgroundName ||
+        a->unitTypes != b->unitTypes || a->getNumberOfRows() != b->getNumberOfRows() ||
+        a->getNumberOfColumns() != b->getNumberOfColumns()) {
+        return false;
+    }
+    for (int depth = 0; a->doesBoardExist(depth) || b->doesBoardExist(depth); depth++) {
+        if (!a->doesBoardExist(depth) || !b->doesBoardExist(depth)) return false;
+        const auto& squaresA = a->getBoard(depth)->getAllSquares();
+        const auto& squaresB = b->getBoard(depth)->getAllSquares();
+        for (int i = 0; i < squaresA.size(); i++) {
+            auto unitA = squaresA[i]->getUnit();
+            auto unitB = squaresB[i]->getUnit();
+            if (unitA->getSubType() != unitB->getSubType() || unitA->getColor() != unitB->getColor() ||
+                unitA->getDirection() != unitB->getDirection() || unitA->getUnitsNeededToKill() != unitB->getUnitsNeededToKill() ||
+                unitA->isMoveable() != unitB->isMoveable() || squaresA[i]->isInteractable() != squaresB[i]->isInteractable()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Compiles or checks the given levels and prints a line for each of them.
+ *
+ * The exit status is 1 if any level could not be compiled, or with --check,
+ * if any binary level is missing or stale.
+ */
+int main(int argc, char* argv[]) {
+    std::string assets = "assets";
+    vector<std::string> paths;
+    bool check = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--assets" && i + 1 < argc) {
+            assets = argv[++i];
+        } else if (arg == "--check") {
+            check = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            printf("usage: %s [--assets DIR] [--check] [LEVEL.json ...]\n", argv[0]);
+            return 2;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        for (int i = 1; fileExists(assets + "/levels/board" + to_string(i) + ".json"); i++) {
+            paths.push_back(assets + "/levels/board" + to_string(i) + ".json");
+        }
+    }
+
+    int status = 0;
+    for (const std::string& path : paths) {
+        std::string contents;
+        std::shared_ptr<JsonValue> json = readFile(path, contents) ? JsonValue::allocWithJson(contents) : nullptr;
+        if (json == nullptr) {
+            fprintf(stderr, "Could not read %s\n", path.c_str());
+            status = 1;
+            continue;
+        }
+        // Levels are compiled without textures
+        std::shared_ptr<Level> level = Level::alloc(nullptr, json);
+        level->sourceHash = Level::hashSource((const uint8_t*)contents.data(), contents.size());
+        vector<uint8_t> binary = level->convertToBinary();
+        std::shared_ptr<Level> check = Level::allocWithBinary(nullptr, binary.data(), binary.size());
+        if (binary.empty() || check == nullptr || !sameLevel(level, check)) {
+            fprintf(stderr, "Could not compile %s\n", path.c_str());
+            status = 1;
+            continue;
+        }
+
+        std::string output = path.substr(0, path.rfind('.')) + ".swl";
+        if (check) {
+            std::shared_ptr<Level> existing = fileExists(output) ? Level::allocWithFile(nullptr, output) : nullptr;
+            bool same = existing != nullptr && sameLevel(level, existing);
+            if (!same) {
+                status = 1;
+            }
+            printf("%s: %s\n", output.c_str(), same ? "ok" : existing == nullptr ? "MISSING" : "STALE");
+            continue;
+        }
+
+        std::ofstream file(output, std::ios::binary);
+        file.write((const char*)binary.data(), binary.size());
+        if (!file) {
+            fprintf(stderr, "Could not write %s\n", output.c_str());
+            status = 1;
+            continue;
+        }
+        printf("%s -> %s (%zu bytes)\n", path.c_str(), output.c_str(), binary.size());
+    }
+    return status;
+}
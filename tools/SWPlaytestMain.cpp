@@ -0,0 +1,158 @@
+//
+//  SWPlaytestMain.cpp
+//  SwitchWitch
+//
+//  A command line tool that plays levels with random swaps, for balancing.
+//  Every game is played through Simulation, the same rules that GameScene
+//  uses, without textures or a window, so thousands of games can be played
+//  per second. Each game uses its own seed for the random units, and its log
+//  is replayed from the seed to check that the game is deterministic.
+//
+//  The tool only needs the model classes of the game and the JSON and math
+//  classes of CUGL. To build it, compile this file together with
+//  SWSimulation.cpp, SWLevel.cpp, SWMappedFile.cpp, SWBoard.cpp, SWSquare.cpp,
+//  SWUnit.cpp, SWUnitTextureSet.cpp and SWSpriteSheetNode.cpp from source/, with cugl/include and
+//  source/ on the include path, and link it against CUGL and SDL2.
+//
+//  Usage:
+//
+//      switchwitch-playtest [--assets DIR] [--games N] [--seed N] [LEVEL.json ...]
+//
+//  Without level files it plays every assets/levels/boardN.json in order.
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include "SWSimulation.h"
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+using namespace cugl;
+
+/** The number of games played per level unless --games is given */
+#define DEFAULT_GAMES 1000
+
+/**
+ * Returns the contents of a JSON file, or nullptr if it cannot be read.
+ */
+static std::shared_ptr<JsonValue> readJson(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) return nullptr;
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return JsonValue::allocWithJson(contents.str());
+}
+
+/**
+ * Returns whether a file can be opened.
+ */
+static bool fileExists(const std::string& path) {
+    std::ifstream file(path);
+    return file.good();
+}
+
+/**
+ * Prints the usage of the tool.
+ */
+static void printUsage(const char* name) {
+    printf("usage: %s [--assets DIR] [--games N] [--seed N] [LEVEL.json ...]\n", name);
+    printf("  --assets DIR   the assets directory of the game (default: assets)\n");
+    printf("  --games N      the number of random games per level (default: %d)\n", DEFAULT_GAMES);
+    printf("  --seed N       the seed of the first game (default: 0)\n");
+}
+
+/**
+ * Plays the given levels and prints a report line for each of them.
+ *
+ * The exit status is 1 if a replayed game did not match the original.
+ */
+int main(int argc, char* argv[]) {
+    std::string assets = "assets";
+    int games = DEFAULT_GAMES;
+    uint64_t firstSeed = 0;
+    vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--assets" && hasValue) {
+            assets = argv[++i];
+        } else if (arg == "--games" && hasValue) {
+            games = std::max(atoi(argv[++i]), 1);
+        } else if (arg == "--seed" && hasValue) {
+            firstSeed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg.rfind("--", 0) == 0) {
+            printUsage(argv[0]);
+            return 2;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        for (int i = 1; fileExists(assets + "/levels/board" + to_string(i) + ".json"); i++) {
+            paths.push_back(assets + "/levels/board" + to_string(i) + ".json");
+        }
+    }
+
+    std::shared_ptr<JsonValue> boardMembers = readJson(assets + "/json/boardMember.json");
+    std::shared_ptr<JsonValue> constants = readJson(assets + "/json/constants.json");
+    if (boardMembers == nullptr || constants == nullptr) {
+        fprintf(stderr, "Could not read the unit definitions in %s/json\n", assets.c_str());
+        return 2;
+    }
+    std::shared_ptr<Simulation> simulation = Simulation::alloc(boardMembers, constants);
+    if (simulation == nullptr) {
+        fprintf(stderr, "Could not create the simulation\n");
+        return 2;
+    }
+
+    int status = 0;
+    printf("%-6s %5s %6s %9s %10s %9s %10s %s\n", "level", "turns", "won", "avg score", "best score", "avg turns", "games/s", "replay");
+    for (const std::string& path : paths) {
+        std::shared_ptr<JsonValue> json = readJson(path);
+        if (json == nullptr) {
+            fprintf(stderr, "Could not read %s\n", path.c_str());
+            status = 2;
+            continue;
+        }
+        // Levels are played without textures
+        std::shared_ptr<Level> level = Level::alloc(nullptr, json);
+
+        int won = 0;
+        long long totalScore = 0;
+        int bestScore = 0;
+        long long totalTurns = 0;
+        bool replayed = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int game = 0; game < games; game++) {
+            uint64_t seed = firstSeed + game;
+            // The player is as random as the units, but from a separate generator
+            std::mt19937_64 player(seed);
+            simulation->start(level, seed);
+            while (simulation->getOutcome() == Simulation::PLAYING) {
+                vector<std::pair<int, int>> swaps = simulation->getLegalSwaps();
+                if (swaps.empty()) break;
+                const std::pair<int, int>& swap = swaps[player() % swaps.size()];
+                simulation->playTurn(swap.first, swap.second);
+            }
+            if (simulation->getOutcome() == Simulation::WON) {
+                won++;
+                totalScore += simulation->getScore();
+                bestScore = std::max(bestScore, simulation->getScore());
+            }
+            totalTurns += level->maxTurns - simulation->getTurnsLeft();
+            // Replaying a few games is enough to catch any hidden state
+            if (game < 8) {
+                vector<Simulation::Event> log = simulation->getLog();
+                replayed = simulation->replay(log) && replayed;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        printf("%-6d %5d %5.1f%% %9.2f %10d %9.2f %10.0f %s\n", level->levelID, level->maxTurns, 100.0 * won / games,
+               won > 0 ? (double)totalScore / won : 0.0, bestScore, (double)totalTurns / games, games / std::max(seconds, 1e-9),
+               replayed ? "ok" : "MISMATCH");
+        if (!replayed) status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,155 @@
+//
+//  SWSolverMain.cpp
+//  SwitchWitch
+//
+//  A command line tool that solves levels without opening a window. It loads
+//  each level through Level and Board, searches every swap sequence allowed
+//  by the level and checks what the best play scores against the star
+//  thresholds of the level.
+//
+//  The tool only needs the model classes of the game, the JSON and math
+//  classes of CUGL, and the CUGL thread pool. To build it, compile this file
+//  together with SWSolver.cpp, SWLevel.cpp, SWMappedFile.cpp, SWBoard.cpp,
+//  SWSquare.cpp, SWUnit.cpp, SWUnitTextureSet.cpp and SWSpriteSheetNode.cpp
+//  from source/, with cugl/include and source/ on the include path, and link
+//  it against CUGL and SDL2. The switchwitch-solver target of the Xcode
+//  project in build-apple does exactly that.
+//
+//  Usage:
+//
+//      switchwitch-solver [--assets DIR] [--threads N] [--nodes N] [--seeds N] [LEVEL.json ...]
+//
+//  Without level files it solves every assets/levels/boardN.json in order.
+//  The seeds decide the random units of the solver only; they do not
+//  reproduce the respawns of the game or of switchwitch-playtest.
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include "SWSolver.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+using namespace cugl;
+
+/** The number of boards searched per level and seed unless --nodes is given */
+#define DEFAULT_NODE_LIMIT 5000000
+
+/**
+ * Returns the contents of a JSON file, or nullptr if it cannot be read.
+ */
+static std::shared_ptr<JsonValue> readJson(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) return nullptr;
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return JsonValue::allocWithJson(contents.str());
+}
+
+/**
+ * Returns whether a file can be opened.
+ */
+static bool fileExists(const std::string& path) {
+    std::ifstream file(path);
+    return file.good();
+}
+
+/**
+ * Prints the usage of the tool.
+ */
+static void printUsage(const char* name) {
+    printf("usage: %s [--assets DIR] [--threads N] [--nodes N] [--seeds N] [LEVEL.json ...]\n", name);
+    printf("  --assets DIR   the assets directory of the game (default: assets)\n");
+    printf("  --threads N    the number of search threads (default: all cores)\n");
+    printf("  --nodes N      the boards to search per level and seed, 0 for no limit (default: %d)\n", DEFAULT_NODE_LIMIT);
+    printf("  --seeds N      the number of solver seeds to try per level (default: 1)\n");
+}
+
+/**
+ * Solves the given levels and prints a report line for each of them.
+ *
+ * The exit status is 1 if a level cannot be won with any seed.
+ */
+int main(int argc, char* argv[]) {
+    std::string assets = "assets";
+    int threads = std::max((int)std::thread::hardware_concurrency(), 1);
+    long long nodes = DEFAULT_NODE_LIMIT;
+    int seeds = 1;
+    vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--assets" && hasValue) {
+            assets = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            threads = std::max(atoi(argv[++i]), 1);
+        } else if (arg == "--nodes" && hasValue) {
+            nodes = atoll(argv[++i]);
+        } else if (arg == "--seeds" && hasValue) {
+            seeds = std::max(atoi(argv[++i]), 1);
+        } else if (arg.rfind("--", 0) == 0) {
+            printUsage(argv[0]);
+            return 2;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        for (int i = 1; fileExists(assets + "/levels/board" + to_string(i) + ".json"); i++) {
+            paths.push_back(assets + "/levels/board" + to_string(i) + ".json");
+        }
+    }
+
+    std::shared_ptr<JsonValue> boardMembers = readJson(assets + "/json/boardMember.json");
+    std::shared_ptr<JsonValue> constants = readJson(assets + "/json/constants.json");
+    if (boardMembers == nullptr || constants == nullptr) {
+        fprintf(stderr, "Could not read the unit definitions in %s/json\n", assets.c_str());
+        return 2;
+    }
+    std::shared_ptr<Solver> solver = Solver::alloc(boardMembers, constants, threads);
+    if (solver == nullptr) {
+        fprintf(stderr, "Could not create the solver\n");
+        return 2;
+    }
+    solver->setNodeLimit(nodes);
+
+    int status = 0;
+    printf("%-6s %5s %11s %11s %9s %5s %s\n", "level", "turns", "stars 1/2/3", "best score", "min swaps", "stars", "search");
+    for (const std::string& path : paths) {
+        std::shared_ptr<JsonValue> json = readJson(path);
+        if (json == nullptr) {
+            fprintf(stderr, "Could not read %s\n", path.c_str());
+            status = 2;
+            continue;
+        }
+        // Levels are solved without textures
+        std::shared_ptr<Level> level = Level::alloc(nullptr, json);
+
+        int lowScore = -1;
+        int highScore = -1;
+        int minSwaps = -1;
+        int lowStars = 3;
+        int highStars = 0;
+        int searchedTurns = level->maxTurns;
+        long long searched = 0;
+        for (int seed = 0; seed < seeds; seed++) {
+            Solver::Result result = solver->solve(level, seed);
+            lowScore = seed == 0 ? result.maxScore : std::min(lowScore, result.maxScore);
+            highScore = std::max(highScore, result.maxScore);
+            if (result.isKillable() && (minSwaps < 0 || result.minSwaps < minSwaps)) minSwaps = result.minSwaps;
+            lowStars = std::min(lowStars, result.stars);
+            highStars = std::max(highStars, result.stars);
+            searchedTurns = std::min(searchedTurns, result.searchedTurns);
+            searched += result.nodes;
+        }
+
+        std::string thresholds = strtool::format("%d/%d/%d", level->oneStarThreshold, level->twoStarThreshold, level->threeStarThreshold);
+        std::string score = lowScore == highScore ? to_string(highScore) : strtool::format("%d-%d", lowScore, highScore);
+        std::string stars = lowStars == highStars ? to_string(highStars) : strtool::format("%d-%d", lowStars, highStars);
+        std::string search = searchedTurns == level->maxTurns ? "complete" : strtool::format("partial, %d/%d turns", searchedTurns, level->maxTurns);
+        printf("%-6d %5d %11s %11s %9s %5s %s (%lld boards)\n", level->levelID, level->maxTurns, thresholds.c_str(),
+               highScore < 0 ? "-" : score.c_str(), minSwaps < 0 ? "-" : to_string(minSwaps).c_str(), stars.c_str(), search.c_str(), searched);
+        if (highScore < 0 && searchedTurns == level->maxTurns) status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,190 @@
+//
+//  SWSpriteBenchMain.cpp
+//  SwitchWitch
+//
+//  A benchmark of the rectangle path of SpriteBatch, which every textured
+//  scene graph node goes through. It draws many transformed sprites per
+//  frame in two ways: as rectangles, which take the quad fast path of
+//  SpriteBatch::prepare, and as a Poly2 made from each rectangle, which is
+//  what the rectangle path used to cost (a temporary Poly2 per sprite that is
+//  then copied into the vertex buffer). The tool reports the sprites per
+//  millisecond of both, for the batching alone and for whole frames.
+//
+//  The tool opens a small window, as SpriteBatch needs an OpenGL context. The
+//  switchwitch-spritebench target of the Xcode project builds it. Elsewhere,
+//  compile this file with cugl/include on the include path, and link it
+//  against CUGL and SDL2 like the game. The batch holds a whole frame, so the
+//  batching time has no flushes in it; the frame time includes the GPU.
+//
+//  Usage:
+//
+//      switchwitch-spritebench [--sprites N] [--frames N]
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include <cugl/cugl.h>
+#include <chrono>
+#include <cstdlib>
+using namespace cugl;
+
+/** The number of sprites per frame unless --sprites is given */
+#define DEFAULT_SPRITES 20000
+/** The number of frames per method unless --frames is given */
+#define DEFAULT_FRAMES  60
+
+/**
+ * An application that runs the benchmark on its first frame and quits.
+ */
+class SpriteBenchApp : public Application {
+protected:
+    /** The sprite batch under test */
+    std::shared_ptr<SpriteBatch> _batch;
+    /** The texture of every sprite */
+    std::shared_ptr<Texture> _texture;
+    /** The bounds of each sprite */
+    std::vector<Rect> _bounds;
+    /** The transform of each sprite */
+    std::vector<Affine2> _transforms;
+    /** The number of sprites per frame */
+    int _sprites;
+    /** The number of frames per method */
+    int _frames;
+
+    /**
+     * Returns the best times of a frame drawn by the given method, in ms.
+     *
+     * @param polygons  Whether to draw each sprite as a Poly2
+     * @param batching  Set to the best time of the draw calls alone
+     *
+     * @return the best time of a whole frame, up to glFinish.
+     */
+    double measure(bool polygons, double& batching) {
+        double best = 1e9;
+        batching = 1e9;
+        for (int frame = 0; frame < _frames; frame++) {
+            auto begin = std::chrono::steady_clock::now();
+            _batch->begin();
+            for (size_t ii = 0; ii < _bounds.size(); ii++) {
+                if (polygons) {
+                    _batch->draw(_texture, Poly2(_bounds[ii]), Vec2::ZERO, _transforms[ii]);
+                } else {
+                    _batch->draw(_texture, _bounds[ii], Vec2::ZERO, _transforms[ii]);
+                }
+            }
+            auto drawn = std::chrono::steady_clock::now();
+            _batch->end();
+            glFinish();
+            auto done = std::chrono::steady_clock::now();
+            batching = std::min(batching, std::chrono::duration<double, std::milli>(drawn - begin).count());
+            best = std::min(best, std::chrono::duration<double, std::milli>(done - begin).count());
+        }
+        return best;
+    }
+
+public:
+    /**
+     * Creates the benchmark with the default settings.
+     */
+    SpriteBenchApp() : _sprites(DEFAULT_SPRITES), _frames(DEFAULT_FRAMES) {}
+
+    /**
+     * Sets the number of sprites per frame.
+     *
+     * @param sprites   The number of sprites per frame
+     */
+    void setSprites(int sprites) { _sprites = sprites; }
+
+    /**
+     * Sets the number of frames per method.
+     *
+     * @param frames    The number of frames per method
+     */
+    void setFrames(int frames) { _frames = frames; }
+
+    /**
+     * Creates the sprite batch and the sprites.
+     */
+    void onStartup() override {
+        Size size = getDisplaySize();
+        // Room for a whole frame, so that the batching is timed without flushes
+        _batch = SpriteBatch::alloc(4 * _sprites);
+        _batch->setPerspective(OrthographicCamera::alloc(size)->getCombined());
+        _texture = Texture::getBlank();
+        std::srand(1);
+        for (int ii = 0; ii < _sprites; ii++) {
+            float x = (float)(std::rand() % (int)size.width);
+            float y = (float)(std::rand() % (int)size.height);
+            _bounds.push_back(Rect(0, 0, 8 + std::rand() % 24, 8 + std::rand() % 24));
+            Affine2 transform;
+            Affine2::createRotation((std::rand() % 628) / 100.0f, &transform);
+            transform.translate(x, y);
+            _transforms.push_back(transform);
+        }
+        Application::onStartup();
+    }
+
+    /**
+     * Releases the sprite batch and the sprites.
+     */
+    void onShutdown() override {
+        _batch = nullptr;
+        _texture = nullptr;
+        _bounds.clear();
+        _transforms.clear();
+        Application::onShutdown();
+    }
+
+    /**
+     * Runs the benchmark and quits.
+     */
+    void draw() override {
+        double polyBatch, quadBatch;
+        double polyFrame = measure(true, polyBatch);
+        double quadFrame = measure(false, quadBatch);
+        printf("%-8s %14s %14s\n", "path", "batch sprt/ms", "frame sprt/ms");
+        printf("%-8s %14.0f %14.0f\n", "poly2", _sprites / polyBatch, _sprites / polyFrame);
+        printf("%-8s %14.0f %14.0f\n", "quad", _sprites / quadBatch, _sprites / quadFrame);
+        printf("speedup: %.2fx batching, %.2fx per frame\n", polyBatch / quadBatch, polyFrame / quadFrame);
+        quit();
+    }
+};
+
+/**
+ * Prints the usage of the tool.
+ */
+static void printUsage(const char* name) {
+    printf("usage: %s [--sprites N] [--frames N]\n", name);
+    printf("  --sprites N    the number of sprites per frame (default: %d)\n", DEFAULT_SPRITES);
+    printf("  --frames N     the number of frames per path (default: %d)\n", DEFAULT_FRAMES);
+}
+
+/**
+ * Runs the benchmark and prints the results.
+ */
+int main(int argc, char* argv[]) {
+    SpriteBenchApp app;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--sprites" && hasValue) {
+            app.setSprites(std::max(atoi(argv[++i]), 1));
+        } else if (arg == "--frames" && hasValue) {
+            app.setFrames(std::max(atoi(argv[++i]), 1));
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    app.setName("Sprite Bench");
+    app.setOrganization("GDIAC");
+    app.setDisplaySize(640, 480);
+    if (!app.init()) {
+        return 2;
+    }
+    app.onStartup();
+    while (app.step());
+    app.onShutdown();
+    return 0;
+}
@@ -0,0 +1,235 @@
+//
+//  SWTextureCheckMain.cpp
+//  SwitchWitch
+//
+//  A command line tool that checks the compressed textures of the game. It
+//  first decodes a few ETC2 and EAC blocks whose pixels are worked out by
+//  hand from the format specification, and fails if the CPU fallback of
+//  CompressedImage disagrees with any of them. That fallback only runs on
+//  devices without ETC2, so this is the one place it is exercised.
+//
+//  It then reports the GPU memory of the given texture files. A KTX file is
+//  measured as it is uploaded, and compared to the same levels in RGBA. A
+//  PNG file is measured as the RGBA texture the game makes today, and as the
+//  ETC2 RGBA texture it would be once converted. Converting the PNG files to
+//  KTX takes an external encoder such as etcpak or astcenc; the steps are in
+//  build-apple/README.md.
+//
+//  The tool needs the CompressedImage class of CUGL, but no OpenGL context.
+//  The switchwitch-ktxcheck target of the Xcode project builds it.
+//
+//  Usage:
+//
+//      switchwitch-ktxcheck [FILE ...]
+//
+//  The exit status is 1 if a reference block decodes wrong or a file cannot
+//  be read.
+//
+//  Copyright © 2022 Game Design Initiative at Cornell. All rights reserved.
+//
+
+#include <cugl/cugl.h>
+#include <cugl/render/CUCompressedImage.h>
+#include <fstream>
+#include <iterator>
+using namespace cugl;
+
+/** The KTX base internal format of RGB images */
+#define KTX_BASE_RGB    0x1907
+/** The KTX base internal format of RGBA images */
+#define KTX_BASE_RGBA   0x1908
+
+/** A pixel of a reference block and the color it must decode to */
+struct Expected {
+    /** The pixel column */
+    int x;
+    /** The pixel row */
+    int y;
+    /** The RGBA color of the pixel */
+    Uint8 rgba[4];
+};
+
+/** A block with a known decoding */
+struct Reference {
+    /** A description of the block for the report */
+    const char* name;
+    /** The format of the block */
+    GLenum format;
+    /** The bytes of the block (only the first 8 for the ETC2 RGB formats) */
+    Uint8 block[16];
+    /** The pixels to check */
+    std::vector<Expected> pixels;
+};
+
+/**
+ * Returns the blocks to decode, with the colors the specification gives them.
+ *
+ * The individual block has base colors (136,68,34) and (255,68,34), table 0
+ * (modifiers 2 and 8) and no flip. The T mode block overflows the red of the
+ * differential mode, and has paint colors (221,85,170), (51,102,153)+16,
+ * (51,102,153) and (51,102,153)-16. The EAC block has base 100, multiplier
+ * 2 and table 0, with index 7 at (0,0), index 4 at (0,1) and 0 elsewhere.
+ */
+static std::vector<Reference> references() {
+    std::vector<Reference> result;
+    result.push_back({ "ETC1 individual mode", CompressedImage::ETC2_RGB8,
+        { 0x8F, 0x44, 0x22, 0x00, 0x00, 0x01, 0x00, 0x11 },
+        { { 0, 0, { 128, 60, 26, 255 } }, { 1, 0, { 144, 76, 42, 255 } },
+          { 0, 1, { 138, 70, 36, 255 } }, { 2, 1, { 255, 70, 36, 255 } },
+          { 3, 3, { 255, 70, 36, 255 } } } });
+    result.push_back({ "ETC2 T mode", CompressedImage::ETC2_RGB8,
+        { 0xF9, 0x5A, 0x36, 0x97, 0x11, 0x00, 0x10, 0x10 },
+        { { 0, 0, { 221, 85, 170, 255 } }, { 1, 0, { 67, 118, 169, 255 } },
+          { 2, 0, { 51, 102, 153, 255 } }, { 3, 0, { 35, 86, 137, 255 } },
+          { 0, 1, { 221, 85, 170, 255 } } } });
+    result.push_back({ "ETC2 RGBA with EAC alpha", CompressedImage::ETC2_RGBA8,
+        { 100, 0x20, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00,
+          0x8F, 0x44, 0x22, 0x00, 0x00, 0x01, 0x00, 0x11 },
+        { { 0, 0, { 128, 60, 26, 128 } }, { 0, 1, { 138, 70, 36, 104 } },
+          { 1, 0, { 144, 76, 42, 94 } }, { 3, 3, { 255, 70, 36, 94 } } } });
+    return result;
+}
+
+/**
+ * Appends a 32-bit word to a KTX file in the byte order of this machine
+ */
+static void appendWord(std::vector<Uint8>& data, Uint32 word) {
+    const Uint8* bytes = (const Uint8*)&word;
+    data.insert(data.end(), bytes, bytes+4);
+}
+
+/**
+ * Returns a KTX file with a single 4x4 block
+ *
+ * @param format    The format of the block
+ * @param block     The bytes of the block
+ */
+static std::vector<Uint8> makeKTX(GLenum format, const Uint8* block) {
+    static const Uint8 identifier[12] = {
+        0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+    };
+    size_t bytes = CompressedImage::getBlockBytes(format);
+    std::vector<Uint8> data(identifier, identifier+12);
+    appendWord(data, 0x04030201);
+    appendWord(data, 0);    // glType
+    appendWord(data, 1);    // glTypeSize
+    appendWord(data, 0);    // glFormat
+    appendWord(data, format);
+    appendWord(data, format == CompressedImage::ETC2_RGB8 ? KTX_BASE_RGB : KTX_BASE_RGBA);
+    appendWord(data, 4);    // width
+    appendWord(data, 4);    // height
+    appendWord(data, 0);    // depth
+    appendWord(data, 0);    // array elements
+    appendWord(data, 1);    // faces
+    appendWord(data, 1);    // mipmap levels
+    appendWord(data, 0);    // metadata
+    appendWord(data, (Uint32)bytes);
+    data.insert(data.end(), block, block+bytes);
+    return data;
+}
+
+/**
+ * Returns true if every reference block decodes to the expected pixels.
+ */
+static bool checkDecoder() {
+    bool ok = true;
+    std::vector<Reference> blocks = references();
+    for(auto it = blocks.begin(); it != blocks.end(); ++it) {
+        std::vector<Uint8> file = makeKTX(it->format, it->block);
+        std::shared_ptr<CompressedImage> image = CompressedImage::allocWithData(file.data(), file.size());
+        if (image == nullptr || !image->decompress()) {
+            printf("FAIL %s: the block was not decoded\n", it->name);
+            ok = false;
+            continue;
+        }
+
+        const std::vector<Uint8>& pixels = image->getLevel(0);
+        bool match = true;
+        for(auto jt = it->pixels.begin(); jt != it->pixels.end(); ++jt) {
+            const Uint8* pixel = pixels.data()+4*(4*jt->y+jt->x);
+            if (memcmp(pixel, jt->rgba, 4) != 0) {
+                printf("FAIL %s: pixel (%d,%d) is (%d,%d,%d,%d), not (%d,%d,%d,%d)\n",
+                       it->name, jt->x, jt->y, pixel[0], pixel[1], pixel[2], pixel[3],
+                       jt->rgba[0], jt->rgba[1], jt->rgba[2], jt->rgba[3]);
+                match = false;
+            }
+        }
+        if (match) {
+            printf("ok   %s\n", it->name);
+        }
+        ok = ok && match;
+    }
+    return ok;
+}
+
+/**
+ * Returns the contents of a file, or an empty vector if it cannot be read.
+ */
+static std::vector<Uint8> readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<Uint8>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+/**
+ * Returns the bytes of the ETC2 RGBA blocks of an image of the given size
+ */
+static size_t etcBytes(size_t width, size_t height) {
+    return ((width+3)/4)*((height+3)/4)*CompressedImage::getBlockBytes(CompressedImage::ETC2_RGBA8);
+}
+
+/**
+ * Adds the GPU memory of a texture file to the totals, and reports it.
+ *
+ * @param path      The texture file
+ * @param current   The memory the texture takes as it is
+ * @param converted The memory the texture takes in a compressed format
+ *
+ * @return true if the file could be read.
+ */
+static bool measure(const std::string& path, size_t& current, size_t& converted) {
+    std::vector<Uint8> data = readFile(path);
+    size_t rgba = 0;
+    size_t compressed = 0;
+    if (data.size() >= 24 && memcmp(data.data()+1, "PNG", 3) == 0 && memcmp(data.data()+12, "IHDR", 4) == 0) {
+        size_t width  = ((size_t)data[16] << 24) | (data[17] << 16) | (data[18] << 8) | data[19];
+        size_t height = ((size_t)data[20] << 24) | (data[21] << 16) | (data[22] << 8) | data[23];
+        rgba = 4*width*height;
+        compressed = etcBytes(width, height);
+        current += rgba;
+        converted += compressed;
+        printf("%-48s %10zu RGBA  %10zu as ETC2\n", path.c_str(), rgba, compressed);
+        return true;
+    }
+
+    std::shared_ptr<CompressedImage> image = CompressedImage::allocWithData(data.data(), data.size());
+    if (image == nullptr) {
+        printf("%-48s cannot be read\n", path.c_str());
+        return false;
+    }
+    for(size_t level = 0; level < image->getLevelCount(); level++) {
+        size_t width  = std::max(image->getWidth()  >> level, 1);
+        size_t height = std::max(image->getHeight() >> level, 1);
+        rgba += 4*width*height;
+    }
+    compressed = image->getByteSize();
+    current += compressed;
+    converted += compressed;
+    printf("%-48s %10zu KTX   %10zu as RGBA\n", path.c_str(), compressed, rgba);
+    return true;
+}
+
+/**
+ * Checks the decoder and reports the memory of the files on the command line.
+ */
+int main(int argc, char** argv) {
+    bool ok = checkDecoder();
+    if (argc > 1) {
+        size_t current = 0;
+        size_t converted = 0;
+        for(int ii = 1; ii < argc; ii++) {
+            ok = measure(argv[ii], current, converted) && ok;
+        }
+        printf("total: %zu bytes now, %zu bytes with every file compressed\n", current, converted);
+    }
+    return ok ? 0 : 1;
+}